@@ -0,0 +1,209 @@
+/******************************************************************************
+ * File:    arena.c
+ * Author:  Doron Shvartztuch
+ * The ARENA module provides a simple memory allocator. The memory is
+ * allocated from big blocks, and it is freed all at once when the arena
+ * itself is freed.
+ *
+ * Implementation:
+ * The arena keeps a linked list of blocks. Allocations are taken from the
+ * free space at the end of the current block (bump allocation). When there
+ * is not enough space, a new block is allocated. Big requests get a block of
+ * their own, so we don't waste the space left in the current block.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include "helper.h"
+#include "arena.h"
+#include "stats.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The size (in bytes) of the data in a regular block */
+#define ARENA_BLOCK_SIZE 0x4000
+
+/* Requests bigger than this size (in bytes) get a block of their own */
+#define ARENA_MAX_SMALL_ALLOCATION (ARENA_BLOCK_SIZE / 4)
+
+/* Round the size up, so the next allocation will be aligned as well */
+#define ARENA_ALIGN_SIZE(nSize)                                         \
+    (((nSize) + sizeof(ARENA_ALIGNMENT) - 1)                            \
+     / sizeof(ARENA_ALIGNMENT) * sizeof(ARENA_ALIGNMENT))
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The union has the strictest alignment of the basic types, so it is used
+ * to align the allocated memory */
+typedef union ARENA_ALIGNMENT {
+    long lLong;
+    double dDouble;
+    void * pvPointer;
+} ARENA_ALIGNMENT;
+
+/* A block of memory. The data of the block follows the header */
+typedef struct ARENA_BLOCK {
+    
+    /* The previous block in the list */
+    struct ARENA_BLOCK * ptPrev;
+    
+    /* Make sure the data after the header is aligned */
+    ARENA_ALIGNMENT atData[];
+} ARENA_BLOCK, *PARENA_BLOCK;
+
+/* ARENA is the struct behind the the HARENA. */
+struct ARENA {
+    
+    /* The last allocated block. New allocations are taken from it */
+    PARENA_BLOCK ptCurrentBlock;
+    
+    /* Used bytes in the data of the current block */
+    int nUsed;
+    
+    /* Size (in bytes) of the data of the current block */
+    int nSize;
+};
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static GLOB_ERROR arena_AddBlock(HARENA hArena, int nSize);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    arena_AddBlock
+ * Purpose: allocate a new block and make it the current block
+ * Parameters:
+ *          hArena [IN] - the handle to the arena
+ *          nSize [IN] - size (in bytes) of the data of the block
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR arena_AddBlock(HARENA hArena, int nSize) {
+    PARENA_BLOCK ptBlock = NULL;
+    
+    STATS_CountAllocation(STATS_MODULE_ARENA, sizeof(*ptBlock) + nSize);
+    ptBlock = malloc(sizeof(*ptBlock) + nSize);
+    if (NULL == ptBlock) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    ptBlock->ptPrev = hArena->ptCurrentBlock;
+    hArena->ptCurrentBlock = ptBlock;
+    hArena->nUsed = 0;
+    hArena->nSize = nSize;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    ARENA_Create
+ *****************************************************************************/
+GLOB_ERROR ARENA_Create(PHARENA phArena) {
+    HARENA hArena = NULL;
+    
+    /* Check parameters. */
+    if (NULL == phArena) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Allocate the handle. The first block is allocated on demand. */
+    STATS_CountAllocation(STATS_MODULE_ARENA, sizeof(*hArena));
+    hArena = malloc(sizeof(*hArena));
+    if (NULL == hArena) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    hArena->ptCurrentBlock = NULL;
+    hArena->nUsed = 0;
+    hArena->nSize = 0;
+    
+    /* Set out parameter */
+    *phArena = hArena;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    ARENA_Alloc
+ *****************************************************************************/
+GLOB_ERROR ARENA_Alloc(HARENA hArena, int nSize, void ** ppvMemory) {
+    PARENA_BLOCK ptBigBlock = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == hArena || NULL == ppvMemory || nSize < 0) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    nSize = ARENA_ALIGN_SIZE(nSize);
+    
+    /* Big requests get their own block. We put it behind the current block,
+     * so we can continue to allocate from the current block. */
+    if (nSize > ARENA_MAX_SMALL_ALLOCATION) {
+        STATS_CountAllocation(STATS_MODULE_ARENA, sizeof(*ptBigBlock) + nSize);
+        ptBigBlock = malloc(sizeof(*ptBigBlock) + nSize);
+        if (NULL == ptBigBlock) {
+            return GLOB_ERROR_SYS_CALL_ERROR();
+        }
+        if (NULL == hArena->ptCurrentBlock) {
+            ptBigBlock->ptPrev = NULL;
+            hArena->ptCurrentBlock = ptBigBlock;
+            hArena->nUsed = nSize;
+            hArena->nSize = nSize;
+        } else {
+            ptBigBlock->ptPrev = hArena->ptCurrentBlock->ptPrev;
+            hArena->ptCurrentBlock->ptPrev = ptBigBlock;
+        }
+        *ppvMemory = ptBigBlock->atData;
+        return GLOB_SUCCESS;
+    }
+    
+    /* Check if there is enough space in the current block */
+    if (NULL == hArena->ptCurrentBlock
+            || hArena->nSize - hArena->nUsed < nSize) {
+        eRetValue = arena_AddBlock(hArena, ARENA_BLOCK_SIZE);
+        if (eRetValue) {
+            return eRetValue;
+        }
+    }
+    
+    /* Take the memory from the free space of the current block */
+    *ppvMemory = (char *)hArena->ptCurrentBlock->atData + hArena->nUsed;
+    hArena->nUsed += nSize;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    ARENA_Free
+ *****************************************************************************/
+void ARENA_Free(HARENA hArena) {
+    PARENA_BLOCK ptBlockToFree = NULL;
+    
+    if (NULL == hArena) {
+        return;
+    }
+    
+    /* Free all blocks */
+    while (NULL != hArena->ptCurrentBlock) {
+        ptBlockToFree = hArena->ptCurrentBlock;
+        hArena->ptCurrentBlock = ptBlockToFree->ptPrev;
+        free(ptBlockToFree);
+    }
+    free(hArena);
+}
@@ -0,0 +1,63 @@
+/******************************************************************************
+ * File:    arena.h
+ * Author:  Doron Shvartztuch
+ * The ARENA module provides a simple memory allocator. The memory is
+ * allocated from big blocks, and it is freed all at once when the arena
+ * itself is freed.
+ *****************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "global.h"
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The HARENA represents a handle to an arena.
+ * Always free the arena with the ARENA_Free function */
+typedef struct ARENA ARENA, *HARENA, **PHARENA;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    ARENA_Create
+ * Purpose: Create a new arena
+ * Parameters:
+ *          phArena [OUT] - the handle to the created arena
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR ARENA_Create(PHARENA phArena);
+
+/******************************************************************************
+ * Name:    ARENA_Alloc
+ * Purpose: Allocate memory from the arena
+ * Parameters:
+ *          hArena [IN] - the handle to the arena
+ *          nSize [IN] - size (in bytes) of the memory to allocate
+ *          ppvMemory [OUT] - pointer to the allocated memory
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  The memory is suitably aligned for any type. It is valid until
+ *          the call to ARENA_Free and can't be freed separately.
+ *****************************************************************************/
+GLOB_ERROR ARENA_Alloc(HARENA hArena, int nSize, void ** ppvMemory);
+
+/******************************************************************************
+ * Name:    ARENA_Free
+ * Purpose: Free the arena and all the memory allocated from it
+ * Parameters:
+ *          hArena [IN] - the handle to the arena
+ *****************************************************************************/
+void ARENA_Free(HARENA hArena);
+
+#endif /* ARENA_H */
@@ -6,10 +6,24 @@
  * Implementation:
  * The ASM modules uses LEX to read the source file and parse it into tokens.
  * It goes over the tokens, checks the grammar and create the binary code.
- * In the first phase, we get the tokens and build binary code(including data)
- * except the operands. Labels are inserted into the symbols table.
- * In the second phase, we already have all symbols in the table, so we can
- * build the binary code of the operands.
+ * The file is compiled in one pass: we get the tokens and build the binary
+ * code (including data and operands). Labels are inserted into the symbols
+ * table.
+ * The labels are identified by the ids of their names, which LEX gets from
+ * a table of names (see INTERN) of the file.
+ * The binary code and data are written to two streams. An operand that uses
+ * a label which is not defined yet (or a data/external label, whose address
+ * is known only after the pass) gets a zero word and a fixup: the index of
+ * the word and the id of the label name. After the pass, the symbols table is
+ * finalized and we go over the fixups to fill these words.
+ * With more than one thread, a large source in memory is split at the
+ * beginning of lines into parts, and each thread runs the first phase on its
+ * part, with its own names, counters, streams and fixups. A part doesn't see
+ * the symbols of the parts before it, so it keeps the label definitions,
+ * extern/entry statements and messages as actions. The parts are merged in
+ * the order of the source: the names are added to the names of the file, the
+ * actions are replayed with the counters and lines of the file, and the
+ * fixups and streams are appended, so the result is the sequential result.
  *****************************************************************************/
 
 /******************************************************************************
@@ -19,14 +33,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <pthread.h>
 #include "helper.h"
 #include "global.h"
 #include "lex.h"
 #include "linestr.h"
+#include "intern.h"
 #include "symtable.h"
 #include "buffer.h"
 #include "memstream.h"
 #include "asm.h"
+#include "stats.h"
 
 /******************************************************************************
  * CONSTANTS & MACROS
@@ -37,88 +54,43 @@
  * we actually have 3 operands (the label and the 2 parameters). */
 #define ASM_MAX_OPERANDS 3
 
-/* The next macros uses the g_szAllowedOperands to retrieve information
- * about opcodes in the language. See documentation next
- * to g_szAllowedOperands definition. */
+/* Each number of .data statement takes at least 2 chars (digit and comma),
+ * so this is the maximum numbers in a statement */
+#define ASM_MAX_DATA_NUMBERS (LINESTR_MAX_LINE_LENGTH / 2)
 
-/* True if this opcode expect source operand (= 2-operand opcode) */
-#define ASM_HAS_SOURCE_OPERAND(opcode) (g_znAllowedOperands[opcode] & 0xF0)
+/* The default size (in fixups) of the fixups array */
+#define ASM_DEFAULT_FIXUPS 64
+#define ASM_FIXUPS_EXPAND_FACTOR 2
 
-/* Get the allowed methods for the source operand of this opcode */
-#define ASM_GET_ALLOWED_SOURCE_OPERAND(opcode) ((g_znAllowedOperands[opcode] \
-                                                 & 0xF0) >> 4)
+/* The estimated number of source chars for each word of the code (and of
+ * the data). The code and data streams are allocated by this estimation
+ * before the first phase. */
+#define ASM_SOURCE_CHARS_PER_WORD 8
 
-/* True if this opcode expect destination operand (= 1 or 2-operand opcode) */
-#define ASM_HAS_DESTINATION_OPERAND(opcode) (g_znAllowedOperands[opcode] & 0x0F)
+/* The minimum length (in chars) of a part of the source that is compiled by
+ * its own thread. Smaller sources are compiled by one thread. */
+#define ASM_MIN_PART_LENGTH (64 * 1024)
 
-/* Get the allowed methods for the destination operand of this opcode */
-#define ASM_GET_ALLOWED_DESTINATION_OPERAND(opcode) \
-                                        ASM_HAS_DESTINATION_OPERAND(opcode)
+/* The default size (in actions) of the actions array of a part */
+#define ASM_DEFAULT_ACTIONS 64
+#define ASM_ACTIONS_EXPAND_FACTOR 2
 
-/* Check whether the specified method is allowed. the parameter should be
- * the result of either  ASM_GET_ALLOWED_SOURCE_OPERAND or 
- * ASM_GET_ALLOWED_DESTINATION_OPERAND.*/
-#define ASM_IS_IMMEDIATE_OPERAND_ALLOWED(operand)   ((operand) & 0x1)
-#define ASM_IS_DIRECT_OPERAND_ALLOWED(operand)      ((operand) & 0x2)
-#define ASM_IS_PARAMETER_OPERAND_ALLOWED(operand)   ((operand) & 0x4)
-#define ASM_IS_REGISTER_OPERAND_ALLOWED(operand)    ((operand) & 0x8)
-
-/* The allowed operands method for each of the parameters in the
- * "jump with parameters" operand method. See documentation next to
- * g_znAllowedOperands for more information. */
-#define ASM_ALLOWED_OPERANDS_AS_PARAM               0xB
-
-/* Create the first binary word of the statement (opcode).
- * the ARE are always absolute. We shift left the parameters to their location*/
-#define ASM_COMBINE_FIRST_WORD(eParam1, eParam2, eOpcode, eSource, eDest) \
-    ((eParam1)<<12 | (eParam2)<<10 | (eOpcode)<<6 | (eSource)<<4          \
-    | (eDest)<<2 | (ASM_ARE_ABSOLUTE))
-
-#define ASM_COMBINE_IMMEDIATE_WORD(value) \
-    (((value) << 2) | ASM_ARE_ABSOLUTE) 
-
-#define ASM_COMBINE_DIRECT_WORD(value) \
-    (((value) << 2) | ASM_ARE_RELOCATABLE) 
-
-#define ASM_COMBINE_EXTERNAL_WORD ASM_ARE_EXTERNAL
-
-#define ASM_COMBINE_REGISTER_WORD(nSource, nDest) \
-    (((nSource) << 8) | ((nDest) << 2) | ASM_ARE_ABSOLUTE) 
+/* The maximum length of a message of a part (with the null-terminator) */
+#define ASM_MAX_MESSAGE_LENGTH 256
 
 /******************************************************************************
  * TYPEDEFS
  *****************************************************************************/
 
-/* enum of the operand methods exist in the language */
-typedef enum ASM_OPERAND_METHOD {
-    ASM_OPERAND_METHOD_IMMEDIATE = 0,
-    ASM_OPERAND_METHOD_DIRECT = 1,
-    ASM_OPERAND_METHOD_PARAMETERS = 2,
-    ASM_OPERAND_METHOD_REGISTER = 3,
-} ASM_OPERAND_METHOD;
-
-/* enum of values of the ARE bits in the first word */
-typedef enum ASM_ARE {
-    ASM_ARE_ABSOLUTE = 0,
-    ASM_ARE_EXTERNAL = 1,
-    ASM_ARE_RELOCATABLE = 2,
-} ASM_ARE;
-
-/* Linked list. Each element represent a line (statement) in the source file */
+/* Represent a line (statement) in the source file */
 typedef struct ASM_LINE {
     
-    /* Stream that contain the binary code of this line*/
-    HMEMSTREAM hStream;
-    
     /* Array of the tokens of the operands */
     PLEX_TOKEN aptOperands[ASM_MAX_OPERANDS];
     
     /* Number of used elements in aptOperands*/
     int nOperandsLength;
     
-    /* The instruction/data counter. the address of the first word*/
-    int nCounter;
-    
     /* The length (in words) of this statement */
     int nLength;
     
@@ -133,26 +105,90 @@ typedef struct ASM_LINE {
     /* The operand method of the source and destination param*/
     ASM_OPERAND_METHOD eSourceParam;
     ASM_OPERAND_METHOD eDestParam;
-    
-    /* pointer to the next line */
-    struct ASM_LINE * ptNext;
 } ASM_LINE, *PASM_LINE;
 
+/* A word of an operand that is filled after the symbols table is finalized */
+typedef struct ASM_FIXUP {
+    
+    /* The index of the word in the code stream */
+    int nWordIndex;
+    
+    /* The id of the label name */
+    int nNameId;
+    
+    /* True for the first fixup of a statement */
+    BOOL bStartsStatement;
+} ASM_FIXUP, *PASM_FIXUP;
+
+/* The kinds of the actions of a part, which are replayed on the file */
+typedef enum ASM_ACTION_KIND {
+    ASM_ACTION_KIND_MESSAGE,
+    ASM_ACTION_KIND_LABEL,
+    ASM_ACTION_KIND_EXTERN,
+    ASM_ACTION_KIND_ENTRY,
+} ASM_ACTION_KIND;
+
+/* An error/warning of a part (the arguments of the errors callback) */
+typedef struct ASM_MESSAGE {
+    const char * pszFileName;
+    
+    /* The line in the part (0 if the message isn't of a line) */
+    int nLine;
+    int nColumn;
+    BOOL bHasSourceLine;
+    char szSourceLine[LINESTR_MAX_LINE_LENGTH];
+    BOOL bIsError;
+    char szMessage[ASM_MAX_MESSAGE_LENGTH];
+} ASM_MESSAGE, *PASM_MESSAGE;
+
+/* A message, or a change of the symbols table, of a part */
+typedef struct ASM_ACTION {
+    ASM_ACTION_KIND eKind;
+    
+    /* The message (MESSAGE only) */
+    PASM_MESSAGE ptMessage;
+    
+    /* The token of the label, with a reference to its line */
+    LEX_TOKEN tToken;
+    
+    /* The type and the address in the part (LABEL only) */
+    SYMTABLE_SYMTYPE eType;
+    int nAddress;
+} ASM_ACTION, *PASM_ACTION;
+
+/* A part of the source that is compiled by a thread */
+typedef struct ASM_PART {
+    /* The handle that compiles the part */
+    HASM_FILE hPart;
+    
+    /* The thread, and whether it was started */
+    pthread_t tThread;
+    BOOL bIsThreadStarted;
+    
+    /* The statistics of the thread (if they are collected) */
+    BOOL bCollectStats;
+    STATS tStats;
+    
+    /* The result of the first phase of the part */
+    GLOB_ERROR eRetValue;
+} ASM_PART, *PASM_PART;
+
 struct ASM_FILE {
     /* Handle to the LEX "instance" that parse the file. */
     HLEX_FILE hLex;
-
+    
     /* Callback function and a context for errors/warnings reporting */
     GLOB_ERRORCALLBACK pfnErrorsCallback;
     void * pvErrorsCallbackContext;
-
-    /* Handle to the symbols table */
+    
+    /* The names of the labels and the symbols table */
+    HINTERN_TABLE hNames;
     HSYMTABLE_TABLE hSymTable;
     
     /* Buffers that contain the content of the externals and entries files */
     HBUFFER hExternalsStream;
     HBUFFER hEntriesStream;
-
+    
     /* Flags to set when the relevant buffer has content */
     BOOL bHaveExternals;
     BOOL bHaveEntries;
@@ -164,10 +200,35 @@ struct ASM_FILE {
     /* Flag to set in case we have compilation errors */
     BOOL bHasErrors;
     
-    /* Pointers to the first element and the last element in the
-     * one-way linked list of the lines */
-    PASM_LINE ptFirstLine;
-    PASM_LINE ptLastLine;
+    /* The binary code and data of the file */
+    HMEMSTREAM hCodeStream;
+    HMEMSTREAM hDataStream;
+    
+    /* Dynamic array of the operand words to fill after the first phase */
+    PASM_FIXUP patFixups;
+    int nFixups;
+    int nAllocatedFixups;
+    
+    /* The tokens of the current line, and the index of the next token */
+    LEX_LINE tTokens;
+    int nNextToken;
+    
+    /* The number of lines that were read, and the number to add to the line
+     * numbers of the messages (the lines before the part that is merged) */
+    int nLines;
+    int nLineOffset;
+    
+    /* TRUE if the handle compiles a part of the source. The messages and the
+     * changes of the symbols table of a part are kept as actions, so they
+     * are replayed on the file in the order of the source. */
+    BOOL bIsPart;
+    PASM_ACTION patActions;
+    int nActions;
+    int nAllocatedActions;
+    
+    /* The first failure to keep a message of the part (the errors callback
+     * can't return it) */
+    GLOB_ERROR eMessagesError;
 };
 
 /******************************************************************************
@@ -180,6 +241,25 @@ static void asm_ReportError(HASM_FILE hFile,
                             PLEX_TOKEN ptToken,
                             const char * pszErrorFormat,
                             ...);
+static GLOB_ERROR asm_ReadNextToken(HASM_FILE hFile, PLEX_TOKEN * pptToken);
+static GLOB_ERROR asm_AddAction(HASM_FILE hFile, PASM_ACTION * pptAction);
+static void asm_PartErrorsCallback(void * pvContext,
+                                   const char * pszFileName,
+                                   int nLine,
+                                   int nColumn,
+                                   const char * pszSourceLine,
+                                   BOOL bIsError,
+                                   const char * pszErrorFormat,
+                                   va_list vaArgs);
+static void asm_ReportPartMessage(HASM_FILE hFile,
+                                  PASM_MESSAGE ptMessage,
+                                  const char * pszErrorFormat,
+                                  ...);
+static GLOB_ERROR asm_DefineSymbol(HASM_FILE hFile,
+                                   ASM_ACTION_KIND eKind,
+                                   PLEX_TOKEN ptToken,
+                                   SYMTABLE_SYMTYPE eType,
+                                   int nAddress);
 static GLOB_ERROR asm_FirstPhaseCompileString(HASM_FILE hFile,PASM_LINE ptLine);
 static GLOB_ERROR asm_FirstPhaseCompileData(HASM_FILE hFile, PASM_LINE ptLine);
 static GLOB_ERROR asm_FirstPhaseCompileExtern(HASM_FILE hFile,PASM_LINE ptLine);
@@ -198,6 +278,12 @@ static GLOB_ERROR asm_FirstPhaseCompileSourceOperand(HASM_FILE hFile,
 static GLOB_ERROR asm_FirstPhaseCompileDestinationOperand(HASM_FILE hFile,
                                                           GLOB_OPCODE eOpcode,
                                                           PASM_LINE ptLine);
+static GLOB_ERROR asm_AddFixup(HASM_FILE hFile,
+                               int nWordIndex,
+                               int nNameId,
+                               BOOL bStartsStatement);
+static GLOB_ERROR asm_FirstPhaseCompileOperands(HASM_FILE hFile,
+                                                PASM_LINE ptLine);
 static GLOB_ERROR asm_FirstPhaseCompileOpcode(HASM_FILE hFile,
                                               GLOB_OPCODE eOpcode,
                                               PASM_LINE ptLine);
@@ -208,13 +294,29 @@ static GLOB_ERROR asm_FirstPhaseCompileNonEmptyLine(HASM_FILE hFile,
                                                     PLEX_TOKEN ptToken);
 static GLOB_ERROR asm_FirstPhaseCompileLine(HASM_FILE hFile);
 static GLOB_ERROR asm_FirstPhase(HASM_FILE hFile);
-static GLOB_ERROR asm_SecondPhaseCompileLine(HASM_FILE hFile, PASM_LINE ptLine);
-static GLOB_ERROR asm_SecondPhase(HASM_FILE hFile);
+static GLOB_ERROR asm_CreateStreams(HASM_FILE hFile);
+static GLOB_ERROR asm_CreatePart(HASM_FILE hFile,
+                                 size_t nOffset,
+                                 size_t nLength,
+                                 PHASM_FILE phPart);
+static void * asm_PartThread(void * pvPart);
+static GLOB_ERROR asm_MergePart(HASM_FILE hFile, HASM_FILE hPart);
+static GLOB_ERROR asm_FirstPhaseInParallel(HASM_FILE hFile, int nParts);
+static GLOB_ERROR asm_AppendSymbolRecord(HBUFFER hStream,
+                                         const char * pszName,
+                                         int nAddress);
+static GLOB_ERROR asm_ResolveFixups(HASM_FILE hFile);
 static GLOB_ERROR asm_SymTableForEachCallback(const char * pszName,
                                               int nAddress, 
                                               BOOL bIsMarkedForExport,
                                               void * pContext);
 static GLOB_ERROR asm_PrepareEntries(HASM_FILE hFile);
+static GLOB_ERROR asm_Create(GLOB_ERRORCALLBACK pfnErrorsCallback,
+                             void * pvContext,
+                             PHASM_FILE phFile);
+static GLOB_ERROR asm_Compile(HASM_FILE hFile,
+                              int nThreads,
+                              PHASM_FILE phFile);
 
 /******************************************************************************
  * CONSTANTS
@@ -260,6 +362,13 @@ const int g_znAllowedOperands[] =
   0x00  /* |   stop   |  0  |  0  |  0  |  0  |  0  |  0  |  0  |  0  | */
 };      /* |----------|-----|-----|-----|-----|-----|-----|-----|-----| */
 
+/* The names of the opcodes, by their code. The tools print the opcodes with
+ * it (the lexer has its own hash table of the keywords). */
+const char * const g_aszOpcodeNames[GLOB_OPCODE_STOP + 1] = {
+    "mov", "cmp", "add", "sub", "not", "clr", "lea", "inc",
+    "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "stop"
+};
+
 /******************************************************************************
  * INTERNAL FUNCTIONS
  *****************************************************************************/
@@ -277,21 +386,257 @@ const int g_znAllowedOperands[] =
 static void asm_ReportError(HASM_FILE hFile, BOOL bIsError, PLEX_TOKEN ptToken,
                             const char * pszErrorFormat, ...) {
     va_list vaArgs;
+    char szLine[LINESTR_MAX_LINE_LENGTH];
     
     if (bIsError) {
         hFile->bHasErrors = TRUE;
     }
+    if (NULL != ptToken) {
+        /* The source line isn't null-terminated, so copy it */
+        LINESTR_CopyLine(ptToken->ptLine, szLine);
+    }
     va_start (vaArgs, pszErrorFormat);
     /* Call the callback function with the relevant arguments*/
     hFile->pfnErrorsCallback(hFile->pvErrorsCallbackContext,
         NULL == ptToken ? "" : LINESTR_GetFullFileName(ptToken->ptLine->hFile),
-        NULL == ptToken ? 0 : ptToken->ptLine->nLineNumber,
+        NULL == ptToken ? 0 : ptToken->ptLine->nLineNumber+hFile->nLineOffset,
         NULL == ptToken ? 0 : ptToken->nColumn+1,
-        NULL == ptToken ? NULL : ptToken->ptLine->szLine,
+        NULL == ptToken ? NULL : szLine,
         bIsError, pszErrorFormat, vaArgs);
     va_end (vaArgs);
 }
 
+/******************************************************************************
+ * Name:    asm_ReadNextToken
+ * Purpose: get the next token of the current line
+ * Parameters:
+ *          hFile [IN] - handle to the current file
+ *          pptToken [OUT] - the token. It is valid until the line is freed.
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          After the end of line, the end of line token is returned again.
+ *          GLOB_ERROR_PARSING_FAILED if the token can't be parsed. The error
+ *          of the lexer is reported when we get to the token, so the errors
+ *          are reported in the order of the line.
+ *****************************************************************************/
+static GLOB_ERROR asm_ReadNextToken(HASM_FILE hFile, PLEX_TOKEN * pptToken) {
+    PLEX_LINE ptTokens = &hFile->tTokens;
+    PLEX_TOKEN ptToken = NULL;
+    
+    if (hFile->nNextToken == ptTokens->nTokens) {
+        /* The tokens stopped before a token that can't be parsed */
+        return LEX_ReportLineError(hFile->hLex, ptTokens);
+    }
+    ptToken = &ptTokens->atTokens[hFile->nNextToken];
+    if (LEX_TOKEN_KIND_END_OF_LINE != ptToken->eKind) {
+        hFile->nNextToken++;
+    }
+    *pptToken = ptToken;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    asm_AddAction
+ * Purpose: add an action at the end of the actions array of a part
+ * Parameters:
+ *          hFile [IN] - handle to the part
+ *          pptAction [OUT] - the added action, for the caller to fill
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR asm_AddAction(HASM_FILE hFile, PASM_ACTION * pptAction) {
+    PASM_ACTION patNewActions = NULL;
+    int nNewAllocatedActions = 0;
+    
+    /* Expand the array if it is full */
+    if (hFile->nActions == hFile->nAllocatedActions) {
+        nNewAllocatedActions = MAX(ASM_DEFAULT_ACTIONS,
+                          hFile->nAllocatedActions * ASM_ACTIONS_EXPAND_FACTOR);
+        STATS_CountAllocation(STATS_MODULE_ASM,
+                              nNewAllocatedActions * sizeof(*patNewActions));
+        patNewActions = realloc(hFile->patActions,
+                                nNewAllocatedActions * sizeof(*patNewActions));
+        if (NULL == patNewActions) {
+            return GLOB_ERROR_SYS_CALL_ERROR();
+        }
+        hFile->patActions = patNewActions;
+        hFile->nAllocatedActions = nNewAllocatedActions;
+    }
+    
+    *pptAction = &hFile->patActions[hFile->nActions];
+    hFile->nActions++;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    asm_PartErrorsCallback
+ * Purpose: errors callback of a part (see GLOB_ERRORCALLBACK). It keeps the
+ *          message as an action, to report it when the part is merged.
+ * Parameters:
+ *          pvContext [IN] - the handle to the part
+ *          (the other parameters are of GLOB_ERRORCALLBACK)
+ *****************************************************************************/
+static void asm_PartErrorsCallback(void * pvContext,
+                                   const char * pszFileName,
+                                   int nLine,
+                                   int nColumn,
+                                   const char * pszSourceLine,
+                                   BOOL bIsError,
+                                   const char * pszErrorFormat,
+                                   va_list vaArgs) {
+    HASM_FILE hPart = (HASM_FILE)pvContext;
+    PASM_MESSAGE ptMessage = NULL;
+    PASM_ACTION ptAction = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Keep the first failure only */
+    if (hPart->eMessagesError) {
+        return;
+    }
+    
+    STATS_CountAllocation(STATS_MODULE_ASM, sizeof(*ptMessage));
+    ptMessage = malloc(sizeof(*ptMessage));
+    if (NULL == ptMessage) {
+        hPart->eMessagesError = GLOB_ERROR_SYS_CALL_ERROR();
+        return;
+    }
+    ptMessage->pszFileName = pszFileName;
+    ptMessage->nLine = nLine;
+    ptMessage->nColumn = nColumn;
+    ptMessage->bHasSourceLine = (NULL != pszSourceLine);
+    if (NULL != pszSourceLine) {
+        strncpy(ptMessage->szSourceLine, pszSourceLine,
+                sizeof(ptMessage->szSourceLine) - 1);
+        ptMessage->szSourceLine[sizeof(ptMessage->szSourceLine) - 1] = '\0';
+    }
+    ptMessage->bIsError = bIsError;
+    vsnprintf(ptMessage->szMessage, sizeof(ptMessage->szMessage),
+              pszErrorFormat, vaArgs);
+    
+    eRetValue = asm_AddAction(hPart, &ptAction);
+    if (eRetValue) {
+        free(ptMessage);
+        hPart->eMessagesError = eRetValue;
+        return;
+    }
+    ptAction->eKind = ASM_ACTION_KIND_MESSAGE;
+    ptAction->ptMessage = ptMessage;
+}
+
+/******************************************************************************
+ * Name:    asm_ReportPartMessage
+ * Purpose: Report a message of a part that is merged into the file
+ * Parameters:
+ *          hFile [IN] - handle to the file
+ *          ptMessage [IN] - the message
+ *          pszErroFormat[IN] - the format of the message ("%s")
+ *          ... [IN] - the text of the message
+ *****************************************************************************/
+static void asm_ReportPartMessage(HASM_FILE hFile,
+                                  PASM_MESSAGE ptMessage,
+                                  const char * pszErrorFormat,
+                                  ...) {
+    va_list vaArgs;
+    
+    if (ptMessage->bIsError) {
+        hFile->bHasErrors = TRUE;
+    }
+    va_start (vaArgs, pszErrorFormat);
+    hFile->pfnErrorsCallback(hFile->pvErrorsCallbackContext,
+        ptMessage->pszFileName,
+        0 == ptMessage->nLine ? 0 : ptMessage->nLine + hFile->nLineOffset,
+        ptMessage->nColumn,
+        ptMessage->bHasSourceLine ? ptMessage->szSourceLine : NULL,
+        ptMessage->bIsError, pszErrorFormat, vaArgs);
+    va_end (vaArgs);
+}
+
+/******************************************************************************
+ * Name:    asm_DefineSymbol
+ * Purpose: change the symbols table by a label of a statement: define the
+ *          label, or mark it as extern/entry
+ * Parameters:
+ *          hFile [IN] - handle to the current file
+ *          eKind [IN] - the change (LABEL, EXTERN or ENTRY)
+ *          ptToken [IN] - the token of the label
+ *          eType [IN] - the type of the label (LABEL only)
+ *          nAddress [IN] - the address of the label (LABEL only)
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_PARSING_FAILED if the label can't be an extern/entry.
+ *          If the function fails, an error code is returned.
+ * Remark:  A duplicate label is reported, and the line is compiled.
+ *          In a part, the change is kept as an action (see asm_MergePart).
+ *****************************************************************************/
+static GLOB_ERROR asm_DefineSymbol(HASM_FILE hFile,
+                                   ASM_ACTION_KIND eKind,
+                                   PLEX_TOKEN ptToken,
+                                   SYMTABLE_SYMTYPE eType,
+                                   int nAddress) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    PASM_ACTION ptAction = NULL;
+    
+    if (hFile->bIsPart) {
+        /* The symbols are known only when the parts before are merged */
+        eRetValue = asm_AddAction(hFile, &ptAction);
+        if (eRetValue) {
+            return eRetValue;
+        }
+        ptAction->eKind = eKind;
+        ptAction->ptMessage = NULL;
+        ptAction->tToken = *ptToken;
+        ptAction->eType = eType;
+        ptAction->nAddress = nAddress;
+        LINESTR_LineAddRef(ptToken->ptLine);
+        return GLOB_SUCCESS;
+    }
+    
+    switch (eKind) {
+        case ASM_ACTION_KIND_LABEL:
+            eRetValue = SYMTABLE_Insert(hFile->hSymTable,
+                    ptToken->uValue.nNameId, eType, nAddress, FALSE);
+            if (GLOB_ERROR_ALREADY_EXIST == eRetValue) {
+                asm_ReportError(hFile, TRUE, ptToken,
+                                "Duplicate label definition");
+                /* return with SUCCESS to continue parsing the line */
+                return GLOB_SUCCESS;
+            }
+            return eRetValue;
+        case ASM_ACTION_KIND_EXTERN:
+            eRetValue = SYMTABLE_Insert(hFile->hSymTable,
+                    ptToken->uValue.nNameId, SYMTABLE_SYMTYPE_CODE, 0, TRUE);
+            if (GLOB_ERROR_ALREADY_EXIST == eRetValue) {
+                asm_ReportError(hFile, TRUE, ptToken, "label already exist");
+                return GLOB_ERROR_PARSING_FAILED;
+            }
+            if (GLOB_ERROR_EXPORT_AND_EXTERN == eRetValue) {
+                asm_ReportError(hFile, TRUE, ptToken,
+                        "label already defined as entry");
+                return GLOB_ERROR_PARSING_FAILED;
+            }
+            return eRetValue;
+        case ASM_ACTION_KIND_ENTRY:
+            eRetValue = SYMTABLE_MarkForExport(hFile->hSymTable,
+                                               ptToken->uValue.nNameId);
+            if (GLOB_ERROR_EXPORT_AND_EXTERN == eRetValue) {
+                /* Same label can't be defined both extern and entry */
+                asm_ReportError(hFile, TRUE, ptToken,
+                        "label already defined as extern");
+                return GLOB_ERROR_PARSING_FAILED;
+            }
+            if (GLOB_ERROR_ALREADY_EXIST == eRetValue) {
+                /* Same label can't be defined both extern and entry */
+                asm_ReportError(hFile, TRUE, ptToken,
+                        "label already defined as entry");
+                return GLOB_ERROR_PARSING_FAILED;
+            }
+            return GLOB_SUCCESS;
+        default:
+            return GLOB_ERROR_UNKNOWN;
+    }
+}
+
 /******************************************************************************
  * Name:    asm_FirstPhaseCompileString
  * Purpose: parse the content of the .string statement
@@ -308,7 +653,7 @@ static GLOB_ERROR asm_FirstPhaseCompileString(HASM_FILE hFile,PASM_LINE ptLine){
     PLEX_TOKEN ptStringToken = NULL;
     
     /* Read the string token */
-    eRetValue = LEX_ReadNextToken(hFile->hLex, &ptStringToken);
+    eRetValue = asm_ReadNextToken(hFile, &ptStringToken);
     if (eRetValue) {
         return eRetValue;
     }
@@ -316,16 +661,14 @@ static GLOB_ERROR asm_FirstPhaseCompileString(HASM_FILE hFile,PASM_LINE ptLine){
     /* Check the token type */
     if (ptStringToken->eKind != LEX_TOKEN_KIND_STRING) {
         asm_ReportError(hFile, TRUE, ptStringToken, "String is expected");
-        LEX_FreeToken(ptStringToken);
         return GLOB_ERROR_PARSING_FAILED;
     }
     
     /* The binary of .string statement is just the string (including '\0') */
-    eRetValue = MEMSTREAM_AppendString(ptLine->hStream,
+    eRetValue = MEMSTREAM_AppendString(hFile->hDataStream,
                                        ptStringToken->uValue.szStr);
     ptLine->nLength = strlen(ptStringToken->uValue.szStr)+1;
     ptLine->bIsData = TRUE;
-    LEX_FreeToken(ptStringToken);
     return eRetValue;
 }
 
@@ -343,31 +686,29 @@ static GLOB_ERROR asm_FirstPhaseCompileString(HASM_FILE hFile,PASM_LINE ptLine){
 static GLOB_ERROR asm_FirstPhaseCompileData(HASM_FILE hFile, PASM_LINE ptLine) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     PLEX_TOKEN ptToken = NULL;
+    int anNumbers[ASM_MAX_DATA_NUMBERS];
     
     ptLine->bIsData = TRUE;
     for (;;) {
         
         /* Read the next number*/
-        eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+        eRetValue = asm_ReadNextToken(hFile, &ptToken);
         if (eRetValue) {
             return eRetValue;
         }
-
+        
         /* Check the token type */
         if (ptToken->eKind != LEX_TOKEN_KIND_NUMBER) {
             asm_ReportError(hFile, TRUE, ptToken, "Number (data) is expected");
-            LEX_FreeToken(ptToken);
             return GLOB_ERROR_PARSING_FAILED;
         }
         
-        /* Write it to the binary */
-        eRetValue = MEMSTREAM_AppendNumber(ptLine->hStream,
-                                           ptToken->uValue.nNumber);
+        /* Keep it. The numbers are written to the binary together. */
+        anNumbers[ptLine->nLength] = ptToken->uValue.nNumber;
         ptLine->nLength++;
-        LEX_FreeToken(ptToken);
         
         /* Check if have a comma (to continue the data) */
-        eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+        eRetValue = asm_ReadNextToken(hFile, &ptToken);
         if (eRetValue) {
             return eRetValue;
         }
@@ -378,12 +719,13 @@ static GLOB_ERROR asm_FirstPhaseCompileData(HASM_FILE hFile, PASM_LINE ptLine) {
                 || ',' != ptToken->uValue.cChar) {
             asm_ReportError(hFile, TRUE, ptToken,
                     "comma or end of line expected");
-            LEX_FreeToken(ptToken);
             return GLOB_ERROR_PARSING_FAILED;
         }
     }
-    LEX_FreeToken(ptToken);    
-    return GLOB_SUCCESS;
+    
+    /* Write the numbers to the binary */
+    return MEMSTREAM_AppendNumbers(hFile->hDataStream,
+                                   anNumbers, ptLine->nLength);
 }
 
 /******************************************************************************
@@ -400,45 +742,29 @@ static GLOB_ERROR asm_FirstPhaseCompileData(HASM_FILE hFile, PASM_LINE ptLine) {
 static GLOB_ERROR asm_FirstPhaseCompileExtern(HASM_FILE hFile,PASM_LINE ptLine){
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     PLEX_TOKEN ptToken = NULL;
-
+    
     for (;;) {
         /* Read the label to define as extern */
-        eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+        eRetValue = asm_ReadNextToken(hFile, &ptToken);
         if (eRetValue) {
             return eRetValue;
         }
-
+        
         /* Check the type */
         if (ptToken->eKind != LEX_TOKEN_KIND_WORD) {
             asm_ReportError(hFile, TRUE, ptToken, "identifier is expected");
-            LEX_FreeToken(ptToken);
             return GLOB_ERROR_PARSING_FAILED;
         }
         
         /* Add to the symbols table*/
-        eRetValue = SYMTABLE_Insert(hFile->hSymTable, ptToken->uValue.szStr,
-                SYMTABLE_SYMTYPE_CODE, 0, TRUE);
-        if (GLOB_ERROR_ALREADY_EXIST == eRetValue) {
-            asm_ReportError(hFile, TRUE, ptToken, "label already exist");
-            LEX_FreeToken(ptToken);
-   
-            return GLOB_ERROR_PARSING_FAILED;
-        }
-        if (GLOB_ERROR_EXPORT_AND_EXTERN == eRetValue) {
-            asm_ReportError(hFile, TRUE, ptToken,
-                    "label already defined as entry");
-            LEX_FreeToken(ptToken);
-   
-            return GLOB_ERROR_PARSING_FAILED;
-        }
+        eRetValue = asm_DefineSymbol(hFile, ASM_ACTION_KIND_EXTERN, ptToken,
+                                     SYMTABLE_SYMTYPE_CODE, 0);
         if (eRetValue) {
-            LEX_FreeToken(ptToken);
             return eRetValue;
         }
-        LEX_FreeToken(ptToken);
-
+        
         /* Check if we have comma (more labels)*/
-        eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+        eRetValue = asm_ReadNextToken(hFile, &ptToken);
         if (eRetValue) {
             return eRetValue;
         }
@@ -448,11 +774,9 @@ static GLOB_ERROR asm_FirstPhaseCompileExtern(HASM_FILE hFile,PASM_LINE ptLine){
         if (LEX_TOKEN_KIND_SPECIAL != ptToken->eKind
                 || ',' != ptToken->uValue.cChar) {
             asm_ReportError(hFile,TRUE,ptToken,"comma or end of line expected");
-            LEX_FreeToken(ptToken);
             return GLOB_ERROR_PARSING_FAILED;
         }
     }
-    LEX_FreeToken(ptToken);
     hFile->bHaveExternals = TRUE;
     return GLOB_SUCCESS;
 }
@@ -471,42 +795,29 @@ static GLOB_ERROR asm_FirstPhaseCompileExtern(HASM_FILE hFile,PASM_LINE ptLine){
 static GLOB_ERROR asm_FirstPhaseCompileEntry(HASM_FILE hFile, PASM_LINE ptLine){
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     PLEX_TOKEN ptToken = NULL;
-
+    
     for (;;) {
         /* Read the label to define as extern */
-        eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+        eRetValue = asm_ReadNextToken(hFile, &ptToken);
         if (eRetValue) {
             return eRetValue;
         }
-
+        
         /* Check the type */
         if (ptToken->eKind != LEX_TOKEN_KIND_WORD) {
             asm_ReportError(hFile, TRUE, ptToken, "identifier is expected");
-            LEX_FreeToken(ptToken);
             return GLOB_ERROR_PARSING_FAILED;
         }
         
         /* Mark this label for export in the symbols table*/
-        eRetValue = SYMTABLE_MarkForExport(hFile->hSymTable,
-                                           ptToken->uValue.szStr);
-        if (GLOB_ERROR_EXPORT_AND_EXTERN == eRetValue) {
-            /* Same label can't be defined both extern and entry */
-            asm_ReportError(hFile, TRUE, ptToken,
-                    "label already defined as extern");
-            LEX_FreeToken(ptToken);
-            return GLOB_ERROR_PARSING_FAILED;
-        }
-        if (GLOB_ERROR_ALREADY_EXIST == eRetValue) {
-            /* Same label can't be defined both extern and entry */
-            asm_ReportError(hFile, TRUE, ptToken,
-                    "label already defined as entry");
-            LEX_FreeToken(ptToken);
-            return GLOB_ERROR_PARSING_FAILED;
+        eRetValue = asm_DefineSymbol(hFile, ASM_ACTION_KIND_ENTRY, ptToken,
+                                     SYMTABLE_SYMTYPE_CODE, 0);
+        if (eRetValue) {
+            return eRetValue;
         }
-        LEX_FreeToken(ptToken);
-
+        
         /* Check if we have comma (more labels)*/
-        eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+        eRetValue = asm_ReadNextToken(hFile, &ptToken);
         if (eRetValue) {
             return eRetValue;
         }
@@ -517,12 +828,10 @@ static GLOB_ERROR asm_FirstPhaseCompileEntry(HASM_FILE hFile, PASM_LINE ptLine){
                 || ',' != ptToken->uValue.cChar) {
             asm_ReportError(hFile, TRUE, ptToken,
                             "comma or end of line expected");
-            LEX_FreeToken(ptToken);
             return GLOB_ERROR_PARSING_FAILED;
         }
     }
     hFile->bHaveEntries = TRUE;
-    LEX_FreeToken(ptToken);
     return GLOB_SUCCESS;
 }
 
@@ -545,14 +854,13 @@ static GLOB_ERROR asm_FirstPhaseReadParameterOperand(HASM_FILE hFile,
     PLEX_TOKEN ptToken = NULL;
     
     /* Try to read the '(' */
-    eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+    eRetValue = asm_ReadNextToken(hFile, &ptToken);
     if (eRetValue) {
         return eRetValue;
     }
     if (LEX_TOKEN_KIND_END_OF_LINE == ptToken->eKind) {
         /* There is no parameters. we will stay with simple label */
         *bParametersRead = FALSE;
-        LEX_FreeToken(ptToken);
         return GLOB_SUCCESS;
     }
     
@@ -562,10 +870,8 @@ static GLOB_ERROR asm_FirstPhaseReadParameterOperand(HASM_FILE hFile,
             || (!(ptToken->eFlags & LEX_TOKEN_FLAGS_NO_SPACE_FROM_PREV_TOKEN))){
         asm_ReportError(hFile, TRUE, ptToken, 
                         "an end of line ot  '(' (withtout space) expected");
-        LEX_FreeToken(ptToken);
         return GLOB_ERROR_PARSING_FAILED;
     }
-    LEX_FreeToken(ptToken);
     
     /* Read the first parameter.
      * For this parameter we use the Param1 field */
@@ -577,7 +883,7 @@ static GLOB_ERROR asm_FirstPhaseReadParameterOperand(HASM_FILE hFile,
     }
     
     /* Read the comma (also here, space are not allowed) */
-    eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+    eRetValue = asm_ReadNextToken(hFile, &ptToken);
     if (eRetValue) {
         return eRetValue;
     }
@@ -585,11 +891,9 @@ static GLOB_ERROR asm_FirstPhaseReadParameterOperand(HASM_FILE hFile,
             || !(ptToken->eFlags & LEX_TOKEN_FLAGS_NO_SPACE_FROM_PREV_TOKEN)) {
         asm_ReportError(hFile, TRUE, ptToken,
                         "a ',' (without spaces) is expected");
-        LEX_FreeToken(ptToken);
         return GLOB_ERROR_PARSING_FAILED;
     }
-    LEX_FreeToken(ptToken);
-
+    
     /* Read the second parameter.
      * For this parameter we use the Param2 field */
     eRetValue = asm_FirstPhaseReadOperand(hFile, &ptLine->eParam2,
@@ -600,18 +904,17 @@ static GLOB_ERROR asm_FirstPhaseReadParameterOperand(HASM_FILE hFile,
     }
     
     /* Read the ')'. don't allow spaces */
-    eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+    eRetValue = asm_ReadNextToken(hFile, &ptToken);
     if (eRetValue) {
         return eRetValue;
     }
     if (LEX_TOKEN_KIND_SPECIAL != ptToken->eKind
             || ')' != ptToken->uValue.cChar) {
         asm_ReportError(hFile, TRUE, ptToken, "a ')' is expected");
-        LEX_FreeToken(ptToken);
         return GLOB_ERROR_PARSING_FAILED;
     }
-    LEX_FreeToken(ptToken);
-
+    
+    *bParametersRead = TRUE;
     return GLOB_SUCCESS;
 }
 /******************************************************************************
@@ -640,23 +943,21 @@ static GLOB_ERROR asm_FirstPhaseReadOperand(HASM_FILE hFile,
     PLEX_TOKEN ptToken = NULL;
     ASM_OPERAND_METHOD eMethod;
     BOOL bParametersRead = FALSE;
-
+    
     /* Read the operand */
-    eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+    eRetValue = asm_ReadNextToken(hFile, &ptToken);
     if (eRetValue) {
         return eRetValue;
     }
     if (LEX_TOKEN_KIND_END_OF_LINE == ptToken->eKind) {
         /* Operand is mandatory. */
         asm_ReportError(hFile, TRUE, ptToken, "an operand is expected");
-        LEX_FreeToken(ptToken);
         return GLOB_ERROR_PARSING_FAILED;
     }
     /* Check for white spaces limitation */
     if (!bAllowSpacesBeforeOperand
             && !(ptToken->eFlags & LEX_TOKEN_FLAGS_NO_SPACE_FROM_PREV_TOKEN)) {
         asm_ReportError(hFile, TRUE, ptToken, "spaces are not allowed here");
-        LEX_FreeToken(ptToken);
         return GLOB_ERROR_PARSING_FAILED;
     }
     
@@ -673,7 +974,6 @@ static GLOB_ERROR asm_FirstPhaseReadOperand(HASM_FILE hFile,
         eMethod = ASM_OPERAND_METHOD_REGISTER;
     } else {
         asm_ReportError(hFile, TRUE, ptToken, "Unsupported operand");
-        LEX_FreeToken(ptToken);
         return GLOB_ERROR_PARSING_FAILED;
     }
     
@@ -733,18 +1033,16 @@ static GLOB_ERROR asm_FirstPhaseCompileSourceOperand(HASM_FILE hFile,
     }
     
     /* Read the comma (we always expect destination operand) */
-    eRetValue = LEX_ReadNextToken(hFile->hLex, &ptCommaToken);
+    eRetValue = asm_ReadNextToken(hFile, &ptCommaToken);
     if (eRetValue) {
         return eRetValue;
     }
     if (LEX_TOKEN_KIND_SPECIAL != ptCommaToken->eKind
             || ',' != ptCommaToken->uValue.cChar) {
         asm_ReportError(hFile, TRUE, ptCommaToken, "a comma is expected");
-        LEX_FreeToken(ptCommaToken);
         return GLOB_ERROR_PARSING_FAILED;
     }
     
-    LEX_FreeToken(ptCommaToken);
     return GLOB_SUCCESS;
 }
 
@@ -781,6 +1079,136 @@ static GLOB_ERROR asm_FirstPhaseCompileDestinationOperand(HASM_FILE hFile,
     return GLOB_SUCCESS;
 }
 
+/******************************************************************************
+ * Name:    asm_AddFixup
+ * Purpose: add a fixup at the end of the fixups array
+ * Parameters:
+ *          hFile [IN] - handle to the current file
+ *          nWordIndex [IN] - the index of the word in the code stream
+ *          nNameId [IN] - the id of the label name
+ *          bStartsStatement [IN] - TRUE for the first fixup of the statement
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR asm_AddFixup(HASM_FILE hFile,
+                               int nWordIndex,
+                               int nNameId,
+                               BOOL bStartsStatement) {
+    PASM_FIXUP patNewFixups = NULL;
+    int nNewAllocatedFixups = 0;
+    
+    /* Expand the array if it is full */
+    if (hFile->nFixups == hFile->nAllocatedFixups) {
+        nNewAllocatedFixups = MAX(ASM_DEFAULT_FIXUPS,
+                            hFile->nAllocatedFixups * ASM_FIXUPS_EXPAND_FACTOR);
+        STATS_CountAllocation(STATS_MODULE_ASM,
+                              nNewAllocatedFixups * sizeof(*patNewFixups));
+        patNewFixups = realloc(hFile->patFixups,
+                               nNewAllocatedFixups * sizeof(*patNewFixups));
+        if (NULL == patNewFixups) {
+            return GLOB_ERROR_SYS_CALL_ERROR();
+        }
+        hFile->patFixups = patNewFixups;
+        hFile->nAllocatedFixups = nNewAllocatedFixups;
+    }
+    
+    hFile->patFixups[hFile->nFixups].nWordIndex = nWordIndex;
+    hFile->patFixups[hFile->nFixups].nNameId = nNameId;
+    hFile->patFixups[hFile->nFixups].bStartsStatement = bStartsStatement;
+    hFile->nFixups++;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    asm_FirstPhaseCompileOperands
+ * Purpose: write the binary code of the operands of a statement
+ * Parameters:
+ *          hFile [IN] - handle to the current file
+ *          ptLine [IN] - the structure of the line (after its first word was
+ *                        written)
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR asm_FirstPhaseCompileOperands(HASM_FILE hFile,
+                                                PASM_LINE ptLine) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    PLEX_TOKEN * aptOperands = ptLine->aptOperands;
+    int nOperand = 0;
+    int nWordIndex = 0;
+    int nLabelAddress = 0;
+    BOOL bStartsStatement = TRUE;
+    
+    /* The words of the operands follow the first word of the statement */
+    nWordIndex = hFile->nCodeCounter - CODE_STARTUP_ADDRESS + 1;
+    
+    /* Compile each operand to its binary code*/
+    for (int nIndex = 0; nIndex < ptLine->nOperandsLength; nIndex++) {
+        switch (aptOperands[nIndex]->eKind) {
+            case LEX_TOKEN_KIND_IMMED_NUMBER:
+                /* For immediate number, write the value*/
+                nOperand = ASM_COMBINE_IMMEDIATE_WORD(
+                                aptOperands[nIndex]->uValue.nNumber);
+                break;
+            case LEX_TOKEN_KIND_WORD:
+                /* A code label that is already defined has its final
+                 * address. Otherwise, the word is filled by the fixup.
+                 * (A part has no symbols table until it is merged.) */
+                nLabelAddress = 0;
+                if (!hFile->bIsPart) {
+                    eRetValue = SYMTABLE_GetCodeAddress(hFile->hSymTable,
+                        aptOperands[nIndex]->uValue.nNameId, &nLabelAddress);
+                    if (eRetValue) {
+                        return eRetValue;
+                    }
+                }
+                if (0 != nLabelAddress) {
+                    nOperand = ASM_COMBINE_DIRECT_WORD(nLabelAddress);
+                    break;
+                }
+                eRetValue = asm_AddFixup(hFile, nWordIndex,
+                        aptOperands[nIndex]->uValue.nNameId, bStartsStatement);
+                if (eRetValue) {
+                    return eRetValue;
+                }
+                bStartsStatement = FALSE;
+                nOperand = 0;
+                break;
+            case LEX_TOKEN_KIND_REGISTER:
+                /* If the next operand is also a register, combine them */
+                if (nIndex+1 < ptLine->nOperandsLength
+                        && LEX_TOKEN_KIND_REGISTER
+                           == aptOperands[nIndex+1]->eKind) {
+                    nOperand = ASM_COMBINE_REGISTER_WORD(
+                                aptOperands[nIndex]->uValue.nNumber,
+                                aptOperands[nIndex+1]->uValue.nNumber);
+                    /* Skip one extra operand */
+                    nIndex++;
+                } else if (nIndex+1 < ptLine->nOperandsLength) {
+                    /* Source operand */
+                    nOperand = ASM_COMBINE_REGISTER_WORD(
+                                aptOperands[nIndex]->uValue.nNumber, 0);
+                } else {
+                    /* Destination operand*/
+                    nOperand = ASM_COMBINE_REGISTER_WORD(
+                                0, aptOperands[nIndex]->uValue.nNumber);
+                }
+                break;
+            default:
+                return GLOB_ERROR_UNKNOWN;
+        }
+        
+        /* Write the operand to the binary */
+        eRetValue = MEMSTREAM_AppendNumber(hFile->hCodeStream, nOperand);
+        if (eRetValue) {
+            return eRetValue;
+        }
+        nWordIndex++;
+    }
+    return GLOB_SUCCESS;
+}
+
 /******************************************************************************
  * Name:    asm_FirstPhaseCompileOpcode
  * Purpose: compile statement that starts with an opcode 
@@ -797,7 +1225,7 @@ static GLOB_ERROR asm_FirstPhaseCompileOpcode(HASM_FILE hFile,
                                               GLOB_OPCODE eOpcode,
                                               PASM_LINE ptLine) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
-
+    
     /* Handle Source operand */
     eRetValue = asm_FirstPhaseCompileSourceOperand(hFile, eOpcode, ptLine);
     if (eRetValue) {
@@ -811,7 +1239,7 @@ static GLOB_ERROR asm_FirstPhaseCompileOpcode(HASM_FILE hFile,
     }
     
     /* Create the first word */
-    eRetValue = MEMSTREAM_AppendNumber(ptLine->hStream,
+    eRetValue = MEMSTREAM_AppendNumber(hFile->hCodeStream,
         ASM_COMBINE_FIRST_WORD(ptLine->eParam1, ptLine->eParam2,
                                 eOpcode,
                                 ptLine->eSourceParam, ptLine->eDestParam));
@@ -833,7 +1261,9 @@ static GLOB_ERROR asm_FirstPhaseCompileOpcode(HASM_FILE hFile,
         ptLine->nLength--;
     }
     ptLine->bIsData = FALSE;
-    return GLOB_SUCCESS;
+    
+    /* Write the words of the operands */
+    return asm_FirstPhaseCompileOperands(hFile, ptLine);
 }
 
 /******************************************************************************
@@ -844,8 +1274,8 @@ static GLOB_ERROR asm_FirstPhaseCompileOpcode(HASM_FILE hFile,
  *          pptToken [IN OUT] - the current token
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
- *          If *pptToken was label definition, it will be freed and the next
- *          token will be read.
+ *          If *pptToken was label definition, it will be replaced by the
+ *          next token.
  *          GLOB_ERROR_PARSING_FAILED if the syntax is incorrect.
  *          If the function fails, an error code is returned.
  *****************************************************************************/
@@ -854,9 +1284,9 @@ static GLOB_ERROR asm_HandleLabelDefinition(HASM_FILE hFile,
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     SYMTABLE_SYMTYPE eLabelType = SYMTABLE_SYMTYPE_DATA;
     int nLabelAddress = 0;
-
+    
     PLEX_TOKEN ptLabelToken = NULL;
-
+    
     if (LEX_TOKEN_KIND_LABEL != (*pptToken)->eKind) {
         /* No label definition in this statement */
         return GLOB_SUCCESS;
@@ -867,7 +1297,7 @@ static GLOB_ERROR asm_HandleLabelDefinition(HASM_FILE hFile,
     *pptToken = NULL;
     
     /* Read the next token */
-    eRetValue = LEX_ReadNextToken(hFile->hLex, pptToken);
+    eRetValue = asm_ReadNextToken(hFile, pptToken);
     if (eRetValue) {
         return eRetValue;
     }
@@ -877,7 +1307,6 @@ static GLOB_ERROR asm_HandleLabelDefinition(HASM_FILE hFile,
             && LEX_TOKEN_KIND_OPCODE != (*pptToken)->eKind) {
         asm_ReportError(hFile, TRUE, *pptToken,
                 "an opcode or directive is expected");
-        LEX_FreeToken(ptLabelToken);
         return GLOB_ERROR_PARSING_FAILED;        
     }
     
@@ -892,7 +1321,6 @@ static GLOB_ERROR asm_HandleLabelDefinition(HASM_FILE hFile,
              * report a warning and ignore */
             asm_ReportError(hFile, FALSE, ptLabelToken,
                     "Label is defined in .extern or .entry statement");
-            LEX_FreeToken(ptLabelToken);
             return GLOB_SUCCESS;
         }
         /* Labels before .string/.data point to the data section*/
@@ -901,20 +1329,8 @@ static GLOB_ERROR asm_HandleLabelDefinition(HASM_FILE hFile,
     }
     
     /* Insert the label */
-    eRetValue = SYMTABLE_Insert(hFile->hSymTable, ptLabelToken->uValue.szStr,
-                     eLabelType, nLabelAddress, FALSE);
-    if (GLOB_ERROR_ALREADY_EXIST == eRetValue) {
-        asm_ReportError(hFile, TRUE, ptLabelToken,"Duplicate label definition");
-        LEX_FreeToken(ptLabelToken);
-        /* return with SUCCESS to continue parsing the line */
-        return GLOB_SUCCESS;
-    }
-    if (eRetValue) {
-        LEX_FreeToken(ptLabelToken);
-        return eRetValue;
-    }
-    LEX_FreeToken(ptLabelToken);
-    return GLOB_SUCCESS;
+    return asm_DefineSymbol(hFile, ASM_ACTION_KIND_LABEL, ptLabelToken,
+                            eLabelType, nLabelAddress);
 }
 
 /******************************************************************************
@@ -958,7 +1374,6 @@ static GLOB_ERROR asm_FirstPhaseCompileLineContent(HASM_FILE hFile,
                 "an opcode or directive is expected");
         eRetValue = GLOB_ERROR_PARSING_FAILED;
     }
-    LEX_FreeToken(ptToken);
     return eRetValue;
 }
 
@@ -976,86 +1391,53 @@ static GLOB_ERROR asm_FirstPhaseCompileLineContent(HASM_FILE hFile,
 static GLOB_ERROR asm_FirstPhaseCompileNonEmptyLine(HASM_FILE hFile,
                                                     PLEX_TOKEN ptToken) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
-    PASM_LINE ptLine = NULL;
+    ASM_LINE tLine;
     
     /* Ignore remark lines */
     if (LEX_TOKEN_KIND_REMARK == ptToken->eKind) {
-        LEX_FreeToken(ptToken);
         return GLOB_SUCCESS;
     }
     
-    /* Allocate the line structure */
-    ptLine = malloc(sizeof(*ptLine));
-    if (NULL == ptLine) {
-        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
-        LEX_FreeToken(ptToken);
-        return eRetValue;
-    }
     /* Init fields */
-    ptLine->hStream = NULL;
-    for (int nIndex = 0; nIndex < ARRAY_ELEMENTS(ptLine->aptOperands);nIndex++){
-        ptLine->aptOperands[nIndex] = NULL;
-    }
-    ptLine->nOperandsLength = 0;
-    ptLine->nLength = 0;
-    ptLine->bIsData = FALSE;;
-    ptLine->ptNext = NULL;
-    ptLine->eParam1 = ASM_OPERAND_METHOD_IMMEDIATE;
-    ptLine->eParam2 = ASM_OPERAND_METHOD_IMMEDIATE;
-    ptLine->eSourceParam = ASM_OPERAND_METHOD_IMMEDIATE;
-    ptLine->eDestParam = ASM_OPERAND_METHOD_IMMEDIATE;
-    
-    eRetValue = MEMSTREAM_Create(&ptLine->hStream);
-    if (eRetValue) {
-        LEX_FreeToken(ptToken);
-        free(ptLine);
-        return eRetValue;
+    for (int nIndex = 0; nIndex < ARRAY_ELEMENTS(tLine.aptOperands); nIndex++){
+        tLine.aptOperands[nIndex] = NULL;
     }
+    tLine.nOperandsLength = 0;
+    tLine.nLength = 0;
+    tLine.bIsData = FALSE;
+    tLine.eParam1 = ASM_OPERAND_METHOD_IMMEDIATE;
+    tLine.eParam2 = ASM_OPERAND_METHOD_IMMEDIATE;
+    tLine.eSourceParam = ASM_OPERAND_METHOD_IMMEDIATE;
+    tLine.eDestParam = ASM_OPERAND_METHOD_IMMEDIATE;
     
     /* Check if a label is defined at the beginning of this line */
     eRetValue = asm_HandleLabelDefinition(hFile, &ptToken);
     if (eRetValue) {
-        MEMSTREAM_Free(ptLine->hStream);
-        LEX_FreeToken(ptToken);
-        free(ptLine);
         return eRetValue;
     }
     
     /* Now ptToken should be the opcode or directive */
-    eRetValue = asm_FirstPhaseCompileLineContent(hFile, ptToken, ptLine);
+    eRetValue = asm_FirstPhaseCompileLineContent(hFile, ptToken, &tLine);
     if (eRetValue) {
-        MEMSTREAM_Free(ptLine->hStream);
-        free(ptLine);
         return eRetValue;
     }
-
-    /* Add the line at the tail of the list */
-    if (NULL == hFile->ptFirstLine) {
-        hFile->ptFirstLine = ptLine;
-    } else {
-        hFile->ptLastLine->ptNext = ptLine;
-    }
-    hFile->ptLastLine = ptLine;
-
+    
     /* Update the data/code counter */
-    if (ptLine->bIsData) {
-        ptLine->nCounter = hFile->nDataCounter;
-        hFile->nDataCounter += ptLine->nLength;
+    if (tLine.bIsData) {
+        hFile->nDataCounter += tLine.nLength;
     } else {
-        ptLine->nCounter = hFile->nCodeCounter;
-        hFile->nCodeCounter += ptLine->nLength;
+        hFile->nCodeCounter += tLine.nLength;
     }
     
     /* expect end of line */
-    eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
+    eRetValue = asm_ReadNextToken(hFile, &ptToken);
     if (eRetValue) {
         return eRetValue;
     }
     if (LEX_TOKEN_KIND_END_OF_LINE != ptToken->eKind) {
         asm_ReportError(hFile, TRUE, ptToken, "end of line expected");     
     }
-    LEX_FreeToken(ptToken);
-
+    
     return GLOB_SUCCESS;
 }
 
@@ -1073,24 +1455,20 @@ static GLOB_ERROR asm_FirstPhaseCompileLine(HASM_FILE hFile) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     PLEX_TOKEN ptToken = NULL;
     
-    /* Read the first token of the line.*/
-    eRetValue = LEX_ReadNextToken(hFile->hLex, &ptToken);
-    switch (eRetValue) {
-        case GLOB_ERROR_PARSING_FAILED:
-            hFile->bHasErrors = TRUE;
-        case GLOB_SUCCESS:
-            break;
-        case GLOB_ERROR_END_OF_FILE:
-            return GLOB_ERROR_END_OF_FILE;
-        default:
-            return eRetValue;
+    /* Read the tokens of the line (including EOF) */
+    eRetValue = LEX_ReadLine(hFile->hLex, &hFile->tTokens);
+    if (eRetValue) {
+        return eRetValue;
     }
+    hFile->nNextToken = 0;
+    hFile->nLines++;
+    
+    /* Get the first token of the line.*/
+    eRetValue = asm_ReadNextToken(hFile, &ptToken);
     if (GLOB_ERROR_PARSING_FAILED == eRetValue) {
+        hFile->bHasErrors = TRUE;
         eRetValue = GLOB_SUCCESS;
-    } else if (LEX_TOKEN_KIND_END_OF_LINE == ptToken->eKind) {
-        /* line without tokens */
-        LEX_FreeToken(ptToken);
-    } else {
+    } else if (LEX_TOKEN_KIND_END_OF_LINE != ptToken->eKind) {
         /* compile the line */
         eRetValue = asm_FirstPhaseCompileNonEmptyLine(hFile, ptToken);
         if (GLOB_ERROR_PARSING_FAILED == eRetValue) {
@@ -1099,8 +1477,8 @@ static GLOB_ERROR asm_FirstPhaseCompileLine(HASM_FILE hFile) {
         }
     }
     
-    /* Now we can move to the next line in the file. */
-    LEX_MoveToNextLine(hFile->hLex);
+    /* The tokens of the line are no longer used */
+    LEX_FreeLine(hFile->hLex, &hFile->tTokens);
     return eRetValue;
 }
 
@@ -1124,110 +1502,386 @@ static GLOB_ERROR asm_FirstPhase(HASM_FILE hFile) {
 }
 
 /******************************************************************************
- * Name:    asm_SecondPhaseCompileLine
- * Purpose: complete the binary code of the line
+ * Name:    asm_CreateStreams
+ * Purpose: create the code and data streams of a handle with an opened lex
+ *          handle
  * Parameters:
- *          hFile [IN] - handle to the current file
- *          ptLine [IN] - the structure of the line to compile
+ *          hFile [IN] - handle to the current file (or part)
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
- *          GLOB_ERROR_PARSING_FAILED if the syntax is incorrect.
  *          If the function fails, an error code is returned.
  *****************************************************************************/
-static GLOB_ERROR asm_SecondPhaseCompileLine(HASM_FILE hFile, PASM_LINE ptLine){
-    int nOperand = 0;
-    int nLabelAddress = 0;
-    BOOL bIsExtern = FALSE;
+static GLOB_ERROR asm_CreateStreams(HASM_FILE hFile) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    int nEstimatedWords = 0;
     
-    /* Compile each operand to its binary code*/
-    for (int nIndex = 0; nIndex < ptLine->nOperandsLength; nIndex++) {
-        switch (ptLine->aptOperands[nIndex]->eKind) {
-            case LEX_TOKEN_KIND_IMMED_NUMBER:
-                /* For immediate number, write the value*/
-                nOperand = ASM_COMBINE_IMMEDIATE_WORD(
-                                ptLine->aptOperands[nIndex]->uValue.nNumber);
-                break;
-            case LEX_TOKEN_KIND_WORD:
-                /* For labels, check the value from the symbols table*/
-                eRetValue = SYMTABLE_GetSymbolInfo(hFile->hSymTable,
-                        ptLine->aptOperands[nIndex]->uValue.szStr,
-                        &nLabelAddress, &bIsExtern);
-                if (GLOB_ERROR_NOT_FOUND == eRetValue) {
-                    asm_ReportError(hFile, TRUE, NULL,
-                            "Missing label %s",
-                            ptLine->aptOperands[nIndex]->uValue.szStr);
-                    return GLOB_SUCCESS;
-                }
-                if (bIsExtern) {
-                    /* For externals label, we do't know their value.
-                     * We put zeros in the address, but set the appropriate ARE.
-                     * In addition, we have to add this location to the 
-                     * externals file. */
-                    nOperand = ASM_COMBINE_EXTERNAL_WORD;
-                    /* Add to the externals file */
-                    eRetValue = BUFFER_AppendPrintf(hFile->hExternalsStream,
-                            "%s\t%d\n",
-                            ptLine->aptOperands[nIndex]->uValue.szStr,
-                            ptLine->nCounter + 1 + nIndex);
-                    if (eRetValue) {
-                        return eRetValue;
-                    }
-                }
-                else {
-                    nOperand = ASM_COMBINE_DIRECT_WORD(nLabelAddress);
-                }
-                break;
-            case LEX_TOKEN_KIND_REGISTER:
-                /* If the next operand is also a register, combine them */
-                if (nIndex+1 < ptLine->nOperandsLength
-                        && LEX_TOKEN_KIND_REGISTER
-                           == ptLine->aptOperands[nIndex+1]->eKind) {
-                    nOperand = ASM_COMBINE_REGISTER_WORD(
-                                ptLine->aptOperands[nIndex]->uValue.nNumber,
-                                ptLine->aptOperands[nIndex+1]->uValue.nNumber);
-                    /* Skip one extra operand */
-                    nIndex++;
-                } else if (nIndex+1 < ptLine->nOperandsLength) {
-                    /* Source operand */
-                    nOperand = ASM_COMBINE_REGISTER_WORD(
-                                ptLine->aptOperands[nIndex]->uValue.nNumber, 0);
-                } else {
-                    /* Destination operand*/
-                    nOperand = ASM_COMBINE_REGISTER_WORD(
-                                0, ptLine->aptOperands[nIndex]->uValue.nNumber);
-                }
-                break;
-            default:
-                return GLOB_ERROR_UNKNOWN;
+    eRetValue = MEMSTREAM_Create(&hFile->hCodeStream);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    eRetValue = MEMSTREAM_Create(&hFile->hDataStream);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* Allocate the streams by the size of the source, so they are hardly
+     * reallocated while we compile */
+    nEstimatedWords = LEX_GetSourceSize(hFile->hLex)
+                      / ASM_SOURCE_CHARS_PER_WORD;
+    eRetValue = MEMSTREAM_Reserve(hFile->hCodeStream, nEstimatedWords);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    return MEMSTREAM_Reserve(hFile->hDataStream, nEstimatedWords);
+}
+
+/******************************************************************************
+ * Name:    asm_CreatePart
+ * Purpose: create a handle that compiles a part of the source of the file
+ * Parameters:
+ *          hFile [IN] - handle to the current file
+ *          nOffset [IN] - the offset of the part (the beginning of a line)
+ *          nLength [IN] - the length of the part
+ *          phPart [OUT] - the handle to the part
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  The part has its own names table, so the threads don't share
+ *          anything but the source.
+ *****************************************************************************/
+static GLOB_ERROR asm_CreatePart(HASM_FILE hFile,
+                                 size_t nOffset,
+                                 size_t nLength,
+                                 PHASM_FILE phPart) {
+    HASM_FILE hPart = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    eRetValue = asm_Create(asm_PartErrorsCallback, NULL, &hPart);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    hPart->pvErrorsCallbackContext = hPart;
+    hPart->bIsPart = TRUE;
+    
+    eRetValue = LEX_OpenPart(hFile->hLex, nOffset, nLength, hPart->hNames,
+                             asm_PartErrorsCallback, hPart, &hPart->hLex);
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = asm_CreateStreams(hPart);
+    }
+    if (eRetValue) {
+        ASM_Close(hPart);
+        return eRetValue;
+    }
+    *phPart = hPart;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    asm_PartThread
+ * Purpose: the thread function that runs the first phase of a part
+ * Parameters:
+ *          pvPart [IN] - the part (PASM_PART)
+ * Return Value:
+ *          NULL. The result is kept in the part.
+ *****************************************************************************/
+static void * asm_PartThread(void * pvPart) {
+    PASM_PART ptPart = (PASM_PART)pvPart;
+    
+    if (ptPart->bCollectStats) {
+        STATS_SetCurrent(&ptPart->tStats);
+    }
+    ptPart->eRetValue = asm_FirstPhase(ptPart->hPart);
+    if (GLOB_SUCCESS == ptPart->eRetValue) {
+        ptPart->eRetValue = ptPart->hPart->eMessagesError;
+    }
+    STATS_SetCurrent(NULL);
+    return NULL;
+}
+
+/******************************************************************************
+ * Name:    asm_MergePart
+ * Purpose: merge a compiled part into the file, as if the file compiled it
+ * Parameters:
+ *          hFile [IN] - handle to the current file (after the parts before)
+ *          hPart [IN] - the compiled part
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  The names of the part are added to the names of the file in the
+ *          order of their ids, which is the order of the source, so the ids
+ *          are the ids the file would give them.
+ *          The actions are replayed in the order they were kept. When the file
+ *          fails a statement on an extern/entry, the rest of the actions of
+ *          its line are skipped (the part didn't know the statement failed).
+ *****************************************************************************/
+static GLOB_ERROR asm_MergePart(HASM_FILE hFile, HASM_FILE hPart) {
+    GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    PASM_ACTION ptAction = NULL;
+    PASM_FIXUP ptFixup = NULL;
+    LEX_TOKEN tToken;
+    const char * pszName = NULL;
+    int * panNameIds = NULL;
+    int nNames = INTERN_GetCount(hPart->hNames);
+    int nCodeOffset = hFile->nCodeCounter - CODE_STARTUP_ADDRESS;
+    int nAddress = 0;
+    int nLine = 0;
+    int nFailedLine = -1;
+    
+    /* Map the name ids of the part to the name ids of the file */
+    STATS_CountAllocation(STATS_MODULE_ASM, MAX(1, nNames) * sizeof(int));
+    panNameIds = malloc(MAX(1, nNames) * sizeof(int));
+    if (NULL == panNameIds) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    for (int nIndex = 0; nIndex < nNames && !eRetValue; nIndex++) {
+        pszName = INTERN_GetName(hPart->hNames, nIndex);
+        eRetValue = INTERN_Add(hFile->hNames, pszName, strlen(pszName),
+                               &panNameIds[nIndex]);
+    }
+    
+    /* Replay the actions, with the lines and addresses of the file */
+    hFile->nLineOffset = hFile->nLines;
+    for (int nIndex = 0; nIndex < hPart->nActions && !eRetValue; nIndex++) {
+        ptAction = &hPart->patActions[nIndex];
+        nLine = (ASM_ACTION_KIND_MESSAGE == ptAction->eKind)
+                ? ptAction->ptMessage->nLine
+                : ptAction->tToken.ptLine->nLineNumber;
+        if (nLine == nFailedLine) {
+            continue;
         }
-        
-        /* Write the operand to the binary */
-        eRetValue = MEMSTREAM_AppendNumber(ptLine->hStream, nOperand);
-        if (eRetValue) {
-            return eRetValue;
+        if (ASM_ACTION_KIND_MESSAGE == ptAction->eKind) {
+            asm_ReportPartMessage(hFile, ptAction->ptMessage, "%s",
+                                  ptAction->ptMessage->szMessage);
+            continue;
+        }
+        tToken = ptAction->tToken;
+        tToken.uValue.nNameId = panNameIds[tToken.uValue.nNameId];
+        nAddress = ptAction->nAddress;
+        if (ASM_ACTION_KIND_LABEL == ptAction->eKind) {
+            nAddress += (SYMTABLE_SYMTYPE_CODE == ptAction->eType)
+                        ? nCodeOffset : hFile->nDataCounter;
+        }
+        eRetValue = asm_DefineSymbol(hFile, ptAction->eKind, &tToken,
+                                     ptAction->eType, nAddress);
+        if (GLOB_ERROR_PARSING_FAILED == eRetValue) {
+            nFailedLine = nLine;
+            eRetValue = GLOB_SUCCESS;
+        } else if (GLOB_SUCCESS == eRetValue) {
+            if (ASM_ACTION_KIND_EXTERN == ptAction->eKind) {
+                hFile->bHaveExternals = TRUE;
+            } else if (ASM_ACTION_KIND_ENTRY == ptAction->eKind) {
+                hFile->bHaveEntries = TRUE;
+            }
         }
     }
+    hFile->nLineOffset = 0;
+    
+    /* Move the fixups to the code of the file */
+    for (int nIndex = 0; nIndex < hPart->nFixups && !eRetValue; nIndex++) {
+        ptFixup = &hPart->patFixups[nIndex];
+        eRetValue = asm_AddFixup(hFile, ptFixup->nWordIndex + nCodeOffset,
+                                 panNameIds[ptFixup->nNameId],
+                                 ptFixup->bStartsStatement);
+    }
+    free(panNameIds);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* Append the code and data, and move the counters after the part */
+    eRetValue = MEMSTREAM_Concat(hFile->hCodeStream, hPart->hCodeStream);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    eRetValue = MEMSTREAM_Concat(hFile->hDataStream, hPart->hDataStream);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    hFile->nCodeCounter += hPart->nCodeCounter - CODE_STARTUP_ADDRESS;
+    hFile->nDataCounter += hPart->nDataCounter;
+    hFile->nLines += hPart->nLines;
     return GLOB_SUCCESS;
 }
- 
+
 /******************************************************************************
- * Name:    asm_SecondPhase
- * Purpose: do the second phase of the compilation
+ * Name:    asm_FirstPhaseInParallel
+ * Purpose: parse and compile the file in parts, each by its own thread
  * Parameters:
- *          hFile [IN] - handle to the current file
+ *          hFile [IN] - handle to the current file (its source in memory)
+ *          nParts [IN] - the number of parts
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
  *          If the function fails, an error code is returned.
+ * Remark:  The source is split into parts of about the same length, at the
+ *          beginning of lines. The parts are merged in the order of the
+ *          source, so the result (and the messages) are the result of
+ *          asm_FirstPhase.
  *****************************************************************************/
-static GLOB_ERROR asm_SecondPhase(HASM_FILE hFile) {
+static GLOB_ERROR asm_FirstPhaseInParallel(HASM_FILE hFile, int nParts) {
     GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    PASM_PART patParts = NULL;
+    PSTATS ptStats = STATS_GetCurrent();
+    const char * pcSource = LEX_GetSource(hFile->hLex);
+    size_t nSourceLength = LEX_GetSourceSize(hFile->hLex);
+    const char * pcEnd = NULL;
+    size_t nOffset = 0;
+    size_t nEnd = 0;
+    int nCreatedParts = 0;
+    
+    STATS_CountAllocation(STATS_MODULE_ASM, nParts * sizeof(*patParts));
+    patParts = calloc(nParts, sizeof(*patParts));
+    if (NULL == patParts) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Create the parts. Each part (except of the last) ends after the first
+     * new line from its share of the source. */
+    while (nCreatedParts < nParts && nOffset < nSourceLength
+           && GLOB_SUCCESS == eRetValue) {
+        nEnd = nSourceLength;
+        if (nCreatedParts < nParts - 1) {
+            nEnd = MAX(nOffset, nSourceLength / nParts * (nCreatedParts + 1));
+            pcEnd = memchr(pcSource + nEnd, '\n', nSourceLength - nEnd);
+            nEnd = (NULL == pcEnd) ? nSourceLength : pcEnd - pcSource + 1;
+        }
+        eRetValue = asm_CreatePart(hFile, nOffset, nEnd - nOffset,
+                                   &patParts[nCreatedParts].hPart);
+        if (GLOB_SUCCESS == eRetValue) {
+            nCreatedParts++;
+            nOffset = nEnd;
+        }
+    }
+    
+    /* Compile the parts. A part whose thread can't be started is compiled
+     * by this thread. */
+    for (int nIndex = 0; nIndex < nCreatedParts && !eRetValue; nIndex++) {
+        patParts[nIndex].bCollectStats = (NULL != ptStats);
+        if (0 == pthread_create(&patParts[nIndex].tThread, NULL,
+                                asm_PartThread, &patParts[nIndex])) {
+            patParts[nIndex].bIsThreadStarted = TRUE;
+        } else {
+            asm_PartThread(&patParts[nIndex]);
+            STATS_SetCurrent(ptStats);
+        }
+    }
+    for (int nIndex = 0; nIndex < nCreatedParts; nIndex++) {
+        if (patParts[nIndex].bIsThreadStarted) {
+            pthread_join(patParts[nIndex].tThread, NULL);
+        }
+        if (NULL != ptStats) {
+            STATS_Add(ptStats, &patParts[nIndex].tStats);
+        }
+    }
+    
+    /* Merge the parts in the order of the source */
+    for (int nIndex = 0; nIndex < nCreatedParts && !eRetValue; nIndex++) {
+        eRetValue = patParts[nIndex].eRetValue;
+        if (GLOB_SUCCESS == eRetValue) {
+            eRetValue = asm_MergePart(hFile, patParts[nIndex].hPart);
+        }
+    }
+    
+    for (int nIndex = 0; nIndex < nCreatedParts; nIndex++) {
+        ASM_Close(patParts[nIndex].hPart);
+    }
+    free(patParts);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    asm_AppendSymbolRecord
+ * Purpose: Append a record of the entries/externals file: the name, a tab,
+ *          the address and a new line (like "%s\t%d\n")
+ * Parameters:
+ *          hStream [IN] - the buffer of the file
+ *          pszName [IN] - the name of the symbol
+ *          nAddress [IN] - the address
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR asm_AppendSymbolRecord(HBUFFER hStream,
+                                         const char * pszName,
+                                         int nAddress) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     
-    /* Run line by line */
-    for (PASM_LINE ptLine = hFile->ptFirstLine;
-         NULL != ptLine;
-         ptLine = ptLine->ptNext) {
-        eRetValue = asm_SecondPhaseCompileLine(hFile, ptLine);
+    eRetValue = BUFFER_AppendString(hStream, pszName, strlen(pszName));
+    if (eRetValue) {
+        return eRetValue;
+    }
+    eRetValue = BUFFER_AppendChar(hStream, '\t');
+    if (eRetValue) {
+        return eRetValue;
+    }
+    eRetValue = BUFFER_AppendInt(hStream, nAddress);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    return BUFFER_AppendChar(hStream, '\n');
+}
+
+/******************************************************************************
+ * Name:    asm_ResolveFixups
+ * Purpose: fill the operand words that use labels, after the symbols table
+ *          is finalized
+ * Parameters:
+ *          hFile [IN] - handle to the current file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  A missing label is reported once for each statement
+ *****************************************************************************/
+static GLOB_ERROR asm_ResolveFixups(HASM_FILE hFile) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    PASM_FIXUP ptFixup = NULL;
+    const char * pszName = NULL;
+    int nOperand = 0;
+    int nLabelAddress = 0;
+    BOOL bIsExtern = FALSE;
+    BOOL bSkipStatement = FALSE;
+    
+    for (int nIndex = 0; nIndex < hFile->nFixups; nIndex++) {
+        ptFixup = &hFile->patFixups[nIndex];
+        
+        /* Skip the rest of a statement with a missing label */
+        if (ptFixup->bStartsStatement) {
+            bSkipStatement = FALSE;
+        }
+        if (bSkipStatement) {
+            continue;
+        }
+        
+        /* Get the value of the label from the symbols table */
+        pszName = INTERN_GetName(hFile->hNames, ptFixup->nNameId);
+        eRetValue = SYMTABLE_GetSymbolInfo(hFile->hSymTable, ptFixup->nNameId,
+                                           &nLabelAddress, &bIsExtern);
+        if (GLOB_ERROR_NOT_FOUND == eRetValue) {
+            asm_ReportError(hFile, TRUE, NULL, "Missing label %s", pszName);
+            bSkipStatement = TRUE;
+            continue;
+        }
+        if (eRetValue) {
+            return eRetValue;
+        }
+        
+        if (bIsExtern) {
+            /* For externals label, we do't know their value.
+             * We put zeros in the address, but set the appropriate ARE.
+             * In addition, we have to add this location to the 
+             * externals file. */
+            nOperand = ASM_COMBINE_EXTERNAL_WORD;
+            eRetValue = asm_AppendSymbolRecord(hFile->hExternalsStream,
+                    pszName, ptFixup->nWordIndex + CODE_STARTUP_ADDRESS);
+            if (eRetValue) {
+                return eRetValue;
+            }
+        } else {
+            nOperand = ASM_COMBINE_DIRECT_WORD(nLabelAddress);
+        }
+        
+        /* Write the operand to the binary (to the reserved word) */
+        eRetValue = MEMSTREAM_SetNumber(hFile->hCodeStream,
+                                        ptFixup->nWordIndex, nOperand);
         if (eRetValue) {
             return eRetValue;
         }
@@ -1259,8 +1913,7 @@ static GLOB_ERROR asm_SymTableForEachCallback(const char * pszName,
     }
     
     /* add the symbol to the buffer of the entries file */
-    return BUFFER_AppendPrintf(hFile->hEntriesStream,
-            "%s\t%d\n", pszName, nAddress);
+    return asm_AppendSymbolRecord(hFile->hEntriesStream, pszName, nAddress);
 }
 
 /******************************************************************************
@@ -1279,22 +1932,25 @@ static GLOB_ERROR asm_PrepareEntries(HASM_FILE hFile) {
 }
 
 /******************************************************************************
- * EXTERNAL FUNCTIONS
- * ------------------
- * See function-level documentation in the header file
- *****************************************************************************/
-
-/******************************************************************************
- * Name:    ASM_Compile
+ * Name:    asm_Create
+ * Purpose: Allocate a handle for compiling a file and init its fields
+ * Parameters:
+ *          pfnErrorsCallback [IN] - callback function to use in case
+ *                                   of errors/warnings
+ *          pvContext [IN] -  context for the callback function
+ *          phFile [OUT] - the allocated handle
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
  *****************************************************************************/
-GLOB_ERROR ASM_Compile(const char * szFileName,
-                       GLOB_ERRORCALLBACK pfnErrorsCallback,
-                        void * pvContext,
-                       PHASM_FILE phFile) {
+static GLOB_ERROR asm_Create(GLOB_ERRORCALLBACK pfnErrorsCallback,
+                             void * pvContext,
+                             PHASM_FILE phFile) {
     HASM_FILE hFile = NULL;
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
-
+    
     /* Allocate the handle */
+    STATS_CountAllocation(STATS_MODULE_ASM, sizeof(*hFile));
     hFile = malloc(sizeof(*hFile));
     if (NULL == hFile) {
         return GLOB_ERROR_SYS_CALL_ERROR();
@@ -1304,6 +1960,7 @@ GLOB_ERROR ASM_Compile(const char * szFileName,
     hFile->pfnErrorsCallback = pfnErrorsCallback;
     hFile->pvErrorsCallbackContext = pvContext;
     hFile->hLex = NULL;
+    hFile->hNames = NULL;
     hFile->hSymTable = NULL;
     hFile->hExternalsStream = NULL;
     hFile->hEntriesStream = NULL;
@@ -1312,18 +1969,52 @@ GLOB_ERROR ASM_Compile(const char * szFileName,
     hFile->bHasErrors = FALSE;
     hFile->bHaveExternals = FALSE;
     hFile->bHaveEntries = FALSE;
-    hFile->ptFirstLine = NULL;
-    hFile->ptLastLine = NULL;
-    
-    /* Open the file for parsing. */
-    eRetValue = LEX_Open(szFileName, pfnErrorsCallback, pvContext,&hFile->hLex);
+    hFile->hCodeStream = NULL;
+    hFile->hDataStream = NULL;
+    hFile->patFixups = NULL;
+    hFile->nFixups = 0;
+    hFile->nAllocatedFixups = 0;
+    hFile->nLines = 0;
+    hFile->nLineOffset = 0;
+    hFile->bIsPart = FALSE;
+    hFile->patActions = NULL;
+    hFile->nActions = 0;
+    hFile->nAllocatedActions = 0;
+    hFile->eMessagesError = GLOB_SUCCESS;
+    
+    /* Create the table of the label names. LEX adds the names to it. */
+    eRetValue = INTERN_Create(&hFile->hNames);
     if (eRetValue) {
-        ASM_Close(hFile);
+        free(hFile);
         return eRetValue;
     }
     
+    /* Set out parameter upon success */
+    *phFile = hFile;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    asm_Compile
+ * Purpose: Compile the source opened in the handle
+ * Parameters:
+ *          hFile [IN] - the handle, with an opened lex handle
+ *          nThreads [IN] - the number of threads for the first phase
+ *          phFile [OUT] - the handle to the compiled file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  The handle is closed by the function on failure
+ *****************************************************************************/
+static GLOB_ERROR asm_Compile(HASM_FILE hFile,
+                              int nThreads,
+                              PHASM_FILE phFile) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    long long nStartTime = 0;
+    size_t nParts = 0;
+    
     /* Create the symbols table */
-    eRetValue = SYMTABLE_Create(&hFile->hSymTable);
+    eRetValue = SYMTABLE_Create(hFile->hNames, &hFile->hSymTable);
     if (eRetValue) {
         ASM_Close(hFile);
         return eRetValue;
@@ -1335,16 +2026,35 @@ GLOB_ERROR ASM_Compile(const char * szFileName,
         ASM_Close(hFile);
         return eRetValue;
     }    
-
+    
     /* Create the Entries Stream */
     eRetValue = BUFFER_Create(&hFile->hEntriesStream);
     if (eRetValue) {
         ASM_Close(hFile);
         return eRetValue;
     }
-
-    /* Start the first phase */
-    eRetValue = asm_FirstPhase(hFile);
+    
+    /* Create the code and data streams */
+    eRetValue = asm_CreateStreams(hFile);
+    if (eRetValue) {
+        ASM_Close(hFile);
+        return eRetValue;
+    }
+    
+    /* Start the first phase. A large source in memory is split into parts,
+     * when we have threads for them. */
+    nParts = 0;
+    if (nThreads > 1 && NULL != LEX_GetSource(hFile->hLex)) {
+        nParts = MIN((size_t)nThreads,
+                     LEX_GetSourceSize(hFile->hLex) / ASM_MIN_PART_LENGTH);
+    }
+    nStartTime = STATS_StartPhase();
+    if (nParts > 1) {
+        eRetValue = asm_FirstPhaseInParallel(hFile, (int)nParts);
+    } else {
+        eRetValue = asm_FirstPhase(hFile);
+    }
+    STATS_EndPhase(STATS_PHASE_FIRST_PHASE, nStartTime);
     if (eRetValue) {
         ASM_Close(hFile);
         return eRetValue;
@@ -1358,7 +2068,9 @@ GLOB_ERROR ASM_Compile(const char * szFileName,
     }
     
     /* Finalize the symbols table */
+    nStartTime = STATS_StartPhase();
     eRetValue = SYMTABLE_Finalize(hFile->hSymTable, hFile->nCodeCounter);
+    STATS_EndPhase(STATS_PHASE_SYMTABLE_FINALIZE, nStartTime);
     if (GLOB_ERROR_NOT_FOUND == eRetValue) {
         asm_ReportError(hFile, TRUE, NULL, "one or more label were defined "
                 "in .entry statement, but can't find them in the code");
@@ -1370,19 +2082,24 @@ GLOB_ERROR ASM_Compile(const char * szFileName,
         return eRetValue;
     }
     
-    /* Start second phase */
-    eRetValue = asm_SecondPhase(hFile);
+    /* Fill the words of the labels */
+    nStartTime = STATS_StartPhase();
+    eRetValue = asm_ResolveFixups(hFile);
+    STATS_EndPhase(STATS_PHASE_RESOLVE_FIXUPS, nStartTime);
     if (eRetValue) {
         ASM_Close(hFile);
         return eRetValue;
     }
     
     if (hFile->bHasErrors) {
+        ASM_Close(hFile);
         return GLOB_ERROR_PARSING_FAILED;
     }
     
     /* Prepare Entries buffer */
+    nStartTime = STATS_StartPhase();
     eRetValue = asm_PrepareEntries(hFile);
+    STATS_EndPhase(STATS_PHASE_PREPARE_ENTRIES, nStartTime);
     if (eRetValue) {
         ASM_Close(hFile);
         return eRetValue;
@@ -1391,52 +2108,108 @@ GLOB_ERROR ASM_Compile(const char * szFileName,
     return GLOB_SUCCESS;
 }
 
-GLOB_ERROR ASM_WriteBinary(HASM_FILE hFile, PHMEMSTREAM phStream, int * nCode, int * nData) {
-    HMEMSTREAM hStream = NULL;
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    ASM_Compile
+ *****************************************************************************/
+GLOB_ERROR ASM_Compile(const char * szFileName,
+                       GLOB_ERRORCALLBACK pfnErrorsCallback,
+                        void * pvContext,
+                       int nThreads,
+                       PHASM_FILE phFile) {
+    HASM_FILE hFile = NULL;
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
-    if (NULL == hFile || NULL == phStream || NULL == nCode || NULL == nData) {
-        return GLOB_ERROR_INVALID_PARAMETERS;
+    
+    /* Allocate the handle */
+    eRetValue = asm_Create(pfnErrorsCallback, pvContext, &hFile);
+    if (eRetValue) {
+        return eRetValue;
     }
-    if (hFile->bHasErrors) {
-        return GLOB_ERROR_INVALID_STATE;
+    
+    /* Open the file for parsing. */
+    eRetValue = LEX_Open(szFileName, hFile->hNames,
+                         pfnErrorsCallback, pvContext, &hFile->hLex);
+    if (eRetValue) {
+        ASM_Close(hFile);
+        return eRetValue;
     }
     
-    eRetValue = MEMSTREAM_Create(&hStream);
+    return asm_Compile(hFile, nThreads, phFile);
+}
+
+/******************************************************************************
+ * Name:    ASM_CompileBuffer
+ *****************************************************************************/
+GLOB_ERROR ASM_CompileBuffer(const char * szName,
+                             const char * pcSource,
+                             size_t nLength,
+                             GLOB_ERRORCALLBACK pfnErrorsCallback,
+                             void * pvContext,
+                             int nThreads,
+                             PHASM_FILE phFile) {
+    HASM_FILE hFile = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Allocate the handle */
+    eRetValue = asm_Create(pfnErrorsCallback, pvContext, &hFile);
     if (eRetValue) {
         return eRetValue;
     }
     
-    /* Append Code */
-    for (PASM_LINE ptLine = hFile->ptFirstLine;
-            ptLine != NULL;
-            ptLine = ptLine->ptNext) {
-        if (!ptLine->bIsData) {
-            eRetValue = MEMSTREAM_Concat(hStream, ptLine->hStream);
-            if (eRetValue) {
-                MEMSTREAM_Free(hStream);
-                return eRetValue;
-            }
-        }
+    /* Open the source buffer for parsing. */
+    eRetValue = LEX_OpenBuffer(szName, pcSource, nLength, hFile->hNames,
+                               pfnErrorsCallback, pvContext, &hFile->hLex);
+    if (eRetValue) {
+        ASM_Close(hFile);
+        return eRetValue;
     }
     
-    /* Append Data */
-    for (PASM_LINE ptLine = hFile->ptFirstLine;
-            ptLine != NULL;
-            ptLine = ptLine->ptNext) {
-        if (ptLine->bIsData) {
-            eRetValue = MEMSTREAM_Concat(hStream, ptLine->hStream);
-            if (eRetValue) {
-                MEMSTREAM_Free(hStream);
-                return eRetValue;
-            }
-        }
+    return asm_Compile(hFile, nThreads, phFile);
+}
+
+/******************************************************************************
+ * Name:    ASM_WriteBinary
+ *****************************************************************************/
+GLOB_ERROR ASM_WriteBinary(HASM_FILE hFile,
+                           const uint16_t ** ppwCode,
+                           int * pnCodeLength,
+                           const uint16_t ** ppwData,
+                           int * pnDataLength) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    uint16_t * pwStream = NULL;
+    int nStreamLength = 0;
+    
+    /* Check parameters */
+    if (NULL == hFile || NULL == ppwCode || NULL == pnCodeLength
+            || NULL == ppwData || NULL == pnDataLength) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    if (hFile->bHasErrors) {
+        return GLOB_ERROR_INVALID_STATE;
     }
     
-    /* Set out parameters */
-    *phStream = hStream;
-    *nCode = hFile->nCodeCounter - CODE_STARTUP_ADDRESS;
-    *nData = hFile->nDataCounter;
+    /* The code section */
+    eRetValue = MEMSTREAM_GetStream(hFile->hCodeStream,
+                                    &pwStream, &nStreamLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    *ppwCode = pwStream;
+    *pnCodeLength = nStreamLength;
     
+    /* The data section */
+    eRetValue = MEMSTREAM_GetStream(hFile->hDataStream,
+                                    &pwStream, &nStreamLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    *ppwData = pwStream;
+    *pnDataLength = nStreamLength;
     return GLOB_SUCCESS;
 }
 
@@ -1474,10 +2247,6 @@ GLOB_ERROR ASM_GetExternals(HASM_FILE hFile,
  * Name:    ASM_Close
  *****************************************************************************/
 void ASM_Close(HASM_FILE hFile) {
-    PASM_LINE ptLineToFree = NULL;
-    if (NULL != hFile->hLex) {
-        LEX_Close(hFile->hLex);
-    }
     if (NULL != hFile->hSymTable) {
         SYMTABLE_Free(hFile->hSymTable);
     }
@@ -1488,17 +2257,30 @@ void ASM_Close(HASM_FILE hFile) {
         BUFFER_Free(hFile->hExternalsStream);
     }
     
-    /* free all lines */
-    while (NULL != hFile->ptFirstLine) {
-        ptLineToFree = hFile->ptFirstLine;
-        hFile->ptFirstLine = ptLineToFree->ptNext;
-        MEMSTREAM_Free(ptLineToFree->hStream);
-        for (int nIndex = 0; nIndex < ARRAY_ELEMENTS(ptLineToFree->aptOperands); nIndex++) {
-            if (NULL != ptLineToFree->aptOperands[nIndex]) {
-                LEX_FreeToken(ptLineToFree->aptOperands[nIndex]);
-            }
+    if (NULL != hFile->hCodeStream) {
+        MEMSTREAM_Free(hFile->hCodeStream);
+    }
+    if (NULL != hFile->hDataStream) {
+        MEMSTREAM_Free(hFile->hDataStream);
+    }
+    
+    free(hFile->patFixups);
+    
+    /* The actions keep references to the lines of the part */
+    for (int nIndex = 0; nIndex < hFile->nActions; nIndex++) {
+        if (ASM_ACTION_KIND_MESSAGE == hFile->patActions[nIndex].eKind) {
+            free(hFile->patActions[nIndex].ptMessage);
+        } else {
+            LINESTR_FreeLine(hFile->patActions[nIndex].tToken.ptLine);
         }
-        free(ptLineToFree);
+    }
+    free(hFile->patActions);
+    
+    if (NULL != hFile->hLex) {
+        LEX_Close(hFile->hLex);
+    }
+    if (NULL != hFile->hNames) {
+        INTERN_Free(hFile->hNames);
     }
     /* free the handle itself */
     free(hFile);
@@ -12,6 +12,109 @@
 #include "memstream.h"
 #include "lex.h"
 
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The next macros uses the g_szAllowedOperands to retrieve information
+ * about opcodes in the language. See documentation next
+ * to g_szAllowedOperands definition. */
+
+/* True if this opcode expect source operand (= 2-operand opcode) */
+#define ASM_HAS_SOURCE_OPERAND(opcode) (g_znAllowedOperands[opcode] & 0xF0)
+
+/* Get the allowed methods for the source operand of this opcode */
+#define ASM_GET_ALLOWED_SOURCE_OPERAND(opcode) ((g_znAllowedOperands[opcode] \
+                                                 & 0xF0) >> 4)
+
+/* True if this opcode expect destination operand (= 1 or 2-operand opcode) */
+#define ASM_HAS_DESTINATION_OPERAND(opcode) (g_znAllowedOperands[opcode] & 0x0F)
+
+/* Get the allowed methods for the destination operand of this opcode */
+#define ASM_GET_ALLOWED_DESTINATION_OPERAND(opcode) \
+                                        ASM_HAS_DESTINATION_OPERAND(opcode)
+
+/* Check whether the specified method is allowed. the parameter should be
+ * the result of either  ASM_GET_ALLOWED_SOURCE_OPERAND or 
+ * ASM_GET_ALLOWED_DESTINATION_OPERAND.*/
+#define ASM_IS_IMMEDIATE_OPERAND_ALLOWED(operand)   ((operand) & 0x1)
+#define ASM_IS_DIRECT_OPERAND_ALLOWED(operand)      ((operand) & 0x2)
+#define ASM_IS_PARAMETER_OPERAND_ALLOWED(operand)   ((operand) & 0x4)
+#define ASM_IS_REGISTER_OPERAND_ALLOWED(operand)    ((operand) & 0x8)
+
+/* The allowed operands method for each of the parameters in the
+ * "jump with parameters" operand method. See documentation next to
+ * g_znAllowedOperands for more information. */
+#define ASM_ALLOWED_OPERANDS_AS_PARAM               0xB
+
+/* Create the first binary word of the statement (opcode).
+ * the ARE are always absolute. We shift left the parameters to their location*/
+#define ASM_COMBINE_FIRST_WORD(eParam1, eParam2, eOpcode, eSource, eDest) \
+    ((eParam1)<<12 | (eParam2)<<10 | (eOpcode)<<6 | (eSource)<<4          \
+    | (eDest)<<2 | (ASM_ARE_ABSOLUTE))
+
+#define ASM_COMBINE_IMMEDIATE_WORD(value) \
+    (((value) << 2) | ASM_ARE_ABSOLUTE) 
+
+#define ASM_COMBINE_DIRECT_WORD(value) \
+    (((value) << 2) | ASM_ARE_RELOCATABLE) 
+
+#define ASM_COMBINE_EXTERNAL_WORD ASM_ARE_EXTERNAL
+
+#define ASM_COMBINE_REGISTER_WORD(nSource, nDest) \
+    (((nSource) << 8) | ((nDest) << 2) | ASM_ARE_ABSOLUTE)
+
+/* Take apart the words that the ASM_COMBINE_* macros create (for the tools
+ * that read the object files) */
+
+/* The fields of the first word of an instruction */
+#define ASM_GET_PARAM1(wWord) (((wWord) >> 12) & 0x3)
+#define ASM_GET_PARAM2(wWord) (((wWord) >> 10) & 0x3)
+#define ASM_GET_OPCODE(wWord) (((wWord) >> 6) & 0xF)
+#define ASM_GET_SOURCE_METHOD(wWord) (((wWord) >> 4) & 0x3)
+#define ASM_GET_DEST_METHOD(wWord) (((wWord) >> 2) & 0x3)
+
+/* The fields of an operand word. The immediate value is signed (12 bits). */
+#define ASM_GET_ARE(wWord) ((wWord) & 0x3)
+#define ASM_GET_IMMEDIATE_VALUE(wWord) ((((int)(wWord) >> 2) ^ 0x800) - 0x800)
+#define ASM_GET_ADDRESS(wWord) (((wWord) >> 2) & 0xFFF)
+#define ASM_GET_SOURCE_REGISTER(wWord) (((wWord) >> 8) & 0x7)
+#define ASM_GET_DEST_REGISTER(wWord) (((wWord) >> 2) & 0x7)
+
+/* Check whether a method is allowed by a mask of allowed methods (see
+ * ASM_GET_ALLOWED_SOURCE_OPERAND) */
+#define ASM_IS_METHOD_ALLOWED(nAllowed, eMethod) (((nAllowed) >> (eMethod)) & 1)
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* enum of the operand methods exist in the language */
+typedef enum ASM_OPERAND_METHOD {
+    ASM_OPERAND_METHOD_IMMEDIATE = 0,
+    ASM_OPERAND_METHOD_DIRECT = 1,
+    ASM_OPERAND_METHOD_PARAMETERS = 2,
+    ASM_OPERAND_METHOD_REGISTER = 3,
+} ASM_OPERAND_METHOD;
+
+/* enum of values of the ARE bits in the first word */
+typedef enum ASM_ARE {
+    ASM_ARE_ABSOLUTE = 0,
+    ASM_ARE_EXTERNAL = 1,
+    ASM_ARE_RELOCATABLE = 2,
+} ASM_ARE;
+
+/******************************************************************************
+ * CONSTANTS
+ *****************************************************************************/
+
+/* The allowed operand methods of each opcode. See documentation next to its
+ * definition. */
+extern const int g_znAllowedOperands[];
+
+/* The names of the opcodes, by their code (GLOB_OPCODE) */
+extern const char * const g_aszOpcodeNames[];
+
 /* The HASM_FILE represents a handle to a file compiled by the ASM module.
  * Always close the handle with the ASM_Close function. */
 typedef struct ASM_FILE ASM_FILE, *HASM_FILE, **PHASM_FILE;
@@ -24,6 +127,8 @@ typedef struct ASM_FILE ASM_FILE, *HASM_FILE, **PHASM_FILE;
  *          pfnErrorsCallback [IN] - callback function to use in case
  *                                   of errors/warnings
  *          pvContext [IN] -  context for the callback function
+ *          nThreads [IN] - the number of threads that compile the file (1 to
+ *                          compile it by the calling thread only)
  *          phFile [OUT] - the handle to the compiled file
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
@@ -33,29 +138,61 @@ typedef struct ASM_FILE ASM_FILE, *HASM_FILE, **PHASM_FILE;
  *          GLOB_ERROR_PARSING_FAILED - in case we found one or more errors
  *                                      in the source code.
  *          If the function fails, an error code is returned.
+ * Remark:  With more than one thread, a large source is compiled in parts by
+ *          the threads. The result and the messages are the same.
  *****************************************************************************/
 GLOB_ERROR ASM_Compile(const char * szFileName,
                        GLOB_ERRORCALLBACK pfnErrorsCallback,
                         void * pvContext,
+                       int nThreads,
                        PHASM_FILE phFile);
 
+/******************************************************************************
+ * Name:    ASM_CompileBuffer
+ * Purpose: The function compiles source code from a memory buffer
+ * Parameters:
+ *          szName [IN] - the name of the source (used in the messages)
+ *          pcSource [IN] - the source code (doesn't have to be
+ *                          null-terminated)
+ *          nLength [IN] - the length (in chars) of the source code
+ *          pfnErrorsCallback [IN] - callback function to use in case
+ *                                   of errors/warnings
+ *          pvContext [IN] -  context for the callback function
+ *          nThreads [IN] - the number of threads (see ASM_Compile)
+ *          phFile [OUT] - the handle to the compiled file
+ * Return Value:
+ *          Same as ASM_Compile.
+ * Remark:  The source buffer must be valid until the call to ASM_Close.
+ *****************************************************************************/
+GLOB_ERROR ASM_CompileBuffer(const char * szName,
+                             const char * pcSource,
+                             size_t nLength,
+                             GLOB_ERRORCALLBACK pfnErrorsCallback,
+                             void * pvContext,
+                             int nThreads,
+                             PHASM_FILE phFile);
+
 /******************************************************************************
  * Name:    ASM_WriteBinary
- * Purpose: writes the binary of the object file to a memstream
+ * Purpose: get the binary of the object file: the code section and then the
+ *          data section
  * Parameters:
  *          hFile [IN] - handle to the compiled file
- *          phStream [OUT] - memory stream with the binary of the object file
- *          nCode [OUT] - size (in words) of the code section
- *          phFile [OUT] - size (in words) of the data section
+ *          ppwCode [OUT] - the words of the code section
+ *          pnCodeLength [OUT] - size (in words) of the code section
+ *          ppwData [OUT] - the words of the data section
+ *          pnDataLength [OUT] - size (in words) of the data section
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
- *          In this case, the caller must free the stream returned in phStream
  *          If the function fails, an error code is returned.
+ * Remark:  The sections are views into memory owned by the handle (nothing
+ *          is copied). They are valid until the call to ASM_Close.
  *****************************************************************************/
 GLOB_ERROR ASM_WriteBinary(HASM_FILE hFile,
-                           PHMEMSTREAM phStream,
-                           int * nCode,
-                           int * nData);
+                           const uint16_t ** ppwCode,
+                           int * pnCodeLength,
+                           const uint16_t ** ppwData,
+                           int * pnDataLength);
 
 /******************************************************************************
  * Name:    ASM_GetExternals
@@ -0,0 +1,318 @@
+/*****************************************************************************
+ * File:    asmc.c
+ * Author:  Doron Shvartztuch
+ * The client of the compile server (see SERVER). It has the same command
+ * line as the assembler, sends the files to the server and prints the
+ * messages the server returns, so it can replace the assembler in the build
+ * scripts.
+ *
+ * Implementation:
+ * The path of the socket is taken from the ASM_SERVER environment variable
+ * (or SERVER_DEFAULT_SOCKET). The client sends its current directory, so the
+ * server finds the relative files, and then the names of the files. The
+ * messages of each file are copied to the stdout as they arrive.
+ * The server answers while it reads the request, so the request is sent by
+ * another thread. Otherwise, once a long request fills the buffers of the
+ * socket, both of us would block on write.
+ * The exit code is the result the server returns.
+ * The client has its own main, so it is built by the "client" target of the
+ * Makefile and not by the configurations.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "global.h"
+#include "server.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The command line should include at least 2 arguments (the program name and
+ * a file to compile. */
+#define MIN_NUMBER_OF_ARGUMENTS 2
+
+/* The command line options. The number of jobs is accepted for compatibility
+ * with the assembler (the server has its own threads). */
+#define ASMC_JOBS_OPTION "-j"
+#define ASMC_STOP_OPTION "--stop"
+
+/* The size (in chars) of the chunks of the messages we copy */
+#define ASMC_COPY_CHUNK_SIZE 4096
+
+/* The maximum length (in chars) of a line of the response */
+#define ASMC_MAX_RESPONSE_LINE 64
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The request, as passed to the thread that sends it */
+typedef struct ASMC_REQUEST {
+    /* The stream to write the request to */
+    FILE * phRequest;
+    
+    /* Stop the server (and don't send any file) */
+    BOOL bStop;
+    
+    /* The directory of the relative names and the names of the files */
+    const char * pszDirectory;
+    const char ** ppszFiles;
+    int nFiles;
+} ASMC_REQUEST, *PASMC_REQUEST;
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static GLOB_ERROR asmc_Connect(FILE ** pphRequest, FILE ** pphResponse);
+static void * asmc_SendRequest(void * pvRequest);
+static GLOB_ERROR asmc_CopyMessages(FILE * phResponse, long nLength);
+static GLOB_ERROR asmc_ReadResponse(FILE * phResponse);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    asmc_Connect
+ * Purpose: Connect to the server
+ * Parameters:
+ *          pphRequest [OUT] - the stream to write the request to
+ *          pphResponse [OUT] - the stream to read the response from
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must close both streams.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR asmc_Connect(FILE ** pphRequest, FILE ** pphResponse) {
+    struct sockaddr_un tAddress;
+    const char * pszSocketPath = getenv(SERVER_SOCKET_VARIABLE);
+    int nSocket = -1;
+    int nResponseSocket = -1;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    if (NULL == pszSocketPath) {
+        pszSocketPath = SERVER_DEFAULT_SOCKET;
+    }
+    if (strlen(pszSocketPath) >= sizeof(tAddress.sun_path)) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    memset(&tAddress, 0, sizeof(tAddress));
+    tAddress.sun_family = AF_UNIX;
+    strcpy(tAddress.sun_path, pszSocketPath);
+    
+    /* Connect */
+    nSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == nSocket) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    if (0 != connect(nSocket, (struct sockaddr *)&tAddress, sizeof(tAddress))
+        || -1 == (nResponseSocket = dup(nSocket))) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        close(nSocket);
+        return eRetValue;
+    }
+    
+    /* Open the streams */
+    *pphRequest = fdopen(nSocket, "w");
+    *pphResponse = fdopen(nResponseSocket, "r");
+    if (NULL == *pphRequest || NULL == *pphResponse) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        if (NULL != *pphRequest) {
+            fclose(*pphRequest);
+        } else {
+            close(nSocket);
+        }
+        if (NULL != *pphResponse) {
+            fclose(*pphResponse);
+        } else {
+            close(nResponseSocket);
+        }
+        return eRetValue;
+    }
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    asmc_SendRequest
+ * Purpose: Send the request to the server and close its stream (the start
+ *          function of the thread that sends the request)
+ * Parameters:
+ *          pvRequest [IN] - the request (PASMC_REQUEST)
+ * Return Value:
+ *          NULL.
+ * Remark:  If the server closes the connection first (e.g. a different
+ *          version), the rest of the request is dropped. The response tells
+ *          why.
+ *****************************************************************************/
+static void * asmc_SendRequest(void * pvRequest) {
+    PASMC_REQUEST ptRequest = (PASMC_REQUEST)pvRequest;
+    
+    if (ptRequest->bStop) {
+        fprintf(ptRequest->phRequest, "%s\n", SERVER_REQUEST_STOP);
+    } else {
+        fprintf(ptRequest->phRequest, "%s %s\n%s %s\n",
+                SERVER_REQUEST_VERSION, GLOB_ASM_VERSION, SERVER_REQUEST_CWD,
+                ptRequest->pszDirectory);
+        for (int nIndex = 0; nIndex < ptRequest->nFiles; nIndex++) {
+            if (0 > fprintf(ptRequest->phRequest, "%s %s\n",
+                            SERVER_REQUEST_FILE,
+                            ptRequest->ppszFiles[nIndex])) {
+                break;
+            }
+        }
+        fprintf(ptRequest->phRequest, "%s\n", SERVER_REQUEST_END);
+    }
+    fclose(ptRequest->phRequest);
+    return NULL;
+}
+
+/******************************************************************************
+ * Name:    asmc_CopyMessages
+ * Purpose: Copy the messages of a file from the response to the stdout
+ * Parameters:
+ *          phResponse [IN] - the response
+ *          nLength [IN] - the length (in chars) of the messages
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR asmc_CopyMessages(FILE * phResponse, long nLength) {
+    char acChunk[ASMC_COPY_CHUNK_SIZE];
+    size_t nRead = 0;
+    
+    while (nLength > 0) {
+        nRead = fread(acChunk, 1, nLength < sizeof(acChunk) ? nLength
+                                                           : sizeof(acChunk),
+                      phResponse);
+        if (0 == nRead) {
+            return GLOB_ERROR_END_OF_FILE;
+        }
+        fwrite(acChunk, 1, nRead, stdout);
+        nLength -= nRead;
+    }
+    fflush(stdout);
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    asmc_ReadResponse
+ * Purpose: Print the messages of the response and get the result
+ * Parameters:
+ *          phResponse [IN] - the response
+ * Return Value:
+ *          The result the server returned (see main of the assembler).
+ *          If the response is broken, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR asmc_ReadResponse(FILE * phResponse) {
+    char szLine[ASMC_MAX_RESPONSE_LINE];
+    long nValue = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    while (NULL != fgets(szLine, sizeof(szLine), phResponse)) {
+        if (1 == sscanf(szLine, SERVER_RESPONSE_MESSAGES " %ld", &nValue)) {
+            eRetValue = asmc_CopyMessages(phResponse, nValue);
+            if (eRetValue) {
+                return eRetValue;
+            }
+        } else if (1 == sscanf(szLine, SERVER_RESPONSE_RESULT " %ld",
+                               &nValue)) {
+            return (GLOB_ERROR)nValue;
+        } else {
+            break;
+        }
+    }
+    return GLOB_ERROR_END_OF_FILE;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    main
+ * Purpose: send the files (as passed in the command line parameters) to the
+ *          server and print the messages
+ * Command Line:
+ *          asmc [-j <jobs>] <file1> <file2> ...
+ *          asmc --stop - stop the server
+ * Return Value:
+ *          The result of the server (same as the assembler).
+ *          If the program fails, an error code is returned.
+ *****************************************************************************/
+int main(int nArgc, const char * ppszArgv[]) {
+    char szDirectory[PATH_MAX];
+    FILE * phRequest = NULL;
+    FILE * phResponse = NULL;
+    ASMC_REQUEST tRequest;
+    pthread_t tSender;
+    BOOL bIsSenderStarted = FALSE;
+    BOOL bStop = FALSE;
+    int nFirstFile = 1;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Parse the options */
+    while (nFirstFile < nArgc) {
+        if (nFirstFile + 1 < nArgc
+            && 0 == strcmp(ppszArgv[nFirstFile], ASMC_JOBS_OPTION)) {
+            nFirstFile += 2;
+        } else if (0 == strcmp(ppszArgv[nFirstFile], ASMC_STOP_OPTION)) {
+            bStop = TRUE;
+            nFirstFile++;
+        } else {
+            break;
+        }
+    }
+    
+    /* Check for minimum number of arguments */
+    if (!bStop && nArgc - nFirstFile + 1 < MIN_NUMBER_OF_ARGUMENTS) {
+        printf("USAGE: %s [-j <jobs>] <file1> <file2> ...\n"
+               "       %s --stop\n", ppszArgv[0], ppszArgv[0]);
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    if (!bStop && NULL == getcwd(szDirectory, sizeof(szDirectory))) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    eRetValue = asmc_Connect(&phRequest, &phResponse);
+    if (eRetValue) {
+        printf("Can't connect to the server\n");
+        return eRetValue;
+    }
+    
+    /* Send the request while we print the response. A write to a closed
+     * connection should fail and not kill us. If the thread can't be
+     * started, the request is sent by this thread. */
+    signal(SIGPIPE, SIG_IGN);
+    tRequest.phRequest = phRequest;
+    tRequest.bStop = bStop;
+    tRequest.pszDirectory = szDirectory;
+    tRequest.ppszFiles = &ppszArgv[nFirstFile];
+    tRequest.nFiles = nArgc - nFirstFile;
+    if (0 == pthread_create(&tSender, NULL, asmc_SendRequest, &tRequest)) {
+        bIsSenderStarted = TRUE;
+    } else {
+        asmc_SendRequest(&tRequest);
+    }
+    
+    /* Print the response */
+    eRetValue = asmc_ReadResponse(phResponse);
+    fclose(phResponse);
+    if (bIsSenderStarted) {
+        pthread_join(tSender, NULL);
+    }
+    return eRetValue;
+}
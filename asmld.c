@@ -0,0 +1,237 @@
+/*****************************************************************************
+ * File:    asmld.c
+ * Author:  Doron Shvartztuch
+ * The linker of the compiled files (see LINKER). It links the output files
+ * (object, entries, externals) of the given files into one object file of a
+ * program, where the uses of the externals are resolved, so the emulator can
+ * run it.
+ *
+ * Implementation:
+ * The files of each compiled file are read to the memory, parsed by the
+ * OUTPUT module and added to the linker, by the order of the command line.
+ * The entries and externals files are optional (the assembler doesn't
+ * create empty files). The object file of the program is formatted by the
+ * OUTPUT module, like the assembler does.
+ * The linker has its own main, so it is built by the "linker" target of the
+ * Makefile and not by the configurations.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+#include "helper.h"
+#include "output.h"
+#include "linker.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The command line should include at least 4 arguments (the program name,
+ * the output option and its file, and a file to link. */
+#define MIN_NUMBER_OF_ARGUMENTS 4
+
+/* The command line option of the output file */
+#define ASMLD_OUTPUT_OPTION "-o"
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static GLOB_ERROR asmld_AddFile(HLINKER hLinker,
+                                const char * pszFileName,
+                                PLINKER_FAILURE ptFailure);
+static GLOB_ERROR asmld_WriteProgram(HLINKER hLinker,
+                                     const char * pszFileName,
+                                     PLINKER_FAILURE ptFailure);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    asmld_AddFile
+ * Purpose: Add the output files of a compiled file to the linker
+ * Parameters:
+ *          hLinker [IN] - handle to the linker
+ *          pszFileName [IN] - the file name (w/o extension)
+ *          ptFailure [OUT] - the symbol, if the linker failed on a symbol
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the files are not valid
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR asmld_AddFile(HLINKER hLinker,
+                                const char * pszFileName,
+                                PLINKER_FAILURE ptFailure) {
+    char * pszFullFileName = NULL;
+    char * pcObject = NULL;
+    size_t nObjectLength = 0;
+    uint16_t * pwWords = NULL;
+    int nCodeLength = 0;
+    int nDataLength = 0;
+    char * pcEntries = NULL;
+    PPACKED_SYMBOL patEntries = NULL;
+    int nEntries = 0;
+    char * pcExternals = NULL;
+    PPACKED_SYMBOL patExternals = NULL;
+    int nExternals = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Read & parse the object file */
+    pszFullFileName = HELPER_ConcatStrings(pszFileName,
+                                           GLOB_FILE_EXTENSION_BINARY);
+    if (NULL == pszFullFileName) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    pcObject = HELPER_ReadFile(pszFullFileName, &nObjectLength);
+    free(pszFullFileName);
+    if (NULL == pcObject) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    eRetValue = OUTPUT_ParseObject(pcObject, nObjectLength, &pwWords,
+                                   &nCodeLength, &nDataLength);
+    free(pcObject);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* Read & parse the entries & externals files */
+    eRetValue = OUTPUT_ReadTable(pszFileName, GLOB_FILE_EXTENSION_ENTRY,
+                                 &pcEntries, &patEntries, &nEntries);
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = OUTPUT_ReadTable(pszFileName, GLOB_FILE_EXTENSION_EXTERN,
+                                     &pcExternals, &patExternals,
+                                     &nExternals);
+        if (eRetValue) {
+            free(patEntries);
+            free(pcEntries);
+        }
+    }
+    if (eRetValue) {
+        free(pwWords);
+        return eRetValue;
+    }
+    
+    /* Add them to the linker */
+    eRetValue = LINKER_AddModule(hLinker, pwWords, nCodeLength, nDataLength,
+                                 patEntries, nEntries, patExternals,
+                                 nExternals, ptFailure);
+    
+    /* Free resources */
+    free(patExternals);
+    free(pcExternals);
+    free(patEntries);
+    free(pcEntries);
+    free(pwWords);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    asmld_WriteProgram
+ * Purpose: Link the program and write its object file
+ * Parameters:
+ *          hLinker [IN] - handle to the linker
+ *          pszFileName [IN] - the file name (w/o extension)
+ *          ptFailure [OUT] - the module and the symbol, if the linker
+ *                            failed on a symbol
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR asmld_WriteProgram(HLINKER hLinker,
+                                     const char * pszFileName,
+                                     PLINKER_FAILURE ptFailure) {
+    OUTPUT_FILES tFiles = {0};
+    uint16_t * pwWords = NULL;
+    int nCodeLength = 0;
+    int nDataLength = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    eRetValue = LINKER_Link(hLinker, &pwWords, &nCodeLength, &nDataLength,
+                            ptFailure);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    eRetValue = OUTPUT_FormatObject(pwWords, nCodeLength,
+                                    pwWords + nCodeLength, nDataLength,
+                                    &tFiles.pcObject, &tFiles.nObjectLength);
+    free(pwWords);
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = OUTPUT_WriteContent(pszFileName, &tFiles);
+    }
+    OUTPUT_FreeFiles(&tFiles);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    main
+ * Purpose: link the compiled files (as passed in the command line parameters)
+ * Command Line:
+ *          asmld -o <program> <file1> <file2> ...
+ *          The files are given w/o the extension (like the assembler). The
+ *          object file of the program is <program>.ob
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS (0) is returned.
+ *          If the linker fails, an error code is returned.
+ *****************************************************************************/
+int main(int nArgc, const char * ppszArgv[]) {
+    HLINKER hLinker = NULL;
+    LINKER_FAILURE tFailure = {0};
+    const char * pszProgram = NULL;
+    int nFirstFile = 3;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check for the arguments */
+    if (nArgc < MIN_NUMBER_OF_ARGUMENTS
+        || 0 != strcmp(ppszArgv[1], ASMLD_OUTPUT_OPTION)) {
+        printf("USAGE: %s -o <program> <file1> <file2> ...\n", ppszArgv[0]);
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    pszProgram = ppszArgv[2];
+    
+    eRetValue = LINKER_Create(&hLinker);
+    if (eRetValue) {
+        printf("Can't create the linker\n");
+        return eRetValue;
+    }
+    
+    /* Add the files */
+    for (int nIndex = nFirstFile; nIndex < nArgc; nIndex++) {
+        eRetValue = asmld_AddFile(hLinker, ppszArgv[nIndex], &tFailure);
+        if (GLOB_ERROR_ALREADY_EXIST == eRetValue) {
+            printf("%s: entry %s is already defined\n", ppszArgv[nIndex],
+                   tFailure.pszSymbol);
+        } else if (GLOB_ERROR_INVALID_PARAMETERS == eRetValue) {
+            printf("%s: not valid output files, or the program is too big "
+                   "for the memory\n", ppszArgv[nIndex]);
+        } else if (eRetValue) {
+            printf("Can't read %s\n", ppszArgv[nIndex]);
+        }
+        if (eRetValue) {
+            LINKER_Free(hLinker);
+            return eRetValue;
+        }
+    }
+    
+    /* Link & write the program */
+    eRetValue = asmld_WriteProgram(hLinker, pszProgram, &tFailure);
+    if (GLOB_ERROR_NOT_FOUND == eRetValue) {
+        printf("%s: extern %s is not an entry of any file\n",
+               ppszArgv[nFirstFile + tFailure.nModule], tFailure.pszSymbol);
+    } else if (eRetValue) {
+        printf("Can't write %s%s\n", pszProgram, GLOB_FILE_EXTENSION_BINARY);
+    }
+    LINKER_Free(hLinker);
+    return eRetValue;
+}
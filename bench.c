@@ -0,0 +1,702 @@
+/*****************************************************************************
+ * File:    bench.c
+ * Author:  Doron Shvartztuch
+ * The benchmark of the assembler. It generates a large, valid source file
+ * and measures the time of the lexing, the phases of the compilation and the
+ * formatting of the output files.
+ *
+ * Implementation:
+ * The source is generated in memory with a pseudo-random generator of our
+ * own, so the same seed produces the same source on every platform. The
+ * instructions are chosen from all the opcodes, and the operands from the
+ * methods allowed by g_znAllowedOperands (of the ASM module).
+ * The source is compiled from memory (ASM_CompileBuffer) and the output files
+ * are formatted in memory (OUTPUT_GetFiles), so the disk is not measured.
+ * Each step is repeated and the best time is reported. The times of the
+ * phases are taken from the STATS module.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "global.h"
+#include "buffer.h"
+#include "intern.h"
+#include "lex.h"
+#include "asm.h"
+#include "output.h"
+#include "stats.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The range of the generated numbers */
+#define BENCH_MAX_IMMEDIATE 500
+#define BENCH_MAX_DATA 2000
+
+/* The maximum number of values in .data line / chars in .string line */
+#define BENCH_MAX_DATA_VALUES 6
+#define BENCH_MAX_STRING_LENGTH 20
+
+/* The number of registers */
+#define BENCH_REGISTERS 8
+
+/* Conversion of the times */
+#define NANOSECONDS_IN_SECOND 1000000000LL
+#define NANOSECONDS_IN_MILLISECOND 1000000.0
+
+/* The name of the generated source (used in the messages) */
+#define BENCH_SOURCE_NAME "bench"
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The options of the benchmark (from the command line) */
+typedef struct BENCH_OPTIONS {
+    /* The seed of the generator */
+    unsigned int nSeed;
+    
+    /* The number of labels. Each label is defined in its own line. */
+    int nLabels;
+    
+    /* The percentage of the .data and .string lines */
+    int nDataPercent;
+    int nStringPercent;
+    
+    /* The number of .extern and .entry lines (percentage of the labels) */
+    int nExternPercent;
+    int nEntryPercent;
+    
+    /* The percentage of the jumps with parameters (when allowed) */
+    int nParameterPercent;
+    
+    /* The number of times to repeat each step */
+    int nRepeat;
+    
+    /* If not NULL, the generated source is written to this file */
+    const char * pszSourceFile;
+} BENCH_OPTIONS, *PBENCH_OPTIONS;
+
+/* The steps we measure. The phases are taken from the STATS module. */
+typedef enum BENCH_STEP {
+    BENCH_STEP_LEX,
+    BENCH_STEP_FIRST_PHASE,
+    BENCH_STEP_SYMTABLE_FINALIZE,
+    BENCH_STEP_RESOLVE_FIXUPS,
+    BENCH_STEP_PREPARE_ENTRIES,
+    BENCH_STEP_COMPILE,
+    BENCH_STEP_OUTPUT,
+    
+    /* The number of steps */
+    BENCH_STEP_COUNT
+} BENCH_STEP;
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static unsigned int bench_Random(unsigned int * pnState, unsigned int nRange);
+static int bench_RandomNumber(unsigned int * pnState, int nMax);
+static GLOB_ERROR bench_AppendSymbol(HBUFFER hSource,
+                                     unsigned int * pnState,
+                                     PBENCH_OPTIONS ptOptions,
+                                     int nExterns);
+static GLOB_ERROR bench_AppendOperand(HBUFFER hSource,
+                                      unsigned int * pnState,
+                                      PBENCH_OPTIONS ptOptions,
+                                      int nExterns,
+                                      int nAllowedMethods);
+static GLOB_ERROR bench_AppendLine(HBUFFER hSource,
+                                   unsigned int * pnState,
+                                   PBENCH_OPTIONS ptOptions,
+                                   int nExterns,
+                                   int nLabel,
+                                   BOOL * pbIsData);
+static GLOB_ERROR bench_Generate(PBENCH_OPTIONS ptOptions,
+                                 PHBUFFER phSource,
+                                 int * pnLines);
+static void bench_ErrorCallback(void * pvContext,
+                                const char * pszFileName,
+                                int nLine,
+                                int nColumn,
+                                const char * pszSourceLine,
+                                BOOL bIsError,
+                                const char * pszErrorFormat,
+                                va_list vaArgs);
+static long long bench_Now(void);
+static GLOB_ERROR bench_Lex(const char * pcSource, int nLength);
+static GLOB_ERROR bench_Run(const char * pcSource,
+                            int nLength,
+                            long long * panTimes);
+static GLOB_ERROR bench_ParseOptions(int nArgc,
+                                     const char * ppszArgv[],
+                                     PBENCH_OPTIONS ptOptions);
+
+/******************************************************************************
+ * CONSTANTS
+ *****************************************************************************/
+
+/* The names of the steps */
+static const char * g_aszSteps[BENCH_STEP_COUNT] = {
+    "lex",
+    "first_phase",
+    "symtable_finalize",
+    "resolve_fixups",
+    "prepare_entries",
+    "compile (total)",
+    "output",
+};
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    bench_Random
+ * Purpose: Get the next pseudo-random number (xorshift)
+ * Parameters:
+ *          pnState [IN OUT] - the state of the generator (not zero)
+ *          nRange [IN] - the range of the number
+ * Return Value:
+ *          A number in the range [0, nRange)
+ *****************************************************************************/
+static unsigned int bench_Random(unsigned int * pnState, unsigned int nRange) {
+    unsigned int nState = *pnState;
+    
+    nState ^= nState << 13;
+    nState ^= nState >> 17;
+    nState ^= nState << 5;
+    *pnState = nState;
+    return nState % nRange;
+}
+
+/******************************************************************************
+ * Name:    bench_RandomNumber
+ * Purpose: Get a pseudo-random number in the range [-nMax, nMax]
+ * Parameters:
+ *          pnState [IN OUT] - the state of the generator
+ *          nMax [IN] - the maximum absolute value of the number
+ * Return Value:
+ *          The number
+ *****************************************************************************/
+static int bench_RandomNumber(unsigned int * pnState, int nMax) {
+    return (int)bench_Random(pnState, 2 * nMax + 1) - nMax;
+}
+
+/******************************************************************************
+ * Name:    bench_AppendSymbol
+ * Purpose: Append a usage of a label or an extern to the source
+ * Parameters:
+ *          hSource [IN] - the source
+ *          pnState [IN OUT] - the state of the generator
+ *          ptOptions [IN] - the options of the benchmark
+ *          nExterns [IN] - the number of externs
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR bench_AppendSymbol(HBUFFER hSource,
+                                     unsigned int * pnState,
+                                     PBENCH_OPTIONS ptOptions,
+                                     int nExterns) {
+    unsigned int nSymbol = bench_Random(pnState, ptOptions->nLabels + nExterns);
+    
+    if (nSymbol < ptOptions->nLabels) {
+        return BUFFER_AppendPrintf(hSource, "L%u", nSymbol);
+    }
+    return BUFFER_AppendPrintf(hSource, "X%u", nSymbol - ptOptions->nLabels);
+}
+
+/******************************************************************************
+ * Name:    bench_AppendOperand
+ * Purpose: Append an operand to the source
+ * Parameters:
+ *          hSource [IN] - the source
+ *          pnState [IN OUT] - the state of the generator
+ *          ptOptions [IN] - the options of the benchmark
+ *          nExterns [IN] - the number of externs
+ *          nAllowedMethods [IN] - the allowed methods (see
+ *                                 ASM_GET_ALLOWED_SOURCE_OPERAND)
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR bench_AppendOperand(HBUFFER hSource,
+                                      unsigned int * pnState,
+                                      PBENCH_OPTIONS ptOptions,
+                                      int nExterns,
+                                      int nAllowedMethods) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    ASM_OPERAND_METHOD eMethod = ASM_OPERAND_METHOD_IMMEDIATE;
+    BOOL bIsChosen = FALSE;
+    
+    /* Choose the method. Jumps with parameters have their own percentage. */
+    if (ASM_IS_PARAMETER_OPERAND_ALLOWED(nAllowedMethods)
+        && bench_Random(pnState, 100) < ptOptions->nParameterPercent) {
+        eMethod = ASM_OPERAND_METHOD_PARAMETERS;
+        bIsChosen = TRUE;
+    }
+    while (!bIsChosen) {
+        eMethod = (ASM_OPERAND_METHOD)bench_Random(pnState, 4);
+        bIsChosen = (ASM_OPERAND_METHOD_PARAMETERS != eMethod
+                     && ASM_IS_METHOD_ALLOWED(nAllowedMethods, eMethod));
+    }
+    
+    switch (eMethod) {
+        case ASM_OPERAND_METHOD_IMMEDIATE:
+            return BUFFER_AppendPrintf(hSource, "#%d",
+                    bench_RandomNumber(pnState, BENCH_MAX_IMMEDIATE));
+        case ASM_OPERAND_METHOD_REGISTER:
+            return BUFFER_AppendPrintf(hSource, "r%u",
+                    bench_Random(pnState, BENCH_REGISTERS));
+        case ASM_OPERAND_METHOD_DIRECT:
+            return bench_AppendSymbol(hSource, pnState, ptOptions, nExterns);
+        default:
+            /* A jump with 2 parameters. Each parameter is an immediate
+             * number, a register or a label. */
+            eRetValue = bench_AppendSymbol(hSource, pnState,
+                                           ptOptions, nExterns);
+            for (int nIndex = 0; !eRetValue && nIndex < 2; nIndex++) {
+                eRetValue = BUFFER_AppendPrintf(hSource, nIndex ? "," : "(");
+                if (!eRetValue) {
+                    eRetValue = bench_AppendOperand(hSource, pnState,
+                            ptOptions, nExterns,
+                            ASM_ALLOWED_OPERANDS_AS_PARAM);
+                }
+            }
+            if (eRetValue) {
+                return eRetValue;
+            }
+            return BUFFER_AppendPrintf(hSource, ")");
+    }
+}
+
+/******************************************************************************
+ * Name:    bench_AppendLine
+ * Purpose: Append a line with a label definition to the source. The line is
+ *          a .data line, a .string line or an instruction.
+ * Parameters:
+ *          hSource [IN] - the source
+ *          pnState [IN OUT] - the state of the generator
+ *          ptOptions [IN] - the options of the benchmark
+ *          nExterns [IN] - the number of externs
+ *          nLabel [IN] - the index of the label to define
+ *          pbIsData [OUT] - TRUE if the label is a data label
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR bench_AppendLine(HBUFFER hSource,
+                                   unsigned int * pnState,
+                                   PBENCH_OPTIONS ptOptions,
+                                   int nExterns,
+                                   int nLabel,
+                                   BOOL * pbIsData) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    unsigned int nKind = bench_Random(pnState, 100);
+    int nOpcode = 0;
+    int nValues = 0;
+    
+    *pbIsData = (nKind < ptOptions->nDataPercent + ptOptions->nStringPercent);
+    if (nKind < ptOptions->nDataPercent) {
+        /* .data line */
+        nValues = 1 + bench_Random(pnState, BENCH_MAX_DATA_VALUES);
+        eRetValue = BUFFER_AppendPrintf(hSource, "L%d: .data %d", nLabel,
+                bench_RandomNumber(pnState, BENCH_MAX_DATA));
+        for (int nIndex = 1; !eRetValue && nIndex < nValues; nIndex++) {
+            eRetValue = BUFFER_AppendPrintf(hSource, ",%d",
+                    bench_RandomNumber(pnState, BENCH_MAX_DATA));
+        }
+    } else if (nKind < ptOptions->nDataPercent + ptOptions->nStringPercent) {
+        /* .string line */
+        nValues = bench_Random(pnState, BENCH_MAX_STRING_LENGTH + 1);
+        eRetValue = BUFFER_AppendPrintf(hSource, "L%d: .string \"", nLabel);
+        for (int nIndex = 0; !eRetValue && nIndex < nValues; nIndex++) {
+            eRetValue = BUFFER_AppendPrintf(hSource, "%c",
+                    "abcXYZ 09"[bench_Random(pnState, 9)]);
+        }
+        if (!eRetValue) {
+            eRetValue = BUFFER_AppendPrintf(hSource, "\"");
+        }
+    } else {
+        /* Instruction: the opcode and the operands it expects */
+        nOpcode = bench_Random(pnState, GLOB_OPCODE_STOP + 1);
+        eRetValue = BUFFER_AppendPrintf(hSource, "L%d:\t%s", nLabel,
+                                        g_aszOpcodeNames[nOpcode]);
+        if (!eRetValue && ASM_GET_ALLOWED_SOURCE_OPERAND(nOpcode)) {
+            eRetValue = BUFFER_AppendPrintf(hSource, " ");
+            if (!eRetValue) {
+                eRetValue = bench_AppendOperand(hSource, pnState, ptOptions,
+                        nExterns, ASM_GET_ALLOWED_SOURCE_OPERAND(nOpcode));
+            }
+            if (!eRetValue) {
+                eRetValue = BUFFER_AppendPrintf(hSource, ",");
+            }
+        }
+        if (!eRetValue && ASM_GET_ALLOWED_DESTINATION_OPERAND(nOpcode)) {
+            eRetValue = BUFFER_AppendPrintf(hSource, " ");
+            if (!eRetValue) {
+                eRetValue = bench_AppendOperand(hSource, pnState, ptOptions,
+                        nExterns, ASM_GET_ALLOWED_DESTINATION_OPERAND(nOpcode));
+            }
+        }
+    }
+    if (eRetValue) {
+        return eRetValue;
+    }
+    return BUFFER_AppendPrintf(hSource, "\n");
+}
+
+/******************************************************************************
+ * Name:    bench_Generate
+ * Purpose: Generate the source of the benchmark
+ * Parameters:
+ *          ptOptions [IN] - the options of the benchmark
+ *          phSource [OUT] - the generated source
+ *          pnLines [OUT] - the number of lines in the source
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the source with BUFFER_Free.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR bench_Generate(PBENCH_OPTIONS ptOptions,
+                                 PHBUFFER phSource,
+                                 int * pnLines) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    HBUFFER hSource = NULL;
+    unsigned int nState = (ptOptions->nSeed * 2654435761u) | 1;
+    int nExterns = (int)((long long)ptOptions->nLabels
+                         * ptOptions->nExternPercent / 100);
+    int nEntries = (int)((long long)ptOptions->nLabels
+                         * ptOptions->nEntryPercent / 100);
+    int nLines = 0;
+    int nFirstDataLabel = -1;
+    int nLabel = 0;
+    BOOL bIsData = FALSE;
+    
+    eRetValue = BUFFER_Create(&hSource);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* The externs */
+    for (int nIndex = 0; !eRetValue && nIndex < nExterns; nIndex++) {
+        eRetValue = BUFFER_AppendPrintf(hSource, ".extern X%d\n", nIndex);
+        nLines++;
+    }
+    
+    /* The lines of the labels, with some remarks and empty lines */
+    for (int nIndex = 0; !eRetValue && nIndex < ptOptions->nLabels; nIndex++) {
+        eRetValue = bench_AppendLine(hSource, &nState, ptOptions,
+                                     nExterns, nIndex, &bIsData);
+        nLines++;
+        if (bIsData && -1 == nFirstDataLabel) {
+            nFirstDataLabel = nIndex;
+        }
+        if (!eRetValue && 0 == bench_Random(&nState, 20)) {
+            eRetValue = BUFFER_AppendPrintf(hSource, "; remark line\n\n");
+            nLines += 2;
+        }
+    }
+    
+    /* The entries (spread over the labels). The symbols table treats
+     * address 0 as undefined, so the first data label (at data offset 0)
+     * can't be exported. */
+    for (int nIndex = 0; !eRetValue && nIndex < nEntries; nIndex++) {
+        nLabel = (int)((long long)nIndex * ptOptions->nLabels / nEntries);
+        if (nLabel != nFirstDataLabel) {
+            eRetValue = BUFFER_AppendPrintf(hSource, ".entry L%d\n", nLabel);
+            nLines++;
+        }
+    }
+    
+    if (eRetValue) {
+        BUFFER_Free(hSource);
+        return eRetValue;
+    }
+    *phSource = hSource;
+    *pnLines = nLines;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    bench_ErrorCallback
+ * Purpose: Print the errors/warnings of the generated source (there shouldn't
+ *          be any)
+ * Parameters:
+ *          See GLOB_ErrorOrWarningCallback declaration.
+ *****************************************************************************/
+static void bench_ErrorCallback(void * pvContext,
+                                const char * pszFileName,
+                                int nLine,
+                                int nColumn,
+                                const char * pszSourceLine,
+                                BOOL bIsError,
+                                const char * pszErrorFormat,
+                                va_list vaArgs) {
+    fprintf(stderr, "%s:%d:%d %s: ", pszFileName, nLine, nColumn,
+            bIsError ? "error" : "warning");
+    vfprintf(stderr, pszErrorFormat, vaArgs);
+    fprintf(stderr, "\n");
+}
+
+/******************************************************************************
+ * Name:    bench_Now
+ * Purpose: Get the current time
+ * Return Value:
+ *          The time (in nanoseconds)
+ *****************************************************************************/
+static long long bench_Now(void) {
+    struct timespec tNow;
+    
+    clock_gettime(CLOCK_MONOTONIC, &tNow);
+    return tNow.tv_sec * NANOSECONDS_IN_SECOND + tNow.tv_nsec;
+}
+
+/******************************************************************************
+ * Name:    bench_Lex
+ * Purpose: Read all the tokens of the source
+ * Parameters:
+ *          pcSource [IN] - the source
+ *          nLength [IN] - the length (in chars) of the source
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR bench_Lex(const char * pcSource, int nLength) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    HINTERN_TABLE hNames = NULL;
+    HLEX_FILE hLex = NULL;
+    LEX_LINE tLine;
+    
+    eRetValue = INTERN_Create(&hNames);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    eRetValue = LEX_OpenBuffer(BENCH_SOURCE_NAME, pcSource, nLength, hNames,
+                               bench_ErrorCallback, NULL, &hLex);
+    if (eRetValue) {
+        INTERN_Free(hNames);
+        return eRetValue;
+    }
+    while (GLOB_SUCCESS == (eRetValue = LEX_ReadLine(hLex, &tLine))) {
+        LEX_FreeLine(hLex, &tLine);
+    }
+    LEX_Close(hLex);
+    INTERN_Free(hNames);
+    return GLOB_ERROR_END_OF_FILE == eRetValue ? GLOB_SUCCESS : eRetValue;
+}
+
+/******************************************************************************
+ * Name:    bench_Run
+ * Purpose: Run all the steps once
+ * Parameters:
+ *          pcSource [IN] - the source
+ *          nLength [IN] - the length (in chars) of the source
+ *          panTimes [OUT] - the time of each step (in nanoseconds)
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR bench_Run(const char * pcSource,
+                            int nLength,
+                            long long * panTimes) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    HASM_FILE hAsm = NULL;
+    OUTPUT_FILES tFiles;
+    STATS tStats = {{0}};
+    long long nStartTime = 0;
+    
+    /* Lexing only */
+    nStartTime = bench_Now();
+    eRetValue = bench_Lex(pcSource, nLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    panTimes[BENCH_STEP_LEX] = bench_Now() - nStartTime;
+    
+    /* Compilation (the phases are measured by the STATS module) */
+    STATS_SetCurrent(&tStats);
+    nStartTime = bench_Now();
+    eRetValue = ASM_CompileBuffer(BENCH_SOURCE_NAME, pcSource, nLength,
+                                  bench_ErrorCallback, NULL, 1, &hAsm);
+    panTimes[BENCH_STEP_COMPILE] = bench_Now() - nStartTime;
+    STATS_SetCurrent(NULL);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    panTimes[BENCH_STEP_FIRST_PHASE] =
+            tStats.anPhaseNanoseconds[STATS_PHASE_FIRST_PHASE];
+    panTimes[BENCH_STEP_SYMTABLE_FINALIZE] =
+            tStats.anPhaseNanoseconds[STATS_PHASE_SYMTABLE_FINALIZE];
+    panTimes[BENCH_STEP_RESOLVE_FIXUPS] =
+            tStats.anPhaseNanoseconds[STATS_PHASE_RESOLVE_FIXUPS];
+    panTimes[BENCH_STEP_PREPARE_ENTRIES] =
+            tStats.anPhaseNanoseconds[STATS_PHASE_PREPARE_ENTRIES];
+    
+    /* The output files (in memory) */
+    nStartTime = bench_Now();
+    eRetValue = OUTPUT_GetFiles(hAsm, &tFiles);
+    if (!eRetValue) {
+        OUTPUT_FreeFiles(&tFiles);
+    }
+    panTimes[BENCH_STEP_OUTPUT] = bench_Now() - nStartTime;
+    
+    ASM_Close(hAsm);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    bench_ParseOptions
+ * Purpose: Parse the command line
+ * Parameters:
+ *          nArgc [IN] - number of arguments
+ *          ppszArgv [IN] - the arguments
+ *          ptOptions [IN OUT] - the options (with the default values)
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_INVALID_PARAMETERS - invalid command line
+ *****************************************************************************/
+static GLOB_ERROR bench_ParseOptions(int nArgc,
+                                     const char * ppszArgv[],
+                                     PBENCH_OPTIONS ptOptions) {
+    int * pnValue = NULL;
+    char * pcEnd = NULL;
+    
+    for (int nIndex = 1; nIndex < nArgc; nIndex += 2) {
+        if (nIndex + 1 >= nArgc || '-' != ppszArgv[nIndex][0]
+            || '\0' == ppszArgv[nIndex][1] || '\0' != ppszArgv[nIndex][2]) {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        
+        /* Find the value of the option */
+        switch (ppszArgv[nIndex][1]) {
+            case 's': pnValue = (int *)&ptOptions->nSeed; break;
+            case 'n': pnValue = &ptOptions->nLabels; break;
+            case 'd': pnValue = &ptOptions->nDataPercent; break;
+            case 't': pnValue = &ptOptions->nStringPercent; break;
+            case 'x': pnValue = &ptOptions->nExternPercent; break;
+            case 'e': pnValue = &ptOptions->nEntryPercent; break;
+            case 'p': pnValue = &ptOptions->nParameterPercent; break;
+            case 'r': pnValue = &ptOptions->nRepeat; break;
+            case 'o':
+                ptOptions->pszSourceFile = ppszArgv[nIndex + 1];
+                continue;
+            default:
+                return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        *pnValue = (int)strtol(ppszArgv[nIndex + 1], &pcEnd, 10);
+        if ('\0' != *pcEnd || *pnValue < 0) {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+    }
+    
+    /* Check the values */
+    if (ptOptions->nLabels < 1 || ptOptions->nRepeat < 1
+        || ptOptions->nDataPercent + ptOptions->nStringPercent > 100
+        || ptOptions->nExternPercent > 100 || ptOptions->nEntryPercent > 100
+        || ptOptions->nParameterPercent > 100) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    main
+ * Purpose: Generate a source and measure the assembler
+ * Command Line:
+ *          bench [-s <seed>] [-n <labels>] [-d <data%>] [-t <string%>]
+ *                [-x <extern%>] [-e <entry%>] [-p <parameter%>]
+ *                [-r <repeat>] [-o <file.as>]
+ *          -s - the seed of the generator. The same seed (and options)
+ *               produces the same source.
+ *          -n - the number of labels (lines)
+ *          -d/-t - the percentage of the .data/.string lines
+ *          -x/-e - the number of .extern/.entry lines (percentage of the
+ *                  labels)
+ *          -p - the percentage of the jumps with parameters
+ *          -r - the number of times to repeat each step
+ *          -o - write the generated source to a file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS (0) is returned.
+ *          If the program fails, an error code is returned.
+ *****************************************************************************/
+int main(int nArgc, const char * ppszArgv[]) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    BENCH_OPTIONS tOptions = {1, 100000, 15, 5, 5, 10, 50, 5, NULL};
+    HBUFFER hSource = NULL;
+    char * pcSource = NULL;
+    int nLength = 0;
+    int nLines = 0;
+    long long anTimes[BENCH_STEP_COUNT];
+    long long anBestTimes[BENCH_STEP_COUNT];
+    FILE * pfSource = NULL;
+    double dMilliseconds = 0;
+    
+    eRetValue = bench_ParseOptions(nArgc, ppszArgv, &tOptions);
+    if (eRetValue) {
+        printf("USAGE: %s [-s <seed>] [-n <labels>] [-d <data%%>] "
+               "[-t <string%%>] [-x <extern%%>] [-e <entry%%>] "
+               "[-p <parameter%%>] [-r <repeat>] [-o <file.as>]\n",
+               ppszArgv[0]);
+        return eRetValue;
+    }
+    
+    /* Generate the source */
+    eRetValue = bench_Generate(&tOptions, &hSource, &nLines);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    BUFFER_GetStream(hSource, &pcSource, &nLength);
+    if (NULL != tOptions.pszSourceFile) {
+        pfSource = fopen(tOptions.pszSourceFile, "w");
+        if (NULL == pfSource) {
+            eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+            BUFFER_Free(hSource);
+            return eRetValue;
+        }
+        fwrite(pcSource, 1, nLength, pfSource);
+        fclose(pfSource);
+    }
+    
+    /* Run the steps and keep the best times */
+    for (int nRun = 0; nRun < tOptions.nRepeat; nRun++) {
+        eRetValue = bench_Run(pcSource, nLength, anTimes);
+        if (eRetValue) {
+            printf("The benchmark failed: 0x%x\n", eRetValue);
+            BUFFER_Free(hSource);
+            return eRetValue;
+        }
+        for (int nStep = 0; nStep < BENCH_STEP_COUNT; nStep++) {
+            if (0 == nRun || anTimes[nStep] < anBestTimes[nStep]) {
+                anBestTimes[nStep] = anTimes[nStep];
+            }
+        }
+    }
+    
+    /* Print the results */
+    printf("seed %u: %d labels, %d lines, %d bytes (best of %d runs)\n",
+           tOptions.nSeed, tOptions.nLabels, nLines, nLength,
+           tOptions.nRepeat);
+    for (int nStep = 0; nStep < BENCH_STEP_COUNT; nStep++) {
+        dMilliseconds = anBestTimes[nStep] / NANOSECONDS_IN_MILLISECOND;
+        printf("  %-20s %10.3f ms %10.0f lines/s\n", g_aszSteps[nStep],
+               dMilliseconds,
+               dMilliseconds > 0 ? nLines / (dMilliseconds / 1000) : 0);
+    }
+    
+    BUFFER_Free(hSource);
+    return GLOB_SUCCESS;
+}
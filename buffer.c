@@ -18,6 +18,7 @@
 #include <string.h>
 #include "helper.h"
 #include "buffer.h"
+#include "stats.h"
 
 /******************************************************************************
  * CONSTANTS & MACROS
@@ -30,6 +31,9 @@
 /* maximum size (in chars) of strings we can write to the buffer */
 #define MAX_STRING_SIZE 80
 
+/* maximum size (in chars) of a decimal int, including the sign */
+#define MAX_INT_DIGITS 11
+
 /******************************************************************************
  * TYPEDEFS
  *****************************************************************************/
@@ -82,6 +86,8 @@ static GLOB_ERROR buffer_EnsureSpace(HBUFFER hStream, int nSpace) {
                         hStream->nAllocated * (BUFFER_EXPAND_FACTOR-1));
     
     /* Reallocate */
+    STATS_CountAllocation(STATS_MODULE_BUFFER,
+                          hStream->nAllocated + nNeedToAllocate);
     pnNewStream = realloc(hStream->pnStream, hStream->nAllocated + nNeedToAllocate);
     if (NULL == pnNewStream) {
         return GLOB_ERROR_SYS_CALL_ERROR();
@@ -110,6 +116,7 @@ GLOB_ERROR BUFFER_Create(PHBUFFER phStream) {
     }
     
     /* Allocate the handle */
+    STATS_CountAllocation(STATS_MODULE_BUFFER, sizeof(*hStream));
     hStream = malloc(sizeof(*hStream));
     if (NULL == hStream) {
         return GLOB_ERROR_SYS_CALL_ERROR();
@@ -118,6 +125,8 @@ GLOB_ERROR BUFFER_Create(PHBUFFER phStream) {
     hStream->nUsed = 0;
     
     /* Allocate the default stream */
+    STATS_CountAllocation(STATS_MODULE_BUFFER,
+                          hStream->nAllocated * sizeof(int));
     hStream->pnStream = malloc(hStream->nAllocated * sizeof(int));
     if (NULL == hStream) {
         eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
@@ -135,35 +144,119 @@ GLOB_ERROR BUFFER_Create(PHBUFFER phStream) {
  * Name:    BUFFER_AppendPrintf
  *****************************************************************************/
 GLOB_ERROR BUFFER_AppendPrintf(HBUFFER hStream, const char * pszFormat, ...) {        
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    va_list vaArgs;
+    
+    va_start (vaArgs, pszFormat);
+    eRetValue = BUFFER_AppendVPrintf(hStream, pszFormat, vaArgs);
+    va_end (vaArgs);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    BUFFER_AppendVPrintf
+ *****************************************************************************/
+GLOB_ERROR BUFFER_AppendVPrintf(HBUFFER hStream, const char * pszFormat,
+                                va_list vaArgs) {
     char szFormatted[MAX_STRING_SIZE];
     int nLength = 0;
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
-
+    va_list vaArgsCopy;
     
     if (NULL == hStream || NULL == pszFormat) {
         return GLOB_ERROR_INVALID_PARAMETERS;
     }
     
-    /* format the parameters into the format string */
-    va_list vaArgs;
-    va_start (vaArgs, pszFormat);
+    /* format the parameters into the format string. We keep a copy of the
+     * arguments in case the string is too long for the local buffer */
+    va_copy (vaArgsCopy, vaArgs);
     nLength = vsnprintf (szFormatted, sizeof(szFormatted), pszFormat, vaArgs);
-    va_end (vaArgs);
     if (nLength < 0) {
+        va_end (vaArgsCopy);
         return GLOB_ERROR_SYS_CALL_ERROR();
     }
     
-    /* Ensure enough space */
-    eRetValue = buffer_EnsureSpace(hStream, nLength);
+    /* Ensure enough space (including the '\0' of a long string) */
+    eRetValue = buffer_EnsureSpace(hStream, nLength + 1);
     if (eRetValue) {
+        va_end (vaArgsCopy);
         return eRetValue;
     }
     
-    /* Copy the string (without the '\0') */
-    memcpy(hStream->pnStream+hStream->nUsed, szFormatted, nLength);
+    /* Copy the string (without the '\0'). A long string is formatted again,
+     * directly into the stream */
+    if (nLength < sizeof(szFormatted)) {
+        memcpy(hStream->pnStream+hStream->nUsed, szFormatted, nLength);
+    } else {
+        vsnprintf (hStream->pnStream+hStream->nUsed, nLength + 1,
+                   pszFormat, vaArgsCopy);
+    }
+    va_end (vaArgsCopy);
     hStream->nUsed += nLength;
     return GLOB_SUCCESS;
 }
+
+/******************************************************************************
+ * Name:    BUFFER_AppendString
+ *****************************************************************************/
+GLOB_ERROR BUFFER_AppendString(HBUFFER hStream, const char * pcStr,
+                               int nLength) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    if (NULL == hStream || NULL == pcStr || nLength < 0) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    eRetValue = buffer_EnsureSpace(hStream, nLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    memcpy(hStream->pnStream + hStream->nUsed, pcStr, nLength);
+    hStream->nUsed += nLength;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    BUFFER_AppendChar
+ *****************************************************************************/
+GLOB_ERROR BUFFER_AppendChar(HBUFFER hStream, char cChar) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    if (NULL == hStream) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    eRetValue = buffer_EnsureSpace(hStream, 1);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    hStream->pnStream[hStream->nUsed++] = cChar;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    BUFFER_AppendInt
+ *****************************************************************************/
+GLOB_ERROR BUFFER_AppendInt(HBUFFER hStream, int nNumber) {
+    char acDigits[MAX_INT_DIGITS];
+    int nFirst = sizeof(acDigits);
+    unsigned int nValue = 0;
+    
+    if (NULL == hStream) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Write the digits from the end of the local buffer. The absolute value
+     * is unsigned, so it fits also for INT_MIN */
+    nValue = nNumber < 0 ? 0U - (unsigned int)nNumber : (unsigned int)nNumber;
+    do {
+        acDigits[--nFirst] = '0' + nValue % 10;
+        nValue /= 10;
+    } while (0 != nValue);
+    if (nNumber < 0) {
+        acDigits[--nFirst] = '-';
+    }
+    return BUFFER_AppendString(hStream, acDigits + nFirst,
+                               sizeof(acDigits) - nFirst);
+}
     
 /******************************************************************************
  * Name:    BUFFER_GetStream
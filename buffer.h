@@ -36,8 +36,72 @@ typedef struct BUFFER BUFFER, *HBUFFER, **PHBUFFER;
  *****************************************************************************/
 GLOB_ERROR BUFFER_Create(PHBUFFER phStream);
 
+/******************************************************************************
+ * Name:    BUFFER_AppendPrintf
+ * Purpose: Append a formatted string (printf syntax) to the stream.
+ *          The '\0' is not appended.
+ * Parameters:
+ *          hStream [IN] - the handle to the stream.
+ *          pszFormat [IN] - the format string
+ *          ... [IN] - parameters to include in the string
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
 GLOB_ERROR BUFFER_AppendPrintf(HBUFFER hStream, const char * pszFormat, ...);
 
+/******************************************************************************
+ * Name:    BUFFER_AppendVPrintf
+ * Purpose: Same as BUFFER_AppendPrintf, with a va_list of the parameters
+ * Parameters:
+ *          hStream [IN] - the handle to the stream.
+ *          pszFormat [IN] - the format string
+ *          vaArgs [IN] - parameters to include in the string
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR BUFFER_AppendVPrintf(HBUFFER hStream, const char * pszFormat,
+                                va_list vaArgs);
+
+/******************************************************************************
+ * Name:    BUFFER_AppendString
+ * Purpose: Append a string to the stream. The '\0' is not appended.
+ * Parameters:
+ *          hStream [IN] - the handle to the stream.
+ *          pcStr [IN] - the string (doesn't have to be null-terminated)
+ *          nLength [IN] - the length (in chars) of the string
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR BUFFER_AppendString(HBUFFER hStream, const char * pcStr,
+                               int nLength);
+
+/******************************************************************************
+ * Name:    BUFFER_AppendChar
+ * Purpose: Append a char (for example, a tab or a new line) to the stream
+ * Parameters:
+ *          hStream [IN] - the handle to the stream.
+ *          cChar [IN] - the char
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR BUFFER_AppendChar(HBUFFER hStream, char cChar);
+
+/******************************************************************************
+ * Name:    BUFFER_AppendInt
+ * Purpose: Append a number, in decimal base (like the "%d" of printf)
+ * Parameters:
+ *          hStream [IN] - the handle to the stream.
+ *          nNumber [IN] - the number
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR BUFFER_AppendInt(HBUFFER hStream, int nNumber);
+
 /******************************************************************************
  * Name:    BUFFER_GetStream
  * Purpose: get a pointer to the memory block itself
@@ -0,0 +1,334 @@
+/******************************************************************************
+ * File:    cache.c
+ * Author:  Doron Shvartztuch
+ * The CACHE module keeps the output files of compiled files in a directory.
+ *
+ * Implementation:
+ * The key is the 64-bit FNV-1a hash of the version of the assembler and the
+ * content of the source file. Each key has one file in the directory, named
+ * after the key in hex. The file has a header line with the version, a line
+ * with the lengths of the object, entries & externals files, and then their
+ * content as is. A file with a different version or a bad length is treated
+ * as a missing file, so we never fail because of the cache content.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "global.h"
+#include "output.h"
+#include "stats.h"
+#include "cache.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* Constants of the 64-bit FNV-1a hash function */
+#define CACHE_HASH_OFFSET_BASIS 14695981039346656037ULL
+#define CACHE_HASH_PRIME 1099511628211ULL
+
+/* The number of hex digits in the name of a cached file */
+#define CACHE_KEY_DIGITS 16
+
+/* The name of the temporary files (for mkstemp). It must not be longer than
+ * CACHE_KEY_DIGITS. */
+#define CACHE_TEMP_NAME "tmpXXXXXX"
+
+/* The first line of a cached file */
+#define CACHE_HEADER "ASMCACHE " GLOB_ASM_VERSION "\n"
+
+/* The maximum length (in chars) of the first line of a cached file */
+#define CACHE_MAX_HEADER_LENGTH 64
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* CACHE is the struct behind the HCACHE */
+struct CACHE {
+    /* The path to the directory */
+    char * pszDirectory;
+};
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static uint64_t cache_Hash(uint64_t nHash, const char * pcData, size_t nLength);
+static char * cache_GetPath(HCACHE hCache, const char * pszName, uint64_t nKey);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    cache_Hash
+ * Purpose: Add data to a FNV-1a hash
+ * Parameters:
+ *          nHash [IN] - the hash of the previous data (or
+ *                       CACHE_HASH_OFFSET_BASIS)
+ *          pcData [IN] - the data
+ *          nLength [IN] - the length (in chars) of the data
+ * Return Value:
+ *          The hash, with the data
+ *****************************************************************************/
+static uint64_t cache_Hash(uint64_t nHash, const char * pcData, size_t nLength){
+    for (size_t nIndex = 0; nIndex < nLength; nIndex++) {
+        nHash ^= (unsigned char)pcData[nIndex];
+        nHash *= CACHE_HASH_PRIME;
+    }
+    return nHash;
+}
+
+/******************************************************************************
+ * Name:    cache_GetPath
+ * Purpose: Get the path to a file in the cache directory
+ * Parameters:
+ *          hCache [IN] - the handle to the cache
+ *          pszName [IN OPTIONAL] - the name of the file. If NULL, the name is
+ *                                  the key in hex.
+ *          nKey [IN] - the key
+ * Return Value:
+ *          Upon successful completion, the path is returned. The caller
+ *          should free it with the free function.
+ *          If the function fails, NULL is returned.
+ *****************************************************************************/
+static char * cache_GetPath(HCACHE hCache, const char * pszName, uint64_t nKey){
+    size_t nSize = strlen(hCache->pszDirectory) + 1 + CACHE_KEY_DIGITS + 1;
+    char * pszPath = NULL;
+    
+    STATS_CountAllocation(STATS_MODULE_CACHE, nSize);
+    pszPath = malloc(nSize);
+    if (NULL == pszPath) {
+        return NULL;
+    }
+    if (NULL != pszName) {
+        snprintf(pszPath, nSize, "%s/%s", hCache->pszDirectory, pszName);
+    } else {
+        snprintf(pszPath, nSize, "%s/%016" PRIx64, hCache->pszDirectory, nKey);
+    }
+    return pszPath;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    CACHE_Open
+ *****************************************************************************/
+GLOB_ERROR CACHE_Open(const char * szDirectory, PHCACHE phCache) {
+    HCACHE hCache = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == szDirectory || NULL == phCache) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Create the directory */
+    if (0 != mkdir(szDirectory, 0777) && EEXIST != errno) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Allocate the handle */
+    STATS_CountAllocation(STATS_MODULE_CACHE, sizeof(*hCache));
+    hCache = malloc(sizeof(*hCache));
+    if (NULL == hCache) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    hCache->pszDirectory = HELPER_ConcatStrings(szDirectory, "");
+    if (NULL == hCache->pszDirectory) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        free(hCache);
+        return eRetValue;
+    }
+    
+    /* Set out parameter upon success */
+    *phCache = hCache;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    CACHE_GetKey
+ *****************************************************************************/
+GLOB_ERROR CACHE_GetKey(const char * pcSource,
+                        size_t nLength,
+                        uint64_t * pnKey) {
+    uint64_t nHash = CACHE_HASH_OFFSET_BASIS;
+    
+    /* Check parameters */
+    if ((NULL == pcSource && 0 != nLength) || NULL == pnKey) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Hash the version (with its '\0') and then the content */
+    nHash = cache_Hash(nHash, GLOB_ASM_VERSION, sizeof(GLOB_ASM_VERSION));
+    nHash = cache_Hash(nHash, pcSource, nLength);
+    
+    /* Set out parameter upon success */
+    *pnKey = nHash;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    CACHE_Find
+ *****************************************************************************/
+GLOB_ERROR CACHE_Find(HCACHE hCache, uint64_t nKey, POUTPUT_FILES ptFiles) {
+    char szHeader[CACHE_MAX_HEADER_LENGTH];
+    char * pszPath = NULL;
+    FILE * phFile = NULL;
+    char * pcContent = NULL;
+    int nObjectLength = 0;
+    int nEntriesLength = 0;
+    int nExternalsLength = 0;
+    size_t nContentLength = 0;
+    BOOL bIsValid = FALSE;
+    
+    /* Check parameters */
+    if (NULL == hCache || NULL == ptFiles) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Open the file of the key */
+    pszPath = cache_GetPath(hCache, NULL, nKey);
+    if (NULL == pszPath) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    phFile = fopen(pszPath, "rb");
+    free(pszPath);
+    if (NULL == phFile) {
+        return GLOB_ERROR_NOT_FOUND;
+    }
+    
+    /* Check the header and read the lengths */
+    if (NULL == fgets(szHeader, sizeof(szHeader), phFile)
+        || 0 != strcmp(szHeader, CACHE_HEADER)
+        || 3 != fscanf(phFile, "%d %d %d", &nObjectLength, &nEntriesLength,
+                       &nExternalsLength)
+        || '\n' != fgetc(phFile)
+        || nObjectLength <= 0 || nEntriesLength < 0 || nExternalsLength < 0) {
+        fclose(phFile);
+        return GLOB_ERROR_NOT_FOUND;
+    }
+    
+    /* Read the content. It should end exactly at the end of the file. */
+    nContentLength = (size_t)nObjectLength + nEntriesLength + nExternalsLength;
+    STATS_CountAllocation(STATS_MODULE_CACHE, nContentLength);
+    pcContent = malloc(nContentLength);
+    if (NULL != pcContent) {
+        bIsValid = (nContentLength == fread(pcContent, 1, nContentLength,
+                                            phFile)
+                    && EOF == fgetc(phFile));
+    }
+    fclose(phFile);
+    if (!bIsValid) {
+        free(pcContent);
+        return GLOB_ERROR_NOT_FOUND;
+    }
+    
+    /* Set out parameters upon success. The files are in one block, that is
+     * freed with the object file (see OUTPUT_FreeFiles) */
+    ptFiles->pcObject = pcContent;
+    ptFiles->nObjectLength = nObjectLength;
+    ptFiles->pcEntries = pcContent + nObjectLength;
+    ptFiles->nEntriesLength = nEntriesLength;
+    ptFiles->pcExternals = pcContent + nObjectLength + nEntriesLength;
+    ptFiles->nExternalsLength = nExternalsLength;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    CACHE_Store
+ *****************************************************************************/
+GLOB_ERROR CACHE_Store(HCACHE hCache,
+                       uint64_t nKey,
+                       const OUTPUT_FILES * ptFiles) {
+    char * pszTempPath = NULL;
+    char * pszPath = NULL;
+    int nDescriptor = -1;
+    FILE * phFile = NULL;
+    BOOL bIsWritten = FALSE;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == hCache || NULL == ptFiles) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Get the paths of the temporary file and of the file of the key */
+    pszTempPath = cache_GetPath(hCache, CACHE_TEMP_NAME, nKey);
+    pszPath = cache_GetPath(hCache, NULL, nKey);
+    if (NULL == pszTempPath || NULL == pszPath) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        free(pszTempPath);
+        free(pszPath);
+        return eRetValue;
+    }
+    
+    /* Create the temporary file */
+    nDescriptor = mkstemp(pszTempPath);
+    if (-1 != nDescriptor) {
+        phFile = fdopen(nDescriptor, "wb");
+        if (NULL == phFile) {
+            close(nDescriptor);
+        }
+    }
+    if (NULL == phFile) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        if (-1 != nDescriptor) {
+            unlink(pszTempPath);
+        }
+        free(pszTempPath);
+        free(pszPath);
+        return eRetValue;
+    }
+    
+    /* Write the header and the files */
+    bIsWritten = (0 <= fprintf(phFile, "%s%d %d %d\n", CACHE_HEADER,
+                               ptFiles->nObjectLength, ptFiles->nEntriesLength,
+                               ptFiles->nExternalsLength)
+        && ptFiles->nObjectLength == fwrite(ptFiles->pcObject, 1,
+                                            ptFiles->nObjectLength, phFile)
+        && ptFiles->nEntriesLength == fwrite(ptFiles->pcEntries, 1,
+                                             ptFiles->nEntriesLength, phFile)
+        && ptFiles->nExternalsLength == fwrite(ptFiles->pcExternals, 1,
+                                               ptFiles->nExternalsLength,
+                                               phFile));
+    if (0 != fclose(phFile)) {
+        bIsWritten = FALSE;
+    }
+    
+    /* Replace the file of the key */
+    if (!bIsWritten || 0 != rename(pszTempPath, pszPath)) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        unlink(pszTempPath);
+        free(pszTempPath);
+        free(pszPath);
+        return eRetValue;
+    }
+    free(pszTempPath);
+    free(pszPath);
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    CACHE_Close
+ *****************************************************************************/
+void CACHE_Close(HCACHE hCache) {
+    if (NULL != hCache) {
+        free(hCache->pszDirectory);
+        free(hCache);
+    }
+}
@@ -0,0 +1,105 @@
+/******************************************************************************
+ * File:    cache.h
+ * Author:  Doron Shvartztuch
+ * The CACHE module keeps the output files of compiled files in a directory,
+ * so a source file that didn't change since the last run doesn't have to be
+ * compiled again.
+ * The results are kept under a key: a hash of the content of the source file
+ * and the version of the assembler (GLOB_ASM_VERSION).
+ *****************************************************************************/
+
+#ifndef CACHE_H
+#define CACHE_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "global.h"
+#include "output.h"
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The HCACHE represents a handle to a cache directory.
+ * Always close the handle with the CACHE_Close function */
+typedef struct CACHE CACHE, *HCACHE, **PHCACHE;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    CACHE_Open
+ * Purpose: Open a cache directory. The directory is created if it doesn't
+ *          exist.
+ * Parameters:
+ *          szDirectory [IN] - the path to the directory
+ *          phCache [OUT] - the handle to the cache
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR CACHE_Open(const char * szDirectory, PHCACHE phCache);
+
+/******************************************************************************
+ * Name:    CACHE_GetKey
+ * Purpose: Calculate the key of the content of a source file
+ * Parameters:
+ *          pcSource [IN] - the content of the source file
+ *          nLength [IN] - the length (in chars) of the content
+ *          pnKey [OUT] - the key
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  The key should be calculated from the same content that is
+ *          compiled, so the output files of another version of the file are
+ *          never kept under its key.
+ *****************************************************************************/
+GLOB_ERROR CACHE_GetKey(const char * pcSource,
+                        size_t nLength,
+                        uint64_t * pnKey);
+
+/******************************************************************************
+ * Name:    CACHE_Find
+ * Purpose: Get the output files kept under a key
+ * Parameters:
+ *          hCache [IN] - the handle to the cache
+ *          nKey [IN] - the key (see CACHE_GetKey)
+ *          ptFiles [OUT] - the content of the output files
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the content with
+ *          OUTPUT_FreeFiles.
+ *          GLOB_ERROR_NOT_FOUND - there are no valid files under the key
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR CACHE_Find(HCACHE hCache, uint64_t nKey, POUTPUT_FILES ptFiles);
+
+/******************************************************************************
+ * Name:    CACHE_Store
+ * Purpose: Keep the output files of a compiled file under a key
+ * Parameters:
+ *          hCache [IN] - the handle to the cache
+ *          nKey [IN] - the key (see CACHE_GetKey)
+ *          ptFiles [IN] - the content of the output files
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  The files are written to a temporary file that is renamed at
+ *          the end, so other processes never see a partial result.
+ *****************************************************************************/
+GLOB_ERROR CACHE_Store(HCACHE hCache,
+                       uint64_t nKey,
+                       const OUTPUT_FILES * ptFiles);
+
+/******************************************************************************
+ * Name:    CACHE_Close
+ * Purpose: Close the handle to the cache
+ * Parameters:
+ *          hCache [IN] - the handle to the cache
+ *****************************************************************************/
+void CACHE_Close(HCACHE hCache);
+
+#endif /* CACHE_H */
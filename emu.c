@@ -0,0 +1,193 @@
+/*****************************************************************************
+ * File:    emu.c
+ * Author:  Doron Shvartztuch
+ * The emulator of the target machine (see MACHINE). It runs a compiled
+ * program and reports the number of the executed instructions and their
+ * rate, so it can be used as a benchmark of the emulator too.
+ *
+ * Implementation:
+ * The object file is read to the memory and parsed by the OUTPUT module.
+ * The program must be complete: the uses of externals should be resolved
+ * first (the machine faults on them). The output of the program (prn) is
+ * printed to the stdout, and the report to the stderr.
+ * The emulator has its own main, so it is built by the "emu" target of the
+ * Makefile and not by the configurations.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "global.h"
+#include "output.h"
+#include "machine.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The command line should include at least 2 arguments (the program name and
+ * a file to run. */
+#define MIN_NUMBER_OF_ARGUMENTS 2
+
+/* The command line option of the limit of instructions */
+#define EMU_LIMIT_OPTION "-n"
+
+/* Conversion of the times */
+#define NANOSECONDS_IN_SECOND 1000000000LL
+#define NANOSECONDS_IN_MILLISECOND 1000000.0
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static long long emu_Now(void);
+static GLOB_ERROR emu_Load(const char * pszFileName, PHMACHINE phMachine);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    emu_Now
+ * Purpose: Get the current time
+ * Return Value:
+ *          The time (in nanoseconds)
+ *****************************************************************************/
+static long long emu_Now(void) {
+    struct timespec tNow;
+    
+    clock_gettime(CLOCK_MONOTONIC, &tNow);
+    return tNow.tv_sec * NANOSECONDS_IN_SECOND + tNow.tv_nsec;
+}
+
+/******************************************************************************
+ * Name:    emu_Load
+ * Purpose: Load the object file of a program to a new machine
+ * Parameters:
+ *          pszFileName [IN] - the file name (w/o extension)
+ *          phMachine [OUT] - the handle to the machine
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the file is not a valid object
+ *                                          file, or the program doesn't fit
+ *                                          in the memory
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR emu_Load(const char * pszFileName, PHMACHINE phMachine) {
+    char * pszFullFileName = NULL;
+    char * pcBuffer = NULL;
+    size_t nBufferLength = 0;
+    uint16_t * pwWords = NULL;
+    int nCodeLength = 0;
+    int nDataLength = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Read the object file */
+    pszFullFileName = HELPER_ConcatStrings(pszFileName,
+                                           GLOB_FILE_EXTENSION_BINARY);
+    if (NULL == pszFullFileName) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    pcBuffer = HELPER_ReadFile(pszFullFileName, &nBufferLength);
+    free(pszFullFileName);
+    if (NULL == pcBuffer) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Parse it and load the sections */
+    eRetValue = OUTPUT_ParseObject(pcBuffer, nBufferLength, &pwWords,
+                                   &nCodeLength, &nDataLength);
+    free(pcBuffer);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    eRetValue = MACHINE_Create(pwWords, nCodeLength, pwWords + nCodeLength,
+                               nDataLength, phMachine);
+    free(pwWords);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    main
+ * Purpose: run the program (as passed in the command line parameters)
+ * Command Line:
+ *          emu [-n <instructions>] <file>
+ *          The file is given w/o the extension (like the assembler).
+ *          -n <instructions> - stop after this number of instructions
+ * Return Value:
+ *          Upon successful completion (the program executed 'stop' or
+ *          reached the limit), GLOB_SUCCESS (0) is returned.
+ *          GLOB_ERROR_INVALID_STATE - the program faulted
+ *          If the emulator fails, an error code is returned.
+ *****************************************************************************/
+int main(int nArgc, const char * ppszArgv[]) {
+    HMACHINE hMachine = NULL;
+    MACHINE_RESULT tResult;
+    long long nMaxInstructions = LLONG_MAX;
+    long long nStartTime = 0;
+    double dMilliseconds = 0;
+    int nFirstFile = 1;
+    char * pcEnd = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Parse the options */
+    if (nFirstFile + 1 < nArgc
+        && 0 == strcmp(ppszArgv[nFirstFile], EMU_LIMIT_OPTION)) {
+        nMaxInstructions = strtoll(ppszArgv[nFirstFile + 1], &pcEnd, 10);
+        if ('\0' != *pcEnd || nMaxInstructions < 1) {
+            printf("Invalid number of instructions: %s\n",
+                   ppszArgv[nFirstFile + 1]);
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        nFirstFile += 2;
+    }
+    
+    /* Check for the number of arguments (one file) */
+    if (nArgc - nFirstFile + 1 != MIN_NUMBER_OF_ARGUMENTS) {
+        printf("USAGE: %s [-n <instructions>] <file>\n", ppszArgv[0]);
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Load the program */
+    eRetValue = emu_Load(ppszArgv[nFirstFile], &hMachine);
+    if (GLOB_ERROR_INVALID_PARAMETERS == eRetValue) {
+        printf("%s%s: not a valid object file, or too big for the memory\n",
+               ppszArgv[nFirstFile], GLOB_FILE_EXTENSION_BINARY);
+        return eRetValue;
+    }
+    if (eRetValue) {
+        printf("Can't load %s\n", ppszArgv[nFirstFile]);
+        return eRetValue;
+    }
+    
+    /* Run it */
+    nStartTime = emu_Now();
+    eRetValue = MACHINE_Run(hMachine, nMaxInstructions, &tResult);
+    dMilliseconds = (emu_Now() - nStartTime) / NANOSECONDS_IN_MILLISECOND;
+    fflush(stdout);
+    MACHINE_Free(hMachine);
+    
+    /* Report */
+    if (NULL != tResult.pszFault) {
+        fprintf(stderr, "Fault at %04d: %s\n", tResult.nAddress,
+                tResult.pszFault);
+    } else if (!tResult.bStopped) {
+        fprintf(stderr, "Stopped at the limit of instructions\n");
+    }
+    fprintf(stderr, "%lld instruction(s) in %.3f ms (%.0f instructions/s)\n",
+            tResult.nInstructions, dMilliseconds,
+            dMilliseconds > 0 ? tResult.nInstructions * 1000.0 / dMilliseconds
+                              : 0.0);
+    return eRetValue;
+}
@@ -21,11 +21,16 @@
 /* The address of the first instruction in the object file */
 #define CODE_STARTUP_ADDRESS        100
 
+/* The version of the assembler. Change it whenever the output files of the
+ * same source may change, so the cached results (see CACHE) are not used. */
+#define GLOB_ASM_VERSION            "1.2"
+
 /* File extensions of input/output files */
 #define GLOB_FILE_EXTENSION_SOURCE  ".as"
 #define GLOB_FILE_EXTENSION_BINARY  ".ob"
 #define GLOB_FILE_EXTENSION_ENTRY   ".ent"
 #define GLOB_FILE_EXTENSION_EXTERN  ".ext"
+#define GLOB_FILE_EXTENSION_PACKED  ".obp"
 
 /* return GLOB_ERROR_SYS_CALL_FAILED error,
  * with the errno in the lower byte */
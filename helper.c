@@ -9,8 +9,10 @@
 /******************************************************************************
  * INCLUDES
  *****************************************************************************/
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include "helper.h"
 
 /******************************************************************************
@@ -59,3 +61,41 @@ int HELPER_FindInStringsArray(const char ** paszStringsArray,
     /* Not found */
     return -1;
 }
+
+/******************************************************************************
+ * Name:    HELPER_ReadFile
+ *****************************************************************************/
+char * HELPER_ReadFile(const char * pszPath, size_t * pnLength) {
+    FILE * phFile = NULL;
+    char * pcContent = NULL;
+    long nLength = 0;
+    int nError = 0;
+    
+    phFile = fopen(pszPath, "rb");
+    if (NULL == phFile) {
+        return NULL;
+    }
+    
+    /* Get the length and read the whole file */
+    if (0 != fseek(phFile, 0, SEEK_END) || 0 > (nLength = ftell(phFile))
+        || 0 != fseek(phFile, 0, SEEK_SET)
+        || NULL == (pcContent = malloc(nLength + 1))) {
+        nError = errno;
+        fclose(phFile);
+        errno = nError;
+        return NULL;
+    }
+    if (nLength != fread(pcContent, 1, nLength, phFile)) {
+        nError = ferror(phFile) ? errno : EIO;
+        free(pcContent);
+        fclose(phFile);
+        errno = nError;
+        return NULL;
+    }
+    fclose(phFile);
+    pcContent[nLength] = '\0';
+    
+    /* Set out parameter upon success */
+    *pnLength = nLength;
+    return pcContent;
+}
@@ -7,14 +7,20 @@
 #ifndef HELPER_H
 #define HELPER_H
 
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stddef.h>
+
 /******************************************************************************
  * CONSTANTS & MACROS
  *****************************************************************************/
 #define FALSE                  0
 #define TRUE                   1
 
-/* Warning: double evaluation when using the MAX macro */
+/* Warning: double evaluation when using the MAX/MIN macros */
 #define MAX(a,b)               ((a) > (b) ? (a) : (b))
+#define MIN(a,b)               ((a) < (b) ? (a) : (b))
 
 /* The ARRAY_ELEMENTS returns the number of elements in the array.
  * Warning: the macro uses the sizeof operator and works only on static arrays*/
@@ -60,4 +66,18 @@ int HELPER_FindInStringsArray(const char ** paszStringsArray,
                               int nArrayElements,
                               const char * pszStr,
                               int nStrLength);
+
+/******************************************************************************
+ * Name:    HELPER_ReadFile
+ * Purpose: Read a whole file to a new (dynamic allocated) buffer
+ * Parameters:
+ *          pszPath [IN] - the path to the file
+ *          pnLength [OUT] - the length (in bytes) of the file
+ * Return Value:
+ *          Upon successful completion, a pointer to the content is returned.
+ *          It is followed by '\0' (not counted in the length). The caller
+ *          should free it with the free function.
+ *          If the function fails, NULL is returned and errno is set.
+ *****************************************************************************/
+char * HELPER_ReadFile(const char * pszPath, size_t * pnLength);
 #endif /* HELPER_H */
@@ -0,0 +1,386 @@
+/******************************************************************************
+ * File:    intern.c
+ * Author:  Doron Shvartztuch
+ * The INTERN module keeps one copy of each name and gives it an id.
+ *
+ * Implementation:
+ * The names are copied to an arena and kept in an array by the order they
+ * were added, so the id of a name is its index in the array. To find a name,
+ * we keep an open-addressing hash index: an array of ids, where the slot of
+ * a name is determined by its hash (linear probing on collisions). The hash
+ * of each name is saved in the array, so we don't have to calculate it again
+ * when the index expands.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "helper.h"
+#include "arena.h"
+#include "intern.h"
+#include "stats.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The default size (in names) of the names array */
+#define INTERN_DEFAULT_NAMES 16
+
+/* The expand factor of the names array and the hash index */
+#define INTERN_EXPAND_FACTOR 2
+
+/* The default size (in slots) of the hash index. Must be a power of 2 */
+#define INTERN_DEFAULT_INDEX_SIZE 32
+
+/* Value of an empty slot in the hash index */
+#define INTERN_EMPTY_SLOT (-1)
+
+/* The index is expanded before more than half of its slots are used,
+ * so the probing sequences stay short */
+#define INTERN_INDEX_IS_FULL(nNames, nIndexSize) (2 * (nNames) >= (nIndexSize))
+
+/* Constants of the FNV-1a hash function */
+#define INTERN_HASH_OFFSET_BASIS 2166136261u
+#define INTERN_HASH_PRIME 16777619u
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* A name in the table */
+typedef struct INTERN_NAME {
+    
+    /* The null-terminated name (allocated from the arena) */
+    char * pszName;
+    
+    /* The length (in chars) of the name */
+    int nLength;
+    
+    /* The hash of the name (see intern_Hash) */
+    unsigned int nHash;
+} INTERN_NAME, *PINTERN_NAME;
+
+/* INTERN_TABLE is the struct behind the HINTERN_TABLE */
+struct INTERN_TABLE {
+    
+    /* The memory of the names */
+    HARENA hArena;
+    
+    /* The names array. The index of a name is its id. */
+    PINTERN_NAME patNames;
+    int nNames;
+    int nAllocatedNames;
+    
+    /* The hash index. Each slot contains an id or INTERN_EMPTY_SLOT.
+     * The number of slots is always a power of 2. */
+    int * panIndex;
+    int nIndexSize;
+};
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static unsigned int intern_Hash(const char * pcName, int nLength);
+static int intern_FindSlot(HINTERN_TABLE hTable,
+                           const char * pcName,
+                           int nLength,
+                           unsigned int nHash);
+static GLOB_ERROR intern_ExpandIndex(HINTERN_TABLE hTable);
+static GLOB_ERROR intern_AddName(HINTERN_TABLE hTable,
+                                 const char * pcName,
+                                 int nLength,
+                                 unsigned int nHash);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    intern_Hash
+ * Purpose: calculate the hash of a name (FNV-1a)
+ * Parameters:
+ *          pcName [IN] - the name
+ *          nLength [IN] - the length (in chars) of the name
+ * Return Value:
+ *          The hash of the name
+ *****************************************************************************/
+static unsigned int intern_Hash(const char * pcName, int nLength) {
+    unsigned int nHash = INTERN_HASH_OFFSET_BASIS;
+    
+    for (int nIndex = 0; nIndex < nLength; nIndex++) {
+        nHash ^= (unsigned char)pcName[nIndex];
+        nHash *= INTERN_HASH_PRIME;
+    }
+    return nHash;
+}
+
+/******************************************************************************
+ * Name:    intern_FindSlot
+ * Purpose: find the slot of a name in the hash index
+ * Parameters:
+ *          hTable [IN] - the handle to the table
+ *          pcName [IN] - the name
+ *          nLength [IN] - the length (in chars) of the name
+ *          nHash [IN] - the hash of the name
+ * Return Value:
+ *          The index of the slot in the hash index. If the name is not in
+ *          the table, this is the empty slot where it should be inserted.
+ *****************************************************************************/
+static int intern_FindSlot(HINTERN_TABLE hTable,
+                           const char * pcName,
+                           int nLength,
+                           unsigned int nHash) {
+    int nMask = hTable->nIndexSize - 1;
+    int nSlot = nHash & nMask;
+    PINTERN_NAME ptName = NULL;
+    
+    /* Linear probing. The index is never full, so we must stop. */
+    while (INTERN_EMPTY_SLOT != hTable->panIndex[nSlot]) {
+        ptName = &hTable->patNames[hTable->panIndex[nSlot]];
+        if (nHash == ptName->nHash && nLength == ptName->nLength
+                && 0 == memcmp(pcName, ptName->pszName, nLength)) {
+            break;
+        }
+        nSlot = (nSlot + 1) & nMask;
+    }
+    return nSlot;
+}
+
+/******************************************************************************
+ * Name:    intern_ExpandIndex
+ * Purpose: expand the hash index and rebuild it
+ * Parameters:
+ *          hTable [IN] - the handle to the table
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR intern_ExpandIndex(HINTERN_TABLE hTable) {
+    int * panNewIndex = NULL;
+    int nNewIndexSize = 0;
+    int nSlot = 0;
+    
+    /* Allocate the new index. We use the saved hashes to rebuild it. */
+    nNewIndexSize = INTERN_EXPAND_FACTOR * hTable->nIndexSize;
+    STATS_CountAllocation(STATS_MODULE_INTERN,
+                          nNewIndexSize * sizeof(*panNewIndex));
+    panNewIndex = malloc(nNewIndexSize * sizeof(*panNewIndex));
+    if (NULL == panNewIndex) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    for (nSlot = 0; nSlot < nNewIndexSize; nSlot++) {
+        panNewIndex[nSlot] = INTERN_EMPTY_SLOT;
+    }
+    
+    /* Re-insert all names. They are unique, so no need to compare. */
+    for (int nId = 0; nId < hTable->nNames; nId++) {
+        nSlot = hTable->patNames[nId].nHash & (nNewIndexSize - 1);
+        while (INTERN_EMPTY_SLOT != panNewIndex[nSlot]) {
+            nSlot = (nSlot + 1) & (nNewIndexSize - 1);
+        }
+        panNewIndex[nSlot] = nId;
+    }
+    
+    /* Replace the old index */
+    free(hTable->panIndex);
+    hTable->panIndex = panNewIndex;
+    hTable->nIndexSize = nNewIndexSize;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    intern_AddName
+ * Purpose: add a new name at the end of the names array
+ * Parameters:
+ *          hTable [IN] - the handle to the table
+ *          pcName [IN] - the name
+ *          nLength [IN] - the length (in chars) of the name
+ *          nHash [IN] - the hash of the name
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  The caller should check the name doesn't exist in the table, and
+ *          that the index has a free slot for it.
+ *****************************************************************************/
+static GLOB_ERROR intern_AddName(HINTERN_TABLE hTable,
+                                 const char * pcName,
+                                 int nLength,
+                                 unsigned int nHash) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    PINTERN_NAME patNewNames = NULL;
+    int nNewAllocatedNames = 0;
+    PINTERN_NAME ptName = NULL;
+    
+    /* Expand the array if it is full */
+    if (hTable->nNames == hTable->nAllocatedNames) {
+        nNewAllocatedNames = INTERN_EXPAND_FACTOR * hTable->nAllocatedNames;
+        STATS_CountAllocation(STATS_MODULE_INTERN,
+                              nNewAllocatedNames * sizeof(*patNewNames));
+        patNewNames = realloc(hTable->patNames,
+                              nNewAllocatedNames * sizeof(*patNewNames));
+        if (NULL == patNewNames) {
+            return GLOB_ERROR_SYS_CALL_ERROR();
+        }
+        hTable->patNames = patNewNames;
+        hTable->nAllocatedNames = nNewAllocatedNames;
+    }
+    
+    /* Copy the name */
+    ptName = &hTable->patNames[hTable->nNames];
+    eRetValue = ARENA_Alloc(hTable->hArena, nLength + 1,
+                            (void **)&ptName->pszName);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    memcpy(ptName->pszName, pcName, nLength);
+    ptName->pszName[nLength] = '\0';
+    ptName->nLength = nLength;
+    ptName->nHash = nHash;
+    hTable->nNames++;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    INTERN_Create
+ *****************************************************************************/
+GLOB_ERROR INTERN_Create(PHINTERN_TABLE phTable) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    HINTERN_TABLE hTable = NULL;
+    
+    /* Check parameters */
+    if (NULL == phTable) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Allocate the handle */
+    STATS_CountAllocation(STATS_MODULE_INTERN, sizeof(*hTable));
+    hTable = malloc(sizeof(*hTable));
+    if (NULL == hTable) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    hTable->hArena = NULL;
+    hTable->patNames = NULL;
+    hTable->nNames = 0;
+    hTable->nAllocatedNames = INTERN_DEFAULT_NAMES;
+    hTable->panIndex = NULL;
+    hTable->nIndexSize = INTERN_DEFAULT_INDEX_SIZE;
+    
+    /* Create the arena of the names */
+    eRetValue = ARENA_Create(&hTable->hArena);
+    if (eRetValue) {
+        INTERN_Free(hTable);
+        return eRetValue;
+    }
+    
+    /* Allocate the names array */
+    STATS_CountAllocation(STATS_MODULE_INTERN,
+                          hTable->nAllocatedNames * sizeof(INTERN_NAME));
+    hTable->patNames = malloc(hTable->nAllocatedNames * sizeof(INTERN_NAME));
+    if (NULL == hTable->patNames) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        INTERN_Free(hTable);
+        return eRetValue;
+    }
+    
+    /* Allocate the hash index, with all slots empty */
+    STATS_CountAllocation(STATS_MODULE_INTERN, hTable->nIndexSize * sizeof(int));
+    hTable->panIndex = malloc(hTable->nIndexSize * sizeof(int));
+    if (NULL == hTable->panIndex) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        INTERN_Free(hTable);
+        return eRetValue;
+    }
+    for (int nSlot = 0; nSlot < hTable->nIndexSize; nSlot++) {
+        hTable->panIndex[nSlot] = INTERN_EMPTY_SLOT;
+    }
+    
+    /* Set out parameter */
+    *phTable = hTable;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    INTERN_Add
+ *****************************************************************************/
+GLOB_ERROR INTERN_Add(HINTERN_TABLE hTable,
+                      const char * pcName,
+                      int nLength,
+                      int * pnId) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    unsigned int nHash = 0;
+    int nSlot = 0;
+    
+    /* Check parameters */
+    if (NULL == hTable || NULL == pcName || nLength < 0 || NULL == pnId) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Search the name */
+    nHash = intern_Hash(pcName, nLength);
+    nSlot = intern_FindSlot(hTable, pcName, nLength, nHash);
+    if (INTERN_EMPTY_SLOT != hTable->panIndex[nSlot]) {
+        *pnId = hTable->panIndex[nSlot];
+        return GLOB_SUCCESS;
+    }
+    
+    /* Not found. Expand the index (if needed) and add the name. */
+    if (INTERN_INDEX_IS_FULL(hTable->nNames + 1, hTable->nIndexSize)) {
+        eRetValue = intern_ExpandIndex(hTable);
+        if (eRetValue) {
+            return eRetValue;
+        }
+        nSlot = intern_FindSlot(hTable, pcName, nLength, nHash);
+    }
+    eRetValue = intern_AddName(hTable, pcName, nLength, nHash);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    hTable->panIndex[nSlot] = hTable->nNames - 1;
+    *pnId = hTable->nNames - 1;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    INTERN_GetName
+ *****************************************************************************/
+const char * INTERN_GetName(HINTERN_TABLE hTable, int nId) {
+    if (NULL == hTable || nId < 0 || nId >= hTable->nNames) {
+        return NULL;
+    }
+    return hTable->patNames[nId].pszName;
+}
+
+/******************************************************************************
+ * Name:    INTERN_GetCount
+ *****************************************************************************/
+int INTERN_GetCount(HINTERN_TABLE hTable) {
+    return hTable->nNames;
+}
+
+/******************************************************************************
+ * Name:    INTERN_Free
+ *****************************************************************************/
+void INTERN_Free(HINTERN_TABLE hTable) {
+    if (NULL == hTable) {
+        return;
+    }
+    if (NULL != hTable->hArena) {
+        ARENA_Free(hTable->hArena);
+    }
+    free(hTable->panIndex);
+    free(hTable->patNames);
+    free(hTable);
+}
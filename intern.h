@@ -0,0 +1,88 @@
+/******************************************************************************
+ * File:    intern.h
+ * Author:  Doron Shvartztuch
+ * The INTERN module keeps one copy of each name (label) of a compiled file
+ * and gives it an id. The ids are sequential (the first name gets 0), so the
+ * other modules can use them as indexes instead of comparing strings.
+ *****************************************************************************/
+
+#ifndef INTERN_H
+#define INTERN_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "global.h"
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The HINTERN_TABLE represents a handle to a table of names.
+ * Always free the table with the INTERN_Free function */
+typedef struct INTERN_TABLE INTERN_TABLE, *HINTERN_TABLE, **PHINTERN_TABLE;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    INTERN_Create
+ * Purpose: Create a new table of names
+ * Parameters:
+ *          phTable [OUT] - the handle to the created table
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR INTERN_Create(PHINTERN_TABLE phTable);
+
+/******************************************************************************
+ * Name:    INTERN_Add
+ * Purpose: Get the id of a name. The name is added if it is not in the table.
+ * Parameters:
+ *          hTable [IN] - the handle to the table
+ *          pcName [IN] - the name (doesn't have to be null-terminated)
+ *          nLength [IN] - the length (in chars) of the name
+ *          pnId [OUT] - the id of the name
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  Names are case-sensitive
+ *****************************************************************************/
+GLOB_ERROR INTERN_Add(HINTERN_TABLE hTable,
+                      const char * pcName,
+                      int nLength,
+                      int * pnId);
+
+/******************************************************************************
+ * Name:    INTERN_GetName
+ * Purpose: Get the name of an id
+ * Parameters:
+ *          hTable [IN] - the handle to the table
+ *          nId [IN] - the id, returned by INTERN_Add
+ * Return Value:
+ *          The null-terminated name. It is valid until the call to INTERN_Free.
+ *****************************************************************************/
+const char * INTERN_GetName(HINTERN_TABLE hTable, int nId);
+
+/******************************************************************************
+ * Name:    INTERN_GetCount
+ * Purpose: Get the number of names in the table. The ids of the names are
+ *          0 to the count - 1, by the order they were added.
+ * Parameters:
+ *          hTable [IN] - the handle to the table
+ * Return Value:
+ *          The number of names
+ *****************************************************************************/
+int INTERN_GetCount(HINTERN_TABLE hTable);
+
+/******************************************************************************
+ * Name:    INTERN_Free
+ * Purpose: Free a table and all its names
+ * Parameters:
+ *          hTable [IN] - the handle to the table
+ *****************************************************************************/
+void INTERN_Free(HINTERN_TABLE hTable);
+
+#endif /* INTERN_H */
@@ -8,6 +8,13 @@
  * Implementation:
  * The LEX modules uses LINESTR to read the source file into lines.
  * It goes over the lines and parse the text into tokens from different types.
+ * The type of a token is known by its first char, so the parser of the token
+ * is selected by a table indexed by the char (see g_afParsers).
+ * The strings of the tokens are allocated from an ARENA owned by the file.
+ * LEX_ReadLine parses a whole line into an array of the caller, so the tokens
+ * are not allocated at all and share the reference of the file to the line.
+ * The first error stops the line and is kept in it, so the caller reports it
+ * in its order among the errors of the caller.
  *****************************************************************************/
 
 /******************************************************************************
@@ -22,7 +29,9 @@
 #include "helper.h"
 #include "global.h"
 #include "linestr.h"
+#include "arena.h"
 #include "lex.h"
+#include "stats.h"
 
 /******************************************************************************
  * CONSTANTS & MACROS
@@ -31,10 +40,48 @@
 /* The maximum length (in characters) of a label */
 #define LEX_MAX_LABEL_LENGTH 31
 
+/* The number of the possible chars (the size of g_afParsers) */
+#define LEX_CHARS 256
+
+/* The length range (in characters) of the keywords */
+#define LEX_MIN_KEYWORD_LENGTH 2
+#define LEX_MAX_KEYWORD_LENGTH 6
+
+/* The number of slots in the keywords hash table (must be a power of 2) */
+#define LEX_KEYWORDS_TABLE_SIZE 64
+
+/* Perfect hash of the keywords (see g_atKeywords below). The keyword must be
+ * at least LEX_MIN_KEYWORD_LENGTH chars long. */
+#define LEX_KEYWORD_HASH(pcKeyword, nLength)                            \
+    (((nLength) + (pcKeyword)[0] + 13 * (pcKeyword)[1])                 \
+     & (LEX_KEYWORDS_TABLE_SIZE - 1))
+
+/* The character at the current position of the parser. The line is not
+ * null-terminated, so we return '\0' if we are at the end of the line */
+#define LEX_CURRENT_CHAR(hFile)                                 \
+    ((hFile)->nCurrentColumn < (hFile)->nCurrentLineLength ?    \
+     (hFile)->ptCurrentLine->pcLine[(hFile)->nCurrentColumn] : '\0')
+
 /******************************************************************************
  * TYPEDEFS
  *****************************************************************************/
 
+/* A reserved word of the language (opcode, register or directive) */
+typedef struct LEX_KEYWORD {
+    /* The keyword text. NULL for an empty slot of the table */
+    const char * pszKeyword;
+    
+    /* The length (in chars) of the keyword */
+    int nLength;
+    
+    /* LEX_TOKEN_KIND_OPCODE, LEX_TOKEN_KIND_REGISTER or
+     * LEX_TOKEN_KIND_DIRECTIVE */
+    LEX_TOKEN_KIND eKind;
+    
+    /* The opcode, register number or directive */
+    int nValue;
+} LEX_KEYWORD, *PLEX_KEYWORD;
+
 /* LEX_FILE is the struct behind the the HLEX_FILE.
  * It keeps the HLINESTR_FILE that read the file as well as other information
  * about the current parsing status  */
@@ -43,6 +90,9 @@ struct LEX_FILE {
      * the lines of the source file.*/
     HLINESTR_FILE hSourceFile;
     
+    /* The table of the names of the labels */
+    HINTERN_TABLE hNames;
+    
     /* Callback function to use for errors and warnings */
     GLOB_ERRORCALLBACK pfnErrorsCallback;
     
@@ -57,19 +107,25 @@ struct LEX_FILE {
     
     /* The zero-based position of the parser in the current line. */
     int nCurrentColumn;     
+    
+    /* The memory of the strings of the tokens */
+    HARENA hArena;
+    
+    /* The line that keeps the errors while it is read by LEX_ReadLine.
+     * NULL if the errors are reported when they are found. */
+    PLEX_LINE ptDeferringLine;
 };
 
 /******************************************************************************
  * Name:    LEX_PARSER
- * Purpose: a LEX_PARSER function tries to parse the token
- *          at the current position
+ * Purpose: a LEX_PARSER function parses the token at the current position.
+ *          The function is selected by the first char of the token (see
+ *          g_afParsers), so it doesn't check this char again.
  * Parameters:
  *          hFile [IN] - the file that we are parsing
  *          ptToken [IN OUT] - the token to fill with the token data
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
- *          If the next token isn't from the type this function handles,
- *          the function should return GLOB_ERROR_CONTINUE.
  *          If the function fails, an error code is returned.
  *****************************************************************************/
 typedef GLOB_ERROR (*LEX_PARSER)(HLEX_FILE hFile, PLEX_TOKEN ptToken);
@@ -79,8 +135,17 @@ typedef GLOB_ERROR (*LEX_PARSER)(HLEX_FILE hFile, PLEX_TOKEN ptToken);
  * -------------------------------
  * See function-level documentation next to the implementation below
  *****************************************************************************/
+static void lex_CallErrorsCallback(HLEX_FILE hFile,
+                                   PLINESTR_LINE ptLine,
+                                   BOOL bIsError,
+                                   int nColumn,
+                                   const char * pszErrorFormat,
+                                   va_list vaArgs);
 static void lex_ReportError(HLEX_FILE hFile, BOOL bIsError, int nColumn,
                             const char * pszErrorFormat, ...);
+static void lex_ReportDeferredError(HLEX_FILE hFile, PLEX_LINE ptLine,
+                                    const char * pszErrorFormat, ...);
+static const LEX_KEYWORD * lex_FindKeyword(const char * pcText, int nLength);
 static GLOB_ERROR lex_ParseRemark(HLEX_FILE hFile, PLEX_TOKEN ptToken);
 static GLOB_ERROR lex_ParseSpecialChar(HLEX_FILE hFile, PLEX_TOKEN ptToken);
 static GLOB_ERROR lex_ParseDirective(HLEX_FILE hFile, PLEX_TOKEN ptToken);
@@ -88,36 +153,119 @@ static GLOB_ERROR lex_ParseImmediateNumber(HLEX_FILE hFile, PLEX_TOKEN ptToken);
 static GLOB_ERROR lex_ParseNumber(HLEX_FILE hFile, PLEX_TOKEN ptToken);
 static GLOB_ERROR lex_ParseString(HLEX_FILE hFile, PLEX_TOKEN ptToken);
 static GLOB_ERROR lex_ParseAlpha(HLEX_FILE hFile, PLEX_TOKEN ptToken);
+static GLOB_ERROR lex_ParseToken(HLEX_FILE hFile,
+                                 LEX_TOKEN_FLAGS eTokenFlags,
+                                 PLEX_TOKEN ptToken);
+static GLOB_ERROR lex_Create(HLINESTR_FILE hSourceFile,
+                             HINTERN_TABLE hNames,
+                             GLOB_ERRORCALLBACK pfnErrorsCallback,
+                             void * pvContext,
+                             PHLEX_FILE phFile);
 
 /******************************************************************************
  * CONSTANTS
  *****************************************************************************/
 
-/* This constant array contains the strings of the opcode in the language.
- * Note: The index of an opcode is equal to its GLOB_OPCODE value. */
-static const char * g_aszOpcodes[] = {"mov", "cmp", "add", "sub", "not", "clr",
-    "lea", "inc", "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "stop"};
-
-/* This constant array contains the strings of the directives in the language.
- * Note: The index of a directive is equal to its GLOB_DIRECTIVE value. */
-static const char * g_aszDirectives[] = {"data", "string", "entry", "extern"};
-
-/* This constant array contains the strings of the registers in the language.
- * Note: The index of a register is equal to its number */
-static const char * g_aszRegisters[] = {"r0", "r1", "r2", "r3",
-                                        "r4", "r5", "r6", "r7"};
+/* The keywords of the language, placed by their LEX_KEYWORD_HASH value.
+ * The hash has no collisions for this set of keywords, so a lookup is one
+ * probe. When adding a keyword, make sure its hash is unique (change the
+ * multiplier or the table size otherwise). */
+static const LEX_KEYWORD g_atKeywords[LEX_KEYWORDS_TABLE_SIZE] = {
+    [0]  = {"entry",  5, LEX_TOKEN_KIND_DIRECTIVE, GLOB_DIRECTIVE_ENTRY},
+    [2]  = {"inc",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_INC},
+    [3]  = {"extern", 6, LEX_TOKEN_KIND_DIRECTIVE, GLOB_DIRECTIVE_EXTERN},
+    [4]  = {"jsr",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_JSR},
+    [8]  = {"dec",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_DEC},
+    [11] = {"r3",     2, LEX_TOKEN_KIND_REGISTER,  3},
+    [16] = {"lea",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_LEA},
+    [19] = {"mov",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_MOV},
+    [20] = {"not",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_NOT},
+    [21] = {"data",   4, LEX_TOKEN_KIND_DIRECTIVE, GLOB_DIRECTIVE_DATA},
+    [22] = {"red",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_RED},
+    [24] = {"r4",     2, LEX_TOKEN_KIND_REGISTER,  4},
+    [25] = {"rts",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_RTS},
+    [27] = {"stop",   4, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_STOP},
+    [29] = {"string", 6, LEX_TOKEN_KIND_DIRECTIVE, GLOB_DIRECTIVE_STRING},
+    [34] = {"clr",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_CLR},
+    [36] = {"r0",     2, LEX_TOKEN_KIND_REGISTER,  0},
+    [37] = {"r5",     2, LEX_TOKEN_KIND_REGISTER,  5},
+    [39] = {"sub",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_SUB},
+    [47] = {"cmp",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_CMP},
+    [49] = {"r1",     2, LEX_TOKEN_KIND_REGISTER,  1},
+    [50] = {"r6",     2, LEX_TOKEN_KIND_REGISTER,  6},
+    [54] = {"jmp",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_JMP},
+    [56] = {"add",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_ADD},
+    [59] = {"bne",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_BNE},
+    [61] = {"prn",    3, LEX_TOKEN_KIND_OPCODE,    GLOB_OPCODE_PRN},
+    [62] = {"r2",     2, LEX_TOKEN_KIND_REGISTER,  2},
+    [63] = {"r7",     2, LEX_TOKEN_KIND_REGISTER,  7}};
 
-/* array of the parsers. The module tries to parse the token text with each
- * parser in this constant array */
-static const LEX_PARSER g_afParsers[] = {
-    lex_ParseRemark, lex_ParseSpecialChar,
-    lex_ParseDirective, lex_ParseImmediateNumber,
-    lex_ParseNumber, lex_ParseString, lex_ParseAlpha};
+/* The parser of each first char of a token (NULL for the chars that can't
+ * start a token). Each parser handles the tokens that start with its chars,
+ * so a token is parsed by one call. */
+static const LEX_PARSER g_afParsers[LEX_CHARS] = {
+    [';'] = lex_ParseRemark,
+    [','] = lex_ParseSpecialChar, ['('] = lex_ParseSpecialChar,
+    [')'] = lex_ParseSpecialChar,
+    ['.'] = lex_ParseDirective,
+    ['#'] = lex_ParseImmediateNumber,
+    ['-'] = lex_ParseNumber, ['+'] = lex_ParseNumber,
+    ['0'] = lex_ParseNumber, ['1'] = lex_ParseNumber, ['2'] = lex_ParseNumber,
+    ['3'] = lex_ParseNumber, ['4'] = lex_ParseNumber, ['5'] = lex_ParseNumber,
+    ['6'] = lex_ParseNumber, ['7'] = lex_ParseNumber, ['8'] = lex_ParseNumber,
+    ['9'] = lex_ParseNumber,
+    ['"'] = lex_ParseString,
+    ['a'] = lex_ParseAlpha, ['b'] = lex_ParseAlpha, ['c'] = lex_ParseAlpha,
+    ['d'] = lex_ParseAlpha, ['e'] = lex_ParseAlpha, ['f'] = lex_ParseAlpha,
+    ['g'] = lex_ParseAlpha, ['h'] = lex_ParseAlpha, ['i'] = lex_ParseAlpha,
+    ['j'] = lex_ParseAlpha, ['k'] = lex_ParseAlpha, ['l'] = lex_ParseAlpha,
+    ['m'] = lex_ParseAlpha, ['n'] = lex_ParseAlpha, ['o'] = lex_ParseAlpha,
+    ['p'] = lex_ParseAlpha, ['q'] = lex_ParseAlpha, ['r'] = lex_ParseAlpha,
+    ['s'] = lex_ParseAlpha, ['t'] = lex_ParseAlpha, ['u'] = lex_ParseAlpha,
+    ['v'] = lex_ParseAlpha, ['w'] = lex_ParseAlpha, ['x'] = lex_ParseAlpha,
+    ['y'] = lex_ParseAlpha, ['z'] = lex_ParseAlpha,
+    ['A'] = lex_ParseAlpha, ['B'] = lex_ParseAlpha, ['C'] = lex_ParseAlpha,
+    ['D'] = lex_ParseAlpha, ['E'] = lex_ParseAlpha, ['F'] = lex_ParseAlpha,
+    ['G'] = lex_ParseAlpha, ['H'] = lex_ParseAlpha, ['I'] = lex_ParseAlpha,
+    ['J'] = lex_ParseAlpha, ['K'] = lex_ParseAlpha, ['L'] = lex_ParseAlpha,
+    ['M'] = lex_ParseAlpha, ['N'] = lex_ParseAlpha, ['O'] = lex_ParseAlpha,
+    ['P'] = lex_ParseAlpha, ['Q'] = lex_ParseAlpha, ['R'] = lex_ParseAlpha,
+    ['S'] = lex_ParseAlpha, ['T'] = lex_ParseAlpha, ['U'] = lex_ParseAlpha,
+    ['V'] = lex_ParseAlpha, ['W'] = lex_ParseAlpha, ['X'] = lex_ParseAlpha,
+    ['Y'] = lex_ParseAlpha, ['Z'] = lex_ParseAlpha};
 
 /******************************************************************************
  * INTERNAL FUNCTIONS
  *****************************************************************************/
 
+/******************************************************************************
+ * Name:    lex_CallErrorsCallback
+ * Purpose: Pass an error message of a line to the errors callback
+ * Parameters:
+ *          hFile [IN] - handle to the current file
+ *          ptLine [IN] - the line of the error
+ *          bIsError [IN] - TRUE for error. FALSE for warning
+ *          nColumn [IN] - zero-based column index of the error
+ *          pszErroFormat[IN] - error message (format as printf syntax)
+ *          vaArgs [IN] - parameters to include in the message
+ *****************************************************************************/
+static void lex_CallErrorsCallback(HLEX_FILE hFile,
+                                   PLINESTR_LINE ptLine,
+                                   BOOL bIsError,
+                                   int nColumn,
+                                   const char * pszErrorFormat,
+                                   va_list vaArgs) {
+    char szLine[LINESTR_MAX_LINE_LENGTH];
+    
+    LINESTR_CopyLine(ptLine, szLine);
+    hFile->pfnErrorsCallback(hFile->pvContext,
+                             LINESTR_GetFullFileName(hFile->hSourceFile),
+                             ptLine->nLineNumber,
+                             nColumn+1, 
+                             szLine,
+                             bIsError, pszErrorFormat, vaArgs);
+}
+
 /******************************************************************************
  * Name:    lex_ReportError
  * Purpose: Report parsing error message
@@ -127,20 +275,73 @@ static const LEX_PARSER g_afParsers[] = {
  *          nColumn [IN] - zero-based column index of the error
  *          pszErroFormat[IN] - error message (format as printf syntax)
  *          ... [IN] - parameters to include in the message
+ * Remark:  While a whole line is read, the message is kept in the line
+ *          instead (see LEX_LINE). The parsers report only the error that
+ *          fails the token, so the line keeps one message.
   *****************************************************************************/
 static void lex_ReportError(HLEX_FILE hFile, BOOL bIsError, int nColumn,
                             const char * pszErrorFormat, ...) {
     va_list vaArgs;
+    PLEX_LINE ptDeferringLine = hFile->ptDeferringLine;
+    
     va_start (vaArgs, pszErrorFormat);
-    hFile->pfnErrorsCallback(hFile->pvContext,
-                             LINESTR_GetFullFileName(hFile->hSourceFile),
-                             hFile->ptCurrentLine->nLineNumber,
-                             nColumn+1, 
-                             hFile->ptCurrentLine->szLine,
-                             bIsError, pszErrorFormat, vaArgs);
+    if (NULL != ptDeferringLine) {
+        vsnprintf(ptDeferringLine->szError, sizeof(ptDeferringLine->szError),
+                  pszErrorFormat, vaArgs);
+        ptDeferringLine->nErrorColumn = nColumn;
+        ptDeferringLine->bIsError = bIsError;
+    } else {
+        lex_CallErrorsCallback(hFile, hFile->ptCurrentLine, bIsError, nColumn,
+                               pszErrorFormat, vaArgs);
+    }
     va_end (vaArgs);
 }
 
+/******************************************************************************
+ * Name:    lex_ReportDeferredError
+ * Purpose: Report the deferred error of a line
+ * Parameters:
+ *          hFile [IN] - handle to the current file
+ *          ptLine [IN] - the line with the deferred error
+ *          pszErroFormat[IN] - error message (format as printf syntax)
+ *          ... [IN] - parameters to include in the message
+ *****************************************************************************/
+static void lex_ReportDeferredError(HLEX_FILE hFile, PLEX_LINE ptLine,
+                                    const char * pszErrorFormat, ...) {
+    va_list vaArgs;
+    
+    va_start (vaArgs, pszErrorFormat);
+    lex_CallErrorsCallback(hFile, ptLine->ptLine, ptLine->bIsError,
+                           ptLine->nErrorColumn, pszErrorFormat, vaArgs);
+    va_end (vaArgs);
+}
+
+/******************************************************************************
+ * Name:    lex_FindKeyword
+ * Purpose: Find a keyword (opcode, register or directive) in the keywords table
+ * Parameters:
+ *          pcText [IN] - the text to search (not null-terminated)
+ *          nLength [IN] - the length (in chars) of the text
+ * Return Value:
+ *          The keyword, or NULL if the text isn't a keyword
+ *****************************************************************************/
+static const LEX_KEYWORD * lex_FindKeyword(const char * pcText, int nLength) {
+    const LEX_KEYWORD * ptKeyword = NULL;
+    
+    /* The hash reads the first 2 chars, so check the length first */
+    if (nLength < LEX_MIN_KEYWORD_LENGTH || nLength > LEX_MAX_KEYWORD_LENGTH) {
+        return NULL;
+    }
+    
+    /* Only one keyword may have this hash */
+    ptKeyword = &g_atKeywords[LEX_KEYWORD_HASH(pcText, nLength)];
+    if (nLength != ptKeyword->nLength
+            || 0 != memcmp(ptKeyword->pszKeyword, pcText, nLength)) {
+        return NULL;
+    }
+    return ptKeyword;
+}
+
 /******************************************************************************
  * Name:    lex_ParseRemark
  * Purpose: Parse remarks in the code. Remark starts with the ';' character
@@ -151,11 +352,6 @@ static void lex_ReportError(HLEX_FILE hFile, BOOL bIsError, int nColumn,
  *          see LEX_PARSER declaration above
  *****************************************************************************/
 static GLOB_ERROR lex_ParseRemark(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
-    /* Check if the current char is the remark sign*/
-    if (';' != hFile->ptCurrentLine->szLine[hFile->nCurrentColumn]) {
-        return GLOB_ERROR_CONTINUE;
-    }
-    
     ptToken->eKind = LEX_TOKEN_KIND_REMARK;
     /* Move to the end of line */
     hFile->nCurrentColumn = hFile->nCurrentLineLength;
@@ -172,15 +368,8 @@ static GLOB_ERROR lex_ParseRemark(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
  *          see LEX_PARSER declaration above
  *****************************************************************************/
 static GLOB_ERROR lex_ParseSpecialChar(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
-    char cCurrentChar = '\0';
-    cCurrentChar = hFile->ptCurrentLine->szLine[hFile->nCurrentColumn];
-    
-    /* Check if the current char is one of the one-char tokens */
-    if (NULL == strchr(",()", cCurrentChar)) {
-        return GLOB_ERROR_CONTINUE;
-    }
     ptToken->eKind = LEX_TOKEN_KIND_SPECIAL;
-    ptToken->uValue.cChar = cCurrentChar;
+    ptToken->uValue.cChar = LEX_CURRENT_CHAR(hFile);
     hFile->nCurrentColumn++;
     return GLOB_SUCCESS;
 }
@@ -195,38 +384,30 @@ static GLOB_ERROR lex_ParseSpecialChar(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
  *****************************************************************************/
 static GLOB_ERROR lex_ParseDirective(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
     int nTokenLength = 0;
-    int nDirectiveIndex = 0;
-    
-    /* Directives start with the "." character. */
-    if ('.' != hFile->ptCurrentLine->szLine[hFile->nCurrentColumn]) {
-        return GLOB_ERROR_CONTINUE;
-    }
+    const LEX_KEYWORD * ptKeyword = NULL;
     
     /* Skip the '.' */
     hFile->nCurrentColumn++;
     
     /* Read the directive name */
     while ((hFile->nCurrentColumn < hFile->nCurrentLineLength)
-            && isalpha(hFile->ptCurrentLine->szLine[hFile->nCurrentColumn])) {
+            && isalpha(LEX_CURRENT_CHAR(hFile))) {
         hFile->nCurrentColumn++;
     }
     
     /* Calculate the directive length (without the '.') */
     nTokenLength = hFile->nCurrentColumn - ptToken->nColumn - 1;
     
-    /* Search the directives array */
-    nDirectiveIndex = HELPER_FindInStringsArray(
-                g_aszDirectives,
-                ARRAY_ELEMENTS(g_aszDirectives),
-                hFile->ptCurrentLine->szLine+ptToken->nColumn+1,
-                nTokenLength);
+    /* Search the keywords table */
+    ptKeyword = lex_FindKeyword(hFile->ptCurrentLine->pcLine+ptToken->nColumn+1,
+                                nTokenLength);
     
-    if (-1 == nDirectiveIndex) {
+    if (NULL == ptKeyword || LEX_TOKEN_KIND_DIRECTIVE != ptKeyword->eKind) {
         /* Unknown directive error */
         lex_ReportError(hFile, TRUE, ptToken->nColumn, "Unknown directive");
         return GLOB_ERROR_PARSING_FAILED;
     }
-    ptToken->uValue.eDiretive = (GLOB_DIRECTIVE)nDirectiveIndex;
+    ptToken->uValue.eDiretive = (GLOB_DIRECTIVE)ptKeyword->nValue;
     ptToken->eKind = LEX_TOKEN_KIND_DIRECTIVE;
     return GLOB_SUCCESS;
 }
@@ -242,11 +423,7 @@ static GLOB_ERROR lex_ParseDirective(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
 static GLOB_ERROR lex_ParseImmediateNumber(HLEX_FILE hFile, PLEX_TOKEN ptToken){
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     
-    /* Check for the '#' sign */
-    if ('#' != hFile->ptCurrentLine->szLine[hFile->nCurrentColumn]) {
-        return GLOB_ERROR_CONTINUE;
-    }
-    /* Skip it. */
+    /* Skip the '#' sign */
     hFile->nCurrentColumn++;
     
     /* Now we expect a number*/
@@ -270,6 +447,10 @@ static GLOB_ERROR lex_ParseImmediateNumber(HLEX_FILE hFile, PLEX_TOKEN ptToken){
  *          see LEX_PARSER declaration above
  * Return Value:
  *          see LEX_PARSER declaration above
+ *          GLOB_ERROR_CONTINUE - there is no number at the current position.
+ *          Possible only after the '#' of an immediate number (see
+ *          lex_ParseImmediateNumber), since the first char isn't checked
+ *          by g_afParsers there.
  *****************************************************************************/
 static GLOB_ERROR lex_ParseNumber(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
     BOOL bFoundDigit = FALSE;
@@ -278,10 +459,10 @@ static GLOB_ERROR lex_ParseNumber(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
     int nValue = 0;
     
     /* the first char may be a digit, a plus or a minus sign */
-    bIsMinus = ('-' == hFile->ptCurrentLine->szLine[hFile->nCurrentColumn]);
-    bIsPlus = ('+' == hFile->ptCurrentLine->szLine[hFile->nCurrentColumn]);
+    bIsMinus = ('-' == LEX_CURRENT_CHAR(hFile));
+    bIsPlus = ('+' == LEX_CURRENT_CHAR(hFile));
     if (!bIsMinus && !bIsPlus
-            && !isdigit(hFile->ptCurrentLine->szLine[hFile->nCurrentColumn])) {
+            && !isdigit(LEX_CURRENT_CHAR(hFile))) {
         return GLOB_ERROR_CONTINUE;
     }
     
@@ -292,10 +473,10 @@ static GLOB_ERROR lex_ParseNumber(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
     
     /* Now we expect the value (digits) */
     while ((hFile->nCurrentColumn < hFile->nCurrentLineLength)
-            && isdigit(hFile->ptCurrentLine->szLine[hFile->nCurrentColumn])) {
+            && isdigit(LEX_CURRENT_CHAR(hFile))) {
         bFoundDigit = TRUE;
         nValue = 10*nValue +
-                hFile->ptCurrentLine->szLine[hFile->nCurrentColumn] - '0';
+                LEX_CURRENT_CHAR(hFile) - '0';
         hFile->nCurrentColumn++;
     }
     
@@ -321,17 +502,14 @@ static GLOB_ERROR lex_ParseNumber(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
  *          see LEX_PARSER declaration above
  *****************************************************************************/
 static GLOB_ERROR lex_ParseString(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
-    /* Strings begin with the '"' character*/
-    if ('"' != hFile->ptCurrentLine->szLine[hFile->nCurrentColumn]) {
-        return GLOB_ERROR_CONTINUE;
-    }
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     
     /* Skip the opening '"' */
     hFile->nCurrentColumn++;
     
     /* Now we are searching for the closing '"' */
     while ((hFile->nCurrentColumn < hFile->nCurrentLineLength)
-            && ('"' != hFile->ptCurrentLine->szLine[hFile->nCurrentColumn])) {
+            && ('"' != LEX_CURRENT_CHAR(hFile))) {
         hFile->nCurrentColumn++;
     }
     
@@ -341,14 +519,18 @@ static GLOB_ERROR lex_ParseString(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
         return GLOB_ERROR_PARSING_FAILED;
     }
     
-    /* Allocate space for the value of the token */
-    ptToken->uValue.szStr = malloc(hFile->nCurrentColumn - ptToken->nColumn );
-    if (NULL == ptToken->uValue.szStr) {
-        return GLOB_ERROR_SYS_CALL_ERROR();
+    /* Allocate space for the value of the token (the '"' is replaced
+     * with '\0') */
+    eRetValue = ARENA_Alloc(hFile->hArena,
+                            hFile->nCurrentColumn - ptToken->nColumn,
+                            (void **)&ptToken->uValue.szStr);
+    if (eRetValue) {
+        return eRetValue;
     }
-    strncpy(ptToken->uValue.szStr,
-        hFile->ptCurrentLine->szLine + ptToken-> nColumn + 1,
+    memcpy(ptToken->uValue.szStr,
+        hFile->ptCurrentLine->pcLine + ptToken-> nColumn + 1,
         hFile->nCurrentColumn - ptToken->nColumn - 1);
+    ptToken->uValue.szStr[hFile->nCurrentColumn - ptToken->nColumn - 1] = '\0';
     /* Skip the closing '"' */
     hFile->nCurrentColumn++;
     
@@ -367,21 +549,16 @@ static GLOB_ERROR lex_ParseString(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
 static GLOB_ERROR lex_ParseAlpha(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
     BOOL bIsLabelDefinition = FALSE;
     int nIdentifierLength = 0;
-    int nOpcode = -1;
-    int nDirective = -1;
-    int nRegister = -1;
+    const LEX_KEYWORD * ptKeyword = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     
-    /* The first character should be a letter */
-    if (!isalpha(hFile->ptCurrentLine->szLine[hFile->nCurrentColumn])) {
-        return GLOB_ERROR_CONTINUE;
-    }
-    /* Skip the first char */
+    /* Skip the first char (a letter) */
     hFile->nCurrentColumn++;
     
     /* The remaining characters may be either letters or digits */
     while ((hFile->nCurrentColumn < hFile->nCurrentLineLength)
-            && (isalpha(hFile->ptCurrentLine->szLine[hFile->nCurrentColumn])
-               ||isdigit(hFile->ptCurrentLine->szLine[hFile->nCurrentColumn]))){
+            && (isalpha(LEX_CURRENT_CHAR(hFile))
+               ||isdigit(LEX_CURRENT_CHAR(hFile)))){
         hFile->nCurrentColumn++;
     }
     
@@ -394,51 +571,42 @@ static GLOB_ERROR lex_ParseAlpha(HLEX_FILE hFile, PLEX_TOKEN ptToken) {
     
     /* Check if the next char is semi-colon, indicates label definition. */
     bIsLabelDefinition =  ((hFile->nCurrentColumn < hFile->nCurrentLineLength)
-            && ':' == hFile->ptCurrentLine->szLine[hFile->nCurrentColumn]);
+            && ':' == LEX_CURRENT_CHAR(hFile));
     
     /* Check if this is an opcode, register or directive*/
-    nOpcode = HELPER_FindInStringsArray(g_aszOpcodes,
-                ARRAY_ELEMENTS(g_aszOpcodes),
-                hFile->ptCurrentLine->szLine + ptToken->nColumn,
-                nIdentifierLength);
-    nRegister = HELPER_FindInStringsArray(g_aszRegisters,
-                ARRAY_ELEMENTS(g_aszRegisters),
-                hFile->ptCurrentLine->szLine + ptToken->nColumn,
-                nIdentifierLength);
-    nDirective = HELPER_FindInStringsArray(g_aszDirectives,
-                ARRAY_ELEMENTS(g_aszDirectives),
-                hFile->ptCurrentLine->szLine + ptToken->nColumn,
-                nIdentifierLength);
+    ptKeyword = lex_FindKeyword(hFile->ptCurrentLine->pcLine + ptToken->nColumn,
+                                nIdentifierLength);
+    
     /* Opcode, Directive and Registers are forbidden as labels */
-    if ((-1 != nDirective) ||
-            (bIsLabelDefinition && ((-1 != nOpcode) || (-1 != nRegister)))) {
+    if ((NULL != ptKeyword)
+            && (bIsLabelDefinition
+                || LEX_TOKEN_KIND_DIRECTIVE == ptKeyword->eKind)) {
         lex_ReportError(hFile, TRUE, ptToken->nColumn,
                 "Forbidden label name");
         return GLOB_ERROR_PARSING_FAILED;
     }
     
     /* Check for opcode. */
-    if (-1 != nOpcode) {
+    if (NULL != ptKeyword && LEX_TOKEN_KIND_OPCODE == ptKeyword->eKind) {
         ptToken->eKind = LEX_TOKEN_KIND_OPCODE;
-        ptToken->uValue.eOpcode = nOpcode;
+        ptToken->uValue.eOpcode = (GLOB_OPCODE)ptKeyword->nValue;
         return GLOB_SUCCESS;
     }
     
     /* Check for register. */
-    if (-1 != nRegister) {
+    if (NULL != ptKeyword && LEX_TOKEN_KIND_REGISTER == ptKeyword->eKind) {
         ptToken->eKind = LEX_TOKEN_KIND_REGISTER;
-        ptToken->uValue.nNumber = nRegister;
+        ptToken->uValue.nNumber = ptKeyword->nValue;
         return GLOB_SUCCESS;
     }
     
-    /* For label (definition/usage) we need to copy the string */
-    ptToken->uValue.szStr = malloc(hFile->nCurrentColumn -ptToken->nColumn + 1);
-    if (NULL == ptToken->uValue.szStr) {
-        return GLOB_ERROR_SYS_CALL_ERROR();
+    /* For label (definition/usage) we need the id of the name */
+    eRetValue = INTERN_Add(hFile->hNames,
+                           hFile->ptCurrentLine->pcLine + ptToken->nColumn,
+                           nIdentifierLength, &ptToken->uValue.nNameId);
+    if (eRetValue) {
+        return eRetValue;
     }
-    strncpy(ptToken->uValue.szStr,
-            hFile->ptCurrentLine->szLine + ptToken->nColumn,
-            hFile->nCurrentColumn - ptToken->nColumn);
     ptToken->eKind = bIsLabelDefinition ?
                      LEX_TOKEN_KIND_LABEL :
                      LEX_TOKEN_KIND_WORD;
@@ -473,16 +641,17 @@ static GLOB_ERROR lex_MoveToNextToken(HLEX_FILE hFile,
             return eRetValue;
         }
         hFile->nCurrentColumn = 0;
-        hFile->nCurrentLineLength = strlen(hFile->ptCurrentLine->szLine);
-
+        hFile->nCurrentLineLength = hFile->ptCurrentLine->nLength;
+        STATS_Count(STATS_COUNTER_LINES, 1);
+        
         bFirstToken = TRUE;
         bNoSpaceFromPrevToken = FALSE;
     }
     
     /* Skip white chars (spaces and tabs) */
     while (hFile->nCurrentColumn < hFile->nCurrentLineLength) {
-        if ((' ' != hFile->ptCurrentLine->szLine[hFile->nCurrentColumn])
-            && ('\t' != hFile->ptCurrentLine->szLine[hFile->nCurrentColumn])) {
+        if ((' ' != LEX_CURRENT_CHAR(hFile))
+            && ('\t' != LEX_CURRENT_CHAR(hFile))) {
             break;
         }
         bNoSpaceFromPrevToken = FALSE;
@@ -498,27 +667,68 @@ static GLOB_ERROR lex_MoveToNextToken(HLEX_FILE hFile,
 }
 
 /******************************************************************************
- * EXTERNAL FUNCTIONS
- * ------------------
- * See function-level documentation in the header file
+ * Name:    lex_ParseToken
+ * Purpose: Parse the token at the current position (after the white chars)
+ * Parameters:
+ *          hFile [IN] - handle to the current file
+ *          eTokenFlags [IN] - the flags of the token (see lex_MoveToNextToken)
+ *          ptToken [OUT] - the token to fill (except of its line)
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_PARSING_FAILED if the token can't be parsed.
+ *          If the function fails, an error code is returned.
  *****************************************************************************/
+static GLOB_ERROR lex_ParseToken(HLEX_FILE hFile,
+                                 LEX_TOKEN_FLAGS eTokenFlags,
+                                 PLEX_TOKEN ptToken) {
+    LEX_PARSER pfnParser = NULL;
+    
+    STATS_Count(STATS_COUNTER_TOKENS, 1);
+    
+    /* Set common properties */
+    ptToken->eFlags = eTokenFlags;
+    ptToken->nColumn = hFile->nCurrentColumn;
+    
+    if (hFile->nCurrentColumn >= hFile->nCurrentLineLength) {
+        /* End of line token */
+        ptToken->eKind = LEX_TOKEN_KIND_END_OF_LINE;
+        return GLOB_SUCCESS;
+    }
+    
+    /* The first char selects the parser */
+    pfnParser = g_afParsers[(unsigned char)LEX_CURRENT_CHAR(hFile)];
+    if (NULL == pfnParser) {
+        /* No parser found */
+        lex_ReportError(hFile, TRUE, ptToken->nColumn, "unknown syntax");
+        return GLOB_ERROR_PARSING_FAILED;
+    }
+    return pfnParser(hFile, ptToken);
+}
 
 /******************************************************************************
- * LEX_Open
+ * Name:    lex_Create
+ * Purpose: Create a handle for parsing an opened source file
+ * Parameters:
+ *          hSourceFile [IN] - the source file. On success, it is closed
+ *                             with the handle.
+ *          hNames [IN] - the table to add the names of the labels to
+ *          pfnErrorsCallback [IN] - callback function for errors/warnings
+ *          pvContext [IN] - context for the callback function
+ *          phFile [OUT] - the created handle
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
  *****************************************************************************/
-GLOB_ERROR LEX_Open(const char * szFileName,
-                    GLOB_ERRORCALLBACK pfnErrorsCallback,
-                    void * pvContext,
-                    PHLEX_FILE phFile){
+static GLOB_ERROR lex_Create(HLINESTR_FILE hSourceFile,
+                             HINTERN_TABLE hNames,
+                             GLOB_ERRORCALLBACK pfnErrorsCallback,
+                             void * pvContext,
+                             PHLEX_FILE phFile) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     HLEX_FILE hFile = NULL;
     
-    /* Check parameters */
-    if (NULL == szFileName || NULL == phFile) {
-        return GLOB_ERROR_INVALID_PARAMETERS;
-    }
-    
     /* Allocate the handle */
+    STATS_CountAllocation(STATS_MODULE_LEX, sizeof(*hFile));
     hFile = malloc(sizeof(*hFile));
     if (NULL == hFile) {
         return GLOB_ERROR_SYS_CALL_ERROR();
@@ -530,11 +740,14 @@ GLOB_ERROR LEX_Open(const char * szFileName,
     hFile->ptCurrentLine = NULL;
     hFile->nCurrentColumn = 0;
     hFile->nCurrentLineLength = 0;
-    hFile->hSourceFile = NULL;
+    hFile->hSourceFile = hSourceFile;
+    hFile->hNames = hNames;
+    hFile->hArena = NULL;
+    hFile->ptDeferringLine = NULL;
     
-    /* Open the source file */
-    eRetValue = LINESTR_Open(szFileName, &hFile->hSourceFile);
-    if(eRetValue) {
+    /* Create the arena of the strings of the tokens */
+    eRetValue = ARENA_Create(&hFile->hArena);
+    if (eRetValue) {
         free(hFile);
         return eRetValue;
     }
@@ -545,103 +758,191 @@ GLOB_ERROR LEX_Open(const char * szFileName,
 }
 
 /******************************************************************************
- * LEX_ReadNextToken
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
  *****************************************************************************/
-GLOB_ERROR LEX_ReadNextToken(HLEX_FILE hFile, PLEX_TOKEN * pptToken) {
-    PLEX_TOKEN ptToken = NULL;
-    LEX_TOKEN_FLAGS eTokenFlags = 0;
-    
+
+/******************************************************************************
+ * LEX_Open
+ *****************************************************************************/
+GLOB_ERROR LEX_Open(const char * szFileName,
+                    HINTERN_TABLE hNames,
+                    GLOB_ERRORCALLBACK pfnErrorsCallback,
+                    void * pvContext,
+                    PHLEX_FILE phFile){
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    HLINESTR_FILE hSourceFile = NULL;
     
-    /* Check Parameters */
-    if (NULL == hFile || NULL == pptToken) {
+    /* Check parameters */
+    if (NULL == szFileName || NULL == hNames || NULL == phFile) {
         return GLOB_ERROR_INVALID_PARAMETERS;
     }
-
-    /* Move to next token */
-    eRetValue = lex_MoveToNextToken(hFile, &eTokenFlags);
+    
+    /* Open the source file */
+    eRetValue = LINESTR_Open(szFileName, &hSourceFile);
+    if(eRetValue) {
+        return eRetValue;
+    }
+    
+    /* Create the handle */
+    eRetValue = lex_Create(hSourceFile, hNames, pfnErrorsCallback,
+                           pvContext, phFile);
     if (eRetValue) {
+        LINESTR_Close(hSourceFile);
         return eRetValue;
     }
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * LEX_OpenBuffer
+ *****************************************************************************/
+GLOB_ERROR LEX_OpenBuffer(const char * szName,
+                          const char * pcBuffer,
+                          size_t nLength,
+                          HINTERN_TABLE hNames,
+                          GLOB_ERRORCALLBACK pfnErrorsCallback,
+                          void * pvContext,
+                          PHLEX_FILE phFile){
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    HLINESTR_FILE hSourceFile = NULL;
     
-    /* Allocate a token */
-    ptToken = malloc(sizeof(*ptToken));
-    if (NULL == ptToken) {
-        return GLOB_ERROR_SYS_CALL_ERROR();
+    /* Check parameters */
+    if (NULL == szName || NULL == hNames || NULL == phFile) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
     }
     
-    /* Set common properties */
-    ptToken->eFlags = eTokenFlags;
-    ptToken->nColumn = hFile->nCurrentColumn;
+    /* Open the source buffer */
+    eRetValue = LINESTR_OpenBuffer(szName, pcBuffer, nLength, &hSourceFile);
+    if(eRetValue) {
+        return eRetValue;
+    }
     
-    if (hFile->nCurrentColumn >= hFile->nCurrentLineLength) {
-        /* End of line token */
-        ptToken->eKind = LEX_TOKEN_KIND_END_OF_LINE;
-    } else {
-        for (int nParserIndex = 0;
-                nParserIndex < ARRAY_ELEMENTS(g_afParsers);
-                nParserIndex++) {
-            eRetValue = g_afParsers[nParserIndex](hFile, ptToken);
-            if (GLOB_ERROR_CONTINUE != eRetValue) {
-                break;
-            }
+    /* Create the handle */
+    eRetValue = lex_Create(hSourceFile, hNames, pfnErrorsCallback,
+                           pvContext, phFile);
+    if (eRetValue) {
+        LINESTR_Close(hSourceFile);
+        return eRetValue;
+    }
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * LEX_ReadLine
+ *****************************************************************************/
+GLOB_ERROR LEX_ReadLine(HLEX_FILE hFile, PLEX_LINE ptLine) {
+    PLEX_TOKEN ptToken = NULL;
+    LEX_TOKEN_FLAGS eTokenFlags = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check Parameters */
+    if (NULL == hFile || NULL == ptLine) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    ptLine->nTokens = 0;
+    
+    /* Parse the tokens until the end of line. The errors are kept in the
+     * line, so the first error stops the line. */
+    hFile->ptDeferringLine = ptLine;
+    do {
+        eRetValue = lex_MoveToNextToken(hFile, &eTokenFlags);
+        if (eRetValue) {
+            /* Including EOF */
+            break;
         }
-        if (GLOB_ERROR_CONTINUE == eRetValue) {
-            /* No parser found */
-            lex_ReportError(hFile, TRUE, ptToken->nColumn,
-                "unknown syntax");
-            eRetValue = GLOB_ERROR_PARSING_FAILED;
+        if (LEX_MAX_LINE_TOKENS == ptLine->nTokens) {
+            /* Can't happen (see LEX_MAX_LINE_TOKENS) */
+            eRetValue = GLOB_ERROR_UNKNOWN;
+            break;
         }
-    
+        ptToken = &ptLine->atTokens[ptLine->nTokens];
+        eRetValue = lex_ParseToken(hFile, eTokenFlags, ptToken);
         if (eRetValue) {
-            /* Failed to parse the current token. */
-            free(ptToken);
-            return eRetValue;
+            break;
         }
+        ptToken->ptLine = hFile->ptCurrentLine;
+        ptLine->nTokens++;
+    } while (LEX_TOKEN_KIND_END_OF_LINE != ptToken->eKind);
+    hFile->ptDeferringLine = NULL;
+    if (eRetValue && GLOB_ERROR_PARSING_FAILED != eRetValue) {
+        return eRetValue;
     }
+    ptLine->eError = eRetValue;
     
-    /* Set the line of the token */
-    ptToken->ptLine = hFile->ptCurrentLine;
-    LINESTR_LineAddRef(ptToken->ptLine);
-    
-    /* Set out parameters */
-    *pptToken = ptToken;
+    /* The tokens take the reference of the file to the line, and the file
+     * moves to the next line */
+    ptLine->ptLine = hFile->ptCurrentLine;
+    hFile->ptCurrentLine = NULL;
     return GLOB_SUCCESS;
 }
 
 /******************************************************************************
- * LEX_MoveToNextLine
+ * LEX_ReportLineError
  *****************************************************************************/
-void LEX_MoveToNextLine(HLEX_FILE hFile){
-    /* Check parameters */
-    if (NULL == hFile) {
-        return;
+GLOB_ERROR LEX_ReportLineError(HLEX_FILE hFile, PLEX_LINE ptLine) {
+    /* Check Parameters */
+    if (NULL == hFile || NULL == ptLine) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
     }
-    if (NULL != hFile->ptCurrentLine) {
-        LINESTR_FreeLine(hFile->ptCurrentLine);
-        hFile->ptCurrentLine = NULL;
+    if (ptLine->eError) {
+        lex_ReportDeferredError(hFile, ptLine, "%s", ptLine->szError);
     }
+    return ptLine->eError;
 }
 
 /******************************************************************************
- * LEX_FreeToken
+ * LEX_FreeLine
  *****************************************************************************/
-void LEX_FreeToken(PLEX_TOKEN ptToken){
-    if (NULL == ptToken) {
+void LEX_FreeLine(HLEX_FILE hFile, PLEX_LINE ptLine) {
+    if (NULL == hFile || NULL == ptLine) {
         return;
     }
+    LINESTR_FreeLine(ptLine->ptLine);
+    ptLine->ptLine = NULL;
+}
+
+/******************************************************************************
+ * LEX_GetSourceSize
+ *****************************************************************************/
+size_t LEX_GetSourceSize(HLEX_FILE hFile) {
+    return LINESTR_GetSize(hFile->hSourceFile);
+}
+
+/******************************************************************************
+ * LEX_GetSource
+ *****************************************************************************/
+const char * LEX_GetSource(HLEX_FILE hFile) {
+    return LINESTR_GetContent(hFile->hSourceFile);
+}
+
+/******************************************************************************
+ * LEX_OpenPart
+ *****************************************************************************/
+GLOB_ERROR LEX_OpenPart(HLEX_FILE hFile,
+                        size_t nOffset,
+                        size_t nLength,
+                        HINTERN_TABLE hNames,
+                        GLOB_ERRORCALLBACK pfnErrorsCallback,
+                        void * pvContext,
+                        PHLEX_FILE phPart) {
+    const char * pcSource = NULL;
     
-    /* In case tokens with a string value, free it*/
-    if (LEX_TOKEN_KIND_STRING == ptToken->eKind
-            || LEX_TOKEN_KIND_LABEL == ptToken->eKind
-            || LEX_TOKEN_KIND_WORD == ptToken->eKind) {
-        free(ptToken->uValue.szStr);
+    /* Check parameters */
+    if (NULL == hFile) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    pcSource = LINESTR_GetContent(hFile->hSourceFile);
+    if (NULL == pcSource
+            || nOffset + nLength > LINESTR_GetSize(hFile->hSourceFile)) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
     }
     
-    LINESTR_FreeLine(ptToken->ptLine);
-    
-    /* Free the token itself */
-    free(ptToken);
+    /* The part is a buffer in the source, with the name of the file */
+    return LEX_OpenBuffer(LINESTR_GetFullFileName(hFile->hSourceFile),
+                          pcSource + nOffset, nLength, hNames,
+                          pfnErrorsCallback, pvContext, phPart);
 }
 
 /******************************************************************************
@@ -652,11 +953,16 @@ void LEX_Close(HLEX_FILE hFile) {
         return;
     }
     /* Free current line */
-    LEX_MoveToNextLine(hFile);
-
+    if (NULL != hFile->ptCurrentLine) {
+        LINESTR_FreeLine(hFile->ptCurrentLine);
+    }
+    
     /* Close the source file*/    
     LINESTR_Close(hFile->hSourceFile);
     
+    /* Free the strings of the tokens */
+    ARENA_Free(hFile->hArena);
+    
     /* Free the handle */
     free(hFile);
 }
@@ -14,6 +14,18 @@
  *****************************************************************************/
 #include "global.h"
 #include "linestr.h"
+#include "intern.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The maximal number of tokens in a line. Each token takes at least one char
+ * of the line, and the end of line token follows them. */
+#define LEX_MAX_LINE_TOKENS LINESTR_MAX_LINE_LENGTH
+
+/* The maximal length of a deferred error message (see LEX_LINE) */
+#define LEX_MAX_ERROR_LENGTH 80
 
 /******************************************************************************
  * TYPEDEFS
@@ -24,8 +36,8 @@
  * about the relevant field to use as a value (see LEX_TOKEN_VALUE). */
 typedef enum LEX_TOKEN_KIND {   /* Description                  Value field*/
                                 /* --------------------------   -----------*/
-    LEX_TOKEN_KIND_LABEL,       /* Label definition             szStr      */
-    LEX_TOKEN_KIND_WORD,        /* Label usage                  szStr      */
+    LEX_TOKEN_KIND_LABEL,       /* Label definition             nNameId    */
+    LEX_TOKEN_KIND_WORD,        /* Label usage                  nNameId    */
     LEX_TOKEN_KIND_NUMBER,      /* Number (in .data line)       nNumber    */
     LEX_TOKEN_KIND_IMMED_NUMBER,/* Number (immediate address)   nNumber    */
     LEX_TOKEN_KIND_OPCODE,      /* Opcode                       eOpcode    */
@@ -41,6 +53,7 @@ typedef enum LEX_TOKEN_KIND {   /* Description                  Value field*/
  * See LEX_TOKEN_KIND documentation above. */
 typedef union LEX_TOKEN_VALUE {
     char * szStr;
+    int nNameId; /* The id of the name in the table of names (see INTERN) */
     int nNumber;
     GLOB_OPCODE eOpcode;
     GLOB_DIRECTIVE eDiretive;
@@ -60,8 +73,8 @@ typedef enum LEX_TOKEN_FLAGS {
     LEX_TOKEN_FLAGS_NO_SPACE_FROM_PREV_TOKEN = 2,
 } LEX_TOKEN_FLAGS, *PLEX_TOKEN_FLAGS;
 
-/* LEX_TOKEN encapsulates the information about a token. The caller must free
- * the token with LEX_FreeToken. */
+/* LEX_TOKEN encapsulates the information about a token. The string of the
+ * token is owned by the file, so it is valid until LEX_Close. */
 typedef struct LEX_TOKEN {
     
     /* The kind of token. It determines the value type.
@@ -81,6 +94,31 @@ typedef struct LEX_TOKEN {
     LEX_TOKEN_VALUE uValue;
 } LEX_TOKEN, *PLEX_TOKEN;
 
+/* LEX_LINE holds the tokens of a whole line (see LEX_ReadLine). The tokens
+ * share one reference to the source line, which is released by LEX_FreeLine.
+ * If a token can't be parsed, the tokens end before it and its error is
+ * deferred, so the caller reports it (by LEX_ReportLineError) only if it
+ * gets to this token, in the order of the other errors of the line. */
+typedef struct LEX_LINE {
+    
+    /* The source line of the tokens */
+    PLINESTR_LINE ptLine;
+    
+    /* The tokens. If the line was parsed successfully, the last token is
+     * the end of line. */
+    LEX_TOKEN atTokens[LEX_MAX_LINE_TOKENS];
+    int nTokens;
+    
+    /* GLOB_SUCCESS, or the error of the token after the tokens */
+    GLOB_ERROR eError;
+    
+    /* The column and the message of the deferred error, and whether it is
+     * an error (TRUE) or a warning (FALSE) */
+    int nErrorColumn;
+    char szError[LEX_MAX_ERROR_LENGTH];
+    BOOL bIsError;
+} LEX_LINE, *PLEX_LINE;
+
 /* The HLEX_FILE represents a handle to a file opened by the LEX_Open
  * function. Always close the handle with the LEX_Close function. */
 typedef struct LEX_FILE LEX_FILE, *HLEX_FILE, **PHLEX_FILE;
@@ -94,6 +132,7 @@ typedef struct LEX_FILE LEX_FILE, *HLEX_FILE, **PHLEX_FILE;
  * Purpose: The function opens a source file for parsing.
  * Parameters:
  *          szFileName [IN] - the path to the file to open (w/o the extension)
+ *          hNames [IN] - the table to add the names of the labels to
  *          pfnErrorsCallback [IN] - callback function for errors/warnings
  *          pvContext [IN] - context for the callback function
  *          phFile [OUT] - the handle to the opened file
@@ -104,47 +143,133 @@ typedef struct LEX_FILE LEX_FILE, *HLEX_FILE, **PHLEX_FILE;
  *          If the function fails, an error code is returned.
  *****************************************************************************/
 GLOB_ERROR LEX_Open(const char * szFileName,
+                    HINTERN_TABLE hNames,
                     GLOB_ERRORCALLBACK pfnErrorsCallback,
                     void * pvContext,
                     PHLEX_FILE phFile);
 
 /******************************************************************************
- * Name:    LEX_ReadNextToken
- * Purpose: The function reads the next token from the current line in the
- *          source file.
+ * Name:    LEX_OpenBuffer
+ * Purpose: The function opens source code in a memory buffer for parsing.
  * Parameters:
- *          hFile [IN] - handle to the file, previously opened by LEX_Open.
- *          pptToken [OUT] - the retrieved token.
+ *          szName [IN] - the name of the source (used in the messages)
+ *          pcBuffer [IN] - the source code (doesn't have to be
+ *                          null-terminated)
+ *          nLength [IN] - the length (in chars) of the source code
+ *          hNames [IN] - the table to add the names of the labels to
+ *          pfnErrorsCallback [IN] - callback function for errors/warnings
+ *          pvContext [IN] - context for the callback function
+ *          phFile [OUT] - the handle to the opened source
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
- *          In this case, the token must be freed with LEX_FreeToken.
+ *          In this case, a handle to the opened source is returned in phFile
+ *          and the caller must close it with LEX_Close.
+ *          If the function fails, an error code is returned.
+ * Remark:  The buffer must be valid until the call to LEX_Close.
+ *****************************************************************************/
+GLOB_ERROR LEX_OpenBuffer(const char * szName,
+                          const char * pcBuffer,
+                          size_t nLength,
+                          HINTERN_TABLE hNames,
+                          GLOB_ERRORCALLBACK pfnErrorsCallback,
+                          void * pvContext,
+                          PHLEX_FILE phFile);
+
+/******************************************************************************
+ * Name:    LEX_ReadLine
+ * Purpose: The function reads the tokens of the rest of the current line (or
+ *          of the next line) in the source file, and moves to the next line.
+ * Parameters:
+ *          hFile [IN] - handle to the file, previously opened by LEX_Open.
+ *          ptLine [OUT] - the tokens of the line
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned, even if
+ *          a token can't be parsed (see LEX_LINE). In this case, the line
+ *          must be freed with LEX_FreeLine.
  *          GLOB_ERROR_END_OF_FILE is returned if finished to process the file.
  *          If the function fails, an error code is returned.
+ * Remark:  The tokens are not allocated, so reading a line costs one
+ *          reference to the source line.
  *****************************************************************************/
-GLOB_ERROR LEX_ReadNextToken(HLEX_FILE hFile, PLEX_TOKEN * pptToken);
+GLOB_ERROR LEX_ReadLine(HLEX_FILE hFile, PLEX_LINE ptLine);
 
 /******************************************************************************
- * Name:    LEX_MoveToNextLine
- * Purpose: Move to the next line in the source file
+ * Name:    LEX_ReportLineError
+ * Purpose: Report the deferred error of a line (see LEX_LINE)
+ * Parameters:
+ *          hFile [IN] - handle to the file the line was read from.
+ *          ptLine [IN] - the line
+ * Return Value:
+ *          The error of the token after the tokens of the line.
+ *          GLOB_SUCCESS if the whole line was parsed (nothing is reported).
+ *****************************************************************************/
+GLOB_ERROR LEX_ReportLineError(HLEX_FILE hFile, PLEX_LINE ptLine);
+
+/******************************************************************************
+ * Name:    LEX_FreeLine
+ * Purpose: The function frees a line previously returned from LEX_ReadLine.
+ * Parameters:
+ *          hFile [IN] - handle to the file the line was read from.
+ *          ptLine [IN] - the line to free.
+ *****************************************************************************/
+void LEX_FreeLine(HLEX_FILE hFile, PLEX_LINE ptLine);
+
+/******************************************************************************
+ * Name:    LEX_GetSourceSize
+ * Purpose: Get the size of the source, to estimate the size of its binary
  * Parameters:
  *          hFile [IN] - handle to the file, previously opened by LEX_Open.
+ * Return Value:
+ *          The size (in chars) of the source. 0 if it is unknown.
  *****************************************************************************/
-void LEX_MoveToNextLine(HLEX_FILE hFile);
+size_t LEX_GetSourceSize(HLEX_FILE hFile);
 
 /******************************************************************************
- * Name:    LEX_FreeTokenLEX_FreeToken
- * Purpose: The function frees a token previously returned
- *          from LEX_ReadNextToken.
+ * Name:    LEX_GetSource
+ * Purpose: Get the source, if it is in the memory
  * Parameters:
- *          ptToken [IN] - the token to free.
+ *          hFile [IN] - handle to the file, previously opened by LEX_Open.
+ * Return Value:
+ *          The source (LEX_GetSourceSize chars, not null-terminated). It is
+ *          valid until LEX_Close. NULL if the source isn't in the memory.
+ *****************************************************************************/
+const char * LEX_GetSource(HLEX_FILE hFile);
+
+/******************************************************************************
+ * Name:    LEX_OpenPart
+ * Purpose: The function opens a part of the source of an opened file for
+ *          parsing. The messages of the part have the name of the file.
+ * Parameters:
+ *          hFile [IN] - handle to the file, previously opened by LEX_Open.
+ *          nOffset [IN] - the offset (in chars) of the part in the source.
+ *                         It should be the beginning of a line.
+ *          nLength [IN] - the length (in chars) of the part
+ *          hNames [IN] - the table to add the names of the labels to
+ *          pfnErrorsCallback [IN] - callback function for errors/warnings
+ *          pvContext [IN] - context for the callback function
+ *          phPart [OUT] - the handle to the part
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_INVALID_PARAMETERS if the source isn't in the memory
+ *          (see LEX_GetSource) or the part isn't in the source.
+ *          If the function fails, an error code is returned.
+ * Remark:  The lines of the part are numbered from 1. The part must be closed
+ *          (with LEX_Close) before the file.
  *****************************************************************************/
-void LEX_FreeToken(PLEX_TOKEN ptToken);
+GLOB_ERROR LEX_OpenPart(HLEX_FILE hFile,
+                        size_t nOffset,
+                        size_t nLength,
+                        HINTERN_TABLE hNames,
+                        GLOB_ERRORCALLBACK pfnErrorsCallback,
+                        void * pvContext,
+                        PHLEX_FILE phPart);
 
 /******************************************************************************
  * Name:    LEX_Close
  * Purpose: The function closes a file previously opened by LEX_Open
  * Parameters:
  *          hFile [IN] - handle to the file to close
+ * Remark:  All the tokens of the file must be freed before closing it.
  *****************************************************************************/
 void LEX_Close(HLEX_FILE hFile);
 
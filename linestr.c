@@ -6,7 +6,14 @@
  * See linestr.h for more documentation.
  * 
  * Implementation:
- * File I/O operations are performed with standard C library functions.
+ * Regular files are mapped to the memory with mmap. The lines are views into
+ * the mapping, and the LINESTR_LINE structures are allocated in blocks that
+ * belong to the file handle, so reading a line doesn't allocate or copy.
+ * Source code in a memory buffer (LINESTR_OpenBuffer) is read the same way
+ * as a mapping, but the buffer belongs to the caller.
+ * For other files (or if the mapping fails) we fall back to the standard C
+ * library functions. In this case, each line is allocated separately
+ * together with the buffer of its text.
  * The LINESTR_HANDLE contains the information for reading the next lines from
  * the source file and counting the rows.
  *****************************************************************************/
@@ -17,29 +24,238 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "global.h"
 #include "helper.h"
 #include "linestr.h"
+#include "stats.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* Number of LINESTR_LINE structures in each block (for mapped files) */
+#define LINESTR_LINES_PER_BLOCK 256
 
 /******************************************************************************
  * TYPEDEFS
  *****************************************************************************/
 
+/* Block of LINESTR_LINE structures. For mapped files, the lines are allocated
+ * from blocks that are freed only when the file is closed */
+typedef struct LINESTR_LINES_BLOCK {
+    
+    /* The lines in this block */
+    LINESTR_LINE atLines[LINESTR_LINES_PER_BLOCK];
+    
+    /* Number of used elements in atLines */
+    int nUsed;
+    
+    /* The previous block */
+    struct LINESTR_LINES_BLOCK * ptPrev;
+} LINESTR_LINES_BLOCK, *PLINESTR_LINES_BLOCK;
+
 /* LINESTR_FILE is the struct behind the the HLINESTR_FILE.
- * It keeps the FILE* to the file itself and the number of the
- * next row to be read  */
+ * It keeps the FILE* (or the mapping) of the file itself and the number of
+ * the next row to be read  */
 struct LINESTR_FILE {
     
     /* Full source file name */
     char * pszFullFileName;
     
-    /* The source file */
+    /* The source file. NULL if the file is mapped */
     FILE * phSourceFile;
     
+    /* Whether the file is mapped to the memory. */
+    BOOL bIsMapped;
+    
+    /* Whether the "mapping" is actually a buffer of the caller (so we
+     * shouldn't unmap it). */
+    BOOL bIsBuffer;
+    
+    /* The mapping of the file, its size and the offset of the next line */
+    const char * pcMapping;
+    size_t nMappingSize;
+    size_t nMappingOffset;
+    
+    /* The last allocated block of lines (for mapped files) */
+    PLINESTR_LINES_BLOCK ptLinesBlock;
+    
     /* Number of the next row that will be read. First row gets 1 */
     int nLineNumber; 
 };
 
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static void linestr_MapFile(HLINESTR_FILE hFile);
+static GLOB_ERROR linestr_GetNextMappedLine(HLINESTR_FILE hFile,
+                                            PLINESTR_LINE ptLine);
+static GLOB_ERROR linestr_AllocateMappedLine(HLINESTR_FILE hFile,
+                                             PPLINESTR_LINE pptLine);
+static GLOB_ERROR linestr_ReadNextLine(HLINESTR_FILE hFile,
+                                       PPLINESTR_LINE pptLine);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    linestr_MapFile
+ * Purpose: try to map the file to the memory
+ * Parameters:
+ *          hFile [IN] - handle to the file
+ * Remark:  If the file can't be mapped (not a regular file, empty file, etc.),
+ *          the function doesn't change the handle, so we keep using stdio.
+ *****************************************************************************/
+static void linestr_MapFile(HLINESTR_FILE hFile) {
+    struct stat tStat;
+    void * pvMapping = NULL;
+    int nDescriptor = fileno(hFile->phSourceFile);
+    
+    /* Only non-empty regular files can be mapped */
+    if (0 != fstat(nDescriptor, &tStat)
+            || !S_ISREG(tStat.st_mode)
+            || 0 == tStat.st_size) {
+        return;
+    }
+    pvMapping = mmap(NULL, tStat.st_size, PROT_READ, MAP_PRIVATE,
+                     nDescriptor, 0);
+    if (MAP_FAILED == pvMapping) {
+        return;
+    }
+    
+    /* The mapping stays valid after closing the file */
+    fclose(hFile->phSourceFile);
+    hFile->phSourceFile = NULL;
+    hFile->bIsMapped = TRUE;
+    hFile->pcMapping = pvMapping;
+    hFile->nMappingSize = tStat.st_size;
+    hFile->nMappingOffset = 0;
+}
+
+/******************************************************************************
+ * Name:    linestr_GetNextMappedLine
+ * Purpose: find the next line in the mapping of the file
+ * Parameters:
+ *          hFile [IN] - handle to the file (must be mapped)
+ *          ptLine [IN] - the line to set its text
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_END_OF_FILE is returned if there are no more lines.
+ * Remark:  We split the text exactly as fgets with a buffer of
+ *          LINESTR_MAX_LINE_LENGTH would do. Longer lines are split to
+ *          several lines.
+ *****************************************************************************/
+static GLOB_ERROR linestr_GetNextMappedLine(HLINESTR_FILE hFile,
+                                            PLINESTR_LINE ptLine) {
+    size_t nRemaining = hFile->nMappingSize - hFile->nMappingOffset;
+    size_t nMaxLength = LINESTR_MAX_LINE_LENGTH - 1;
+    const char * pcLine = hFile->pcMapping + hFile->nMappingOffset;
+    const char * pcNewLine = NULL;
+    
+    if (0 == nRemaining) {
+        return GLOB_ERROR_END_OF_FILE;
+    }
+    
+    /* Search the '\n' in the maximum length of a line */
+    pcNewLine = memchr(pcLine, '\n', nRemaining < nMaxLength ?
+                                     nRemaining : nMaxLength);
+    if (NULL != pcNewLine) {
+        /* Skip the '\n', but don't include it in the line. */
+        ptLine->nLength = pcNewLine - pcLine;
+        hFile->nMappingOffset += ptLine->nLength + 1;
+    } else {
+        /* Last line of the file or too long line */
+        ptLine->nLength = nRemaining < nMaxLength ? nRemaining : nMaxLength;
+        hFile->nMappingOffset += ptLine->nLength;
+    }
+    ptLine->pcLine = pcLine;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    linestr_AllocateMappedLine
+ * Purpose: allocate a LINESTR_LINE structure for a mapped file
+ * Parameters:
+ *          hFile [IN] - handle to the file (must be mapped)
+ *          pptLine [OUT] - the allocated structure
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  The structure belongs to the file and is freed by LINESTR_Close.
+ *****************************************************************************/
+static GLOB_ERROR linestr_AllocateMappedLine(HLINESTR_FILE hFile,
+                                             PPLINESTR_LINE pptLine) {
+    PLINESTR_LINES_BLOCK ptBlock = hFile->ptLinesBlock;
+    
+    /* Allocate a new block if the current one is full */
+    if (NULL == ptBlock || LINESTR_LINES_PER_BLOCK == ptBlock->nUsed) {
+        STATS_CountAllocation(STATS_MODULE_LINESTR, sizeof(*ptBlock));
+        ptBlock = malloc(sizeof(*ptBlock));
+        if (NULL == ptBlock) {
+            return GLOB_ERROR_SYS_CALL_ERROR();
+        }
+        ptBlock->nUsed = 0;
+        ptBlock->ptPrev = hFile->ptLinesBlock;
+        hFile->ptLinesBlock = ptBlock;
+    }
+    *pptLine = &ptBlock->atLines[ptBlock->nUsed];
+    ptBlock->nUsed++;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    linestr_ReadNextLine
+ * Purpose: read the next line from a file that is not mapped (with stdio)
+ * Parameters:
+ *          hFile [IN] - handle to the file
+ *          pptLine [OUT] - the line retrieved by the function.
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_END_OF_FILE is returned if there are no more lines.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR linestr_ReadNextLine(HLINESTR_FILE hFile,
+                                       PPLINESTR_LINE pptLine) {
+    PLINESTR_LINE ptLine = NULL;
+    char * pszText = NULL;
+    GLOB_ERROR eRetVal = GLOB_ERROR_UNKNOWN;
+    
+    /* allocate a new LINESTR_LINE structure, followed by the text buffer */
+    STATS_CountAllocation(STATS_MODULE_LINESTR,
+                          sizeof(*ptLine) + LINESTR_MAX_LINE_LENGTH);
+    ptLine = malloc(sizeof(*ptLine) + LINESTR_MAX_LINE_LENGTH);
+    if (NULL == ptLine) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    pszText = (char *)(ptLine + 1);
+    
+    /* Read the line */
+    if (NULL == fgets(pszText, LINESTR_MAX_LINE_LENGTH, hFile->phSourceFile)) {
+        eRetVal = GLOB_ERROR_SYS_CALL_ERROR();
+        free(ptLine);
+        /* fgets returns NULL in case of either error or EOF, so check it */
+        return feof(hFile->phSourceFile) ? GLOB_ERROR_END_OF_FILE : eRetVal;
+    }
+    
+    /* Trunk the '\n', if exists from the string. */
+    ptLine->nLength = strlen(pszText);
+    if (ptLine->nLength > 0 && pszText[ptLine->nLength-1] == '\n') {
+        ptLine->nLength--;
+        pszText[ptLine->nLength] = '\0';
+    }
+    ptLine->pcLine = pszText;
+    
+    *pptLine = ptLine;
+    return GLOB_SUCCESS;
+}
+
 /******************************************************************************
  * EXTERNAL FUNCTIONS
  * ------------------
@@ -59,6 +275,7 @@ GLOB_ERROR LINESTR_Open(const char * szFileName,  PHLINESTR_FILE phFile) {
     }
     
     /* Allocate the handle */
+    STATS_CountAllocation(STATS_MODULE_LINESTR, sizeof(*hFile));
     hFile = malloc(sizeof(*hFile));
     if (NULL == hFile) {
         return GLOB_ERROR_SYS_CALL_ERROR();
@@ -72,7 +289,7 @@ GLOB_ERROR LINESTR_Open(const char * szFileName,  PHLINESTR_FILE phFile) {
         free(hFile);
         return eRetVal;
     }
-
+    
     /* Open the file */
     hFile->phSourceFile = fopen(hFile->pszFullFileName, "r");
     if (hFile->phSourceFile == NULL) {
@@ -85,6 +302,61 @@ GLOB_ERROR LINESTR_Open(const char * szFileName,  PHLINESTR_FILE phFile) {
     /* Init the line counter */
     hFile->nLineNumber = 1;
     
+    /* Map the file to the memory (if possible) */
+    hFile->bIsMapped = FALSE;
+    hFile->bIsBuffer = FALSE;
+    hFile->pcMapping = NULL;
+    hFile->nMappingSize = 0;
+    hFile->nMappingOffset = 0;
+    hFile->ptLinesBlock = NULL;
+    linestr_MapFile(hFile);
+    
+    /* Set out parameter upon success */
+    *phFile = hFile;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * LINESTR_OpenBuffer
+ *****************************************************************************/
+GLOB_ERROR LINESTR_OpenBuffer(const char * szName,
+                              const char * pcBuffer,
+                              size_t nLength,
+                              PHLINESTR_FILE phFile) {
+    HLINESTR_FILE hFile = NULL;
+    GLOB_ERROR eRetVal = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == szName || (NULL == pcBuffer && 0 != nLength)
+            || NULL == phFile) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Allocate the handle */
+    STATS_CountAllocation(STATS_MODULE_LINESTR, sizeof(*hFile));
+    hFile = malloc(sizeof(*hFile));
+    if (NULL == hFile) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Keep a copy of the name (for the messages) */
+    hFile->pszFullFileName = HELPER_ConcatStrings(szName, "");
+    if (NULL == hFile->pszFullFileName) {
+        eRetVal = GLOB_ERROR_SYS_CALL_ERROR();
+        free(hFile);
+        return eRetVal;
+    }
+    
+    /* The buffer is read as a mapping */
+    hFile->phSourceFile = NULL;
+    hFile->nLineNumber = 1;
+    hFile->bIsMapped = TRUE;
+    hFile->bIsBuffer = TRUE;
+    hFile->pcMapping = pcBuffer;
+    hFile->nMappingSize = nLength;
+    hFile->nMappingOffset = 0;
+    hFile->ptLinesBlock = NULL;
+    
     /* Set out parameter upon success */
     *phFile = hFile;
     return GLOB_SUCCESS;
@@ -99,6 +371,27 @@ const char * LINESTR_GetFullFileName(HLINESTR_FILE hFile) {
     }
     return hFile->pszFullFileName;
 }
+
+/******************************************************************************
+ * LINESTR_GetSize
+ *****************************************************************************/
+size_t LINESTR_GetSize(HLINESTR_FILE hFile) {
+    if (NULL == hFile || !hFile->bIsMapped) {
+        return 0;
+    }
+    return hFile->nMappingSize;
+}
+
+/******************************************************************************
+ * LINESTR_GetContent
+ *****************************************************************************/
+const char * LINESTR_GetContent(HLINESTR_FILE hFile) {
+    if (NULL == hFile || !hFile->bIsMapped) {
+        return NULL;
+    }
+    return hFile->pcMapping;
+}
+
 /******************************************************************************
  * LINESTR_GetNextLine
  *****************************************************************************/
@@ -110,11 +403,22 @@ GLOB_ERROR LINESTR_GetNextLine(HLINESTR_FILE hFile, PLINESTR_LINE * pptLine) {
     if (NULL == hFile || NULL == pptLine) {
         return GLOB_ERROR_INVALID_PARAMETERS;
     }
-
-    /* allocate a new LINESTR_LINE structure */
-    ptLine = malloc(sizeof(*ptLine));
-    if (NULL == ptLine) {
-        return GLOB_ERROR_SYS_CALL_ERROR();
+    
+    if (hFile->bIsMapped) {
+        /* Check for end of file before allocating the structure */
+        if (hFile->nMappingOffset == hFile->nMappingSize) {
+            return GLOB_ERROR_END_OF_FILE;
+        }
+        eRetVal = linestr_AllocateMappedLine(hFile, &ptLine);
+        if (eRetVal) {
+            return eRetVal;
+        }
+        eRetVal = linestr_GetNextMappedLine(hFile, ptLine);
+    } else {
+        eRetVal = linestr_ReadNextLine(hFile, &ptLine);
+    }
+    if (eRetVal) {
+        return eRetVal;
     }
     
     /* Newly created. have just 1 reference. */
@@ -126,25 +430,9 @@ GLOB_ERROR LINESTR_GetNextLine(HLINESTR_FILE hFile, PLINESTR_LINE * pptLine) {
     /* set the reference to the file. */
     ptLine->hFile = hFile;
     
-    /* Read the line */
-    if (NULL == fgets(ptLine->szLine, sizeof(ptLine->szLine),
-        hFile->phSourceFile)) {
-        eRetVal = GLOB_ERROR_SYS_CALL_ERROR();
-        free(ptLine);
-        /* fgets returns NULL in case of either error or EOF, so check it */
-        return feof(hFile->phSourceFile) ? GLOB_ERROR_END_OF_FILE : eRetVal;
-    }
-
-    TERMINATE_STRING(ptLine->szLine);
-    
-    /* Trunk the '\n', if exists from the string. */
-    if (ptLine->szLine[strlen(ptLine->szLine)-1] == '\n') {
-        ptLine->szLine[strlen(ptLine->szLine)-1] = '\0';
-    }
-    
     /* Increment the rows counter */
     hFile->nLineNumber++;
-
+    
     /* Set out parameters */
     *pptLine = ptLine;
     return GLOB_SUCCESS;
@@ -159,13 +447,22 @@ void LINESTR_LineAddRef(PLINESTR_LINE ptLine) {
     }
 }
 
+/******************************************************************************
+ * Name:    LINESTR_CopyLine
+ *****************************************************************************/
+void LINESTR_CopyLine(PLINESTR_LINE ptLine, char * pszBuffer) {
+    memcpy(pszBuffer, ptLine->pcLine, ptLine->nLength);
+    pszBuffer[ptLine->nLength] = '\0';
+}
+
 /******************************************************************************
  * LINESTR_FreeLine
  *****************************************************************************/
 void LINESTR_FreeLine(PLINESTR_LINE ptLine) {
     if (NULL != ptLine) {
         ptLine->nReferences--;
-        if (0 == ptLine->nReferences) {
+        /* Lines of mapped files are freed with the file itself */
+        if (0 == ptLine->nReferences && !ptLine->hFile->bIsMapped) {
             free(ptLine);
         }
     }
@@ -175,8 +472,23 @@ void LINESTR_FreeLine(PLINESTR_LINE ptLine) {
  * LINESTR_Close
  *****************************************************************************/
 void LINESTR_Close(HLINESTR_FILE hFile) {
+    PLINESTR_LINES_BLOCK ptBlockToFree = NULL;
+    
     if (NULL != hFile) {
-        fclose(hFile->phSourceFile);
+        if (hFile->bIsBuffer) {
+            /* The buffer belongs to the caller */
+        } else if (hFile->bIsMapped) {
+            munmap((void *)hFile->pcMapping, hFile->nMappingSize);
+        } else {
+            fclose(hFile->phSourceFile);
+        }
+        
+        /* Free the blocks of the lines */
+        while (NULL != hFile->ptLinesBlock) {
+            ptBlockToFree = hFile->ptLinesBlock;
+            hFile->ptLinesBlock = ptBlockToFree->ptPrev;
+            free(ptBlockToFree);
+        }
         free(hFile->pszFullFileName);
         free(hFile);
     }
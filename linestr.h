@@ -31,9 +31,14 @@ typedef struct LINESTR_FILE LINESTR_FILE, *HLINESTR_FILE, **PHLINESTR_FILE;
 /* The LINESTR_LINE struct includes a data of a row read from the source file.
  * After finishing using the LINESTR_LINE, use LINESTR_FreeLine. */
 typedef struct LINESTR_LINE {
-    /* The original line from the source file.
+    /* The original line from the source file. This is a view into memory
+     * owned by the module, so it is NOT null-terminated (see nLength).
+     * Use LINESTR_CopyLine to get a null-terminated copy.
      * It doesn't contain the '\n' character. */
-    char szLine[LINESTR_MAX_LINE_LENGTH];
+    const char * pcLine;
+    
+    /* The length (in chars) of the line. Less than LINESTR_MAX_LINE_LENGTH */
+    int nLength;
     
     /* Row number in the source file.
      * First row gets 1. */
@@ -54,6 +59,8 @@ typedef struct LINESTR_LINE {
  * Name:    LINESTR_Open
  * Purpose: The function opens a source file. The caller gets a handle to the
  *          opened file.
+ *          Regular files are mapped to the memory, so the lines are views
+ *          into the mapping. Otherwise the file is read with stdio.
  * Parameters:
  *          szFileName [IN] - the path to the file to open (w/o the extension)
  *          phFile [OUT] - the handle to the opened file
@@ -65,6 +72,29 @@ typedef struct LINESTR_LINE {
  *****************************************************************************/
 GLOB_ERROR LINESTR_Open(const char * szFilenName, PHLINESTR_FILE phFile);
 
+/******************************************************************************
+ * Name:    LINESTR_OpenBuffer
+ * Purpose: The function opens source code from a memory buffer. The caller
+ *          gets a handle that is used like a handle of an opened file.
+ * Parameters:
+ *          szName [IN] - the name of the source (used in the messages)
+ *          pcBuffer [IN] - the source code (doesn't have to be
+ *                          null-terminated)
+ *          nLength [IN] - the length (in chars) of the source code
+ *          phFile [OUT] - the handle to the opened source
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, a handle to the opened source is returned in phFile
+ *          and the caller must close it with LINESTR_Close.
+ *          If the function fails, an error code is returned.
+ * Remark:  The lines are views into the buffer, so the buffer must be valid
+ *          until the call to LINESTR_Close.
+ *****************************************************************************/
+GLOB_ERROR LINESTR_OpenBuffer(const char * szName,
+                              const char * pcBuffer,
+                              size_t nLength,
+                              PHLINESTR_FILE phFile);
+
 /******************************************************************************
  * Name:    LINESTR_GetFullFileName
  * Purpose: Get the full file name of a file opened with LINESTR_Open
@@ -76,6 +106,30 @@ GLOB_ERROR LINESTR_Open(const char * szFilenName, PHLINESTR_FILE phFile);
  *****************************************************************************/
 const char * LINESTR_GetFullFileName(HLINESTR_FILE hFile);
 
+/******************************************************************************
+ * Name:    LINESTR_GetSize
+ * Purpose: Get the size of a source that is mapped to the memory (or opened
+ *          with LINESTR_OpenBuffer)
+ * Parameters:
+ *          hFile [IN] - the handle to the file
+ * Return Value:
+ *          The size (in chars) of the source. 0 if the file is read with stdio
+ *****************************************************************************/
+size_t LINESTR_GetSize(HLINESTR_FILE hFile);
+
+/******************************************************************************
+ * Name:    LINESTR_GetContent
+ * Purpose: Get the content of a source that is mapped to the memory (or opened
+ *          with LINESTR_OpenBuffer)
+ * Parameters:
+ *          hFile [IN] - the handle to the file
+ * Return Value:
+ *          The content (LINESTR_GetSize chars, not null-terminated). It is
+ *          valid until the call to LINESTR_Close.
+ *          NULL if the file is read with stdio
+ *****************************************************************************/
+const char * LINESTR_GetContent(HLINESTR_FILE hFile);
+
 /******************************************************************************
  * Name:    LINESTR_GetNextLine
  * Purpose: The function reads the next line from the file
@@ -92,12 +146,22 @@ GLOB_ERROR LINESTR_GetNextLine(HLINESTR_FILE hFile, PPLINESTR_LINE pptLine);
 
 /******************************************************************************
  * Name:    LINESTR_LineAddRef
- * Purpose: TODO
+ * Purpose: Add a reference to a line. Each reference should be released
+ *          with LINESTR_FreeLine.
  * Parameters:
- *          ptLine [IN] - TODO
+ *          ptLine [IN] - the line to add reference to
  *****************************************************************************/
 void LINESTR_LineAddRef(PLINESTR_LINE ptLine);
 
+/******************************************************************************
+ * Name:    LINESTR_CopyLine
+ * Purpose: Copy the text of a line into a null-terminated string
+ * Parameters:
+ *          ptLine [IN] - the line to copy
+ *          pszBuffer [OUT] - buffer of at least LINESTR_MAX_LINE_LENGTH chars
+ *****************************************************************************/
+void LINESTR_CopyLine(PLINESTR_LINE ptLine, char * pszBuffer);
+
 /******************************************************************************
  * Name:    LINESTR_FreeLine
  * Purpose: The function frees a LINESTR_LINE struct previously returned
@@ -112,6 +176,7 @@ void LINESTR_FreeLine(PLINESTR_LINE ptLine);
  * Purpose: The function closes a file previously opened by LINESTR_Open
  * Parameters:
  *          hFile [IN] - handle to the file to close
+ * Remark:  All the lines of the file must be freed before closing it.
  *****************************************************************************/
 void LINESTR_Close(HLINESTR_FILE hFile);
 
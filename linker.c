@@ -0,0 +1,495 @@
+/******************************************************************************
+ * File:    linker.c
+ * Author:  Doron Shvartztuch
+ * The LINKER module links the compiled files (modules) into one program.
+ *
+ * Implementation:
+ * The code and the data of the modules are appended to two arrays when they
+ * are added, and each module keeps the positions of its sections in them.
+ * The names of the entries & externals are kept in a table of names (see
+ * INTERN), which is a hash index, so each name is hashed once and the
+ * symbols are found by their name ids: the definitions are kept in an array
+ * indexed by the name id, and each use of an extern keeps the name id and
+ * the position of its word.
+ * The addresses of a module can be moved only when the length of all the
+ * code is known, so the relocatable words and the uses of the externals are
+ * patched by LINKER_Link, in one pass over the code of each module and one
+ * pass over the uses.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+#include "helper.h"
+#include "intern.h"
+#include "machine.h"
+#include "asm.h"
+#include "stats.h"
+#include "linker.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The default size (in elements) of the arrays */
+#define LINKER_DEFAULT_ARRAY_SIZE 16
+
+/* The expand factor of the arrays */
+#define LINKER_EXPAND_FACTOR 2
+
+/* The module of a name without a definition */
+#define LINKER_UNDEFINED (-1)
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* A module (compiled file) of the program */
+typedef struct LINKER_MODULE {
+    /* The position (in words) of its code in the code of the program, and
+     * the length of its code */
+    int nCodeStart;
+    int nCodeLength;
+    
+    /* The position (in words) of its data in the data of the program, and
+     * the length of its data */
+    int nDataStart;
+    int nDataLength;
+} LINKER_MODULE, *PLINKER_MODULE;
+
+/* The definition of a name (an entry) */
+typedef struct LINKER_DEFINITION {
+    /* The module of the entry, or LINKER_UNDEFINED */
+    int nModule;
+    
+    /* The address of the entry in its module */
+    int nAddress;
+} LINKER_DEFINITION, *PLINKER_DEFINITION;
+
+/* A use of an extern */
+typedef struct LINKER_USE {
+    /* The name id of the extern */
+    int nNameId;
+    
+    /* The module of the use, and the position of its word in the code of
+     * the program */
+    int nModule;
+    int nCodeIndex;
+} LINKER_USE, *PLINKER_USE;
+
+/* LINKER is the struct behind the HLINKER */
+struct LINKER {
+    /* The names of the entries & externals */
+    HINTERN_TABLE hNames;
+    
+    /* The modules, by the order they were added */
+    PLINKER_MODULE patModules;
+    int nModules;
+    int nAllocatedModules;
+    
+    /* The code & data of all the modules */
+    uint16_t * pwCode;
+    int nCodeLength;
+    int nAllocatedCode;
+    uint16_t * pwData;
+    int nDataLength;
+    int nAllocatedData;
+    
+    /* The definition of each name id */
+    PLINKER_DEFINITION patDefinitions;
+    int nAllocatedDefinitions;
+    
+    /* The uses of the externals */
+    PLINKER_USE patUses;
+    int nUses;
+    int nAllocatedUses;
+};
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static GLOB_ERROR linker_Reserve(void ** ppvArray,
+                                 int * pnAllocated,
+                                 int nRequired,
+                                 size_t nElementSize);
+static GLOB_ERROR linker_GetNameId(HLINKER hLinker,
+                                   const PACKED_SYMBOL * ptSymbol,
+                                   int * pnNameId);
+static int linker_Relocate(HLINKER hLinker,
+                           const LINKER_MODULE * ptModule,
+                           int nAddress);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    linker_Reserve
+ * Purpose: Make sure an array has space for a number of elements
+ * Parameters:
+ *          ppvArray [IN OUT] - the array. It is reallocated if it is too
+ *                              small.
+ *          pnAllocated [IN OUT] - size (in elements) of the array
+ *          nRequired [IN] - the required size (in elements)
+ *          nElementSize [IN] - size (in bytes) of an element
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR linker_Reserve(void ** ppvArray,
+                                 int * pnAllocated,
+                                 int nRequired,
+                                 size_t nElementSize) {
+    void * pvNewArray = NULL;
+    int nNewAllocated = 0;
+    
+    if (nRequired <= *pnAllocated) {
+        return GLOB_SUCCESS;
+    }
+    
+    /* Calculate the new size */
+    nNewAllocated = MAX(LINKER_DEFAULT_ARRAY_SIZE,
+                        MAX(LINKER_EXPAND_FACTOR * *pnAllocated, nRequired));
+    
+    /* try to reallocate the memory */
+    STATS_CountAllocation(STATS_MODULE_LINKER, nNewAllocated * nElementSize);
+    pvNewArray = realloc(*ppvArray, nNewAllocated * nElementSize);
+    if (NULL == pvNewArray) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    *ppvArray = pvNewArray;
+    *pnAllocated = nNewAllocated;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    linker_GetNameId
+ * Purpose: Get the name id of a symbol, and make sure it has a definition
+ *          record
+ * Parameters:
+ *          hLinker [IN] - handle to the linker
+ *          ptSymbol [IN] - the symbol
+ *          pnNameId [OUT] - the name id
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR linker_GetNameId(HLINKER hLinker,
+                                   const PACKED_SYMBOL * ptSymbol,
+                                   int * pnNameId) {
+    int nNameId = 0;
+    int nAllocated = hLinker->nAllocatedDefinitions;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    eRetValue = INTERN_Add(hLinker->hNames, ptSymbol->pcName,
+                           ptSymbol->nNameLength, &nNameId);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* The new name ids don't have definitions */
+    eRetValue = linker_Reserve((void **)&hLinker->patDefinitions,
+                               &hLinker->nAllocatedDefinitions, nNameId + 1,
+                               sizeof(*hLinker->patDefinitions));
+    if (eRetValue) {
+        return eRetValue;
+    }
+    for (int nId = nAllocated; nId < hLinker->nAllocatedDefinitions; nId++) {
+        hLinker->patDefinitions[nId].nModule = LINKER_UNDEFINED;
+    }
+    
+    *pnNameId = nNameId;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    linker_Relocate
+ * Purpose: Get the address in the program of an address in a module
+ * Parameters:
+ *          hLinker [IN] - handle to the linker (after all the modules were
+ *                         added)
+ *          ptModule [IN] - the module
+ *          nAddress [IN] - the address in the module (in its code or data)
+ * Return Value:
+ *          The address in the program
+ *****************************************************************************/
+static int linker_Relocate(HLINKER hLinker,
+                           const LINKER_MODULE * ptModule,
+                           int nAddress) {
+    if (nAddress < CODE_STARTUP_ADDRESS + ptModule->nCodeLength) {
+        return nAddress + ptModule->nCodeStart;
+    }
+    return nAddress - ptModule->nCodeLength + hLinker->nCodeLength
+           + ptModule->nDataStart;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    LINKER_Create
+ *****************************************************************************/
+GLOB_ERROR LINKER_Create(PHLINKER phLinker) {
+    HLINKER hLinker = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == phLinker) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    STATS_CountAllocation(STATS_MODULE_LINKER, sizeof(*hLinker));
+    hLinker = calloc(1, sizeof(*hLinker));
+    if (NULL == hLinker) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    eRetValue = INTERN_Create(&hLinker->hNames);
+    if (eRetValue) {
+        free(hLinker);
+        return eRetValue;
+    }
+    
+    /* Set out parameter upon success */
+    *phLinker = hLinker;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    LINKER_AddModule
+ *****************************************************************************/
+GLOB_ERROR LINKER_AddModule(HLINKER hLinker,
+                            const uint16_t * pwWords,
+                            int nCodeLength,
+                            int nDataLength,
+                            const PACKED_SYMBOL * patEntries,
+                            int nEntries,
+                            const PACKED_SYMBOL * patExternals,
+                            int nExternals,
+                            PLINKER_FAILURE ptFailure) {
+    PLINKER_MODULE ptModule = NULL;
+    int nModuleEnd = CODE_STARTUP_ADDRESS + nCodeLength + nDataLength;
+    int nAddress = 0;
+    int nNameId = 0;
+    uint16_t wWord = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == hLinker || (NULL == pwWords && 0 != nCodeLength + nDataLength)
+        || (NULL == patEntries && 0 != nEntries)
+        || (NULL == patExternals && 0 != nExternals) || NULL == ptFailure
+        || nCodeLength < 0 || nDataLength < 0 || nEntries < 0
+        || nExternals < 0) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    ptFailure->nModule = hLinker->nModules;
+    ptFailure->pszSymbol = NULL;
+    
+    /* The program must fit in the memory (so its addresses fit in the
+     * operand words) */
+    if ((long long)hLinker->nCodeLength + hLinker->nDataLength + nCodeLength
+        + nDataLength > MACHINE_MEMORY_SIZE - CODE_STARTUP_ADDRESS) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* The relocatable words must point into the module */
+    for (int nIndex = 0; nIndex < nCodeLength; nIndex++) {
+        nAddress = ASM_GET_ADDRESS(pwWords[nIndex]);
+        if (ASM_ARE_RELOCATABLE == ASM_GET_ARE(pwWords[nIndex])
+            && (nAddress < CODE_STARTUP_ADDRESS || nAddress >= nModuleEnd)) {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+    }
+    
+    /* Add the module and its sections */
+    eRetValue = linker_Reserve((void **)&hLinker->patModules,
+                               &hLinker->nAllocatedModules,
+                               hLinker->nModules + 1,
+                               sizeof(*hLinker->patModules));
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = linker_Reserve((void **)&hLinker->pwCode,
+                                   &hLinker->nAllocatedCode,
+                                   hLinker->nCodeLength + nCodeLength,
+                                   sizeof(*hLinker->pwCode));
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = linker_Reserve((void **)&hLinker->pwData,
+                                   &hLinker->nAllocatedData,
+                                   hLinker->nDataLength + nDataLength,
+                                   sizeof(*hLinker->pwData));
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = linker_Reserve((void **)&hLinker->patUses,
+                                   &hLinker->nAllocatedUses,
+                                   hLinker->nUses + nExternals,
+                                   sizeof(*hLinker->patUses));
+    }
+    if (eRetValue) {
+        return eRetValue;
+    }
+    ptModule = &hLinker->patModules[hLinker->nModules];
+    ptModule->nCodeStart = hLinker->nCodeLength;
+    ptModule->nCodeLength = nCodeLength;
+    ptModule->nDataStart = hLinker->nDataLength;
+    ptModule->nDataLength = nDataLength;
+    if (0 != nCodeLength) {
+        memcpy(hLinker->pwCode + hLinker->nCodeLength, pwWords,
+               nCodeLength * sizeof(*pwWords));
+    }
+    if (0 != nDataLength) {
+        memcpy(hLinker->pwData + hLinker->nDataLength, pwWords + nCodeLength,
+               nDataLength * sizeof(*pwWords));
+    }
+    
+    /* Define the entries */
+    for (int nIndex = 0; nIndex < nEntries; nIndex++) {
+        eRetValue = linker_GetNameId(hLinker, &patEntries[nIndex], &nNameId);
+        if (eRetValue) {
+            return eRetValue;
+        }
+        ptFailure->pszSymbol = INTERN_GetName(hLinker->hNames, nNameId);
+        nAddress = patEntries[nIndex].nAddress;
+        if (nAddress < CODE_STARTUP_ADDRESS || nAddress >= nModuleEnd) {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        if (LINKER_UNDEFINED != hLinker->patDefinitions[nNameId].nModule) {
+            return GLOB_ERROR_ALREADY_EXIST;
+        }
+        hLinker->patDefinitions[nNameId].nModule = hLinker->nModules;
+        hLinker->patDefinitions[nNameId].nAddress = nAddress;
+    }
+    
+    /* Keep the uses of the externals. Each one must be an external word in
+     * the code. */
+    for (int nIndex = 0; nIndex < nExternals; nIndex++) {
+        eRetValue = linker_GetNameId(hLinker, &patExternals[nIndex],
+                                     &nNameId);
+        if (eRetValue) {
+            return eRetValue;
+        }
+        ptFailure->pszSymbol = INTERN_GetName(hLinker->hNames, nNameId);
+        nAddress = patExternals[nIndex].nAddress;
+        if (nAddress < CODE_STARTUP_ADDRESS
+            || nAddress >= CODE_STARTUP_ADDRESS + nCodeLength) {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        wWord = pwWords[nAddress - CODE_STARTUP_ADDRESS];
+        if (ASM_ARE_EXTERNAL != ASM_GET_ARE(wWord)) {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        hLinker->patUses[hLinker->nUses].nNameId = nNameId;
+        hLinker->patUses[hLinker->nUses].nModule = hLinker->nModules;
+        hLinker->patUses[hLinker->nUses].nCodeIndex =
+                hLinker->nCodeLength + nAddress - CODE_STARTUP_ADDRESS;
+        hLinker->nUses++;
+    }
+    
+    hLinker->nModules++;
+    hLinker->nCodeLength += nCodeLength;
+    hLinker->nDataLength += nDataLength;
+    ptFailure->pszSymbol = NULL;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    LINKER_Link
+ *****************************************************************************/
+GLOB_ERROR LINKER_Link(HLINKER hLinker,
+                       uint16_t ** ppwWords,
+                       int * pnCodeLength,
+                       int * pnDataLength,
+                       PLINKER_FAILURE ptFailure) {
+    uint16_t * pwWords = NULL;
+    const LINKER_MODULE * ptModule = NULL;
+    const LINKER_USE * ptUse = NULL;
+    const LINKER_DEFINITION * ptDefinition = NULL;
+    int nAddress = 0;
+    
+    /* Check parameters */
+    if (NULL == hLinker || NULL == ppwWords || NULL == pnCodeLength
+        || NULL == pnDataLength || NULL == ptFailure) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    ptFailure->nModule = 0;
+    ptFailure->pszSymbol = NULL;
+    
+    STATS_CountAllocation(STATS_MODULE_LINKER,
+                          ((size_t)hLinker->nCodeLength + hLinker->nDataLength
+                           + 1) * sizeof(*pwWords));
+    pwWords = malloc(((size_t)hLinker->nCodeLength + hLinker->nDataLength + 1)
+                     * sizeof(*pwWords));
+    if (NULL == pwWords) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    if (0 != hLinker->nCodeLength) {
+        memcpy(pwWords, hLinker->pwCode,
+               hLinker->nCodeLength * sizeof(*pwWords));
+    }
+    if (0 != hLinker->nDataLength) {
+        memcpy(pwWords + hLinker->nCodeLength, hLinker->pwData,
+               hLinker->nDataLength * sizeof(*pwWords));
+    }
+    
+    /* Move the addresses of each module with its sections */
+    for (int nModule = 0; nModule < hLinker->nModules; nModule++) {
+        ptModule = &hLinker->patModules[nModule];
+        for (int nIndex = ptModule->nCodeStart;
+             nIndex < ptModule->nCodeStart + ptModule->nCodeLength;
+             nIndex++) {
+            if (ASM_ARE_RELOCATABLE == ASM_GET_ARE(pwWords[nIndex])) {
+                nAddress = linker_Relocate(
+                        hLinker, ptModule, ASM_GET_ADDRESS(pwWords[nIndex]));
+                pwWords[nIndex] = (uint16_t)ASM_COMBINE_DIRECT_WORD(nAddress);
+            }
+        }
+    }
+    
+    /* Patch the uses of the externals with the addresses of their entries */
+    for (int nIndex = 0; nIndex < hLinker->nUses; nIndex++) {
+        ptUse = &hLinker->patUses[nIndex];
+        ptDefinition = &hLinker->patDefinitions[ptUse->nNameId];
+        if (LINKER_UNDEFINED == ptDefinition->nModule) {
+            ptFailure->nModule = ptUse->nModule;
+            ptFailure->pszSymbol = INTERN_GetName(hLinker->hNames,
+                                                  ptUse->nNameId);
+            free(pwWords);
+            return GLOB_ERROR_NOT_FOUND;
+        }
+        nAddress = linker_Relocate(hLinker,
+                                   &hLinker->patModules[ptDefinition->nModule],
+                                   ptDefinition->nAddress);
+        pwWords[ptUse->nCodeIndex] =
+                (uint16_t)ASM_COMBINE_DIRECT_WORD(nAddress);
+    }
+    
+    /* Set out parameters upon success */
+    *ppwWords = pwWords;
+    *pnCodeLength = hLinker->nCodeLength;
+    *pnDataLength = hLinker->nDataLength;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    LINKER_Free
+ *****************************************************************************/
+void LINKER_Free(HLINKER hLinker) {
+    if (NULL == hLinker) {
+        return;
+    }
+    INTERN_Free(hLinker->hNames);
+    free(hLinker->patModules);
+    free(hLinker->pwCode);
+    free(hLinker->pwData);
+    free(hLinker->patDefinitions);
+    free(hLinker->patUses);
+    free(hLinker);
+}
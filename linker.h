@@ -0,0 +1,125 @@
+/******************************************************************************
+ * File:    linker.h
+ * Author:  Doron Shvartztuch
+ * The LINKER module links the compiled files (modules) into one program that
+ * can be run (see MACHINE).
+ *
+ * The program:
+ * The code sections of the modules are placed one after the other, from
+ * CODE_STARTUP_ADDRESS, and then their data sections (so the program has one
+ * code section and one data section, like a compiled file). The addresses in
+ * the code (the relocatable words) are moved with their sections, and each
+ * use of an extern gets the address of the entry with the same name in one
+ * of the modules.
+ *****************************************************************************/
+
+#ifndef LINKER_H
+#define LINKER_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "global.h"
+#include "packed.h"
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* Handle to a linker */
+typedef struct LINKER LINKER, *HLINKER, **PHLINKER;
+
+/* The module and the symbol that failed the linking */
+typedef struct LINKER_FAILURE {
+    /* The index of the module (by the order they were added) */
+    int nModule;
+    
+    /* The name of the symbol (NULL if the failure is not of a symbol) */
+    const char * pszSymbol;
+} LINKER_FAILURE, *PLINKER_FAILURE;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    LINKER_Create
+ * Purpose: Create a linker without modules
+ * Parameters:
+ *          phLinker [OUT] - the handle to the created linker
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR LINKER_Create(PHLINKER phLinker);
+
+/******************************************************************************
+ * Name:    LINKER_AddModule
+ * Purpose: Add a compiled file to the program
+ * Parameters:
+ *          hLinker [IN] - handle to the linker
+ *          pwWords [IN] - the words of the code section and then the data
+ *                         section (see OUTPUT_ParseObject)
+ *          nCodeLength [IN] - size (in words) of the code section
+ *          nDataLength [IN] - size (in words) of the data section
+ *          patEntries [IN] - the records of the entries file
+ *          nEntries [IN] - number of entries
+ *          patExternals [IN] - the records of the externals file
+ *          nExternals [IN] - number of records of the externals file
+ *          ptFailure [OUT] - the module and the symbol, if the function
+ *                            fails on a symbol
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_ALREADY_EXIST - an entry is already defined by another
+ *                                     module
+ *          GLOB_ERROR_INVALID_PARAMETERS - the records don't match the
+ *                                          sections, or the program doesn't
+ *                                          fit in the memory
+ *          If the function fails, an error code is returned.
+ * Remark:  The linker copies what it needs, so the caller can free the
+ *          parameters after the call. If the function fails, the linker
+ *          can only be freed.
+ *****************************************************************************/
+GLOB_ERROR LINKER_AddModule(HLINKER hLinker,
+                            const uint16_t * pwWords,
+                            int nCodeLength,
+                            int nDataLength,
+                            const PACKED_SYMBOL * patEntries,
+                            int nEntries,
+                            const PACKED_SYMBOL * patExternals,
+                            int nExternals,
+                            PLINKER_FAILURE ptFailure);
+
+/******************************************************************************
+ * Name:    LINKER_Link
+ * Purpose: Link the modules into one program
+ * Parameters:
+ *          hLinker [IN] - handle to the linker
+ *          ppwWords [OUT] - the words of the code section and then the data
+ *                           section of the program
+ *          pnCodeLength [OUT] - size (in words) of the code section
+ *          pnDataLength [OUT] - size (in words) of the data section
+ *          ptFailure [OUT] - the module and the symbol, if the function
+ *                            fails on a symbol
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the words.
+ *          GLOB_ERROR_NOT_FOUND - an extern is not an entry of any module
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR LINKER_Link(HLINKER hLinker,
+                       uint16_t ** ppwWords,
+                       int * pnCodeLength,
+                       int * pnDataLength,
+                       PLINKER_FAILURE ptFailure);
+
+/******************************************************************************
+ * Name:    LINKER_Free
+ * Purpose: Free the linker
+ * Parameters:
+ *          hLinker [IN] - handle to the linker
+ *****************************************************************************/
+void LINKER_Free(HLINKER hLinker);
+
+#endif /* LINKER_H */
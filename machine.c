@@ -0,0 +1,754 @@
+/******************************************************************************
+ * File:    machine.c
+ * Author:  Doron Shvartztuch
+ * The MACHINE module emulates the target machine of the assembler, so the
+ * compiled programs can be run.
+ *
+ * Implementation:
+ * Each address of the memory has a slot with its predecoded instruction: the
+ * function that executes the opcode, pointers to the operands (into the
+ * memory, into the registers, or into constants of the slot for immediate
+ * operands and addresses) and a pointer to the slot of the next instruction.
+ * The run loop only calls the function of the current slot, which executes
+ * the instruction and returns the next slot (the dispatch is threaded through
+ * the slots, there is no central switch).
+ * The slots are decoded on their first execution: their function is
+ * machine_Decode, which decodes the instruction and then executes it. A write
+ * to the memory resets the slots of the instructions that may contain the
+ * written word, so the program can modify its code.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+#include "stats.h"
+#include "asm.h"
+#include "machine.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The values of a word */
+#define MACHINE_WORD_MASK 0x3FFF
+#define MACHINE_TO_SIGNED(wWord) (((int)(wWord) ^ 0x2000) - 0x2000)
+
+/* The registers, and the registers that get the parameters of a jump */
+#define MACHINE_REGISTERS 8
+#define MACHINE_PARAM1_REGISTER 6
+#define MACHINE_PARAM2_REGISTER 7
+
+/* The depth of the stack of the return addresses */
+#define MACHINE_STACK_SIZE 1024
+
+/* The maximum length (in words) of an instruction: "jmp L(p1,p2)" */
+#define MACHINE_MAX_INSTRUCTION_LENGTH 4
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* A predecoded instruction (the slot of an address) */
+typedef struct MACHINE_INSTRUCTION MACHINE_INSTRUCTION, *PMACHINE_INSTRUCTION;
+
+/******************************************************************************
+ * Name:    MACHINE_HANDLER
+ * Purpose: Execute a predecoded instruction
+ * Parameters:
+ *          hMachine [IN] - handle to the machine
+ *          ptInstruction [IN] - the instruction
+ * Return Value:
+ *          The next instruction, or NULL if the program stopped or faulted
+ *****************************************************************************/
+typedef PMACHINE_INSTRUCTION (*MACHINE_HANDLER)(
+                                    HMACHINE hMachine,
+                                    PMACHINE_INSTRUCTION ptInstruction);
+
+struct MACHINE_INSTRUCTION {
+    /* The function that executes the instruction */
+    MACHINE_HANDLER pfnHandler;
+    
+    /* The operands. For the jumps, the destination is the target address.
+     * The parameters are NULL, unless it is a jump with parameters. */
+    const uint16_t * pwSource;
+    uint16_t * pwDest;
+    const uint16_t * apwParams[2];
+    
+    /* The address of the destination if it is in the memory, otherwise -1 */
+    int nDestAddress;
+    
+    /* The next instruction */
+    PMACHINE_INSTRUCTION ptNext;
+    
+    /* The immediate values and the addresses the operands point to */
+    uint16_t awConstants[MACHINE_MAX_INSTRUCTION_LENGTH];
+};
+
+struct MACHINE {
+    /* The memory, the registers and the flag */
+    uint16_t awMemory[MACHINE_MEMORY_SIZE];
+    uint16_t awRegisters[MACHINE_REGISTERS];
+    BOOL bZero;
+    
+    /* The stack of the return addresses */
+    PMACHINE_INSTRUCTION aptStack[MACHINE_STACK_SIZE];
+    int nStackDepth;
+    
+    /* The next instruction to run (NULL after the program stopped or
+     * faulted) */
+    PMACHINE_INSTRUCTION ptCurrent;
+    
+    /* The end of the program */
+    BOOL bStopped;
+    const char * pszFault;
+    int nFaultAddress;
+    
+    /* The slot of each address, and one more slot after the end of the
+     * memory */
+    MACHINE_INSTRUCTION atInstructions[MACHINE_MEMORY_SIZE + 1];
+};
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Fault(HMACHINE hMachine,
+                                          PMACHINE_INSTRUCTION ptInstruction,
+                                          const char * pszFault);
+static void machine_Invalidate(HMACHINE hMachine, int nAddress);
+static PMACHINE_INSTRUCTION machine_Store(HMACHINE hMachine,
+                                          PMACHINE_INSTRUCTION ptInstruction,
+                                          int nValue);
+static PMACHINE_INSTRUCTION machine_Jump(HMACHINE hMachine,
+                                         PMACHINE_INSTRUCTION ptInstruction);
+static const char * machine_DecodeOperand(HMACHINE hMachine,
+                                          PMACHINE_INSTRUCTION ptInstruction,
+                                          int nMethod,
+                                          BOOL bIsSource,
+                                          BOOL bIsAddress,
+                                          int nPosition,
+                                          int nConstant,
+                                          uint16_t ** ppwOperand);
+static PMACHINE_INSTRUCTION machine_Decode(HMACHINE hMachine,
+                                           PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_OutOfMemory(
+                                    HMACHINE hMachine,
+                                    PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Mov(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Cmp(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Add(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Sub(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Not(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Clr(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Inc(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Dec(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Bne(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Red(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Prn(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Jsr(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Rts(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction);
+static PMACHINE_INSTRUCTION machine_Stop(HMACHINE hMachine,
+                                         PMACHINE_INSTRUCTION ptInstruction);
+
+/******************************************************************************
+ * CONSTANTS
+ *****************************************************************************/
+
+/* The function that executes each opcode, by its code. lea is executed as
+ * mov, since its source is decoded to the address of the label. */
+static const MACHINE_HANDLER g_apfnHandlers[GLOB_OPCODE_STOP + 1] = {
+    machine_Mov,    /* mov */
+    machine_Cmp,    /* cmp */
+    machine_Add,    /* add */
+    machine_Sub,    /* sub */
+    machine_Not,    /* not */
+    machine_Clr,    /* clr */
+    machine_Mov,    /* lea */
+    machine_Inc,    /* inc */
+    machine_Dec,    /* dec */
+    machine_Jump,   /* jmp */
+    machine_Bne,    /* bne */
+    machine_Red,    /* red */
+    machine_Prn,    /* prn */
+    machine_Jsr,    /* jsr */
+    machine_Rts,    /* rts */
+    machine_Stop,   /* stop */
+};
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    machine_Fault
+ * Purpose: Stop the program because of a fault
+ * Parameters:
+ *          hMachine [IN] - handle to the machine
+ *          ptInstruction [IN] - the instruction that faulted
+ *          pszFault [IN] - the description of the fault
+ * Return Value:
+ *          NULL (to stop the run loop)
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Fault(HMACHINE hMachine,
+                                          PMACHINE_INSTRUCTION ptInstruction,
+                                          const char * pszFault) {
+    hMachine->pszFault = pszFault;
+    hMachine->nFaultAddress = ptInstruction - hMachine->atInstructions;
+    return NULL;
+}
+
+/******************************************************************************
+ * Name:    machine_Invalidate
+ * Purpose: Reset the slots of the instructions that may contain a word,
+ *          after the word was written
+ * Parameters:
+ *          hMachine [IN] - handle to the machine
+ *          nAddress [IN] - the address of the word
+ *****************************************************************************/
+static void machine_Invalidate(HMACHINE hMachine, int nAddress) {
+    int nFirst = MAX(0, nAddress - MACHINE_MAX_INSTRUCTION_LENGTH + 1);
+    
+    for (int nIndex = nFirst; nIndex <= nAddress; nIndex++) {
+        hMachine->atInstructions[nIndex].pfnHandler = machine_Decode;
+    }
+}
+
+/******************************************************************************
+ * Name:    machine_Store
+ * Purpose: Write the result of an instruction to its destination
+ * Parameters:
+ *          hMachine [IN] - handle to the machine
+ *          ptInstruction [IN] - the instruction
+ *          nValue [IN] - the result
+ * Return Value:
+ *          The next instruction
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Store(HMACHINE hMachine,
+                                          PMACHINE_INSTRUCTION ptInstruction,
+                                          int nValue) {
+    *ptInstruction->pwDest = nValue & MACHINE_WORD_MASK;
+    if (ptInstruction->nDestAddress >= 0) {
+        machine_Invalidate(hMachine, ptInstruction->nDestAddress);
+    }
+    return ptInstruction->ptNext;
+}
+
+/******************************************************************************
+ * Name:    machine_Jump
+ * Purpose: Execute jmp (and the jump of bne & jsr): pass the parameters (if
+ *          any) and jump to the destination
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Jump(HMACHINE hMachine,
+                                         PMACHINE_INSTRUCTION ptInstruction) {
+    int nTarget = *ptInstruction->pwDest;
+    uint16_t wParam1 = 0;
+    
+    if (NULL != ptInstruction->apwParams[0]) {
+        /* Read both before the writing, for "jmp L(r7,r6)" */
+        wParam1 = *ptInstruction->apwParams[0];
+        hMachine->awRegisters[MACHINE_PARAM2_REGISTER] =
+                *ptInstruction->apwParams[1];
+        hMachine->awRegisters[MACHINE_PARAM1_REGISTER] = wParam1;
+    }
+    if (nTarget >= MACHINE_MEMORY_SIZE) {
+        return machine_Fault(hMachine, ptInstruction,
+                             "jump out of the memory");
+    }
+    return &hMachine->atInstructions[nTarget];
+}
+
+/******************************************************************************
+ * Name:    machine_DecodeOperand
+ * Purpose: Decode an operand of an instruction
+ * Parameters:
+ *          hMachine [IN] - handle to the machine
+ *          ptInstruction [IN] - the instruction
+ *          nMethod [IN] - the method of the operand
+ *          bIsSource [IN] - TRUE if a register operand is in the source
+ *                           field of the word
+ *          bIsAddress [IN] - TRUE if the operand of the direct method is the
+ *                            address (and not the word in the address)
+ *          nPosition [IN] - the address of the word of the operand
+ *          nConstant [IN] - the index of the constant of the operand
+ *          ppwOperand [OUT] - the operand
+ * Return Value:
+ *          NULL upon success. Otherwise, the description of the fault.
+ *****************************************************************************/
+static const char * machine_DecodeOperand(HMACHINE hMachine,
+                                          PMACHINE_INSTRUCTION ptInstruction,
+                                          int nMethod,
+                                          BOOL bIsSource,
+                                          BOOL bIsAddress,
+                                          int nPosition,
+                                          int nConstant,
+                                          uint16_t ** ppwOperand) {
+    uint16_t wWord = 0;
+    uint16_t * pwConstant = &ptInstruction->awConstants[nConstant];
+    
+    if (nPosition >= MACHINE_MEMORY_SIZE) {
+        return "the instruction exceeds the memory";
+    }
+    wWord = hMachine->awMemory[nPosition];
+    
+    switch (nMethod) {
+        case ASM_OPERAND_METHOD_IMMEDIATE:
+            *pwConstant = ASM_GET_IMMEDIATE_VALUE(wWord) & MACHINE_WORD_MASK;
+            *ppwOperand = pwConstant;
+            break;
+        case ASM_OPERAND_METHOD_DIRECT:
+            if (ASM_ARE_EXTERNAL == ASM_GET_ARE(wWord)) {
+                return "unresolved external (link the program first)";
+            }
+            if (bIsAddress) {
+                *pwConstant = ASM_GET_ADDRESS(wWord);
+                *ppwOperand = pwConstant;
+            } else {
+                *ppwOperand = &hMachine->awMemory[ASM_GET_ADDRESS(wWord)];
+            }
+            break;
+        case ASM_OPERAND_METHOD_REGISTER:
+            *ppwOperand = &hMachine->awRegisters[bIsSource
+                                    ? ASM_GET_SOURCE_REGISTER(wWord)
+                                    : ASM_GET_DEST_REGISTER(wWord)];
+            break;
+        default:
+            return "invalid operand method";
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ * Name:    machine_Decode
+ * Purpose: Decode the instruction of a slot and execute it. It is the
+ *          function of the slots that were not decoded yet.
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Decode(HMACHINE hMachine,
+                                           PMACHINE_INSTRUCTION ptInstruction) {
+    int nAddress = ptInstruction - hMachine->atInstructions;
+    int nPosition = nAddress + 1;
+    uint16_t wFirstWord = hMachine->awMemory[nAddress];
+    int nOpcode = ASM_GET_OPCODE(wFirstWord);
+    int nSource = ASM_GET_SOURCE_METHOD(wFirstWord);
+    int nDest = ASM_GET_DEST_METHOD(wFirstWord);
+    int nParam1 = ASM_GET_PARAM1(wFirstWord);
+    int nParam2 = ASM_GET_PARAM2(wFirstWord);
+    BOOL bIsJump = (GLOB_OPCODE_JMP == nOpcode || GLOB_OPCODE_BNE == nOpcode
+                    || GLOB_OPCODE_JSR == nOpcode);
+    uint16_t * pwOperand = NULL;
+    const char * pszFault = NULL;
+    
+    ptInstruction->pwSource = NULL;
+    ptInstruction->pwDest = NULL;
+    ptInstruction->apwParams[0] = NULL;
+    ptInstruction->apwParams[1] = NULL;
+    ptInstruction->nDestAddress = -1;
+    
+    /* The source operand. Two register operands share one word. */
+    if (ASM_HAS_SOURCE_OPERAND(nOpcode)) {
+        pszFault = machine_DecodeOperand(hMachine, ptInstruction, nSource,
+                                         TRUE, GLOB_OPCODE_LEA == nOpcode,
+                                         nPosition, 0, &pwOperand);
+        ptInstruction->pwSource = pwOperand;
+        if (ASM_OPERAND_METHOD_REGISTER != nSource
+            || ASM_OPERAND_METHOD_REGISTER != nDest) {
+            nPosition++;
+        }
+    }
+    
+    /* The destination operand */
+    if (NULL == pszFault && ASM_HAS_DESTINATION_OPERAND(nOpcode)) {
+        if (bIsJump && ASM_OPERAND_METHOD_PARAMETERS == nDest) {
+            /* The label and then the parameters */
+            pszFault = machine_DecodeOperand(hMachine, ptInstruction,
+                                             ASM_OPERAND_METHOD_DIRECT, FALSE,
+                                             TRUE, nPosition, 1,
+                                             &ptInstruction->pwDest);
+            nPosition++;
+            if (NULL == pszFault) {
+                pszFault = machine_DecodeOperand(hMachine, ptInstruction,
+                                                 nParam1, TRUE, FALSE,
+                                                 nPosition, 2, &pwOperand);
+                ptInstruction->apwParams[0] = pwOperand;
+                if (ASM_OPERAND_METHOD_REGISTER != nParam1
+                    || ASM_OPERAND_METHOD_REGISTER != nParam2) {
+                    nPosition++;
+                }
+            }
+            if (NULL == pszFault) {
+                pszFault = machine_DecodeOperand(hMachine, ptInstruction,
+                                                 nParam2, FALSE, FALSE,
+                                                 nPosition, 3, &pwOperand);
+                ptInstruction->apwParams[1] = pwOperand;
+                nPosition++;
+            }
+        } else {
+            pszFault = machine_DecodeOperand(hMachine, ptInstruction, nDest,
+                                             FALSE, bIsJump, nPosition, 1,
+                                             &ptInstruction->pwDest);
+            if (ASM_OPERAND_METHOD_DIRECT == nDest && !bIsJump) {
+                ptInstruction->nDestAddress =
+                        ptInstruction->pwDest - hMachine->awMemory;
+            }
+            nPosition++;
+        }
+    }
+    
+    /* A fault is reported again if the instruction runs again */
+    if (NULL != pszFault) {
+        return machine_Fault(hMachine, ptInstruction, pszFault);
+    }
+    
+    /* Keep the decoded instruction and execute it */
+    ptInstruction->ptNext = &hMachine->atInstructions[nPosition];
+    ptInstruction->pfnHandler = g_apfnHandlers[nOpcode];
+    return ptInstruction->pfnHandler(hMachine, ptInstruction);
+}
+
+/******************************************************************************
+ * Name:    machine_OutOfMemory
+ * Purpose: The function of the slot after the end of the memory
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_OutOfMemory(
+                                    HMACHINE hMachine,
+                                    PMACHINE_INSTRUCTION ptInstruction) {
+    return machine_Fault(hMachine, ptInstruction,
+                         "the program ran out of the memory");
+}
+
+/******************************************************************************
+ * Name:    machine_Mov
+ * Purpose: Execute mov (and lea)
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Mov(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    return machine_Store(hMachine, ptInstruction, *ptInstruction->pwSource);
+}
+
+/******************************************************************************
+ * Name:    machine_Cmp
+ * Purpose: Execute cmp
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Cmp(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    hMachine->bZero = (*ptInstruction->pwSource == *ptInstruction->pwDest);
+    return ptInstruction->ptNext;
+}
+
+/******************************************************************************
+ * Name:    machine_Add
+ * Purpose: Execute add
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Add(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    int nResult = (*ptInstruction->pwDest + *ptInstruction->pwSource)
+                  & MACHINE_WORD_MASK;
+    
+    hMachine->bZero = (0 == nResult);
+    return machine_Store(hMachine, ptInstruction, nResult);
+}
+
+/******************************************************************************
+ * Name:    machine_Sub
+ * Purpose: Execute sub
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Sub(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    int nResult = (*ptInstruction->pwDest - *ptInstruction->pwSource)
+                  & MACHINE_WORD_MASK;
+    
+    hMachine->bZero = (0 == nResult);
+    return machine_Store(hMachine, ptInstruction, nResult);
+}
+
+/******************************************************************************
+ * Name:    machine_Not
+ * Purpose: Execute not
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Not(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    int nResult = ~*ptInstruction->pwDest & MACHINE_WORD_MASK;
+    
+    hMachine->bZero = (0 == nResult);
+    return machine_Store(hMachine, ptInstruction, nResult);
+}
+
+/******************************************************************************
+ * Name:    machine_Clr
+ * Purpose: Execute clr
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Clr(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    hMachine->bZero = TRUE;
+    return machine_Store(hMachine, ptInstruction, 0);
+}
+
+/******************************************************************************
+ * Name:    machine_Inc
+ * Purpose: Execute inc
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Inc(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    int nResult = (*ptInstruction->pwDest + 1) & MACHINE_WORD_MASK;
+    
+    hMachine->bZero = (0 == nResult);
+    return machine_Store(hMachine, ptInstruction, nResult);
+}
+
+/******************************************************************************
+ * Name:    machine_Dec
+ * Purpose: Execute dec
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Dec(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    int nResult = (*ptInstruction->pwDest - 1) & MACHINE_WORD_MASK;
+    
+    hMachine->bZero = (0 == nResult);
+    return machine_Store(hMachine, ptInstruction, nResult);
+}
+
+/******************************************************************************
+ * Name:    machine_Bne
+ * Purpose: Execute bne
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Bne(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    if (hMachine->bZero) {
+        return ptInstruction->ptNext;
+    }
+    return machine_Jump(hMachine, ptInstruction);
+}
+
+/******************************************************************************
+ * Name:    machine_Red
+ * Purpose: Execute red
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Red(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    return machine_Store(hMachine, ptInstruction, getchar());
+}
+
+/******************************************************************************
+ * Name:    machine_Prn
+ * Purpose: Execute prn
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Prn(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    printf("%d\n", MACHINE_TO_SIGNED(*ptInstruction->pwDest));
+    return ptInstruction->ptNext;
+}
+
+/******************************************************************************
+ * Name:    machine_Jsr
+ * Purpose: Execute jsr
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Jsr(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    if (MACHINE_STACK_SIZE == hMachine->nStackDepth) {
+        return machine_Fault(hMachine, ptInstruction, "stack overflow");
+    }
+    hMachine->aptStack[hMachine->nStackDepth] = ptInstruction->ptNext;
+    hMachine->nStackDepth++;
+    return machine_Jump(hMachine, ptInstruction);
+}
+
+/******************************************************************************
+ * Name:    machine_Rts
+ * Purpose: Execute rts
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Rts(HMACHINE hMachine,
+                                        PMACHINE_INSTRUCTION ptInstruction) {
+    if (0 == hMachine->nStackDepth) {
+        return machine_Fault(hMachine, ptInstruction, "stack underflow");
+    }
+    hMachine->nStackDepth--;
+    return hMachine->aptStack[hMachine->nStackDepth];
+}
+
+/******************************************************************************
+ * Name:    machine_Stop
+ * Purpose: Execute stop
+ * Parameters:
+ *          See MACHINE_HANDLER
+ * Return Value:
+ *          See MACHINE_HANDLER
+ *****************************************************************************/
+static PMACHINE_INSTRUCTION machine_Stop(HMACHINE hMachine,
+                                         PMACHINE_INSTRUCTION ptInstruction) {
+    hMachine->bStopped = TRUE;
+    return NULL;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    MACHINE_Create
+ *****************************************************************************/
+GLOB_ERROR MACHINE_Create(const uint16_t * pwCode,
+                          int nCodeLength,
+                          const uint16_t * pwData,
+                          int nDataLength,
+                          PHMACHINE phMachine) {
+    HMACHINE hMachine = NULL;
+    
+    /* Check parameters */
+    if ((NULL == pwCode && 0 != nCodeLength)
+        || (NULL == pwData && 0 != nDataLength) || NULL == phMachine
+        || nCodeLength < 0 || nDataLength < 0) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    if (nCodeLength + (long long)nDataLength
+        > MACHINE_MEMORY_SIZE - CODE_STARTUP_ADDRESS) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    STATS_CountAllocation(STATS_MODULE_MACHINE, sizeof(*hMachine));
+    hMachine = calloc(1, sizeof(*hMachine));
+    if (NULL == hMachine) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Load the program. No slot is decoded yet. */
+    for (int nIndex = 0; nIndex < nCodeLength; nIndex++) {
+        hMachine->awMemory[CODE_STARTUP_ADDRESS + nIndex] =
+                pwCode[nIndex] & MACHINE_WORD_MASK;
+    }
+    for (int nIndex = 0; nIndex < nDataLength; nIndex++) {
+        hMachine->awMemory[CODE_STARTUP_ADDRESS + nCodeLength + nIndex] =
+                pwData[nIndex] & MACHINE_WORD_MASK;
+    }
+    for (int nIndex = 0; nIndex < MACHINE_MEMORY_SIZE; nIndex++) {
+        hMachine->atInstructions[nIndex].pfnHandler = machine_Decode;
+    }
+    hMachine->atInstructions[MACHINE_MEMORY_SIZE].pfnHandler =
+            machine_OutOfMemory;
+    hMachine->ptCurrent = &hMachine->atInstructions[CODE_STARTUP_ADDRESS];
+    
+    /* Set out parameter upon success */
+    *phMachine = hMachine;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    MACHINE_Run
+ *****************************************************************************/
+GLOB_ERROR MACHINE_Run(HMACHINE hMachine,
+                       long long nMaxInstructions,
+                       PMACHINE_RESULT ptResult) {
+    PMACHINE_INSTRUCTION ptInstruction = NULL;
+    long long nInstructions = 0;
+    
+    /* Check parameters */
+    if (NULL == hMachine || NULL == ptResult) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* The run loop */
+    ptInstruction = hMachine->ptCurrent;
+    while (NULL != ptInstruction && nInstructions < nMaxInstructions) {
+        ptInstruction = ptInstruction->pfnHandler(hMachine, ptInstruction);
+        nInstructions++;
+    }
+    hMachine->ptCurrent = ptInstruction;
+    
+    /* Set out parameter */
+    ptResult->nInstructions = nInstructions;
+    ptResult->bStopped = hMachine->bStopped;
+    ptResult->pszFault = hMachine->pszFault;
+    ptResult->nAddress = hMachine->nFaultAddress;
+    return (NULL == hMachine->pszFault) ? GLOB_SUCCESS
+                                        : GLOB_ERROR_INVALID_STATE;
+}
+
+/******************************************************************************
+ * Name:    MACHINE_Free
+ *****************************************************************************/
+void MACHINE_Free(HMACHINE hMachine) {
+    free(hMachine);
+}
@@ -0,0 +1,110 @@
+/******************************************************************************
+ * File:    machine.h
+ * Author:  Doron Shvartztuch
+ * The MACHINE module emulates the target machine of the assembler, so the
+ * compiled programs can be run.
+ *
+ * The machine:
+ * The memory has MACHINE_MEMORY_SIZE words of 14 bits. The code section is
+ * loaded at CODE_STARTUP_ADDRESS and the data section right after it (where
+ * the assembler placed the data labels). There are 8 registers (r0-r7), a Z
+ * flag and a stack of return addresses.
+ * The instructions are encoded as the ASM module writes them. The results of
+ * cmp, add, sub, not, clr, inc & dec set the Z flag, and bne jumps if it
+ * is clear. Jumping with parameters - "jmp L(p1,p2)" - copies p1 to r6 and
+ * p2 to r7, and then jumps (bne copies them only if it jumps). red reads a
+ * char from the stdin (-1 on end of file) and prn prints its operand as a
+ * signed decimal number and '\n'.
+ *****************************************************************************/
+
+#ifndef MACHINE_H
+#define MACHINE_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "global.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The size (in words) of the memory. An operand word keeps a 12-bit
+ * address. */
+#define MACHINE_MEMORY_SIZE 4096
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* Handle to a machine */
+typedef struct MACHINE MACHINE, *HMACHINE, **PHMACHINE;
+
+/* The result of MACHINE_Run */
+typedef struct MACHINE_RESULT {
+    /* The number of the executed instructions (including the last one) */
+    long long nInstructions;
+    
+    /* TRUE if the program executed 'stop'. FALSE if the run stopped at the
+     * limit of instructions (or at a fault). */
+    BOOL bStopped;
+    
+    /* The fault (NULL if none) and the address of the instruction */
+    const char * pszFault;
+    int nAddress;
+} MACHINE_RESULT, *PMACHINE_RESULT;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    MACHINE_Create
+ * Purpose: Create a machine and load a program to its memory
+ * Parameters:
+ *          pwCode [IN] - the words of the code section
+ *          nCodeLength [IN] - size (in words) of the code section
+ *          pwData [IN] - the words of the data section
+ *          nDataLength [IN] - size (in words) of the data section
+ *          phMachine [OUT] - the handle to the created machine
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the program doesn't fit in the
+ *                                          memory
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR MACHINE_Create(const uint16_t * pwCode,
+                          int nCodeLength,
+                          const uint16_t * pwData,
+                          int nDataLength,
+                          PHMACHINE phMachine);
+
+/******************************************************************************
+ * Name:    MACHINE_Run
+ * Purpose: Run the program from the current instruction (the first one, on
+ *          the first call)
+ * Parameters:
+ *          hMachine [IN] - handle to the machine
+ *          nMaxInstructions [IN] - the maximum number of instructions to run
+ *          ptResult [OUT] - the result of the run
+ * Return Value:
+ *          Upon successful completion (the program stopped, or the limit
+ *          was reached), GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_INVALID_STATE - the program faulted (see the result).
+ *          It can't be run anymore.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR MACHINE_Run(HMACHINE hMachine,
+                       long long nMaxInstructions,
+                       PMACHINE_RESULT ptResult);
+
+/******************************************************************************
+ * Name:    MACHINE_Free
+ * Purpose: Free the machine
+ * Parameters:
+ *          hMachine [IN] - handle to the machine
+ *****************************************************************************/
+void MACHINE_Free(HMACHINE hMachine);
+
+#endif /* MACHINE_H */
@@ -10,6 +10,27 @@
  * and use the OUTPUT module to produce the output files.
  * Errors and Warning are received via callback function from the compilation
  * process and we write them to stdout.
+ * With "-j <jobs>" the files are compiled by a pool of worker threads. Each
+ * file has its own counters and its messages are kept in a buffer, which is
+ * printed by the main thread in the order of the command line arguments.
+ * When there are more jobs than files, each file gets the spare threads, so
+ * a large file is compiled in parts (see ASM_Compile).
+ * With "--stats" (or "--stats=json") the statistics of the compilation are
+ * collected by the STATS module and printed to the stderr at the end.
+ * Without "-j", the output files are written by the WRITER module, so the
+ * output files of a file are written while the next file is compiled. The
+ * messages of each file are kept in a buffer too, and printed when its
+ * output files are written (in the order of the files), so a file is
+ * reported as a success only after its files exist. With "-j", each worker
+ * writes the output files of its own files.
+ * With "--cache <dir>" the output files of each file that compiled without
+ * errors and warnings are kept in the directory (see CACHE). The next time,
+ * if the source file didn't change, its output files are written from the
+ * cache instead of compiling it again.
+ * With "--server <socket>" we run as a compile server (see SERVER) with
+ * <jobs> threads, until a client stops it. The server compiles each file
+ * from the memory, under the name the client sent, so the messages are the
+ * same as the messages of the command line.
  *****************************************************************************/
 
 /******************************************************************************
@@ -17,9 +38,17 @@
  *****************************************************************************/
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include "global.h"
+#include "buffer.h"
 #include "asm.h"
+#include "cache.h"
 #include "output.h"
+#include "server.h"
+#include "stats.h"
+#include "writer.h"
 
 /******************************************************************************
  * CONSTANTS & MACROS
@@ -29,18 +58,122 @@
  * a file to compile. */
 #define MIN_NUMBER_OF_ARGUMENTS 2
 
+/* The command line option of the number of jobs (worker threads) */
+#define MAIN_JOBS_OPTION "-j"
+
+/* The maximum number of jobs */
+#define MAIN_MAX_JOBS 256
+
+/* The command line options of the statistics (as a table or as JSON) */
+#define MAIN_STATS_OPTION "--stats"
+#define MAIN_STATS_JSON_OPTION "--stats=json"
+
+/* The command line option of the cache directory */
+#define MAIN_CACHE_OPTION "--cache"
+
+/* The command line option of the server mode */
+#define MAIN_SERVER_OPTION "--server"
+
+/* The command line option of the packed object file */
+#define MAIN_PACKED_OPTION "--packed"
+
+/* The number of the threads that write the output files (without "-j") */
+#define MAIN_WRITER_THREADS 2
+
 /******************************************************************************
  * TYPEDEFS
  *****************************************************************************/
 
 /* The MAIN_ERRORS_COUNTER structure is used as the context of the errors 
  * callback function context. We use it to count the errors and warnings during
- * the compilation process */
+ * the compilation process. Each file has its own counters. */
 typedef struct MAIN_ERRORS_COUNTER{
     int nErrors;
     int nWarnings;
+    
+    /* The messages of the file. If NULL, the messages are printed directly
+     * to the stdout. */
+    HBUFFER hMessages;
 } MAIN_ERRORS_COUNTER, *PMAIN_ERRORS_COUNTER;
 
+/* The files that are printed when they are done, in the order of the command
+ * line arguments (see main_CompileFiles) */
+typedef struct MAIN_RESULTS MAIN_RESULTS, *PMAIN_RESULTS;
+
+/* A file to compile */
+typedef struct MAIN_JOB {
+    /* The file name (w/o extension) */
+    const char * pszFileName;
+    
+    /* The counters and the messages of the file */
+    MAIN_ERRORS_COUNTER tCounters;
+    
+    /* The result of the compilation */
+    GLOB_ERROR eRetValue;
+    
+    /* TRUE when the compilation of the file is done */
+    BOOL bIsDone;
+    
+    /* The statistics of the file */
+    STATS tStats;
+    
+    /* TRUE if the output files were submitted to the writer. Then the job is
+     * done when the writer calls back. */
+    BOOL bIsSubmitted;
+    
+    /* The results the file belongs to (main_CompileFiles only) */
+    PMAIN_RESULTS ptResults;
+    
+    /* The content of a submitted file, that was read by main (see
+     * main_CompileFile). It's freed when the writer calls back, since the
+     * lines of the compiled file are views into it. */
+    char * pcSource;
+} MAIN_JOB, *PMAIN_JOB;
+
+/* MAIN_RESULTS is the struct behind the PMAIN_RESULTS.
+ * All the fields (and the bIsDone of the jobs) are protected by tLock. */
+struct MAIN_RESULTS {
+    pthread_mutex_t tLock;
+    
+    /* The jobs, in the order of the command line arguments */
+    PMAIN_JOB patJobs;
+    int nJobs;
+    
+    /* The index of the next job to print */
+    int nNextToPrint;
+};
+
+/* The state shared by the main thread and the worker threads.
+ * All the fields (and the bIsDone of the jobs) are protected by tLock. */
+typedef struct MAIN_JOBS_QUEUE {
+    pthread_mutex_t tLock;
+    
+    /* Signaled when a job is done */
+    pthread_cond_t tJobDone;
+    
+    /* The jobs, in the order of the command line arguments */
+    PMAIN_JOB patJobs;
+    int nJobs;
+    
+    /* The index of the next job to start */
+    int nNextJob;
+    
+    /* Set to stop the workers before they start the next job */
+    BOOL bStop;
+    
+    /* TRUE if the workers should collect statistics */
+    BOOL bCollectStats;
+    
+    /* The cache of the output files (NULL if not used) */
+    HCACHE hCache;
+    
+    /* TRUE if the packed object files should be written */
+    BOOL bWritePacked;
+    
+    /* The number of threads that compile each file */
+    int nThreadsPerFile;
+} MAIN_JOBS_QUEUE, *PMAIN_JOBS_QUEUE;
+
 /******************************************************************************
  * INTERNAL FUNCTIONS (prototypes)
  * -------------------------------
@@ -54,7 +187,49 @@ static void main_ErrorOrWarningCallback(void * pvContext,
                                         BOOL bIsError,
                                         const char * pszErrorFormat,
                                         va_list vaArgs);
-
+static void main_Print(PMAIN_ERRORS_COUNTER ptCounters,
+                       const char * pszFormat, ...);
+static BOOL main_WriteCachedFiles(const char * pszFileName,
+                                  HCACHE hCache,
+                                  uint64_t nKey,
+                                  GLOB_ERROR * peRetValue);
+static void main_StoreInCache(HCACHE hCache, uint64_t nKey, HASM_FILE hAsm);
+static GLOB_ERROR main_CompileSource(const char * pszFileName,
+                                     const char * pcSource,
+                                     size_t nLength,
+                                     PMAIN_ERRORS_COUNTER ptCounters,
+                                     int nThreads,
+                                     PHASM_FILE phAsm);
+static GLOB_ERROR main_CompileFile(PMAIN_JOB ptJob,
+                                   HWRITER hWriter,
+                                   HCACHE hCache,
+                                   BOOL bWritePacked,
+                                   int nThreads);
+static void main_FinishJob(PMAIN_RESULTS ptResults,
+                           PMAIN_JOB ptJob,
+                           GLOB_ERROR eRetValue);
+static void main_WriterDoneCallback(void * pvJob, GLOB_ERROR eRetValue);
+static GLOB_ERROR main_CompileFiles(const char ** ppszFileNames,
+                                    int nFiles,
+                                    PSTATS ptStats,
+                                    HCACHE hCache,
+                                    BOOL bWritePacked);
+static GLOB_ERROR main_ReadSource(const char * pszPath,
+                                  char ** ppcSource,
+                                  size_t * pnLength);
+static GLOB_ERROR main_ServeFile(void * pvContext,
+                                 const char * pszName,
+                                 const char * pszPath,
+                                 const char * pcSource,
+                                 size_t nLength,
+                                 HBUFFER hMessages);
+static void * main_WorkerThread(void * pvQueue);
+static GLOB_ERROR main_CompileFilesInParallel(const char ** ppszFileNames,
+                                              int nFiles,
+                                              int nThreads,
+                                              PSTATS ptStats,
+                                              HCACHE hCache,
+                                              BOOL bWritePacked);
 
 /******************************************************************************
  * INTERNAL FUNCTIONS
@@ -90,30 +265,668 @@ static void main_ErrorOrWarningCallback(void * pvContext,
     
     /* Print the location of the error/message. Line & Column are optional.*/
     if (nLine > 0 && nColumn > 0) {
-        printf("%s:%d:%d ", pszFileName, nLine, nColumn);
+        main_Print(ptCounters, "%s:%d:%d ", pszFileName, nLine, nColumn);
     } else {
-        printf("%s ", pszFileName);
-
+        main_Print(ptCounters, "%s ", pszFileName);
+    
     }
     /* Print the message type. */
-    printf(bIsError ? "error: " : "warning: ");
+    main_Print(ptCounters, bIsError ? "error: " : "warning: ");
     
     /* Print the message itself */
-    vprintf (pszErrorFormat, vaArgs);
+    if (NULL == ptCounters->hMessages) {
+        vprintf (pszErrorFormat, vaArgs);
+    } else {
+        BUFFER_AppendVPrintf(ptCounters->hMessages,
+                             pszErrorFormat, vaArgs);
+    }
     
     if (NULL == pszSourceLine || nColumn <= 0) {
         /* Source line isn't provided. */
-        printf("\n");
+        main_Print(ptCounters, "\n");
         return;
     }
     /* Print the source line. */
-    printf("\n%s\n", pszSourceLine);
-
+    main_Print(ptCounters, "\n%s\n", pszSourceLine);
+    
     /* Print an arrow below the error. */
     for (nIndex = 0; nIndex < nColumn-1; nIndex++){
-        printf(" ");
+        main_Print(ptCounters, " ");
+    }
+    main_Print(ptCounters, "^\n");    
+}
+
+/******************************************************************************
+ * Name:    main_Print
+ * Purpose: Print a message of a file, to the stdout or to the messages
+ *          buffer of the file.
+ * Parameters:
+ *          ptCounters [IN] - the counters of the file
+ *          pszFormat [IN] - the message (format as printf syntax)
+ *          ... [IN] - parameters to include in the message
+ * Remark:  A message that we failed to buffer is lost. The compilation
+ *          itself is not affected.
+ *****************************************************************************/
+static void main_Print(PMAIN_ERRORS_COUNTER ptCounters,
+                       const char * pszFormat, ...) {
+    va_list vaArgs;
+    
+    va_start (vaArgs, pszFormat);
+    if (NULL == ptCounters->hMessages) {
+        vprintf (pszFormat, vaArgs);
+    } else {
+        BUFFER_AppendVPrintf(ptCounters->hMessages, pszFormat, vaArgs);
+    }
+    va_end (vaArgs);
+}
+
+/******************************************************************************
+ * Name:    main_WriteCachedFiles
+ * Purpose: Write the output files of a file from the cache
+ * Parameters:
+ *          pszFileName [IN] - the file name (w/o extension)
+ *          hCache [IN] - the cache
+ *          nKey [IN] - the key of the source file
+ *          peRetValue [OUT] - the result of writing the files
+ * Return Value:
+ *          TRUE if the files were found in the cache. In this case, the
+ *          result of writing them is returned in peRetValue.
+ *          FALSE if the file should be compiled.
+ *****************************************************************************/
+static BOOL main_WriteCachedFiles(const char * pszFileName,
+                                  HCACHE hCache,
+                                  uint64_t nKey,
+                                  GLOB_ERROR * peRetValue) {
+    OUTPUT_FILES tFiles = {0};
+    
+    if (GLOB_SUCCESS != CACHE_Find(hCache, nKey, &tFiles)) {
+        return FALSE;
+    }
+    STATS_Count(STATS_COUNTER_CACHE_HITS, 1);
+    *peRetValue = OUTPUT_WriteContent(pszFileName, &tFiles);
+    OUTPUT_FreeFiles(&tFiles);
+    return TRUE;
+}
+
+/******************************************************************************
+ * Name:    main_StoreInCache
+ * Purpose: Keep the output files of a compiled file in the cache
+ * Parameters:
+ *          hCache [IN] - the cache
+ *          nKey [IN] - the key of the source file
+ *          hAsm [IN] - handle to the compiled file
+ * Remark:  The cache is only an optimization, so the errors are ignored
+ *****************************************************************************/
+static void main_StoreInCache(HCACHE hCache, uint64_t nKey, HASM_FILE hAsm) {
+    OUTPUT_FILES tFiles = {0};
+    
+    if (GLOB_SUCCESS == OUTPUT_GetFiles(hAsm, &tFiles)) {
+        CACHE_Store(hCache, nKey, &tFiles);
+    }
+    OUTPUT_FreeFiles(&tFiles);
+}
+
+/******************************************************************************
+ * Name:    main_CompileSource
+ * Purpose: Compile a file, from its content if it was read already
+ * Parameters:
+ *          pszFileName [IN] - the file name (w/o extension)
+ *          pcSource [IN OPTIONAL] - the content of the file. If NULL, the
+ *                                   file is read by the compilation.
+ *          nLength [IN] - the length (in chars) of the content
+ *          ptCounters [IN] - the counters (and messages) of the file
+ *          nThreads [IN] - the number of threads that compile the file
+ *          phAsm [OUT] - handle to the compiled file
+ * Return Value:
+ *          See ASM_Compile.
+ * Remark:  The content must be valid until the compiled file is closed.
+ *****************************************************************************/
+static GLOB_ERROR main_CompileSource(const char * pszFileName,
+                                     const char * pcSource,
+                                     size_t nLength,
+                                     PMAIN_ERRORS_COUNTER ptCounters,
+                                     int nThreads,
+                                     PHASM_FILE phAsm) {
+    char * pszSourceName = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    if (NULL == pcSource) {
+        return ASM_Compile(pszFileName, main_ErrorOrWarningCallback,
+                           ptCounters, nThreads, phAsm);
+    }
+    
+    /* Compile the content under the name of the source file, as ASM_Compile
+     * would name it */
+    pszSourceName = HELPER_ConcatStrings(pszFileName,
+                                         GLOB_FILE_EXTENSION_SOURCE);
+    if (NULL == pszSourceName) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    eRetValue = ASM_CompileBuffer(pszSourceName, pcSource, nLength,
+                                  main_ErrorOrWarningCallback, ptCounters,
+                                  nThreads, phAsm);
+    free(pszSourceName);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    main_CompileFile
+ * Purpose: Compile a file and write its output files
+ * Parameters:
+ *          ptJob [IN OUT] - the file name, and the counters (and messages)
+ *                           of the file
+ *          hWriter [IN OPTIONAL] - the writer of the output files. If NULL,
+ *                                  the files are written before the function
+ *                                  returns. Otherwise, if the files are
+ *                                  submitted (see bIsSubmitted of the job),
+ *                                  the result of the file is printed by
+ *                                  main_WriterDoneCallback.
+ *          hCache [IN OPTIONAL] - the cache of the output files
+ *          bWritePacked [IN] - TRUE if the packed object file should be
+ *                              written (if a writer is used, it decides)
+ *          nThreads [IN] - the number of threads that compile the file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_PARSING_FAILED - the compilation of the file failed
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR main_CompileFile(PMAIN_JOB ptJob,
+                                   HWRITER hWriter,
+                                   HCACHE hCache,
+                                   BOOL bWritePacked,
+                                   int nThreads) {
+    const char * pszFileName = ptJob->pszFileName;
+    PMAIN_ERRORS_COUNTER ptCounters = &ptJob->tCounters;
+    HASM_FILE hAsm = NULL;
+    char * pcSource = NULL;
+    size_t nLength = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    uint64_t nKey = 0;
+    BOOL bHaveKey = FALSE;
+    
+    main_Print(ptCounters, "Compiling %s...\n", pszFileName);
+    STATS_Count(STATS_COUNTER_FILES, 1);
+    
+    /* Reset the counters */
+    ptCounters->nErrors = 0;
+    ptCounters->nWarnings = 0;
+    
+    /* With a cache, the source is read once, so the key is calculated from
+     * the same content that is compiled. If we can't read the source, we let
+     * the compilation report it. */
+    if (NULL != hCache && GLOB_SUCCESS == main_ReadSource(pszFileName,
+                                                          &pcSource,
+                                                          &nLength)) {
+        bHaveKey = (GLOB_SUCCESS == CACHE_GetKey(pcSource, nLength, &nKey));
+    }
+    
+    /* Use the cached output files if the source didn't change */
+    if (bHaveKey && main_WriteCachedFiles(pszFileName, hCache, nKey,
+                                          &eRetValue)) {
+        free(pcSource);
+        if (eRetValue) {
+            main_Print(ptCounters, "FAILED - can't write the output files\n");
+            return eRetValue;
+        }
+        main_Print(ptCounters, "SUCCESS - 0 error(s), 0 warning(s)\n");
+        return GLOB_SUCCESS;
+    }
+    
+    /* Compile the file */
+    eRetValue = main_CompileSource(pszFileName, pcSource, nLength,
+                                   ptCounters, nThreads, &hAsm);
+    if (GLOB_ERROR_PARSING_FAILED == eRetValue) {
+        /* We have one or more compilation errors*/
+        main_Print(ptCounters, "FAILED - %d error(s), %d warning(s)\n",
+                   ptCounters->nErrors, ptCounters->nWarnings);
+        free(pcSource);
+        return eRetValue;
+    }
+    if (eRetValue) {
+        /* Fatal error during the compilation process */
+        free(pcSource);
+        return eRetValue;
+    }
+    
+    /* Keep the output files in the cache. A file with warnings is always
+     * compiled, so its warnings are printed again. */
+    if (bHaveKey && 0 == ptCounters->nWarnings) {
+        main_StoreInCache(hCache, nKey, hAsm);
+    }
+    
+    /* write the output files of the compilation. The writer closes the
+     * file after the writing, and reports the result. */
+    if (NULL != hWriter) {
+        ptJob->pcSource = pcSource;
+        eRetValue = WRITER_Submit(hWriter, pszFileName, hAsm,
+                                  main_WriterDoneCallback, ptJob);
+        ptJob->bIsSubmitted = (GLOB_SUCCESS == eRetValue);
+        if (!ptJob->bIsSubmitted) {
+            free(ptJob->pcSource);
+            ptJob->pcSource = NULL;
+        }
+        return eRetValue;
+    }
+    eRetValue = OUTPUT_WriteFiles(pszFileName, hAsm);
+    if (GLOB_SUCCESS == eRetValue && bWritePacked) {
+        eRetValue = OUTPUT_WritePacked(pszFileName, hAsm);
+    }
+    
+    /* Close resources of this file */
+    ASM_Close(hAsm);
+    free(pcSource);
+    if (eRetValue) {
+        main_Print(ptCounters, "FAILED - can't write the output files\n");
+        return eRetValue;
+    }
+    main_Print(ptCounters, "SUCCESS - 0 error(s), %d warning(s)\n",
+               ptCounters->nWarnings);
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    main_FinishJob
+ * Purpose: Mark a job as done, and print the jobs that are done, in order
+ * Parameters:
+ *          ptResults [IN] - the results the job belongs to
+ *          ptJob [IN] - the job
+ *          eRetValue [IN] - the result of the job
+ * Remark:  After a fatal error of a file, the next files are not printed,
+ *          since they are not compiled (or their files are not written).
+ *****************************************************************************/
+static void main_FinishJob(PMAIN_RESULTS ptResults,
+                           PMAIN_JOB ptJob,
+                           GLOB_ERROR eRetValue) {
+    PMAIN_JOB ptNextJob = NULL;
+    char * pcMessages = NULL;
+    int nMessagesLength = 0;
+    
+    pthread_mutex_lock(&ptResults->tLock);
+    ptJob->eRetValue = eRetValue;
+    ptJob->bIsDone = TRUE;
+    while (ptResults->nNextToPrint < ptResults->nJobs) {
+        ptNextJob = &ptResults->patJobs[ptResults->nNextToPrint];
+        if (!ptNextJob->bIsDone) {
+            break;
+        }
+        
+        /* Print the messages of the file */
+        BUFFER_GetStream(ptNextJob->tCounters.hMessages,
+                         &pcMessages, &nMessagesLength);
+        fwrite(pcMessages, 1, nMessagesLength, stdout);
+        ptResults->nNextToPrint++;
+        if (GLOB_SUCCESS != ptNextJob->eRetValue
+                && GLOB_ERROR_PARSING_FAILED != ptNextJob->eRetValue) {
+            /* Fatal error */
+            ptResults->nNextToPrint = ptResults->nJobs;
+        }
+    }
+    pthread_mutex_unlock(&ptResults->tLock);
+}
+
+/******************************************************************************
+ * Name:    main_WriterDoneCallback
+ * Purpose: Report a file whose output files were written by the writer (see
+ *          WRITER_DONECALLBACK)
+ * Parameters:
+ *          pvJob [IN] - the job of the file (PMAIN_JOB)
+ *          eRetValue [IN] - the result of writing the files
+ *****************************************************************************/
+static void main_WriterDoneCallback(void * pvJob, GLOB_ERROR eRetValue) {
+    PMAIN_JOB ptJob = (PMAIN_JOB)pvJob;
+    
+    /* The compiled file is closed, so its source isn't needed anymore */
+    free(ptJob->pcSource);
+    ptJob->pcSource = NULL;
+    
+    if (eRetValue) {
+        main_Print(&ptJob->tCounters,
+                   "FAILED - can't write the output files\n");
+    } else {
+        main_Print(&ptJob->tCounters, "SUCCESS - 0 error(s), %d warning(s)\n",
+                   ptJob->tCounters.nWarnings);
+    }
+    main_FinishJob(ptJob->ptResults, ptJob, eRetValue);
+}
+
+/******************************************************************************
+ * Name:    main_ReadSource
+ * Purpose: Read a source file to the memory
+ * Parameters:
+ *          pszPath [IN] - the path to the file (w/o the extension)
+ *          ppcSource [OUT] - the content of the file
+ *          pnLength [OUT] - the length (in chars) of the content
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the content.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR main_ReadSource(const char * pszPath,
+                                  char ** ppcSource,
+                                  size_t * pnLength) {
+    char * pszFullPath = NULL;
+    char * pcSource = NULL;
+    
+    pszFullPath = HELPER_ConcatStrings(pszPath, GLOB_FILE_EXTENSION_SOURCE);
+    if (NULL == pszFullPath) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    pcSource = HELPER_ReadFile(pszFullPath, pnLength);
+    free(pszFullPath);
+    if (NULL == pcSource) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Set out parameter upon success */
+    *ppcSource = pcSource;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    main_ServeFile
+ * Purpose: Compile a file of a client of the server and write its output
+ *          files
+ * Parameters:
+ *          See SERVER_COMPILECALLBACK declaration.
+ *****************************************************************************/
+static GLOB_ERROR main_ServeFile(void * pvContext,
+                                 const char * pszName,
+                                 const char * pszPath,
+                                 const char * pcSource,
+                                 size_t nLength,
+                                 HBUFFER hMessages) {
+    MAIN_ERRORS_COUNTER tCounters = {0};
+    HASM_FILE hAsm = NULL;
+    char * pcReadSource = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    tCounters.hMessages = hMessages;
+    main_Print(&tCounters, "Compiling %s...\n", pszName);
+    
+    /* Read the source, unless the client sent it */
+    if (NULL == pcSource) {
+        eRetValue = main_ReadSource(pszPath, &pcReadSource, &nLength);
+        if (eRetValue) {
+            return eRetValue;
+        }
+        pcSource = pcReadSource;
+    }
+    
+    /* Compile the file under the name of the source file */
+    eRetValue = main_CompileSource(pszName, pcSource, nLength, &tCounters, 1,
+                                   &hAsm);
+    if (GLOB_ERROR_PARSING_FAILED == eRetValue) {
+        main_Print(&tCounters, "FAILED - %d error(s), %d warning(s)\n",
+                   tCounters.nErrors, tCounters.nWarnings);
+    } else if (GLOB_SUCCESS == eRetValue) {
+        /* write the output files, next to the source */
+        eRetValue = OUTPUT_WriteFiles(pszPath, hAsm);
+        ASM_Close(hAsm);
+        if (GLOB_SUCCESS == eRetValue) {
+            main_Print(&tCounters, "SUCCESS - 0 error(s), %d warning(s)\n",
+                       tCounters.nWarnings);
+        }
+    }
+    free(pcReadSource);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    main_WorkerThread
+ * Purpose: The entry point of a worker thread. The worker compiles the files
+ *          of the queue until all of them are started (or the queue stopped).
+ * Parameters:
+ *          pvQueue [IN] - pointer to the MAIN_JOBS_QUEUE
+ * Return Value:
+ *          NULL
+ *****************************************************************************/
+static void * main_WorkerThread(void * pvQueue) {
+    PMAIN_JOBS_QUEUE ptQueue = (PMAIN_JOBS_QUEUE)pvQueue;
+    PMAIN_JOB ptJob = NULL;
+    
+    while (TRUE) {
+        /* Take the next job */
+        pthread_mutex_lock(&ptQueue->tLock);
+        if (ptQueue->bStop || ptQueue->nNextJob >= ptQueue->nJobs) {
+            pthread_mutex_unlock(&ptQueue->tLock);
+            return NULL;
+        }
+        ptJob = &ptQueue->patJobs[ptQueue->nNextJob];
+        ptQueue->nNextJob++;
+        pthread_mutex_unlock(&ptQueue->tLock);
+        
+        /* Compile the file. Only this thread uses the job until it is done */
+        STATS_SetCurrent(ptQueue->bCollectStats ? &ptJob->tStats : NULL);
+        ptJob->eRetValue = main_CompileFile(ptJob, NULL, ptQueue->hCache,
+                                            ptQueue->bWritePacked,
+                                            ptQueue->nThreadsPerFile);
+        STATS_SetCurrent(NULL);
+        
+        /* Let the main thread print the messages */
+        pthread_mutex_lock(&ptQueue->tLock);
+        ptJob->bIsDone = TRUE;
+        pthread_cond_broadcast(&ptQueue->tJobDone);
+        pthread_mutex_unlock(&ptQueue->tLock);
+    }
+}
+
+/******************************************************************************
+ * Name:    main_CompileFiles
+ * Purpose: Compile the files one after another. The output files of each
+ *          file are written by the writer threads, while the next file is
+ *          compiled. The messages of each file are printed when it is done,
+ *          in the order of the files.
+ * Parameters:
+ *          ppszFileNames [IN] - the files to compile (w/o extension)
+ *          nFiles [IN] - number of files
+ *          ptStats [IN OUT OPTIONAL] - the statistics of the files are
+ *                                      added to it. NULL if they are not
+ *                                      collected.
+ *          hCache [IN OPTIONAL] - the cache of the output files
+ *          bWritePacked [IN] - TRUE if the packed object files should be
+ *                              written
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_PARSING_FAILED - the compilation of one or more files
+ *                                      failed
+ *          If the function fails, an error code is returned.
+ * Remark:  The result of a file is printed after its output files are
+ *          written. A failure to write them is reported with the file, and
+ *          stops the compilation of the next files.
+ *****************************************************************************/
+static GLOB_ERROR main_CompileFiles(const char ** ppszFileNames,
+                                    int nFiles,
+                                    PSTATS ptStats,
+                                    HCACHE hCache,
+                                    BOOL bWritePacked) {
+    MAIN_RESULTS tResults;
+    PMAIN_JOB ptJob = NULL;
+    HWRITER hWriter = NULL;
+    BOOL bSuccess = TRUE;
+    GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    GLOB_ERROR eWriterRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Prepare the jobs */
+    memset(&tResults, 0, sizeof(tResults));
+    tResults.patJobs = calloc(nFiles, sizeof(*tResults.patJobs));
+    if (NULL == tResults.patJobs) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    tResults.nJobs = nFiles;
+    pthread_mutex_init(&tResults.tLock, NULL);
+    for (int nIndex = 0; nIndex < nFiles; nIndex++) {
+        ptJob = &tResults.patJobs[nIndex];
+        ptJob->pszFileName = ppszFileNames[nIndex];
+        ptJob->ptResults = &tResults;
+        eRetValue = BUFFER_Create(&ptJob->tCounters.hMessages);
+        if (eRetValue) {
+            nFiles = nIndex;
+            goto lblCleanup;
+        }
+    }
+    
+    STATS_SetCurrent(ptStats);
+    eRetValue = WRITER_Create(MAIN_WRITER_THREADS, NULL != ptStats,
+                              bWritePacked, &hWriter);
+    if (eRetValue) {
+        STATS_SetCurrent(NULL);
+        goto lblCleanup;
+    }
+    
+    /* Compile the files. A file that isn't submitted to the writer is done
+     * at once. */
+    for (int nIndex = 0; nIndex < nFiles; nIndex++) {
+        ptJob = &tResults.patJobs[nIndex];
+        eRetValue = main_CompileFile(ptJob, hWriter, hCache, bWritePacked, 1);
+        if (!ptJob->bIsSubmitted) {
+            main_FinishJob(&tResults, ptJob, eRetValue);
+        }
+        if (GLOB_ERROR_PARSING_FAILED == eRetValue) {
+            bSuccess = FALSE;
+            eRetValue = GLOB_SUCCESS;
+            continue;
+        }
+        if (eRetValue) {
+            /* Fatal error */
+            break;
+        }
+    }
+    STATS_SetCurrent(NULL);
+    
+    /* Wait for the output files. The first fatal error is returned. */
+    eWriterRetValue = WRITER_Close(hWriter, ptStats);
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = eWriterRetValue;
+    }
+    if (GLOB_SUCCESS == eRetValue && !bSuccess) {
+        eRetValue = GLOB_ERROR_PARSING_FAILED;
+    }
+    
+lblCleanup:
+    for (int nIndex = 0; nIndex < nFiles; nIndex++) {
+        BUFFER_Free(tResults.patJobs[nIndex].tCounters.hMessages);
+    }
+    pthread_mutex_destroy(&tResults.tLock);
+    free(tResults.patJobs);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    main_CompileFilesInParallel
+ * Purpose: Compile the files with a pool of worker threads. The messages are
+ *          printed in the order of the files.
+ * Parameters:
+ *          ppszFileNames [IN] - the files to compile (w/o extension)
+ *          nFiles [IN] - number of files
+ *          nThreads [IN] - number of worker threads
+ *          ptStats [IN OUT OPTIONAL] - the statistics of the files are
+ *                                      added to it. NULL if they are not
+ *                                      collected.
+ *          hCache [IN OPTIONAL] - the cache of the output files
+ *          bWritePacked [IN] - TRUE if the packed object files should be
+ *                              written
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_PARSING_FAILED - the compilation of one or more files
+ *                                      failed
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR main_CompileFilesInParallel(const char ** ppszFileNames,
+                                              int nFiles,
+                                              int nThreads,
+                                              PSTATS ptStats,
+                                              HCACHE hCache,
+                                              BOOL bWritePacked) {
+    MAIN_JOBS_QUEUE tQueue;
+    pthread_t atThreads[MAIN_MAX_JOBS];
+    int nStartedThreads = 0;
+    PMAIN_JOB ptJob = NULL;
+    char * pcMessages = NULL;
+    int nMessagesLength = 0;
+    BOOL bSuccess = TRUE;
+    GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    
+    /* Prepare the jobs */
+    memset(&tQueue, 0, sizeof(tQueue));
+    tQueue.patJobs = calloc(nFiles, sizeof(*tQueue.patJobs));
+    if (NULL == tQueue.patJobs) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    tQueue.nJobs = nFiles;
+    tQueue.bCollectStats = (NULL != ptStats);
+    tQueue.hCache = hCache;
+    tQueue.bWritePacked = bWritePacked;
+    tQueue.nThreadsPerFile = MAX(1, nThreads / nFiles);
+    for (int nIndex = 0; nIndex < nFiles; nIndex++) {
+        tQueue.patJobs[nIndex].pszFileName = ppszFileNames[nIndex];
+        eRetValue = BUFFER_Create(&tQueue.patJobs[nIndex].tCounters.hMessages);
+        if (eRetValue) {
+            nFiles = nIndex;
+            goto lblCleanup;
+        }
+    }
+    pthread_mutex_init(&tQueue.tLock, NULL);
+    pthread_cond_init(&tQueue.tJobDone, NULL);
+    
+    /* Start the workers */
+    nThreads = MIN(nThreads, nFiles);
+    for (nStartedThreads = 0; nStartedThreads < nThreads; nStartedThreads++) {
+        if (0 != pthread_create(&atThreads[nStartedThreads], NULL,
+                                main_WorkerThread, &tQueue)) {
+            eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+            break;
+        }
+    }
+    
+    /* Print the results in the order of the files. If we failed to start
+     * any worker, we stop at once. */
+    for (int nIndex = 0; 0 < nStartedThreads && nIndex < nFiles; nIndex++) {
+        ptJob = &tQueue.patJobs[nIndex];
+        
+        /* Wait for the job */
+        pthread_mutex_lock(&tQueue.tLock);
+        while (!ptJob->bIsDone) {
+            pthread_cond_wait(&tQueue.tJobDone, &tQueue.tLock);
+        }
+        pthread_mutex_unlock(&tQueue.tLock);
+        
+        /* Print the messages of the file */
+        BUFFER_GetStream(ptJob->tCounters.hMessages,
+                         &pcMessages, &nMessagesLength);
+        fwrite(pcMessages, 1, nMessagesLength, stdout);
+        if (NULL != ptStats) {
+            STATS_Add(ptStats, &ptJob->tStats);
+        }
+        
+        if (GLOB_ERROR_PARSING_FAILED == ptJob->eRetValue) {
+            bSuccess = FALSE;
+        } else if (ptJob->eRetValue) {
+            /* Fatal error. Don't start other files */
+            eRetValue = ptJob->eRetValue;
+            break;
+        }
+    }
+    
+    /* Stop the workers and wait for them */
+    pthread_mutex_lock(&tQueue.tLock);
+    tQueue.bStop = TRUE;
+    pthread_mutex_unlock(&tQueue.tLock);
+    for (int nIndex = 0; nIndex < nStartedThreads; nIndex++) {
+        pthread_join(atThreads[nIndex], NULL);
     }
-    printf("^\n");    
+    pthread_cond_destroy(&tQueue.tJobDone);
+    pthread_mutex_destroy(&tQueue.tLock);
+    
+    if (GLOB_SUCCESS == eRetValue && !bSuccess) {
+        eRetValue = GLOB_ERROR_PARSING_FAILED;
+    }
+    
+lblCleanup:
+    for (int nIndex = 0; nIndex < nFiles; nIndex++) {
+        BUFFER_Free(tQueue.patJobs[nIndex].tCounters.hMessages);
+    }
+    free(tQueue.patJobs);
+    return eRetValue;
 }
 
 
@@ -126,8 +939,25 @@ static void main_ErrorOrWarningCallback(void * pvContext,
  * Purpose: compiling the source file (as passed in the command line parameters)
  *          and produce the output files.
  * Command Line:
- *          asm <file1> <file2> ...
- *          The command line should include at least one file to compile
+ *          asm [-j <jobs>] [--stats|--stats=json] [--cache <dir>]
+ *              [--packed] <file1> <file2> ...
+ *          The command line should include at least one file to compile.
+ *          -j <jobs> - compile the files with <jobs> worker threads. The
+ *                      messages are printed in the order of the files.
+ *                      With fewer files than jobs, the first phase of a
+ *                      large file is run by several threads.
+ *          --stats - print the time of each phase, the number of
+ *                    lines/tokens/symbols and the allocations of each module
+ *                    to the stderr. With "=json" they are printed as a JSON
+ *                    object.
+ *          --cache <dir> - keep the output files in <dir> and use them
+ *                          for the sources that didn't change.
+ *          --packed - write also the packed object file (.obp, see
+ *                     PACKED). The cache keeps only the textual files, so
+ *                     it isn't used with this option.
+ *          asm [-j <jobs>] --server <socket>
+ *          Run as a compile server on the Unix domain socket, with <jobs>
+ *          threads. The files are sent by the client (asmc).
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS (0) is returned.
  *          GLOB_ERROR_PARSING_FAILED - the compilation failed of one
@@ -135,52 +965,102 @@ static void main_ErrorOrWarningCallback(void * pvContext,
  *          If the program fails, an error code is returned.
   *****************************************************************************/
 int main(int nArgc, const char * ppszArgv[]) {
-    HASM_FILE hAsm = NULL;
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
-    MAIN_ERRORS_COUNTER tCounters = {0};
-    BOOL bSuccess = TRUE;
+    STATS tStats = {{0}};
+    PSTATS ptStats = NULL;
+    BOOL bIsJsonStats = FALSE;
+    const char * pszCacheDirectory = NULL;
+    const char * pszServerSocket = NULL;
+    HCACHE hCache = NULL;
+    BOOL bWritePacked = FALSE;
+    int nFirstFile = 1;
+    int nJobs = 1;
+    char * pcEnd = NULL;
+    
+    /* Parse the options. The first argument that isn't an option is the first
+     * file. */
+    while (nFirstFile < nArgc) {
+        if (nFirstFile + 1 < nArgc
+            && 0 == strcmp(ppszArgv[nFirstFile], MAIN_JOBS_OPTION)) {
+            /* The number of jobs */
+            nJobs = (int)strtol(ppszArgv[nFirstFile + 1], &pcEnd, 10);
+            if ('\0' != *pcEnd || nJobs < 1 || nJobs > MAIN_MAX_JOBS) {
+                printf("Invalid number of jobs: %s\n",
+                       ppszArgv[nFirstFile + 1]);
+                return GLOB_ERROR_INVALID_PARAMETERS;
+            }
+            nFirstFile += 2;
+        } else if (nFirstFile + 1 < nArgc
+                   && 0 == strcmp(ppszArgv[nFirstFile], MAIN_CACHE_OPTION)) {
+            /* The cache directory */
+            pszCacheDirectory = ppszArgv[nFirstFile + 1];
+            nFirstFile += 2;
+        } else if (nFirstFile + 1 < nArgc
+                   && 0 == strcmp(ppszArgv[nFirstFile], MAIN_SERVER_OPTION)) {
+            /* The socket of the server mode */
+            pszServerSocket = ppszArgv[nFirstFile + 1];
+            nFirstFile += 2;
+        } else if (0 == strcmp(ppszArgv[nFirstFile], MAIN_PACKED_OPTION)) {
+            bWritePacked = TRUE;
+            nFirstFile++;
+        } else if (0 == strcmp(ppszArgv[nFirstFile], MAIN_STATS_OPTION)) {
+            ptStats = &tStats;
+            nFirstFile++;
+        } else if (0 == strcmp(ppszArgv[nFirstFile], MAIN_STATS_JSON_OPTION)) {
+            ptStats = &tStats;
+            bIsJsonStats = TRUE;
+            nFirstFile++;
+        } else {
+            break;
+        }
+    }
+    
+    /* Run as a server */
+    if (NULL != pszServerSocket) {
+        eRetValue = SERVER_Run(pszServerSocket, nJobs, main_ServeFile, NULL);
+        if (GLOB_ERROR_ALREADY_EXIST == eRetValue) {
+            printf("Can't run the server: %s exists, and it isn't the socket "
+                   "of a stopped server\n", pszServerSocket);
+        } else if (eRetValue) {
+            printf("Can't run the server on the socket: %s\n",
+                   pszServerSocket);
+        }
+        return eRetValue;
+    }
     
     /* Check for minimum number of arguments */
-    if (nArgc < MIN_NUMBER_OF_ARGUMENTS) {
-        printf("USAGE: %s <file1> <file2> ...\n", ppszArgv[0]);
+    if (nArgc - nFirstFile + 1 < MIN_NUMBER_OF_ARGUMENTS) {
+        printf("USAGE: %s [-j <jobs>] [--stats|--stats=json] "
+               "[--cache <dir>] [--packed] <file1> <file2> ...\n"
+               "       %s [-j <jobs>] --server <socket>\n",
+               ppszArgv[0], ppszArgv[0]);
         return GLOB_ERROR_INVALID_PARAMETERS;
     }
     
-    /* Start to compile the files */
-    for (int nIndex = 1; nIndex < nArgc; nIndex++) {
-        printf("Compiling %s...\n", ppszArgv[nIndex]);
-        
-        /* Reset the counters */
-        tCounters.nErrors = 0;
-        tCounters.nWarnings = 0;
-        
-        /* Compile the file */
-        eRetValue = ASM_Compile(ppszArgv[nIndex], main_ErrorOrWarningCallback,
-                                &tCounters, &hAsm);
-        if (GLOB_ERROR_PARSING_FAILED == eRetValue) {
-            /* We have one or more compilation errors*/
-            bSuccess = FALSE;
-            printf("FAILED - %d error(s), %d warning(s)\n",
-                    tCounters.nErrors, tCounters.nWarnings);
-            continue;
-        }
-        if (eRetValue) {
-            /* Fatal error during the compilation process */
-            return eRetValue;
-        }
-        
-        /* write the output files of the compilation */
-        eRetValue = OUTPUT_WriteFiles(ppszArgv[nIndex], hAsm);
+    /* Open the cache (unless the packed files are written) */
+    if (NULL != pszCacheDirectory && !bWritePacked) {
+        eRetValue = CACHE_Open(pszCacheDirectory, &hCache);
         if (eRetValue) {
-            ASM_Close(hAsm);
+            printf("Can't open the cache directory: %s\n", pszCacheDirectory);
             return eRetValue;
         }
-        
-        /* Close resources of this file */
-        ASM_Close(hAsm);
-        printf("SUCCESS - 0 error(s), %d warning(s)\n", tCounters.nWarnings);
     }
     
-    return bSuccess? GLOB_SUCCESS : GLOB_ERROR_PARSING_FAILED;
+    if (nJobs > 1) {
+        eRetValue = main_CompileFilesInParallel(ppszArgv + nFirstFile,
+                                                nArgc - nFirstFile, nJobs,
+                                                ptStats, hCache, bWritePacked);
+    } else {
+        eRetValue = main_CompileFiles(ppszArgv + nFirstFile,
+                                      nArgc - nFirstFile, ptStats, hCache,
+                                      bWritePacked);
+    }
+    CACHE_Close(hCache);
+    
+    /* Print the statistics, unless we had a fatal error */
+    if (NULL != ptStats && (GLOB_SUCCESS == eRetValue
+                            || GLOB_ERROR_PARSING_FAILED == eRetValue)) {
+        STATS_Print(stderr, ptStats, bIsJsonStats);
+    }
+    return eRetValue;
 }
-
@@ -2,10 +2,10 @@
  * File:    memstream.c
  * Author:  Doron Shvartztuch
  * The MEMSTREAM module provides memory stream functionality.
- * The basic unit of the stream is int.
+ * The basic unit of the stream is a 16-bit word.
  * 
  * Implementation:
- * The memory stream is based on dynamic allocated array of integers.
+ * The memory stream is based on dynamic allocated array of words.
  * We use realloc to expand the array when there is not enough space 
  *****************************************************************************/
 
@@ -18,12 +18,13 @@
 #include <string.h>
 #include "helper.h"
 #include "memstream.h"
+#include "stats.h"
 
 /******************************************************************************
  * CONSTANTS & MACROS
  *****************************************************************************/
 
-/* The default size(in int) of a stream */
+/* The default size(in words) of a stream */
 #define MEMSTREAM_DEFAULT_SIZE 4
 #define MEMSTREAM_EXPAND_FACTOR 2
 
@@ -34,8 +35,8 @@
 /* MEMSTREAM is the struct behind the the HMEMSTREAM.
  * It keeps some information about the stream */
 struct MEMSTREAM {
-    int * pnStream; /* Pointer to the dynamic allocated stream */
-    int nAllocated; /* Allocated words (int) */
+    uint16_t * pwStream; /* Pointer to the dynamic allocated stream */
+    int nAllocated; /* Allocated words */
     int nUsed; /* Used words (int) */
 };
 
@@ -64,7 +65,7 @@ static GLOB_ERROR memstream_EnsureSpace(HMEMSTREAM hStream, int nSpace);
  *****************************************************************************/
 static GLOB_ERROR memstream_EnsureSpace(HMEMSTREAM hStream, int nSpace) {
     int nNeedToAllocate = 0;
-    int * pnNewStream = NULL;
+    uint16_t * pwNewStream = NULL;
     
     /* Calc the size we need */
     nNeedToAllocate = nSpace - hStream->nAllocated + hStream->nUsed;
@@ -76,13 +77,15 @@ static GLOB_ERROR memstream_EnsureSpace(HMEMSTREAM hStream, int nSpace) {
                         hStream->nAllocated * (MEMSTREAM_EXPAND_FACTOR-1));
     
     /* Reallocate */
-    pnNewStream = realloc(hStream->pnStream,
-                    (hStream->nAllocated + nNeedToAllocate) * sizeof(int));
-    if (NULL == pnNewStream) {
+    STATS_CountAllocation(STATS_MODULE_MEMSTREAM,
+                (hStream->nAllocated + nNeedToAllocate) * sizeof(uint16_t));
+    pwNewStream = realloc(hStream->pwStream,
+                (hStream->nAllocated + nNeedToAllocate) * sizeof(uint16_t));
+    if (NULL == pwNewStream) {
         return GLOB_ERROR_SYS_CALL_ERROR();
     }
     hStream->nAllocated += nNeedToAllocate;
-    hStream->pnStream = pnNewStream;
+    hStream->pwStream = pwNewStream;
     return GLOB_SUCCESS;
 }
 /******************************************************************************
@@ -104,6 +107,7 @@ GLOB_ERROR MEMSTREAM_Create(PHMEMSTREAM phStream) {
     }
     
     /* Allocate the handle */
+    STATS_CountAllocation(STATS_MODULE_MEMSTREAM, sizeof(*hStream));
     hStream = malloc(sizeof(*hStream));
     if (NULL == hStream) {
         return GLOB_ERROR_SYS_CALL_ERROR();
@@ -112,7 +116,9 @@ GLOB_ERROR MEMSTREAM_Create(PHMEMSTREAM phStream) {
     hStream->nUsed = 0;
     
     /* Allocate the default stream */
-    hStream->pnStream = malloc(hStream->nAllocated * sizeof(int));
+    STATS_CountAllocation(STATS_MODULE_MEMSTREAM,
+                          hStream->nAllocated * sizeof(uint16_t));
+    hStream->pwStream = malloc(hStream->nAllocated * sizeof(uint16_t));
     if (NULL == hStream) {
         eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
         free(hStream);
@@ -124,29 +130,44 @@ GLOB_ERROR MEMSTREAM_Create(PHMEMSTREAM phStream) {
     return GLOB_SUCCESS;
 }
 
+/******************************************************************************
+ * Name:    MEMSTREAM_Reserve
+ *****************************************************************************/
+GLOB_ERROR MEMSTREAM_Reserve(HMEMSTREAM hStream, int nWords) {
+    /* Check parameters */
+    if (NULL == hStream || nWords < 0) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    return memstream_EnsureSpace(hStream, nWords);
+}
+
 /******************************************************************************
  * Name:    MEMSTREAM_AppendString
  *****************************************************************************/
 GLOB_ERROR MEMSTREAM_AppendString(HMEMSTREAM hStream, const char * pszStr) {
-    int nIndex = 0;
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    uint16_t * pwWords = NULL;
+    int nLength = 0;
     
     /* Check parameters */
     if (NULL == hStream || NULL == pszStr) {
         return GLOB_ERROR_INVALID_PARAMETERS;
     }
     
-    /* Note the '<='. we include the null terminator */
-    for (nIndex = 0; nIndex <= strlen(pszStr) ; nIndex++) {
-        int nCurrentCharAsNumber = 0;
-        nCurrentCharAsNumber = pszStr[nIndex];
-        /* We write each char from the string as a "number" so it takes
-         * the size of a word */
-        eRetValue = MEMSTREAM_AppendNumber(hStream, nCurrentCharAsNumber);
-        if (eRetValue) {
-            return eRetValue;
-        }
+    /* We need space for the string and its null terminator */
+    nLength = strlen(pszStr) + 1;
+    eRetValue = memstream_EnsureSpace(hStream, nLength);
+    if (eRetValue) {
+        return eRetValue;
     }
+    
+    /* We write each char from the string as a "number" so it takes
+     * a word */
+    pwWords = hStream->pwStream + hStream->nUsed;
+    for (int nIndex = 0; nIndex < nLength; nIndex++) {
+        pwWords[nIndex] = (uint16_t)pszStr[nIndex];
+    }
+    hStream->nUsed += nLength;
     return GLOB_SUCCESS;
 }
 
@@ -168,11 +189,53 @@ GLOB_ERROR MEMSTREAM_AppendNumber(HMEMSTREAM hStream, int nNumber) {
     }
     
     /* Write to the stream */
-    hStream->pnStream[hStream->nUsed] = nNumber;
+    hStream->pwStream[hStream->nUsed] = (uint16_t)nNumber;
     hStream->nUsed++;
     return GLOB_SUCCESS;
 }
 
+/******************************************************************************
+ * Name:    MEMSTREAM_AppendNumbers
+ *****************************************************************************/
+GLOB_ERROR MEMSTREAM_AppendNumbers(HMEMSTREAM hStream,
+                                   const int * anNumbers,
+                                   int nCount) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    uint16_t * pwWords = NULL;
+    
+    /* Check parameters */
+    if (NULL == hStream || NULL == anNumbers || nCount < 0) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* We need space for all the numbers */
+    eRetValue = memstream_EnsureSpace(hStream, nCount);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* Write to the stream */
+    pwWords = hStream->pwStream + hStream->nUsed;
+    for (int nIndex = 0; nIndex < nCount; nIndex++) {
+        pwWords[nIndex] = (uint16_t)anNumbers[nIndex];
+    }
+    hStream->nUsed += nCount;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    MEMSTREAM_SetNumber
+ *****************************************************************************/
+GLOB_ERROR MEMSTREAM_SetNumber(HMEMSTREAM hStream, int nIndex, int nNumber) {
+    /* Check parameters */
+    if (NULL == hStream || nIndex < 0 || nIndex >= hStream->nUsed) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    hStream->pwStream[nIndex] = (uint16_t)nNumber;
+    return GLOB_SUCCESS;
+}
+
 /******************************************************************************
  * Name:    MEMSTREAM_Concat
  *****************************************************************************/
@@ -185,9 +248,9 @@ GLOB_ERROR MEMSTREAM_Concat(HMEMSTREAM hStream1, HMEMSTREAM hStream2) {
     if (eRetValue) {
         return eRetValue;
     }
-    memcpy(hStream1->pnStream + hStream1->nUsed,
-           hStream2->pnStream,
-           hStream2->nUsed * sizeof(int));
+    memcpy(hStream1->pwStream + hStream1->nUsed,
+           hStream2->pwStream,
+           hStream2->nUsed * sizeof(uint16_t));
     hStream1->nUsed += hStream2->nUsed;
     return GLOB_SUCCESS;
 }
@@ -196,11 +259,11 @@ GLOB_ERROR MEMSTREAM_Concat(HMEMSTREAM hStream1, HMEMSTREAM hStream2) {
  * Name:    MEMSTREAM_GetStream
  *****************************************************************************/
 GLOB_ERROR MEMSTREAM_GetStream(HMEMSTREAM hStream,
-                               int ** ppnStream, int * pnStreamLength) {
+                               uint16_t ** ppwStream, int * pnStreamLength) {
     if (NULL == hStream) {
         return GLOB_ERROR_INVALID_PARAMETERS;
     }
-    *ppnStream = hStream->pnStream;
+    *ppwStream = hStream->pwStream;
     *pnStreamLength = hStream->nUsed;
     return GLOB_SUCCESS;
 }
@@ -210,7 +273,7 @@ GLOB_ERROR MEMSTREAM_GetStream(HMEMSTREAM hStream,
  *****************************************************************************/
 void MEMSTREAM_Free(HMEMSTREAM hStream) {
     if (NULL != hStream) {
-        free(hStream->pnStream);
+        free(hStream->pwStream);
         free(hStream);
     }
 }
@@ -2,7 +2,9 @@
  * File:    memstream.h
  * Author:  Doron Shvartztuch
  * The MEMSTREAM module provides memory stream functionality.
- * The basic unit of the stream is int.
+ * The basic unit of the stream is a 16-bit word (uint16_t). It is enough for
+ * the words of the machine, so numbers are written by their 16 less
+ * significant bits.
  *****************************************************************************/
 
 #ifndef MEMSTREAM_H
@@ -11,6 +13,7 @@
 /******************************************************************************
  * INCLUDES
  *****************************************************************************/
+#include <stdint.h>
 #include "global.h"
 
 /******************************************************************************
@@ -36,6 +39,19 @@ typedef struct MEMSTREAM MEMSTREAM, *HMEMSTREAM, **PHMEMSTREAM;
  *****************************************************************************/
 GLOB_ERROR MEMSTREAM_Create(PHMEMSTREAM phStream);
 
+/******************************************************************************
+ * Name:    MEMSTREAM_Reserve
+ * Purpose: Allocate space for the next words of the stream, so appending them
+ *          doesn't reallocate the stream
+ * Parameters:
+ *          hStream [IN] - the handle to the stream
+ *          nWords [IN] - the number of words to allocate space for
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR MEMSTREAM_Reserve(HMEMSTREAM hStream, int nWords);
+
 /******************************************************************************
  * Name:    MEMSTREAM_AppendString
  * Purpose: Write a string to the stream 
@@ -46,7 +62,7 @@ GLOB_ERROR MEMSTREAM_Create(PHMEMSTREAM phStream);
  *          Upon successful completion, GLOB_SUCCESS is returned.
  *          If the function fails, an error code is returned.
  * Remark:  The function also write the NULL-terminator to the stream.
- *          Each character takes the size of an integer in the stream.
+ *          Each character takes a word in the stream.
  *****************************************************************************/
 GLOB_ERROR MEMSTREAM_AppendString(HMEMSTREAM hStream, const char * pszStr);
 
@@ -62,6 +78,34 @@ GLOB_ERROR MEMSTREAM_AppendString(HMEMSTREAM hStream, const char * pszStr);
  *****************************************************************************/
 GLOB_ERROR MEMSTREAM_AppendNumber(HMEMSTREAM hStream, int nNumber);
 
+/******************************************************************************
+ * Name:    MEMSTREAM_AppendNumbers
+ * Purpose: Write an array of numbers to the stream
+ * Parameters:
+ *          hStream [IN] - the handle to the stream
+ *          anNumbers [IN] - the numbers to write into the stream
+ *          nCount [IN] - the number of elements in anNumbers
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR MEMSTREAM_AppendNumbers(HMEMSTREAM hStream,
+                                   const int * anNumbers,
+                                   int nCount);
+
+/******************************************************************************
+ * Name:    MEMSTREAM_SetNumber
+ * Purpose: Overwrite a word that was already written to the stream
+ * Parameters:
+ *          hStream [IN] - the handle to the stream
+ *          nIndex [IN] - zero-based index (in words) of the word to overwrite
+ *          nNumber [IN] - the number to write into the stream
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR MEMSTREAM_SetNumber(HMEMSTREAM hStream, int nIndex, int nNumber);
+
 /******************************************************************************
  * Name:    MEMSTREAM_Concat
  * Purpose: Concat the content of the second stream to the first one
@@ -79,8 +123,8 @@ GLOB_ERROR MEMSTREAM_Concat(HMEMSTREAM hStream1, HMEMSTREAM hStream2);
  * Purpose: get a pointer to the memory block itself
  * Parameters:
  *          hStream [IN] - the handle to the stream.
- *          ppnStream [OUT] - pointer to the beginning of the memory block
- *          pnStreamLength [OUT] - size (in 'int') of the memory block
+ *          ppwStream [OUT] - pointer to the beginning of the memory block
+ *          pnStreamLength [OUT] - size (in words) of the memory block
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
  *          If the function fails, an error code is returned.
@@ -90,7 +134,7 @@ GLOB_ERROR MEMSTREAM_Concat(HMEMSTREAM hStream1, HMEMSTREAM hStream2);
  *          of the module.
  *****************************************************************************/
 GLOB_ERROR MEMSTREAM_GetStream(HMEMSTREAM hStream,
-                               int ** ppnStream,
+                               uint16_t ** ppwStream,
                                int * pnStreamLength);
 
 /******************************************************************************
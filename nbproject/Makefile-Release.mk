@@ -35,15 +35,24 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 
 # Object Files
 OBJECTFILES= \
+	${OBJECTDIR}/arena.o \
 	${OBJECTDIR}/asm.o \
 	${OBJECTDIR}/buffer.o \
+	${OBJECTDIR}/cache.o \
 	${OBJECTDIR}/helper.o \
+	${OBJECTDIR}/intern.o \
 	${OBJECTDIR}/lex.o \
 	${OBJECTDIR}/linestr.o \
+	${OBJECTDIR}/linker.o \
+	${OBJECTDIR}/machine.o \
 	${OBJECTDIR}/main.o \
 	${OBJECTDIR}/memstream.o \
 	${OBJECTDIR}/output.o \
-	${OBJECTDIR}/symtable.o
+	${OBJECTDIR}/packed.o \
+	${OBJECTDIR}/server.o \
+	${OBJECTDIR}/stats.o \
+	${OBJECTDIR}/symtable.o \
+	${OBJECTDIR}/writer.o
 
 
 # C Compiler Flags
@@ -60,7 +69,7 @@ FFLAGS=
 ASFLAGS=
 
 # Link Libraries and Options
-LDLIBSOPTIONS=
+LDLIBSOPTIONS=-lpthread
 
 # Build Targets
 .build-conf: ${BUILD_SUBPROJECTS}
@@ -70,6 +79,11 @@ ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/asm: ${OBJECTFILES}
 	${MKDIR} -p ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}
 	${LINK.c} -o ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/asm ${OBJECTFILES} ${LDLIBSOPTIONS}
 
+${OBJECTDIR}/arena.o: arena.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/arena.o arena.c
+
 ${OBJECTDIR}/asm.o: asm.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -80,11 +94,21 @@ ${OBJECTDIR}/buffer.o: buffer.c
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/buffer.o buffer.c
 
+${OBJECTDIR}/cache.o: cache.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/cache.o cache.c
+
 ${OBJECTDIR}/helper.o: helper.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/helper.o helper.c
 
+${OBJECTDIR}/intern.o: intern.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/intern.o intern.c
+
 ${OBJECTDIR}/lex.o: lex.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -95,6 +119,16 @@ ${OBJECTDIR}/linestr.o: linestr.c
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/linestr.o linestr.c
 
+${OBJECTDIR}/linker.o: linker.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/linker.o linker.c
+
+${OBJECTDIR}/machine.o: machine.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/machine.o machine.c
+
 ${OBJECTDIR}/main.o: main.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -110,11 +144,31 @@ ${OBJECTDIR}/output.o: output.c
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/output.o output.c
 
+${OBJECTDIR}/packed.o: packed.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/packed.o packed.c
+
+${OBJECTDIR}/server.o: server.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/server.o server.c
+
+${OBJECTDIR}/stats.o: stats.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/stats.o stats.c
+
 ${OBJECTDIR}/symtable.o: symtable.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/symtable.o symtable.c
 
+${OBJECTDIR}/writer.o: writer.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -Wall -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/writer.o writer.c
+
 # Subprojects
 .build-subprojects:
 
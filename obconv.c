@@ -0,0 +1,226 @@
+/*****************************************************************************
+ * File:    obconv.c
+ * Author:  Doron Shvartztuch
+ * The converter of the packed object files (see PACKED) back to the textual
+ * output files (object, externals, entries), for the tools that read only
+ * the text.
+ *
+ * Implementation:
+ * The packed file is read to the memory and parsed. The object file is
+ * formatted by the OUTPUT module, like the assembler does, and the
+ * entries & externals files are built from the records. The files are the
+ * same files the assembler writes for the source.
+ * The converter has its own main, so it is built by the "obconv" target of
+ * the Makefile and not by the configurations.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include "global.h"
+#include "buffer.h"
+#include "output.h"
+#include "packed.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The command line should include at least 2 arguments (the program name and
+ * a file to convert. */
+#define MIN_NUMBER_OF_ARGUMENTS 2
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static GLOB_ERROR obconv_FormatTable(const PACKED_SYMBOL * patSymbols,
+                                     int nSymbols,
+                                     HBUFFER hStream);
+static GLOB_ERROR obconv_ConvertObject(const char * pszFileName,
+                                       const PACKED_OBJECT * ptObject);
+static GLOB_ERROR obconv_ConvertFile(const char * pszFileName);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    obconv_FormatTable
+ * Purpose: Format the records of a table as the lines of the entries or
+ *          externals file
+ * Parameters:
+ *          patSymbols [IN] - the records
+ *          nSymbols [IN] - number of records
+ *          hStream [IN] - the buffer of the file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR obconv_FormatTable(const PACKED_SYMBOL * patSymbols,
+                                     int nSymbols,
+                                     HBUFFER hStream) {
+    GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    
+    for (int nIndex = 0; GLOB_SUCCESS == eRetValue && nIndex < nSymbols;
+         nIndex++) {
+        eRetValue = BUFFER_AppendString(hStream, patSymbols[nIndex].pcName,
+                                        patSymbols[nIndex].nNameLength);
+        if (GLOB_SUCCESS == eRetValue) {
+            eRetValue = BUFFER_AppendChar(hStream, '\t');
+        }
+        if (GLOB_SUCCESS == eRetValue) {
+            eRetValue = BUFFER_AppendInt(hStream, patSymbols[nIndex].nAddress);
+        }
+        if (GLOB_SUCCESS == eRetValue) {
+            eRetValue = BUFFER_AppendChar(hStream, '\n');
+        }
+    }
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    obconv_ConvertObject
+ * Purpose: Write the textual output files of a parsed packed object file
+ * Parameters:
+ *          pszFileName [IN] - the file name (w/o extension)
+ *          ptObject [IN] - the content of the packed file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR obconv_ConvertObject(const char * pszFileName,
+                                       const PACKED_OBJECT * ptObject) {
+    OUTPUT_FILES tFiles = {0};
+    HBUFFER hEntries = NULL;
+    HBUFFER hExternals = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Format the object file */
+    eRetValue = OUTPUT_FormatObject(ptObject->pwCode, ptObject->nCodeLength,
+                                    ptObject->pwData, ptObject->nDataLength,
+                                    &tFiles.pcObject, &tFiles.nObjectLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* Format the entries & externals files */
+    eRetValue = BUFFER_Create(&hEntries);
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = BUFFER_Create(&hExternals);
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = obconv_FormatTable(ptObject->patEntries,
+                                       ptObject->nEntries, hEntries);
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = obconv_FormatTable(ptObject->patExternals,
+                                       ptObject->nExternals, hExternals);
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = BUFFER_GetStream(hEntries, &tFiles.pcEntries,
+                                     &tFiles.nEntriesLength);
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = BUFFER_GetStream(hExternals, &tFiles.pcExternals,
+                                     &tFiles.nExternalsLength);
+    }
+    
+    /* Write the files */
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = OUTPUT_WriteContent(pszFileName, &tFiles);
+    }
+    
+    /* Free resources */
+    if (NULL != hExternals) {
+        BUFFER_Free(hExternals);
+    }
+    if (NULL != hEntries) {
+        BUFFER_Free(hEntries);
+    }
+    OUTPUT_FreeFiles(&tFiles);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    obconv_ConvertFile
+ * Purpose: Convert a packed object file to the textual output files
+ * Parameters:
+ *          pszFileName [IN] - the file name (w/o extension)
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the file is not a valid packed
+ *                                          object file
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR obconv_ConvertFile(const char * pszFileName) {
+    char * pszFullFileName = NULL;
+    char * pcBuffer = NULL;
+    size_t nBufferLength = 0;
+    PACKED_OBJECT tObject;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Read the packed file */
+    pszFullFileName = HELPER_ConcatStrings(pszFileName,
+                                           GLOB_FILE_EXTENSION_PACKED);
+    if (NULL == pszFullFileName) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    pcBuffer = HELPER_ReadFile(pszFullFileName, &nBufferLength);
+    free(pszFullFileName);
+    if (NULL == pcBuffer) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Parse it and write the textual files */
+    eRetValue = PACKED_Parse(pcBuffer, nBufferLength, &tObject);
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = obconv_ConvertObject(pszFileName, &tObject);
+        PACKED_Free(&tObject);
+    }
+    free(pcBuffer);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    main
+ * Purpose: convert the packed object files (as passed in the command line
+ *          parameters) to the textual output files
+ * Command Line:
+ *          obconv <file1> <file2> ...
+ *          The files are given w/o the extension (like the assembler).
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS (0) is returned.
+ *          Otherwise, the error of the last file that failed is returned.
+ *****************************************************************************/
+int main(int nArgc, const char * ppszArgv[]) {
+    GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    GLOB_ERROR eFileRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check for minimum number of arguments */
+    if (nArgc < MIN_NUMBER_OF_ARGUMENTS) {
+        printf("USAGE: %s <file1> <file2> ...\n", ppszArgv[0]);
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    for (int nIndex = 1; nIndex < nArgc; nIndex++) {
+        eFileRetValue = obconv_ConvertFile(ppszArgv[nIndex]);
+        if (GLOB_ERROR_INVALID_PARAMETERS == eFileRetValue) {
+            printf("%s%s: not a valid packed object file\n",
+                   ppszArgv[nIndex], GLOB_FILE_EXTENSION_PACKED);
+            eRetValue = eFileRetValue;
+        } else if (eFileRetValue) {
+            printf("Can't convert %s\n", ppszArgv[nIndex]);
+            eRetValue = eFileRetValue;
+        }
+    }
+    return eRetValue;
+}
@@ -0,0 +1,642 @@
+/*****************************************************************************
+ * File:    obdis.c
+ * Author:  Doron Shvartztuch
+ * The disassembler of the object files. It prints the instructions of the
+ * code section and the words of the data section, with the names of the
+ * entries (from the entries file) as labels and as the operands that point
+ * to them, and the names of the externals (from the externals file) where
+ * they are used.
+ *
+ * Implementation:
+ * The first word of an instruction has 14 bits, so all its fields are
+ * decoded once, to a table of the formats of all the possible first words
+ * (see obdis_BuildFormats): the opcode, the length of the instruction, and
+ * the kind, the word and the text before each operand. An invalid first
+ * word has a length of 0 and is printed as data. Disassembling is then a
+ * lookup per instruction and a lookup per operand.
+ * The names of the symbols are kept in arrays indexed by the address. The
+ * lines are formatted to a fixed buffer that is written to the stdout when
+ * it is full, so the output is streamed and not kept in the memory.
+ * The disassembler has its own main, so it is built by the "disasm" target
+ * of the Makefile and not by the configurations.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+#include "helper.h"
+#include "output.h"
+#include "asm.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The command line should include at least 2 arguments (the program name and
+ * a file to disassemble. */
+#define MIN_NUMBER_OF_ARGUMENTS 2
+
+/* The number of the possible first words (14 bits) */
+#define OBDIS_WORDS (1 << 14)
+
+/* The maximum number of operands: "jmp L(p1,p2)" */
+#define OBDIS_MAX_OPERANDS 3
+
+/* The size (in chars) of the output buffer, and the maximum length of a
+ * line: the address, the label, the opcode and the operands. The names are
+ * cut to OBDIS_MAX_NAME_LENGTH chars, so a line always fits. */
+#define OBDIS_OUTPUT_SIZE 65536
+#define OBDIS_MAX_LINE_LENGTH 1024
+#define OBDIS_MAX_NAME_LENGTH 200
+
+/* The minimum number of digits of an address (like the object file) */
+#define OBDIS_ADDRESS_DIGITS 4
+
+/* The maximum number of digits of an int */
+#define OBDIS_MAX_INT_DIGITS 10
+
+/* The value of a data word */
+#define OBDIS_TO_SIGNED(wWord) (((int)(wWord) ^ 0x2000) - 0x2000)
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The kinds of the operands */
+typedef enum OBDIS_OPERAND {
+    OBDIS_OPERAND_IMMEDIATE,
+    OBDIS_OPERAND_ADDRESS,
+    OBDIS_OPERAND_SOURCE_REGISTER,
+    OBDIS_OPERAND_DEST_REGISTER,
+} OBDIS_OPERAND;
+
+/* The format of a first word */
+typedef struct OBDIS_FORMAT {
+    /* The length (in words) of the instruction. 0 if it is not a valid
+     * first word. */
+    int nLength;
+    
+    /* The opcode */
+    const char * pszOpcode;
+    
+    /* The operands: the kind, the word (from the first word) and the text
+     * before each one, and the text after the last one */
+    int nOperands;
+    OBDIS_OPERAND aeKinds[OBDIS_MAX_OPERANDS];
+    int anWords[OBDIS_MAX_OPERANDS];
+    const char * apszPrefixes[OBDIS_MAX_OPERANDS];
+    const char * pszSuffix;
+} OBDIS_FORMAT, *POBDIS_FORMAT;
+
+/* The disassembled file */
+typedef struct OBDIS_FILE {
+    /* The words of the code section and then the data section */
+    const uint16_t * pwWords;
+    int nCodeLength;
+    int nDataLength;
+    
+    /* The entry and the used extern of each address (NULL if none) */
+    const PACKED_SYMBOL ** pptEntries;
+    const PACKED_SYMBOL ** pptExternals;
+    
+    /* The output buffer */
+    char acOutput[OBDIS_OUTPUT_SIZE];
+    int nOutputLength;
+} OBDIS_FILE, *POBDIS_FILE;
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static void obdis_AddOperand(POBDIS_FORMAT ptFormat,
+                             OBDIS_OPERAND eKind,
+                             int nWord,
+                             const char * pszPrefix);
+static OBDIS_OPERAND obdis_GetKind(int nMethod, BOOL bIsSource);
+static void obdis_BuildFormat(uint16_t wWord, POBDIS_FORMAT ptFormat);
+static void obdis_BuildFormats(void);
+static GLOB_ERROR obdis_Flush(POBDIS_FILE ptFile);
+static void obdis_WriteString(POBDIS_FILE ptFile,
+                              const char * pcString,
+                              int nLength);
+static void obdis_WriteNumber(POBDIS_FILE ptFile,
+                              int nNumber,
+                              int nMinDigits);
+static void obdis_WriteAddress(POBDIS_FILE ptFile,
+                               int nAddress,
+                               uint16_t wWord);
+static int obdis_WriteInstruction(POBDIS_FILE ptFile, int nIndex);
+static GLOB_ERROR obdis_Disassemble(POBDIS_FILE ptFile);
+static GLOB_ERROR obdis_IndexSymbols(const PACKED_SYMBOL * patSymbols,
+                                     int nSymbols,
+                                     int nWords,
+                                     const PACKED_SYMBOL *** ppptIndex);
+static GLOB_ERROR obdis_DisassembleFile(const char * pszFileName);
+
+/******************************************************************************
+ * GLOBALS
+ *****************************************************************************/
+
+/* The format of each first word (see obdis_BuildFormats) */
+static OBDIS_FORMAT g_atFormats[OBDIS_WORDS];
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    obdis_AddOperand
+ * Purpose: Add an operand to a format
+ * Parameters:
+ *          ptFormat [IN OUT] - the format
+ *          eKind [IN] - the kind of the operand
+ *          nWord [IN] - the word of the operand (from the first word)
+ *          pszPrefix [IN] - the text before the operand
+ *****************************************************************************/
+static void obdis_AddOperand(POBDIS_FORMAT ptFormat,
+                             OBDIS_OPERAND eKind,
+                             int nWord,
+                             const char * pszPrefix) {
+    ptFormat->aeKinds[ptFormat->nOperands] = eKind;
+    ptFormat->anWords[ptFormat->nOperands] = nWord;
+    ptFormat->apszPrefixes[ptFormat->nOperands] = pszPrefix;
+    ptFormat->nOperands++;
+}
+
+/******************************************************************************
+ * Name:    obdis_GetKind
+ * Purpose: Get the kind of an operand by its method
+ * Parameters:
+ *          nMethod [IN] - the method (not the parameters method)
+ *          bIsSource [IN] - whether the register is kept in the bits of the
+ *                           source register
+ * Return Value:
+ *          The kind of the operand
+ *****************************************************************************/
+static OBDIS_OPERAND obdis_GetKind(int nMethod, BOOL bIsSource) {
+    if (ASM_OPERAND_METHOD_IMMEDIATE == nMethod) {
+        return OBDIS_OPERAND_IMMEDIATE;
+    }
+    if (ASM_OPERAND_METHOD_DIRECT == nMethod) {
+        return OBDIS_OPERAND_ADDRESS;
+    }
+    return bIsSource ? OBDIS_OPERAND_SOURCE_REGISTER
+                     : OBDIS_OPERAND_DEST_REGISTER;
+}
+
+/******************************************************************************
+ * Name:    obdis_BuildFormat
+ * Purpose: Decode a first word to its format
+ * Parameters:
+ *          wWord [IN] - the first word
+ *          ptFormat [OUT] - the format (with a length of 0 if the word is
+ *                           not a valid first word)
+ * Remark:  The operand words are laid out as the ASM module writes them:
+ *          two register operands share one word, and a jump with parameters
+ *          has the label and then the parameters.
+ *****************************************************************************/
+static void obdis_BuildFormat(uint16_t wWord, POBDIS_FORMAT ptFormat) {
+    int nOpcode = ASM_GET_OPCODE(wWord);
+    int nSource = ASM_GET_SOURCE_METHOD(wWord);
+    int nDest = ASM_GET_DEST_METHOD(wWord);
+    int nParam1 = ASM_GET_PARAM1(wWord);
+    int nParam2 = ASM_GET_PARAM2(wWord);
+    int nSourceMask = ASM_GET_ALLOWED_SOURCE_OPERAND(nOpcode);
+    int nDestMask = ASM_GET_ALLOWED_DESTINATION_OPERAND(nOpcode);
+    BOOL bHasParams = (0 != nDestMask
+                       && ASM_OPERAND_METHOD_PARAMETERS == nDest);
+    int nWord = 1;
+    
+    memset(ptFormat, 0, sizeof(*ptFormat));
+    
+    /* Check that the word could be written by the assembler */
+    if (ASM_ARE_ABSOLUTE != ASM_GET_ARE(wWord)
+        || (0 == nSourceMask && 0 != nSource)
+        || (0 != nSourceMask && !ASM_IS_METHOD_ALLOWED(nSourceMask, nSource))
+        || (0 == nDestMask && 0 != nDest)
+        || (0 != nDestMask && !ASM_IS_METHOD_ALLOWED(nDestMask, nDest))
+        || (!bHasParams && (0 != nParam1 || 0 != nParam2))
+        || (bHasParams
+            && (!ASM_IS_METHOD_ALLOWED(ASM_ALLOWED_OPERANDS_AS_PARAM, nParam1)
+                || !ASM_IS_METHOD_ALLOWED(ASM_ALLOWED_OPERANDS_AS_PARAM,
+                                          nParam2)))) {
+        return;
+    }
+    ptFormat->pszOpcode = g_aszOpcodeNames[nOpcode];
+    ptFormat->pszSuffix = "";
+    
+    /* The source operand. Two register operands share one word. */
+    if (0 != nSourceMask) {
+        obdis_AddOperand(ptFormat, obdis_GetKind(nSource, TRUE), nWord, " ");
+        if (ASM_OPERAND_METHOD_REGISTER != nSource
+            || ASM_OPERAND_METHOD_REGISTER != nDest) {
+            nWord++;
+        }
+    }
+    
+    /* The destination operand */
+    if (bHasParams) {
+        obdis_AddOperand(ptFormat, OBDIS_OPERAND_ADDRESS, nWord, " ");
+        nWord++;
+        obdis_AddOperand(ptFormat, obdis_GetKind(nParam1, TRUE), nWord, "(");
+        if (ASM_OPERAND_METHOD_REGISTER != nParam1
+            || ASM_OPERAND_METHOD_REGISTER != nParam2) {
+            nWord++;
+        }
+        obdis_AddOperand(ptFormat, obdis_GetKind(nParam2, FALSE), nWord, ",");
+        nWord++;
+        ptFormat->pszSuffix = ")";
+    } else if (0 != nDestMask) {
+        obdis_AddOperand(ptFormat, obdis_GetKind(nDest, FALSE), nWord,
+                         (0 != nSourceMask) ? ", " : " ");
+        nWord++;
+    }
+    ptFormat->nLength = nWord;
+}
+
+/******************************************************************************
+ * Name:    obdis_BuildFormats
+ * Purpose: Build the table of the formats of all the possible first words
+ *****************************************************************************/
+static void obdis_BuildFormats(void) {
+    for (int nWord = 0; nWord < OBDIS_WORDS; nWord++) {
+        obdis_BuildFormat((uint16_t)nWord, &g_atFormats[nWord]);
+    }
+}
+
+/******************************************************************************
+ * Name:    obdis_Flush
+ * Purpose: Write the output buffer to the stdout
+ * Parameters:
+ *          ptFile [IN] - the disassembled file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR obdis_Flush(POBDIS_FILE ptFile) {
+    if (ptFile->nOutputLength != fwrite(ptFile->acOutput, 1,
+                                        ptFile->nOutputLength, stdout)) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    ptFile->nOutputLength = 0;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    obdis_WriteString
+ * Purpose: Add a string to the output buffer
+ * Parameters:
+ *          ptFile [IN] - the disassembled file
+ *          pcString [IN] - the string (not null-terminated)
+ *          nLength [IN] - the length (in chars) of the string
+ * Remark:  The caller makes sure there is space for a line in the buffer.
+ *****************************************************************************/
+static void obdis_WriteString(POBDIS_FILE ptFile,
+                              const char * pcString,
+                              int nLength) {
+    memcpy(ptFile->acOutput + ptFile->nOutputLength, pcString, nLength);
+    ptFile->nOutputLength += nLength;
+}
+
+/******************************************************************************
+ * Name:    obdis_WriteNumber
+ * Purpose: Add a decimal number to the output buffer
+ * Parameters:
+ *          ptFile [IN] - the disassembled file
+ *          nNumber [IN] - the number
+ *          nMinDigits [IN] - the minimum number of digits (with leading
+ *                            zeros)
+ *****************************************************************************/
+static void obdis_WriteNumber(POBDIS_FILE ptFile,
+                              int nNumber,
+                              int nMinDigits) {
+    char acDigits[OBDIS_MAX_INT_DIGITS];
+    unsigned int nValue = (nNumber < 0) ? -(unsigned int)nNumber : nNumber;
+    int nDigits = 0;
+    
+    if (nNumber < 0) {
+        ptFile->acOutput[ptFile->nOutputLength++] = '-';
+    }
+    
+    /* Get the digits, from the least significant one */
+    do {
+        acDigits[nDigits] = '0' + nValue % 10;
+        nValue /= 10;
+        nDigits++;
+    } while (0 != nValue);
+    while (nDigits < nMinDigits) {
+        acDigits[nDigits] = '0';
+        nDigits++;
+    }
+    
+    /* Copy the digits in the right order */
+    while (nDigits > 0) {
+        nDigits--;
+        ptFile->acOutput[ptFile->nOutputLength++] = acDigits[nDigits];
+    }
+}
+
+/******************************************************************************
+ * Name:    obdis_WriteAddress
+ * Purpose: Add an address operand to the output buffer: the name of the
+ *          extern or of the entry, or the address
+ * Parameters:
+ *          ptFile [IN] - the disassembled file
+ *          nAddress [IN] - the address of the operand word
+ *          wWord [IN] - the operand word
+ *****************************************************************************/
+static void obdis_WriteAddress(POBDIS_FILE ptFile,
+                               int nAddress,
+                               uint16_t wWord) {
+    const PACKED_SYMBOL * ptSymbol = NULL;
+    int nTarget = ASM_GET_ADDRESS(wWord) - CODE_STARTUP_ADDRESS;
+    
+    if (ASM_ARE_EXTERNAL == ASM_GET_ARE(wWord)) {
+        ptSymbol = ptFile->pptExternals[nAddress - CODE_STARTUP_ADDRESS];
+    } else if (0 <= nTarget
+               && nTarget < ptFile->nCodeLength + ptFile->nDataLength) {
+        ptSymbol = ptFile->pptEntries[nTarget];
+    }
+    
+    if (NULL != ptSymbol) {
+        obdis_WriteString(ptFile, ptSymbol->pcName,
+                          MIN(ptSymbol->nNameLength, OBDIS_MAX_NAME_LENGTH));
+    } else if (ASM_ARE_EXTERNAL == ASM_GET_ARE(wWord)) {
+        obdis_WriteString(ptFile, "?", 1);
+    } else {
+        obdis_WriteNumber(ptFile, ASM_GET_ADDRESS(wWord), 0);
+    }
+}
+
+/******************************************************************************
+ * Name:    obdis_WriteInstruction
+ * Purpose: Add the text of an instruction to the output buffer
+ * Parameters:
+ *          ptFile [IN] - the disassembled file
+ *          nIndex [IN] - the index of the first word
+ * Return Value:
+ *          The length (in words) of the instruction, or 0 if the word is
+ *          not an instruction (nothing is added)
+ *****************************************************************************/
+static int obdis_WriteInstruction(POBDIS_FILE ptFile, int nIndex) {
+    const OBDIS_FORMAT * ptFormat = &g_atFormats[ptFile->pwWords[nIndex]];
+    uint16_t wWord = 0;
+    int nAddress = 0;
+    
+    /* The instruction must be in the code section */
+    if (0 == ptFormat->nLength
+        || nIndex + ptFormat->nLength > ptFile->nCodeLength) {
+        return 0;
+    }
+    
+    obdis_WriteString(ptFile, ptFormat->pszOpcode,
+                      strlen(ptFormat->pszOpcode));
+    for (int nOperand = 0; nOperand < ptFormat->nOperands; nOperand++) {
+        obdis_WriteString(ptFile, ptFormat->apszPrefixes[nOperand],
+                          strlen(ptFormat->apszPrefixes[nOperand]));
+        wWord = ptFile->pwWords[nIndex + ptFormat->anWords[nOperand]];
+        nAddress = CODE_STARTUP_ADDRESS + nIndex + ptFormat->anWords[nOperand];
+        switch (ptFormat->aeKinds[nOperand]) {
+            case OBDIS_OPERAND_IMMEDIATE:
+                obdis_WriteString(ptFile, "#", 1);
+                obdis_WriteNumber(ptFile, ASM_GET_IMMEDIATE_VALUE(wWord), 0);
+                break;
+            case OBDIS_OPERAND_ADDRESS:
+                obdis_WriteAddress(ptFile, nAddress, wWord);
+                break;
+            case OBDIS_OPERAND_SOURCE_REGISTER:
+                obdis_WriteString(ptFile, "r", 1);
+                obdis_WriteNumber(ptFile, ASM_GET_SOURCE_REGISTER(wWord), 0);
+                break;
+            case OBDIS_OPERAND_DEST_REGISTER:
+                obdis_WriteString(ptFile, "r", 1);
+                obdis_WriteNumber(ptFile, ASM_GET_DEST_REGISTER(wWord), 0);
+                break;
+        }
+    }
+    obdis_WriteString(ptFile, ptFormat->pszSuffix,
+                      strlen(ptFormat->pszSuffix));
+    return ptFormat->nLength;
+}
+
+/******************************************************************************
+ * Name:    obdis_Disassemble
+ * Purpose: Print the lines of the file: the address, the label and the
+ *          instruction (or the data word)
+ * Parameters:
+ *          ptFile [IN] - the disassembled file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR obdis_Disassemble(POBDIS_FILE ptFile) {
+    const PACKED_SYMBOL * ptEntry = NULL;
+    int nWords = ptFile->nCodeLength + ptFile->nDataLength;
+    int nLength = 0;
+    GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    
+    for (int nIndex = 0; GLOB_SUCCESS == eRetValue && nIndex < nWords;
+         nIndex += nLength) {
+        /* The address and the label */
+        obdis_WriteNumber(ptFile, CODE_STARTUP_ADDRESS + nIndex,
+                          OBDIS_ADDRESS_DIGITS);
+        obdis_WriteString(ptFile, "\t", 1);
+        ptEntry = ptFile->pptEntries[nIndex];
+        if (NULL != ptEntry) {
+            obdis_WriteString(ptFile, ptEntry->pcName,
+                              MIN(ptEntry->nNameLength,
+                                  OBDIS_MAX_NAME_LENGTH));
+            obdis_WriteString(ptFile, ": ", 2);
+        }
+        
+        /* The instruction, or a data word */
+        nLength = obdis_WriteInstruction(ptFile, nIndex);
+        if (0 == nLength) {
+            obdis_WriteString(ptFile, ".data ", 6);
+            obdis_WriteNumber(ptFile,
+                              OBDIS_TO_SIGNED(ptFile->pwWords[nIndex]), 0);
+            nLength = 1;
+        }
+        obdis_WriteString(ptFile, "\n", 1);
+        
+        /* Write the buffer before it can't keep another line */
+        if (ptFile->nOutputLength > OBDIS_OUTPUT_SIZE - OBDIS_MAX_LINE_LENGTH) {
+            eRetValue = obdis_Flush(ptFile);
+        }
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = obdis_Flush(ptFile);
+    }
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    obdis_IndexSymbols
+ * Purpose: Build the array of the symbol of each address
+ * Parameters:
+ *          patSymbols [IN] - the records of the entries or externals file
+ *          nSymbols [IN] - number of records
+ *          nWords [IN] - size (in words) of the sections
+ *          ppptIndex [OUT] - the symbol of each address (from
+ *                            CODE_STARTUP_ADDRESS), or NULL
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the array.
+ *          If the function fails, an error code is returned.
+ * Remark:  Records with addresses out of the sections are ignored.
+ *****************************************************************************/
+static GLOB_ERROR obdis_IndexSymbols(const PACKED_SYMBOL * patSymbols,
+                                     int nSymbols,
+                                     int nWords,
+                                     const PACKED_SYMBOL *** ppptIndex) {
+    const PACKED_SYMBOL ** pptIndex = NULL;
+    int nIndex = 0;
+    
+    pptIndex = calloc((size_t)nWords + 1, sizeof(*pptIndex));
+    if (NULL == pptIndex) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    for (int nSymbol = 0; nSymbol < nSymbols; nSymbol++) {
+        nIndex = patSymbols[nSymbol].nAddress - CODE_STARTUP_ADDRESS;
+        if (0 <= nIndex && nIndex < nWords) {
+            pptIndex[nIndex] = &patSymbols[nSymbol];
+        }
+    }
+    *ppptIndex = pptIndex;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    obdis_DisassembleFile
+ * Purpose: Read the output files of a compiled file and disassemble them
+ * Parameters:
+ *          pszFileName [IN] - the file name (w/o extension)
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the files are not valid
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR obdis_DisassembleFile(const char * pszFileName) {
+    POBDIS_FILE ptFile = NULL;
+    char * pszFullFileName = NULL;
+    char * pcObject = NULL;
+    size_t nObjectLength = 0;
+    uint16_t * pwWords = NULL;
+    char * pcEntries = NULL;
+    PPACKED_SYMBOL patEntries = NULL;
+    int nEntries = 0;
+    char * pcExternals = NULL;
+    PPACKED_SYMBOL patExternals = NULL;
+    int nExternals = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    ptFile = calloc(1, sizeof(*ptFile));
+    if (NULL == ptFile) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Read & parse the object file */
+    pszFullFileName = HELPER_ConcatStrings(pszFileName,
+                                           GLOB_FILE_EXTENSION_BINARY);
+    if (NULL == pszFullFileName) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        free(ptFile);
+        return eRetValue;
+    }
+    pcObject = HELPER_ReadFile(pszFullFileName, &nObjectLength);
+    free(pszFullFileName);
+    if (NULL == pcObject) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        free(ptFile);
+        return eRetValue;
+    }
+    eRetValue = OUTPUT_ParseObject(pcObject, nObjectLength, &pwWords,
+                                   &ptFile->nCodeLength,
+                                   &ptFile->nDataLength);
+    free(pcObject);
+    ptFile->pwWords = pwWords;
+    
+    /* Read the entries & externals files, and index them by address */
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = OUTPUT_ReadTable(pszFileName, GLOB_FILE_EXTENSION_ENTRY,
+                                     &pcEntries, &patEntries, &nEntries);
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = OUTPUT_ReadTable(pszFileName, GLOB_FILE_EXTENSION_EXTERN,
+                                     &pcExternals, &patExternals,
+                                     &nExternals);
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = obdis_IndexSymbols(patEntries, nEntries,
+                                       ptFile->nCodeLength
+                                       + ptFile->nDataLength,
+                                       &ptFile->pptEntries);
+    }
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = obdis_IndexSymbols(patExternals, nExternals,
+                                       ptFile->nCodeLength
+                                       + ptFile->nDataLength,
+                                       &ptFile->pptExternals);
+    }
+    
+    /* Disassemble */
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = obdis_Disassemble(ptFile);
+    }
+    
+    /* Free resources */
+    free(ptFile->pptExternals);
+    free(ptFile->pptEntries);
+    free(patExternals);
+    free(pcExternals);
+    free(patEntries);
+    free(pcEntries);
+    free(pwWords);
+    free(ptFile);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    main
+ * Purpose: disassemble the object files (as passed in the command line
+ *          parameters) to the stdout
+ * Command Line:
+ *          obdis <file1> <file2> ...
+ *          The files are given w/o the extension (like the assembler).
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS (0) is returned.
+ *          Otherwise, the error of the last file that failed is returned.
+ *****************************************************************************/
+int main(int nArgc, const char * ppszArgv[]) {
+    GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    GLOB_ERROR eFileRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check for minimum number of arguments */
+    if (nArgc < MIN_NUMBER_OF_ARGUMENTS) {
+        printf("USAGE: %s <file1> <file2> ...\n", ppszArgv[0]);
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    obdis_BuildFormats();
+    for (int nIndex = 1; nIndex < nArgc; nIndex++) {
+        eFileRetValue = obdis_DisassembleFile(ppszArgv[nIndex]);
+        if (GLOB_ERROR_INVALID_PARAMETERS == eFileRetValue) {
+            fprintf(stderr, "%s: not valid output files\n", ppszArgv[nIndex]);
+            eRetValue = eFileRetValue;
+        } else if (eFileRetValue) {
+            fprintf(stderr, "Can't disassemble %s\n", ppszArgv[nIndex]);
+            eRetValue = eFileRetValue;
+        }
+    }
+    return eRetValue;
+}
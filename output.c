@@ -8,6 +8,11 @@
  * The module gets the textual content of the extern+entries files and write
  * it as is to the files. For the object file - it also gets the content, but
  * have to format it as described in the project requirements.
+ * The object file is formatted into one buffer and written with one call.
+ * Each word is encoded as two 7-bit halves, using a table of the encoding
+ * of all the possible halves.
+ * The packed object file is formatted by PACKED. Its tables are parsed from
+ * the textual content of the entries & externals files.
  *****************************************************************************/
 
 /******************************************************************************
@@ -15,11 +20,14 @@
  *****************************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include "helper.h"
 #include "global.h"
 #include "asm.h"
-#include "memstream.h"
 #include "output.h"
+#include "packed.h"
+#include "stats.h"
 
 /******************************************************************************
  * CONSTANTS & MACROS
@@ -32,102 +40,173 @@
 #define ENCODE_1 '/'
 #define ENCODE_0 '.'
 
+/* number of bits in a half of a word. Each half is encoded with
+ * g_aacHalfWords */
+#define BIT_IN_HALF_WORD 7
+#define HALF_WORD_MASK 0x7F
+
+/* The minimum number of digits of an address in the object file */
+#define MIN_ADDRESS_DIGITS 4
+
+/* The maximum number of digits of an int */
+#define MAX_INT_DIGITS 10
+
+/* The maximum length (in chars) of a line in the object file:
+ * address, tab, the word and '\n' */
+#define MAX_BINARY_LINE_LENGTH (MAX_INT_DIGITS + 1 + BIT_IN_WORD + 1)
+
+/* The maximum length (in chars) of the header line of the object file */
+#define MAX_BINARY_HEADER_LENGTH (2 * (MAX_INT_DIGITS + 1) + 1)
+
+/* The next macros build the g_aacHalfWords table at compile time */
+#define ENCODE_BIT(nHalfWord, nBit)                                     \
+    (((nHalfWord) >> (nBit)) & 1 ? ENCODE_1 : ENCODE_0)
+#define ENCODE_HALF_WORD(n)                                             \
+    {ENCODE_BIT(n, 6), ENCODE_BIT(n, 5), ENCODE_BIT(n, 4), ENCODE_BIT(n, 3), \
+     ENCODE_BIT(n, 2), ENCODE_BIT(n, 1), ENCODE_BIT(n, 0)}
+#define ENCODE_4_HALF_WORDS(n)                                          \
+    ENCODE_HALF_WORD(n), ENCODE_HALF_WORD((n) + 1),                     \
+    ENCODE_HALF_WORD((n) + 2), ENCODE_HALF_WORD((n) + 3)
+#define ENCODE_16_HALF_WORDS(n)                                         \
+    ENCODE_4_HALF_WORDS(n), ENCODE_4_HALF_WORDS((n) + 4),               \
+    ENCODE_4_HALF_WORDS((n) + 8), ENCODE_4_HALF_WORDS((n) + 12)
+#define ENCODE_64_HALF_WORDS(n)                                         \
+    ENCODE_16_HALF_WORDS(n), ENCODE_16_HALF_WORDS((n) + 16),            \
+    ENCODE_16_HALF_WORDS((n) + 32), ENCODE_16_HALF_WORDS((n) + 48)
+
 /******************************************************************************
  * INTERNAL FUNCTIONS (prototypes)
  * -------------------------------
  * See function-level documentation next to the implementation below
  *****************************************************************************/
+static int output_FormatAddress(char * pcBuffer, int nAddress);
+static GLOB_ERROR output_FormatBinary(HASM_FILE hFile,
+                                      char ** ppcBuffer,
+                                      int * pnBufferLength);
 static GLOB_ERROR output_WriteBinary(const char * szFileName, HASM_FILE hFile);
 static GLOB_ERROR output_WriteToFile(const char * szFileName,
                                      const char * szFileExt,
-                                     char * pszBuffer,
+                                     const char * pszBuffer,
                                      int nBufferLength);
 static GLOB_ERROR output_WriteExternals(const char * szFileName,
                                         HASM_FILE hFile);
 static GLOB_ERROR output_WriteEntries(const char * szFileName, HASM_FILE hFile);
+static int output_CountRecords(const char * pcText, int nLength);
+static void output_ParseRecords(const char * pcText,
+                                int nLength,
+                                PPACKED_SYMBOL patSymbols);
+static BOOL output_ParseNumber(const char ** ppcText,
+                               const char * pcEnd,
+                               int * pnNumber);
+
+/******************************************************************************
+ * CONSTANTS
+ *****************************************************************************/
+
+/* The encoding of each possible 7-bit half of a word (most significant bit
+ * first). Note: the strings are not null-terminated. */
+static const char g_aacHalfWords[HALF_WORD_MASK + 1][BIT_IN_HALF_WORD] = {
+    ENCODE_64_HALF_WORDS(0), ENCODE_64_HALF_WORDS(64)};
 
 /******************************************************************************
  * INTERNAL FUNCTIONS
  *****************************************************************************/
 
 /******************************************************************************
- * Name:    output_WriteBinary
- * Purpose: Writes the object file
+ * Name:    output_FormatAddress
+ * Purpose: Format an address in decimal, with leading zeros up to
+ *          MIN_ADDRESS_DIGITS digits (like "%04d")
+ * Parameters:
+ *          pcBuffer [OUT] - buffer of at least MAX_INT_DIGITS chars. The
+ *                           string is not null-terminated.
+ *          nAddress [IN] - the address (not negative)
+ * Return Value:
+ *          The number of chars written to the buffer
+ *****************************************************************************/
+static int output_FormatAddress(char * pcBuffer, int nAddress) {
+    char acDigits[MAX_INT_DIGITS];
+    int nDigits = 0;
+    
+    /* Get the digits, from the least significant one */
+    do {
+        acDigits[nDigits] = '0' + nAddress % 10;
+        nAddress /= 10;
+        nDigits++;
+    } while (0 != nAddress);
+    
+    /* Add the leading zeros */
+    while (nDigits < MIN_ADDRESS_DIGITS) {
+        acDigits[nDigits] = '0';
+        nDigits++;
+    }
+    
+    /* Copy the digits in the right order */
+    for (int nIndex = 0; nIndex < nDigits; nIndex++) {
+        pcBuffer[nIndex] = acDigits[nDigits - 1 - nIndex];
+    }
+    return nDigits;
+}
+
+/******************************************************************************
+ * Name:    output_FormatBinary
+ * Purpose: Formats the content of the object file
  * Parameters:
- *          szFileName [IN] - the file name (w/o the extension)
  *          hFile [IN] - handle to the compiled file
+ *          ppcBuffer [OUT] - the content of the object file
+ *                            (not null-terminated)
+ *          pnBufferLength [OUT] - the length (in chars) of the content
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the buffer returned in
+ *          ppcBuffer.
  *          If the function fails, an error code is returned.
  *****************************************************************************/
-static GLOB_ERROR output_WriteBinary(const char * szFileName, HASM_FILE hFile) {
+static GLOB_ERROR output_FormatBinary(HASM_FILE hFile,
+                                      char ** ppcBuffer,
+                                      int * pnBufferLength) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
-    HMEMSTREAM hStream = NULL;
-    int * pnStream = NULL;
-    int nStreamLength = 0;
-    char * szBinaryFileName = NULL;
-    FILE * phBinaryFile = NULL;
-    int nCode = 0;
-    int nData = 0;
-    int nAddress = CODE_STARTUP_ADDRESS;
-    char szWord[BIT_IN_WORD+1];
-    int nMask = 0;
-
-    TERMINATE_STRING(szWord);
+    const uint16_t * apwSections[2] = {NULL, NULL};
+    int anSectionLengths[2] = {0, 0};
     
-    /* Get the binary to write */
-    eRetValue = ASM_WriteBinary(hFile, &hStream, &nCode, &nData);
+    /* Get the binary to write (the code section and the data section) */
+    eRetValue = ASM_WriteBinary(hFile, &apwSections[0], &anSectionLengths[0],
+                                &apwSections[1], &anSectionLengths[1]);
     if (eRetValue) {
         return eRetValue;
     }
     
-    /* Get the full name of the object file*/
-    szBinaryFileName = HELPER_ConcatStrings(szFileName,
-                                            GLOB_FILE_EXTENSION_BINARY);
-    if (NULL == szBinaryFileName) {
-        eRetValue = GLOB_ERROR_SYS_CALL_ERROR(); 
-        MEMSTREAM_Free(hStream);
-        return eRetValue;
-    }
+    /* Format the sections */
+    return OUTPUT_FormatObject(apwSections[0], anSectionLengths[0],
+                               apwSections[1], anSectionLengths[1],
+                               ppcBuffer, pnBufferLength);
+}
+
+/******************************************************************************
+ * Name:    output_WriteBinary
+ * Purpose: Writes the object file
+ * Parameters:
+ *          szFileName [IN] - the file name (w/o the extension)
+ *          hFile [IN] - handle to the compiled file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR output_WriteBinary(const char * szFileName, HASM_FILE hFile) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    char * pcBuffer = NULL;
+    int nBufferLength = 0;
     
-    /* Get the pointer to the buffer of the stream */
-    eRetValue =  MEMSTREAM_GetStream(hStream, &pnStream, &nStreamLength);
+    /* Format the content of the object file */
+    eRetValue = output_FormatBinary(hFile, &pcBuffer, &nBufferLength);
     if (eRetValue) {
-        MEMSTREAM_Free(hStream);
-        free(szBinaryFileName);
-        return eRetValue;        
-    }
-    
-    /* Open the file in write mode */
-    phBinaryFile = fopen(szBinaryFileName, "w");
-    if (NULL == phBinaryFile) {
-        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
-        MEMSTREAM_Free(hStream);
-        free(szBinaryFileName);
         return eRetValue;
     }
     
-    /* Write the header line (with the length of the code section
-     * and the length of the data section. */
-    fprintf(phBinaryFile, "%d %d\n", nCode, nData);
-    
-    for (int nIndex = 0; nIndex < nStreamLength; nIndex++) {
-        /* We start with nMask to get the most significant bit */
-        nMask = 0x2000; /* 10 0000 0000 0000 */
-        for (int nBit=0; nBit<BIT_IN_WORD; nBit++) {
-            szWord[nBit] = pnStream[nIndex] & nMask ? ENCODE_1 : ENCODE_0;
-            /* Shift right to get the next bit */
-            nMask = nMask >> 1;
-        }
-        
-        /* Write the word to the object file */
-        fprintf(phBinaryFile, "%04d\t%s\n", nAddress, szWord);
-        nAddress++;
-    }
-    MEMSTREAM_Free(hStream);
-    free(szBinaryFileName);
-    fclose(phBinaryFile);
-    return GLOB_SUCCESS;
+    /* Write the buffer to the object file */
+    eRetValue = output_WriteToFile(szFileName, GLOB_FILE_EXTENSION_BINARY,
+                                   pcBuffer, nBufferLength);
+    free(pcBuffer);
+    return eRetValue;
 }
 
 /******************************************************************************
@@ -144,12 +223,12 @@ static GLOB_ERROR output_WriteBinary(const char * szFileName, HASM_FILE hFile) {
  *****************************************************************************/
 static GLOB_ERROR output_WriteToFile(const char * szFileName,
                                      const char * szFileExt,
-                                     char * pszBuffer,
+                                     const char * pszBuffer,
                                      int nBufferLength) {
     char * szFullFileName = NULL;
     FILE * phFile = NULL;
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
-
+    
     /* Get the full file name */
     szFullFileName = HELPER_ConcatStrings(szFileName, szFileExt);
     if (NULL == szFullFileName) {
@@ -237,6 +316,94 @@ static GLOB_ERROR output_WriteEntries(const char * szFileName, HASM_FILE hFile){
     return GLOB_SUCCESS;
 }
 
+/******************************************************************************
+ * Name:    output_CountRecords
+ * Purpose: Count the records (lines) of the entries/externals file
+ * Parameters:
+ *          pcText [IN] - the content of the file
+ *          nLength [IN] - the length (in chars) of the content
+ * Return Value:
+ *          The number of records
+ *****************************************************************************/
+static int output_CountRecords(const char * pcText, int nLength) {
+    int nRecords = 0;
+    
+    for (int nIndex = 0; nIndex < nLength; nIndex++) {
+        if ('\n' == pcText[nIndex]) {
+            nRecords++;
+        }
+    }
+    return nRecords;
+}
+
+/******************************************************************************
+ * Name:    output_ParseRecords
+ * Purpose: Parse the records ("<name>\t<address>\n") of the entries/externals
+ *          file
+ * Parameters:
+ *          pcText [IN] - the content of the file
+ *          nLength [IN] - the length (in chars) of the content
+ *          patSymbols [OUT] - the records (see output_CountRecords). The
+ *                             names point into the content.
+ *****************************************************************************/
+static void output_ParseRecords(const char * pcText,
+                                int nLength,
+                                PPACKED_SYMBOL patSymbols) {
+    const char * pcEnd = pcText + nLength;
+    int nAddress = 0;
+    
+    while (pcText < pcEnd) {
+        /* The name */
+        patSymbols->pcName = pcText;
+        while ('\t' != *pcText) {
+            pcText++;
+        }
+        patSymbols->nNameLength = pcText - patSymbols->pcName;
+        pcText++;
+        
+        /* The address */
+        for (nAddress = 0; '\n' != *pcText; pcText++) {
+            nAddress = nAddress * 10 + (*pcText - '0');
+        }
+        patSymbols->nAddress = nAddress;
+        pcText++;
+        patSymbols++;
+    }
+}
+
+/******************************************************************************
+ * Name:    output_ParseNumber
+ * Purpose: Parse a non-negative decimal number
+ * Parameters:
+ *          ppcText [IN OUT] - the position of the number. It is moved to the
+ *                             position after the number.
+ *          pcEnd [IN] - the end of the text
+ *          pnNumber [OUT] - the number
+ * Return Value:
+ *          TRUE if a number was parsed. FALSE if there are no digits, or
+ *          the number is too big.
+ *****************************************************************************/
+static BOOL output_ParseNumber(const char ** ppcText,
+                               const char * pcEnd,
+                               int * pnNumber) {
+    const char * pcText = *ppcText;
+    int nNumber = 0;
+    
+    while (pcText < pcEnd && '0' <= *pcText && '9' >= *pcText) {
+        if (nNumber > (INT_MAX - 9) / 10) {
+            return FALSE;
+        }
+        nNumber = nNumber * 10 + (*pcText - '0');
+        pcText++;
+    }
+    if (pcText == *ppcText) {
+        return FALSE;
+    }
+    *ppcText = pcText;
+    *pnNumber = nNumber;
+    return TRUE;
+}
+
 /******************************************************************************
  * EXTERNAL FUNCTIONS
  * ------------------
@@ -248,6 +415,7 @@ static GLOB_ERROR output_WriteEntries(const char * szFileName, HASM_FILE hFile){
  *****************************************************************************/
 GLOB_ERROR OUTPUT_WriteFiles(const char * szFileName, HASM_FILE hFile) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    long long nStartTime = 0;
     
     /* Check parameters */
     if (NULL == hFile) { 
@@ -255,22 +423,424 @@ GLOB_ERROR OUTPUT_WriteFiles(const char * szFileName, HASM_FILE hFile) {
     }
     
     /* Write the object file */
+    nStartTime = STATS_StartPhase();
     eRetValue = output_WriteBinary(szFileName, hFile);
+    STATS_EndPhase(STATS_PHASE_WRITE_OBJECT, nStartTime);
     if (eRetValue) {
         return eRetValue;
     }
-
+    
     /* Write the externals file */
+    nStartTime = STATS_StartPhase();
     eRetValue = output_WriteExternals(szFileName, hFile);
+    STATS_EndPhase(STATS_PHASE_WRITE_EXTERNALS, nStartTime);
     if (eRetValue) {
         return eRetValue;
     }
     
     /* Write the entries file */
+    nStartTime = STATS_StartPhase();
     eRetValue = output_WriteEntries(szFileName, hFile);
+    STATS_EndPhase(STATS_PHASE_WRITE_ENTRIES, nStartTime);
     if (eRetValue) {
         return eRetValue;
     }
+    
+    return GLOB_SUCCESS;
+}
 
+/******************************************************************************
+ * Name:    OUTPUT_WritePacked
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_WritePacked(const char * szFileName, HASM_FILE hFile) {
+    PACKED_OBJECT tObject;
+    char * pcEntries = NULL;
+    int nEntriesLength = 0;
+    char * pcExternals = NULL;
+    int nExternalsLength = 0;
+    PPACKED_SYMBOL patSymbols = NULL;
+    char * pcBuffer = NULL;
+    int nBufferLength = 0;
+    long long nStartTime = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == hFile) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Get the content of the files */
+    memset(&tObject, 0, sizeof(tObject));
+    eRetValue = ASM_WriteBinary(hFile, &tObject.pwCode, &tObject.nCodeLength,
+                                &tObject.pwData, &tObject.nDataLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    eRetValue = ASM_GetEntries(hFile, &pcEntries, &nEntriesLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    eRetValue = ASM_GetExternals(hFile, &pcExternals, &nExternalsLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    nStartTime = STATS_StartPhase();
+    
+    /* Get the records of the tables (one array for both tables) */
+    tObject.nEntries = output_CountRecords(pcEntries, nEntriesLength);
+    tObject.nExternals = output_CountRecords(pcExternals, nExternalsLength);
+    STATS_CountAllocation(STATS_MODULE_OUTPUT,
+            ((size_t)tObject.nEntries + tObject.nExternals + 1)
+            * sizeof(*patSymbols));
+    patSymbols = malloc(((size_t)tObject.nEntries + tObject.nExternals + 1)
+                        * sizeof(*patSymbols));
+    if (NULL == patSymbols) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    output_ParseRecords(pcEntries, nEntriesLength, patSymbols);
+    output_ParseRecords(pcExternals, nExternalsLength,
+                        patSymbols + tObject.nEntries);
+    tObject.patEntries = patSymbols;
+    tObject.patExternals = patSymbols + tObject.nEntries;
+    
+    /* Format and write the file */
+    eRetValue = PACKED_Format(&tObject, &pcBuffer, &nBufferLength);
+    free(patSymbols);
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = output_WriteToFile(szFileName, GLOB_FILE_EXTENSION_PACKED,
+                                       pcBuffer, nBufferLength);
+        free(pcBuffer);
+    }
+    STATS_EndPhase(STATS_PHASE_WRITE_PACKED, nStartTime);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    OUTPUT_FormatObject
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_FormatObject(const uint16_t * pwCode,
+                               int nCodeLength,
+                               const uint16_t * pwData,
+                               int nDataLength,
+                               char ** ppcBuffer,
+                               int * pnBufferLength) {
+    const uint16_t * apwSections[2] = {pwCode, pwData};
+    int anSectionLengths[2] = {nCodeLength, nDataLength};
+    const uint16_t * pwStream = NULL;
+    int nAddress = CODE_STARTUP_ADDRESS;
+    char * pcBuffer = NULL;
+    int nBufferLength = 0;
+    
+    /* Check parameters */
+    if (NULL == ppcBuffer || NULL == pnBufferLength) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Allocate the buffer of the object file */
+    STATS_CountAllocation(STATS_MODULE_OUTPUT,
+            MAX_BINARY_HEADER_LENGTH
+            + ((size_t)anSectionLengths[0] + anSectionLengths[1])
+              * MAX_BINARY_LINE_LENGTH);
+    pcBuffer = malloc(MAX_BINARY_HEADER_LENGTH
+                      + ((size_t)anSectionLengths[0] + anSectionLengths[1])
+                        * MAX_BINARY_LINE_LENGTH);
+    if (NULL == pcBuffer) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Write the header line (with the length of the code section
+     * and the length of the data section. */
+    nBufferLength = sprintf(pcBuffer, "%d %d\n",
+                            anSectionLengths[0], anSectionLengths[1]);
+    
+    for (int nSection = 0; nSection < ARRAY_ELEMENTS(apwSections); nSection++){
+        pwStream = apwSections[nSection];
+        for (int nIndex = 0; nIndex < anSectionLengths[nSection]; nIndex++) {
+            /* The address and a tab */
+            nBufferLength += output_FormatAddress(pcBuffer + nBufferLength,
+                                                  nAddress);
+            pcBuffer[nBufferLength] = '\t';
+            nBufferLength++;
+        
+            /* The word: the most significant half and then the other half */
+            memcpy(pcBuffer + nBufferLength,
+                   g_aacHalfWords[(pwStream[nIndex] >> BIT_IN_HALF_WORD)
+                                  & HALF_WORD_MASK],
+                   BIT_IN_HALF_WORD);
+            nBufferLength += BIT_IN_HALF_WORD;
+            memcpy(pcBuffer + nBufferLength,
+                   g_aacHalfWords[pwStream[nIndex] & HALF_WORD_MASK],
+                   BIT_IN_HALF_WORD);
+            nBufferLength += BIT_IN_HALF_WORD;
+            pcBuffer[nBufferLength] = '\n';
+            nBufferLength++;
+            nAddress++;
+        }
+    }
+    
+    /* Set out parameters upon success */
+    *ppcBuffer = pcBuffer;
+    *pnBufferLength = nBufferLength;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    OUTPUT_ParseObject
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_ParseObject(const char * pcBuffer,
+                              int nBufferLength,
+                              uint16_t ** ppwWords,
+                              int * pnCodeLength,
+                              int * pnDataLength) {
+    const char * pcText = pcBuffer;
+    const char * pcEnd = pcBuffer + nBufferLength;
+    int nCodeLength = 0;
+    int nDataLength = 0;
+    int nAddress = 0;
+    uint16_t * pwWords = NULL;
+    uint16_t wWord = 0;
+    
+    /* Check parameters */
+    if (NULL == pcBuffer || NULL == ppwWords || NULL == pnCodeLength
+        || NULL == pnDataLength) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* The header line. Each word takes a line of more than 2 chars, so a
+     * valid file is never shorter than what the lengths require. */
+    if (!output_ParseNumber(&pcText, pcEnd, &nCodeLength)
+        || pcText == pcEnd || ' ' != *pcText++
+        || !output_ParseNumber(&pcText, pcEnd, &nDataLength)
+        || pcText == pcEnd || '\n' != *pcText++
+        || (long long)nCodeLength + nDataLength > (pcEnd - pcText) / 2) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    STATS_CountAllocation(STATS_MODULE_OUTPUT,
+                          ((size_t)nCodeLength + nDataLength + 1)
+                          * sizeof(*pwWords));
+    pwWords = malloc(((size_t)nCodeLength + nDataLength + 1)
+                     * sizeof(*pwWords));
+    if (NULL == pwWords) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* The words: the address, a tab, the word and '\n' */
+    for (int nIndex = 0; nIndex < nCodeLength + nDataLength; nIndex++) {
+        if (!output_ParseNumber(&pcText, pcEnd, &nAddress)
+            || CODE_STARTUP_ADDRESS + nIndex != nAddress
+            || pcEnd - pcText < 1 + BIT_IN_WORD + 1 || '\t' != *pcText++) {
+            free(pwWords);
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        wWord = 0;
+        for (int nBit = 0; nBit < BIT_IN_WORD; nBit++) {
+            if (ENCODE_1 != pcText[nBit] && ENCODE_0 != pcText[nBit]) {
+                free(pwWords);
+                return GLOB_ERROR_INVALID_PARAMETERS;
+            }
+            wWord = (wWord << 1) | (ENCODE_1 == pcText[nBit]);
+        }
+        pcText += BIT_IN_WORD;
+        if ('\n' != *pcText++) {
+            free(pwWords);
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        pwWords[nIndex] = wWord;
+    }
+    
+    /* Set out parameters upon success */
+    *ppwWords = pwWords;
+    *pnCodeLength = nCodeLength;
+    *pnDataLength = nDataLength;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    OUTPUT_ParseTable
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_ParseTable(const char * pcBuffer,
+                             int nBufferLength,
+                             PPACKED_SYMBOL * ppatSymbols,
+                             int * pnSymbols) {
+    const char * pcText = pcBuffer;
+    const char * pcEnd = pcBuffer + nBufferLength;
+    PPACKED_SYMBOL patSymbols = NULL;
+    int nSymbols = 0;
+    
+    /* Check parameters */
+    if (NULL == pcBuffer || NULL == ppatSymbols || NULL == pnSymbols) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Each record ends with '\n' */
+    nSymbols = output_CountRecords(pcBuffer, nBufferLength);
+    STATS_CountAllocation(STATS_MODULE_OUTPUT,
+                          ((size_t)nSymbols + 1) * sizeof(*patSymbols));
+    patSymbols = malloc(((size_t)nSymbols + 1) * sizeof(*patSymbols));
+    if (NULL == patSymbols) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* The records: the name, a tab, the address and '\n' */
+    for (int nIndex = 0; nIndex < nSymbols; nIndex++) {
+        patSymbols[nIndex].pcName = pcText;
+        while (pcText < pcEnd && '\t' != *pcText && '\n' != *pcText) {
+            pcText++;
+        }
+        patSymbols[nIndex].nNameLength = pcText - patSymbols[nIndex].pcName;
+        if (0 == patSymbols[nIndex].nNameLength
+            || pcText == pcEnd || '\t' != *pcText++
+            || !output_ParseNumber(&pcText, pcEnd,
+                                   &patSymbols[nIndex].nAddress)
+            || pcText == pcEnd || '\n' != *pcText++) {
+            free(patSymbols);
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+    }
+    
+    /* Nothing may follow the last record */
+    if (pcText != pcEnd) {
+        free(patSymbols);
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Set out parameters upon success */
+    *ppatSymbols = patSymbols;
+    *pnSymbols = nSymbols;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    OUTPUT_ReadTable
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_ReadTable(const char * szFileName,
+                            const char * szFileExt,
+                            char ** ppcBuffer,
+                            PPACKED_SYMBOL * ppatSymbols,
+                            int * pnSymbols) {
+    char * szFullFileName = NULL;
+    char * pcBuffer = NULL;
+    size_t nBufferLength = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == szFileName || NULL == szFileExt || NULL == ppcBuffer) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Read the file */
+    szFullFileName = HELPER_ConcatStrings(szFileName, szFileExt);
+    if (NULL == szFullFileName) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    pcBuffer = HELPER_ReadFile(szFullFileName, &nBufferLength);
+    free(szFullFileName);
+    if (NULL == pcBuffer && ENOENT != errno) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Parse it */
+    eRetValue = OUTPUT_ParseTable((NULL == pcBuffer) ? "" : pcBuffer,
+                                  nBufferLength, ppatSymbols, pnSymbols);
+    if (eRetValue) {
+        free(pcBuffer);
+        return eRetValue;
+    }
+    
+    /* Set out parameter upon success */
+    *ppcBuffer = pcBuffer;
     return GLOB_SUCCESS;
 }
+
+/******************************************************************************
+ * Name:    OUTPUT_WriteContent
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_WriteContent(const char * szFileName,
+                               const OUTPUT_FILES * ptFiles) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    long long nStartTime = 0;
+    
+    /* Check parameters */
+    if (NULL == ptFiles) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Write the object file */
+    nStartTime = STATS_StartPhase();
+    eRetValue = output_WriteToFile(szFileName, GLOB_FILE_EXTENSION_BINARY,
+                                   ptFiles->pcObject, ptFiles->nObjectLength);
+    STATS_EndPhase(STATS_PHASE_WRITE_OBJECT, nStartTime);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* Write the externals & entries files. We don't create empty files. */
+    nStartTime = STATS_StartPhase();
+    if (ptFiles->nExternalsLength > 0) {
+        eRetValue = output_WriteToFile(szFileName, GLOB_FILE_EXTENSION_EXTERN,
+                ptFiles->pcExternals, ptFiles->nExternalsLength);
+    }
+    STATS_EndPhase(STATS_PHASE_WRITE_EXTERNALS, nStartTime);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    nStartTime = STATS_StartPhase();
+    if (ptFiles->nEntriesLength > 0) {
+        eRetValue = output_WriteToFile(szFileName, GLOB_FILE_EXTENSION_ENTRY,
+                ptFiles->pcEntries, ptFiles->nEntriesLength);
+    }
+    STATS_EndPhase(STATS_PHASE_WRITE_ENTRIES, nStartTime);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    OUTPUT_GetFiles
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_GetFiles(HASM_FILE hFile, POUTPUT_FILES ptFiles) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == hFile || NULL == ptFiles) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Get the content of the externals file */
+    eRetValue = ASM_GetExternals(hFile, &ptFiles->pcExternals,
+                                 &ptFiles->nExternalsLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* Get the content of the entries file */
+    eRetValue = ASM_GetEntries(hFile, &ptFiles->pcEntries,
+                               &ptFiles->nEntriesLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    /* Format the object file */
+    eRetValue = output_FormatBinary(hFile, &ptFiles->pcObject,
+                                    &ptFiles->nObjectLength);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    OUTPUT_FreeFiles
+ *****************************************************************************/
+void OUTPUT_FreeFiles(POUTPUT_FILES ptFiles) {
+    if (NULL != ptFiles) {
+        free(ptFiles->pcObject);
+        ptFiles->pcObject = NULL;
+        ptFiles->nObjectLength = 0;
+    }
+}
@@ -13,6 +13,27 @@
  *****************************************************************************/
 #include "global.h"
 #include "asm.h"
+#include "packed.h"
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The OUTPUT_FILES struct holds the content of the output files of a
+ * compiled file. The buffers are not null-terminated. A length of 0 means
+ * that the file wouldn't be created by OUTPUT_WriteFiles. */
+typedef struct OUTPUT_FILES {
+    /* The object file. Free it with OUTPUT_FreeFiles */
+    char * pcObject;
+    int nObjectLength;
+    
+    /* The entries & externals files. They are owned by the handle of the
+     * compiled file and valid until the call to ASM_Close */
+    char * pcEntries;
+    int nEntriesLength;
+    char * pcExternals;
+    int nExternalsLength;
+} OUTPUT_FILES, *POUTPUT_FILES;
 
 /******************************************************************************
  * FUNCTIONS
@@ -30,4 +51,147 @@
  *****************************************************************************/
 GLOB_ERROR OUTPUT_WriteFiles(const char * szFileName, HASM_FILE hFile);
 
+/******************************************************************************
+ * Name:    OUTPUT_WritePacked
+ * Purpose: write the packed object file (see PACKED) of successfully
+ *          compiled file
+ * Parameters:
+ *          szFileName [IN] - the file name (w/o extension)
+ *          hFile [IN] - handle to the compiled file 
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_WritePacked(const char * szFileName, HASM_FILE hFile);
+
+/******************************************************************************
+ * Name:    OUTPUT_FormatObject
+ * Purpose: format the content of the object file from its sections
+ * Parameters:
+ *          pwCode [IN] - the words of the code section
+ *          nCodeLength [IN] - size (in words) of the code section
+ *          pwData [IN] - the words of the data section
+ *          nDataLength [IN] - size (in words) of the data section
+ *          ppcBuffer [OUT] - the content of the object file
+ *                            (not null-terminated)
+ *          pnBufferLength [OUT] - the length (in chars) of the content
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the buffer.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_FormatObject(const uint16_t * pwCode,
+                               int nCodeLength,
+                               const uint16_t * pwData,
+                               int nDataLength,
+                               char ** ppcBuffer,
+                               int * pnBufferLength);
+
+/******************************************************************************
+ * Name:    OUTPUT_ParseObject
+ * Purpose: parse the content of an object file (the reverse of
+ *          OUTPUT_FormatObject)
+ * Parameters:
+ *          pcBuffer [IN] - the content of the object file
+ *          nBufferLength [IN] - the length (in chars) of the content
+ *          ppwWords [OUT] - the words of the code section and then the
+ *                           data section
+ *          pnCodeLength [OUT] - size (in words) of the code section
+ *          pnDataLength [OUT] - size (in words) of the data section
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the words.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the content is not a valid object
+ *                                          file
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_ParseObject(const char * pcBuffer,
+                              int nBufferLength,
+                              uint16_t ** ppwWords,
+                              int * pnCodeLength,
+                              int * pnDataLength);
+
+/******************************************************************************
+ * Name:    OUTPUT_ParseTable
+ * Purpose: parse the content of an entries or externals file
+ * Parameters:
+ *          pcBuffer [IN] - the content of the file
+ *          nBufferLength [IN] - the length (in chars) of the content
+ *          ppatSymbols [OUT] - the records. The names point into the
+ *                              content.
+ *          pnSymbols [OUT] - number of records
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the records.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the content is not a valid
+ *                                          entries/externals file
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_ParseTable(const char * pcBuffer,
+                             int nBufferLength,
+                             PPACKED_SYMBOL * ppatSymbols,
+                             int * pnSymbols);
+
+/******************************************************************************
+ * Name:    OUTPUT_ReadTable
+ * Purpose: read and parse the entries or externals file of a compiled file
+ * Parameters:
+ *          szFileName [IN] - the file name (w/o the extension)
+ *          szFileExt [IN] - the extension of the file
+ *          ppcBuffer [OUT] - the content of the file (NULL if there is no
+ *                            such file)
+ *          ppatSymbols [OUT] - the records. The names point into the
+ *                              content.
+ *          pnSymbols [OUT] - number of records
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the content and the records.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the file is not valid
+ *          If the function fails, an error code is returned.
+ * Remark:  A missing file has no records (the assembler doesn't create
+ *          empty files).
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_ReadTable(const char * szFileName,
+                            const char * szFileExt,
+                            char ** ppcBuffer,
+                            PPACKED_SYMBOL * ppatSymbols,
+                            int * pnSymbols);
+
+/******************************************************************************
+ * Name:    OUTPUT_WriteContent
+ * Purpose: write output files with a given content (for example, the
+ *          content returned by OUTPUT_GetFiles)
+ * Parameters:
+ *          szFileName [IN] - the file name (w/o extension)
+ *          ptFiles [IN] - the content of the files
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_WriteContent(const char * szFileName,
+                               const OUTPUT_FILES * ptFiles);
+
+/******************************************************************************
+ * Name:    OUTPUT_GetFiles
+ * Purpose: get the content of the output files of successfully compiled
+ *          file, without writing them to the disk
+ * Parameters:
+ *          hFile [IN] - handle to the compiled file 
+ *          ptFiles [OUT] - the content of the files
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the content with
+ *          OUTPUT_FreeFiles.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR OUTPUT_GetFiles(HASM_FILE hFile, POUTPUT_FILES ptFiles);
+
+/******************************************************************************
+ * Name:    OUTPUT_FreeFiles
+ * Purpose: free the content returned by OUTPUT_GetFiles
+ * Parameters:
+ *          ptFiles [IN] - the content of the files
+ *****************************************************************************/
+void OUTPUT_FreeFiles(POUTPUT_FILES ptFiles);
+
 #endif /* OUTPUT_H */
@@ -0,0 +1,342 @@
+/******************************************************************************
+ * File:    packed.c
+ * Author:  Doron Shvartztuch
+ * The PACKED module formats and parses the packed object file.
+ *
+ * Implementation:
+ * The numbers are written and read byte by byte, so the file is the same on
+ * every host and the buffer doesn't have to be aligned.
+ * The parsed words are copied to one array (code and then data), and the
+ * records of both tables to another array. The names are not copied.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+#include "stats.h"
+#include "packed.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The magic of the file */
+#define PACKED_MAGIC "ASMP"
+#define PACKED_MAGIC_LENGTH 4
+
+/* The size (in bytes) of the header and of the fixed part of a record */
+#define PACKED_HEADER_SIZE (PACKED_MAGIC_LENGTH + 2 + 2 + 4 * 4)
+#define PACKED_RECORD_SIZE (4 + 2)
+
+/* The maximum length of a name in a record */
+#define PACKED_MAX_NAME_LENGTH 0xFFFF
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static unsigned char * packed_Put16(unsigned char * pcBuffer, unsigned nValue);
+static unsigned char * packed_Put32(unsigned char * pcBuffer,
+                                    uint32_t nValue);
+static unsigned char * packed_PutTable(unsigned char * pcBuffer,
+                                       const PACKED_SYMBOL * patSymbols,
+                                       int nSymbols);
+static unsigned packed_Get16(const unsigned char * pcBuffer);
+static uint32_t packed_Get32(const unsigned char * pcBuffer);
+static GLOB_ERROR packed_GetTable(const unsigned char ** ppcBuffer,
+                                  const unsigned char * pcEnd,
+                                  PPACKED_SYMBOL patSymbols,
+                                  int nSymbols);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    packed_Put16
+ * Purpose: Write a 16-bit number (little-endian)
+ * Parameters:
+ *          pcBuffer [OUT] - where to write
+ *          nValue [IN] - the number
+ * Return Value:
+ *          The position after the number
+ *****************************************************************************/
+static unsigned char * packed_Put16(unsigned char * pcBuffer, unsigned nValue){
+    pcBuffer[0] = nValue & 0xFF;
+    pcBuffer[1] = (nValue >> 8) & 0xFF;
+    return pcBuffer + 2;
+}
+
+/******************************************************************************
+ * Name:    packed_Put32
+ * Purpose: Write a 32-bit number (little-endian)
+ * Parameters:
+ *          pcBuffer [OUT] - where to write
+ *          nValue [IN] - the number
+ * Return Value:
+ *          The position after the number
+ *****************************************************************************/
+static unsigned char * packed_Put32(unsigned char * pcBuffer,
+                                    uint32_t nValue) {
+    pcBuffer = packed_Put16(pcBuffer, nValue & 0xFFFF);
+    return packed_Put16(pcBuffer, nValue >> 16);
+}
+
+/******************************************************************************
+ * Name:    packed_PutTable
+ * Purpose: Write the records of a table
+ * Parameters:
+ *          pcBuffer [OUT] - where to write
+ *          patSymbols [IN] - the records
+ *          nSymbols [IN] - number of records
+ * Return Value:
+ *          The position after the table
+ *****************************************************************************/
+static unsigned char * packed_PutTable(unsigned char * pcBuffer,
+                                       const PACKED_SYMBOL * patSymbols,
+                                       int nSymbols) {
+    for (int nIndex = 0; nIndex < nSymbols; nIndex++) {
+        pcBuffer = packed_Put32(pcBuffer, patSymbols[nIndex].nAddress);
+        pcBuffer = packed_Put16(pcBuffer, patSymbols[nIndex].nNameLength);
+        memcpy(pcBuffer, patSymbols[nIndex].pcName,
+               patSymbols[nIndex].nNameLength);
+        pcBuffer += patSymbols[nIndex].nNameLength;
+    }
+    return pcBuffer;
+}
+
+/******************************************************************************
+ * Name:    packed_Get16
+ * Purpose: Read a 16-bit number (little-endian)
+ * Parameters:
+ *          pcBuffer [IN] - where to read from
+ * Return Value:
+ *          The number
+ *****************************************************************************/
+static unsigned packed_Get16(const unsigned char * pcBuffer) {
+    return pcBuffer[0] | (pcBuffer[1] << 8);
+}
+
+/******************************************************************************
+ * Name:    packed_Get32
+ * Purpose: Read a 32-bit number (little-endian)
+ * Parameters:
+ *          pcBuffer [IN] - where to read from
+ * Return Value:
+ *          The number
+ *****************************************************************************/
+static uint32_t packed_Get32(const unsigned char * pcBuffer) {
+    return packed_Get16(pcBuffer)
+           | ((uint32_t)packed_Get16(pcBuffer + 2) << 16);
+}
+
+/******************************************************************************
+ * Name:    packed_GetTable
+ * Purpose: Read the records of a table
+ * Parameters:
+ *          ppcBuffer [IN OUT] - the position of the table. It is moved to
+ *                               the position after the table.
+ *          pcEnd [IN] - the end of the file
+ *          patSymbols [OUT] - the records
+ *          nSymbols [IN] - number of records
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the table exceeds the file
+ *****************************************************************************/
+static GLOB_ERROR packed_GetTable(const unsigned char ** ppcBuffer,
+                                  const unsigned char * pcEnd,
+                                  PPACKED_SYMBOL patSymbols,
+                                  int nSymbols) {
+    const unsigned char * pcBuffer = *ppcBuffer;
+    
+    for (int nIndex = 0; nIndex < nSymbols; nIndex++) {
+        if (pcEnd - pcBuffer < PACKED_RECORD_SIZE) {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        patSymbols[nIndex].nAddress = (int)packed_Get32(pcBuffer);
+        patSymbols[nIndex].nNameLength = packed_Get16(pcBuffer + 4);
+        pcBuffer += PACKED_RECORD_SIZE;
+        if (pcEnd - pcBuffer < patSymbols[nIndex].nNameLength) {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        patSymbols[nIndex].pcName = (const char *)pcBuffer;
+        pcBuffer += patSymbols[nIndex].nNameLength;
+    }
+    *ppcBuffer = pcBuffer;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    PACKED_Format
+ *****************************************************************************/
+GLOB_ERROR PACKED_Format(const PACKED_OBJECT * ptObject,
+                         char ** ppcBuffer,
+                         int * pnBufferLength) {
+    size_t nSize = PACKED_HEADER_SIZE;
+    unsigned char * pcBuffer = NULL;
+    unsigned char * pcPosition = NULL;
+    
+    /* Check parameters */
+    if (NULL == ptObject || NULL == ppcBuffer || NULL == pnBufferLength) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Calc the size of the file */
+    nSize += 2 * ((size_t)ptObject->nCodeLength + ptObject->nDataLength);
+    for (int nIndex = 0; nIndex < ptObject->nEntries; nIndex++) {
+        if (ptObject->patEntries[nIndex].nNameLength > PACKED_MAX_NAME_LENGTH){
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        nSize += PACKED_RECORD_SIZE + ptObject->patEntries[nIndex].nNameLength;
+    }
+    for (int nIndex = 0; nIndex < ptObject->nExternals; nIndex++) {
+        if (ptObject->patExternals[nIndex].nNameLength
+                > PACKED_MAX_NAME_LENGTH) {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        nSize += PACKED_RECORD_SIZE
+                 + ptObject->patExternals[nIndex].nNameLength;
+    }
+    
+    STATS_CountAllocation(STATS_MODULE_PACKED, nSize);
+    pcBuffer = malloc(nSize);
+    if (NULL == pcBuffer) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* The header */
+    memcpy(pcBuffer, PACKED_MAGIC, PACKED_MAGIC_LENGTH);
+    pcPosition = packed_Put16(pcBuffer + PACKED_MAGIC_LENGTH, PACKED_VERSION);
+    pcPosition = packed_Put16(pcPosition, 0);
+    pcPosition = packed_Put32(pcPosition, ptObject->nCodeLength);
+    pcPosition = packed_Put32(pcPosition, ptObject->nDataLength);
+    pcPosition = packed_Put32(pcPosition, ptObject->nEntries);
+    pcPosition = packed_Put32(pcPosition, ptObject->nExternals);
+    
+    /* The words and the tables */
+    for (int nIndex = 0; nIndex < ptObject->nCodeLength; nIndex++) {
+        pcPosition = packed_Put16(pcPosition, ptObject->pwCode[nIndex]);
+    }
+    for (int nIndex = 0; nIndex < ptObject->nDataLength; nIndex++) {
+        pcPosition = packed_Put16(pcPosition, ptObject->pwData[nIndex]);
+    }
+    pcPosition = packed_PutTable(pcPosition, ptObject->patEntries,
+                                 ptObject->nEntries);
+    packed_PutTable(pcPosition, ptObject->patExternals, ptObject->nExternals);
+    
+    /* Set out parameters upon success */
+    *ppcBuffer = (char *)pcBuffer;
+    *pnBufferLength = nSize;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    PACKED_Parse
+ *****************************************************************************/
+GLOB_ERROR PACKED_Parse(const char * pcBuffer,
+                        int nBufferLength,
+                        PPACKED_OBJECT ptObject) {
+    const unsigned char * pcPosition = (const unsigned char *)pcBuffer;
+    const unsigned char * pcEnd = pcPosition + nBufferLength;
+    uint32_t nCodeLength = 0;
+    uint32_t nDataLength = 0;
+    uint32_t nEntries = 0;
+    uint32_t nExternals = 0;
+    uint16_t * pwWords = NULL;
+    PPACKED_SYMBOL patSymbols = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (NULL == pcBuffer || NULL == ptObject) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Check the header. Each record takes at least PACKED_RECORD_SIZE bytes,
+     * so a valid file is never shorter than what the counts require. */
+    if (nBufferLength < PACKED_HEADER_SIZE
+        || 0 != memcmp(pcPosition, PACKED_MAGIC, PACKED_MAGIC_LENGTH)
+        || PACKED_VERSION != packed_Get16(pcPosition + PACKED_MAGIC_LENGTH)) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    pcPosition += PACKED_MAGIC_LENGTH + 2 + 2;
+    nCodeLength = packed_Get32(pcPosition);
+    nDataLength = packed_Get32(pcPosition + 4);
+    nEntries = packed_Get32(pcPosition + 8);
+    nExternals = packed_Get32(pcPosition + 12);
+    pcPosition += 16;
+    if ((uint64_t)nCodeLength + nDataLength > (pcEnd - pcPosition) / 2
+        || (uint64_t)nEntries + nExternals
+           > (pcEnd - pcPosition) / PACKED_RECORD_SIZE) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Copy the words */
+    STATS_CountAllocation(STATS_MODULE_PACKED,
+                          ((size_t)nCodeLength + nDataLength + 1)
+                          * sizeof(*pwWords));
+    pwWords = malloc(((size_t)nCodeLength + nDataLength + 1)
+                     * sizeof(*pwWords));
+    if (NULL == pwWords) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    for (uint32_t nIndex = 0; nIndex < nCodeLength + nDataLength; nIndex++) {
+        pwWords[nIndex] = packed_Get16(pcPosition);
+        pcPosition += 2;
+    }
+    
+    /* Read the tables */
+    STATS_CountAllocation(STATS_MODULE_PACKED,
+                          ((size_t)nEntries + nExternals + 1)
+                          * sizeof(*patSymbols));
+    patSymbols = malloc(((size_t)nEntries + nExternals + 1)
+                        * sizeof(*patSymbols));
+    if (NULL == patSymbols) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        free(pwWords);
+        return eRetValue;
+    }
+    eRetValue = packed_GetTable(&pcPosition, pcEnd, patSymbols, nEntries);
+    if (GLOB_SUCCESS == eRetValue) {
+        eRetValue = packed_GetTable(&pcPosition, pcEnd,
+                                    patSymbols + nEntries, nExternals);
+    }
+    if (eRetValue) {
+        free(patSymbols);
+        free(pwWords);
+        return eRetValue;
+    }
+    
+    /* Set out parameter upon success */
+    ptObject->pwCode = pwWords;
+    ptObject->nCodeLength = nCodeLength;
+    ptObject->pwData = pwWords + nCodeLength;
+    ptObject->nDataLength = nDataLength;
+    ptObject->patEntries = patSymbols;
+    ptObject->nEntries = nEntries;
+    ptObject->patExternals = patSymbols + nEntries;
+    ptObject->nExternals = nExternals;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    PACKED_Free
+ *****************************************************************************/
+void PACKED_Free(PPACKED_OBJECT ptObject) {
+    if (NULL != ptObject) {
+        free((uint16_t *)ptObject->pwCode);
+        free((PPACKED_SYMBOL)ptObject->patEntries);
+        memset(ptObject, 0, sizeof(*ptObject));
+    }
+}
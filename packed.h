@@ -0,0 +1,114 @@
+/******************************************************************************
+ * File:    packed.h
+ * Author:  Doron Shvartztuch
+ * The PACKED module formats and parses the packed object file: a compact
+ * binary form of the object, entries & externals files, that loaders can
+ * read without parsing text.
+ *
+ * The file (all the numbers are little-endian):
+ *   "ASMP"                 - magic
+ *   uint16 version         - PACKED_VERSION
+ *   uint16 reserved        - 0
+ *   uint32 code length     - in words
+ *   uint32 data length     - in words
+ *   uint32 entries         - number of records in the entries table
+ *   uint32 externals       - number of records in the externals table
+ *   uint16 words[]         - the code section and then the data section
+ *   the entries table and then the externals table. Each record is:
+ *   uint32 address, uint16 name length, the name (not null-terminated)
+ *****************************************************************************/
+
+#ifndef PACKED_H
+#define PACKED_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "global.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The version of the format */
+#define PACKED_VERSION 1
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* A record of the entries/externals table */
+typedef struct PACKED_SYMBOL {
+    /* The name (not null-terminated) */
+    const char * pcName;
+    int nNameLength;
+
+    /* The address of the entry, or the address of the use of the extern */
+    int nAddress;
+} PACKED_SYMBOL, *PPACKED_SYMBOL;
+
+/* The content of a packed object file */
+typedef struct PACKED_OBJECT {
+    /* The words of the code section and then the data section */
+    const uint16_t * pwCode;
+    int nCodeLength;
+    const uint16_t * pwData;
+    int nDataLength;
+
+    /* The tables */
+    const PACKED_SYMBOL * patEntries;
+    int nEntries;
+    const PACKED_SYMBOL * patExternals;
+    int nExternals;
+} PACKED_OBJECT, *PPACKED_OBJECT;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    PACKED_Format
+ * Purpose: Format a packed object file
+ * Parameters:
+ *          ptObject [IN] - the content of the file
+ *          ppcBuffer [OUT] - the file
+ *          pnBufferLength [OUT] - the length (in bytes) of the file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the buffer.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR PACKED_Format(const PACKED_OBJECT * ptObject,
+                         char ** ppcBuffer,
+                         int * pnBufferLength);
+
+/******************************************************************************
+ * Name:    PACKED_Parse
+ * Purpose: Parse a packed object file
+ * Parameters:
+ *          pcBuffer [IN] - the file
+ *          nBufferLength [IN] - the length (in bytes) of the file
+ *          ptObject [OUT] - the content of the file
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the caller must free the content with PACKED_Free.
+ *          The names point into the buffer, so it should be valid until
+ *          then.
+ *          GLOB_ERROR_INVALID_PARAMETERS - the file is not a valid packed
+ *                                          object file
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR PACKED_Parse(const char * pcBuffer,
+                        int nBufferLength,
+                        PPACKED_OBJECT ptObject);
+
+/******************************************************************************
+ * Name:    PACKED_Free
+ * Purpose: Free the content returned by PACKED_Parse
+ * Parameters:
+ *          ptObject [IN] - the content
+ *****************************************************************************/
+void PACKED_Free(PPACKED_OBJECT ptObject);
+
+#endif /* PACKED_H */
@@ -0,0 +1,542 @@
+/******************************************************************************
+ * File:    server.c
+ * Author:  Doron Shvartztuch
+ * The SERVER module runs the assembler as a long-lived server.
+ *
+ * Implementation:
+ * The server listens on a Unix domain socket. Each thread of the pool
+ * accepts a connection, reads the request line by line and compiles each
+ * file as soon as its line is read, so the messages of the first files are
+ * sent while the client still sends the next ones. The messages of a file
+ * are kept in a buffer and sent in one "MSG" block.
+ * The threads wait in poll for a client or for the stop pipe. A "STOP"
+ * request writes a byte to the pipe, which is never read, so the pipe
+ * stays readable and wakes all the threads. The listening socket is
+ * non-blocking, since another thread may accept the client first.
+ * (Shutting the listening socket down to wake accept works on Linux only.)
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "global.h"
+#include "buffer.h"
+#include "stats.h"
+#include "server.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The maximum number of connections that wait to be accepted */
+#define SERVER_BACKLOG 64
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The state shared by the threads of the server */
+typedef struct SERVER_STATE {
+    /* The listening socket */
+    int nListener;
+    
+    /* The compile function and its context */
+    SERVER_COMPILECALLBACK pfnCompile;
+    void * pvContext;
+    
+    /* The read and the write ends of the stop pipe. It's readable once the
+     * server is stopped. */
+    int anStopPipe[2];
+} SERVER_STATE, *PSERVER_STATE;
+
+/* A connection with a client */
+typedef struct SERVER_CLIENT {
+    /* The request and the response streams (of the same socket) */
+    FILE * phInput;
+    FILE * phOutput;
+    
+    /* The last line read from the request (without the '\n') */
+    char * pszLine;
+    size_t nLineSize;
+    
+    /* The directory of the relative names */
+    char * pszDirectory;
+} SERVER_CLIENT, *PSERVER_CLIENT;
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static BOOL server_ReadLine(PSERVER_CLIENT ptClient);
+static const char * server_GetArgument(const char * pszLine,
+                                       const char * pszKeyword);
+static GLOB_ERROR server_CompileFile(PSERVER_STATE ptState,
+                                     PSERVER_CLIENT ptClient,
+                                     const char * pszName,
+                                     const char * pcSource,
+                                     size_t nLength);
+static GLOB_ERROR server_CompileRequest(PSERVER_STATE ptState,
+                                        PSERVER_CLIENT ptClient);
+static void server_ServeClient(PSERVER_STATE ptState, int nSocket);
+static GLOB_ERROR server_RemoveStaleSocket(
+                                    const struct sockaddr_un * ptAddress);
+static void server_Stop(PSERVER_STATE ptState);
+static void * server_Thread(void * pvState);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    server_ReadLine
+ * Purpose: Read the next line of the request
+ * Parameters:
+ *          ptClient [IN] - the client. The line is read into its pszLine.
+ * Return Value:
+ *          TRUE if a line was read. FALSE at the end of the request.
+ *****************************************************************************/
+static BOOL server_ReadLine(PSERVER_CLIENT ptClient) {
+    ssize_t nLength = getline(&ptClient->pszLine, &ptClient->nLineSize,
+                              ptClient->phInput);
+    
+    if (nLength <= 0) {
+        return FALSE;
+    }
+    if ('\n' == ptClient->pszLine[nLength - 1]) {
+        ptClient->pszLine[nLength - 1] = '\0';
+    }
+    return TRUE;
+}
+
+/******************************************************************************
+ * Name:    server_GetArgument
+ * Purpose: Get the argument of a line of the protocol
+ * Parameters:
+ *          pszLine [IN] - the line
+ *          pszKeyword [IN] - the keyword the line should start with
+ * Return Value:
+ *          The argument (after the keyword and a space). NULL if the line
+ *          doesn't start with the keyword.
+ *****************************************************************************/
+static const char * server_GetArgument(const char * pszLine,
+                                       const char * pszKeyword) {
+    size_t nKeywordLength = strlen(pszKeyword);
+    
+    if (0 != strncmp(pszLine, pszKeyword, nKeywordLength)
+        || ' ' != pszLine[nKeywordLength]) {
+        return NULL;
+    }
+    return pszLine + nKeywordLength + 1;
+}
+
+/******************************************************************************
+ * Name:    server_CompileFile
+ * Purpose: Compile a file of the request and send its messages
+ * Parameters:
+ *          ptState [IN] - the server
+ *          ptClient [IN] - the client
+ *          pszName [IN] - the name of the file, as the client sent it
+ *          pcSource [IN OPTIONAL] - the source sent by the client
+ *          nLength [IN] - the length (in chars) of the source
+ * Return Value:
+ *          The result of the compilation (see SERVER_COMPILECALLBACK)
+ *****************************************************************************/
+static GLOB_ERROR server_CompileFile(PSERVER_STATE ptState,
+                                     PSERVER_CLIENT ptClient,
+                                     const char * pszName,
+                                     const char * pcSource,
+                                     size_t nLength) {
+    HBUFFER hMessages = NULL;
+    char * pszPath = NULL;
+    char * pcMessages = NULL;
+    int nMessagesLength = 0;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Relative names are relative to the directory of the client */
+    if ('/' == pszName[0]) {
+        pszPath = HELPER_ConcatStrings(pszName, "");
+    } else {
+        pszPath = HELPER_ConcatStrings(ptClient->pszDirectory, pszName);
+    }
+    if (NULL == pszPath) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    eRetValue = BUFFER_Create(&hMessages);
+    if (eRetValue) {
+        free(pszPath);
+        return eRetValue;
+    }
+    
+    /* Compile the file and send its messages */
+    eRetValue = ptState->pfnCompile(ptState->pvContext, pszName, pszPath,
+                                    pcSource, nLength, hMessages);
+    BUFFER_GetStream(hMessages, &pcMessages, &nMessagesLength);
+    fprintf(ptClient->phOutput, "%s %d\n", SERVER_RESPONSE_MESSAGES,
+            nMessagesLength);
+    fwrite(pcMessages, 1, nMessagesLength, ptClient->phOutput);
+    fflush(ptClient->phOutput);
+    
+    BUFFER_Free(hMessages);
+    free(pszPath);
+    return eRetValue;
+}
+
+/******************************************************************************
+ * Name:    server_CompileRequest
+ * Purpose: Read the files of a request (after the version line) and compile
+ *          them
+ * Parameters:
+ *          ptState [IN] - the server
+ *          ptClient [IN] - the client
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          GLOB_ERROR_PARSING_FAILED - the compilation of one or more files
+ *                                      failed
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR server_CompileRequest(PSERVER_STATE ptState,
+                                        PSERVER_CLIENT ptClient) {
+    const char * pszArgument = NULL;
+    char * pcSource = NULL;
+    char * pcEnd = NULL;
+    size_t nLength = 0;
+    BOOL bSuccess = TRUE;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* The directory of the relative names (with a '/' at the end) */
+    if (!server_ReadLine(ptClient)
+        || NULL == (pszArgument = server_GetArgument(ptClient->pszLine,
+                                                     SERVER_REQUEST_CWD))) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    ptClient->pszDirectory = HELPER_ConcatStrings(pszArgument, "/");
+    if (NULL == ptClient->pszDirectory) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Compile the files, until the end of the request */
+    while (server_ReadLine(ptClient)) {
+        if (0 == strcmp(ptClient->pszLine, SERVER_REQUEST_END)) {
+            return bSuccess ? GLOB_SUCCESS : GLOB_ERROR_PARSING_FAILED;
+        }
+        if (NULL != (pszArgument = server_GetArgument(ptClient->pszLine,
+                                                      SERVER_REQUEST_FILE))) {
+            /* The server reads the source */
+            eRetValue = server_CompileFile(ptState, ptClient, pszArgument,
+                                           NULL, 0);
+        } else if (NULL != (pszArgument = server_GetArgument(
+                                ptClient->pszLine, SERVER_REQUEST_SOURCE))) {
+            /* The source follows the line */
+            nLength = strtoul(pszArgument, &pcEnd, 10);
+            if (pcEnd == pszArgument || ' ' != *pcEnd) {
+                return GLOB_ERROR_INVALID_PARAMETERS;
+            }
+            STATS_CountAllocation(STATS_MODULE_SERVER, nLength + 1);
+            pcSource = malloc(nLength + 1);
+            if (NULL == pcSource) {
+                return GLOB_ERROR_SYS_CALL_ERROR();
+            }
+            if (nLength != fread(pcSource, 1, nLength, ptClient->phInput)) {
+                free(pcSource);
+                return GLOB_ERROR_INVALID_PARAMETERS;
+            }
+            eRetValue = server_CompileFile(ptState, ptClient, pcEnd + 1,
+                                           pcSource, nLength);
+            free(pcSource);
+        } else {
+            return GLOB_ERROR_INVALID_PARAMETERS;
+        }
+        
+        if (GLOB_ERROR_PARSING_FAILED == eRetValue) {
+            bSuccess = FALSE;
+        } else if (eRetValue) {
+            /* Fatal error. Don't compile the other files */
+            return eRetValue;
+        }
+    }
+    /* The request ended without "END" */
+    return GLOB_ERROR_INVALID_PARAMETERS;
+}
+
+/******************************************************************************
+ * Name:    server_ServeClient
+ * Purpose: Serve the request of a connected client
+ * Parameters:
+ *          ptState [IN] - the server
+ *          nSocket [IN] - the socket of the client. It is closed by the
+ *                         function.
+ *****************************************************************************/
+static void server_ServeClient(PSERVER_STATE ptState, int nSocket) {
+    SERVER_CLIENT tClient = {0};
+    const char * pszVersion = NULL;
+    int nOutputSocket = -1;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Open the streams of the request and the response */
+    nOutputSocket = dup(nSocket);
+    tClient.phInput = fdopen(nSocket, "r");
+    tClient.phOutput = (-1 == nOutputSocket) ? NULL
+                                             : fdopen(nOutputSocket, "w");
+    if (NULL == tClient.phInput || NULL == tClient.phOutput) {
+        if (NULL != tClient.phInput) {
+            fclose(tClient.phInput);
+        } else {
+            close(nSocket);
+        }
+        if (NULL != tClient.phOutput) {
+            fclose(tClient.phOutput);
+        } else if (-1 != nOutputSocket) {
+            close(nOutputSocket);
+        }
+        return;
+    }
+    
+    /* The first line is the version, or a request to stop the server */
+    if (!server_ReadLine(&tClient)) {
+        eRetValue = GLOB_ERROR_INVALID_PARAMETERS;
+    } else if (0 == strcmp(tClient.pszLine, SERVER_REQUEST_STOP)) {
+        server_Stop(ptState);
+        eRetValue = GLOB_SUCCESS;
+    } else {
+        pszVersion = server_GetArgument(tClient.pszLine,
+                                        SERVER_REQUEST_VERSION);
+        if (NULL == pszVersion || 0 != strcmp(pszVersion, GLOB_ASM_VERSION)) {
+            eRetValue = GLOB_ERROR_INVALID_PARAMETERS;
+        } else {
+            eRetValue = server_CompileRequest(ptState, &tClient);
+        }
+    }
+    
+    /* Send the result */
+    fprintf(tClient.phOutput, "%s %d\n", SERVER_RESPONSE_RESULT, eRetValue);
+    fclose(tClient.phOutput);
+    fclose(tClient.phInput);
+    free(tClient.pszLine);
+    free(tClient.pszDirectory);
+}
+
+/******************************************************************************
+ * Name:    server_RemoveStaleSocket
+ * Purpose: Remove the socket of a server that didn't stop cleanly from the
+ *          path of the socket
+ * Parameters:
+ *          ptAddress [IN] - the address (path) of the socket
+ * Return Value:
+ *          Upon successful completion (the path is free), GLOB_SUCCESS is
+ *          returned.
+ *          GLOB_ERROR_ALREADY_EXIST - the path is not a socket, or it is the
+ *                                     socket of a running server
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR server_RemoveStaleSocket(
+                                    const struct sockaddr_un * ptAddress) {
+    struct stat tStat;
+    int nSocket = -1;
+    int nResult = 0;
+    
+    if (0 != lstat(ptAddress->sun_path, &tStat)) {
+        return (ENOENT == errno) ? GLOB_SUCCESS : GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* Never remove a file that isn't a socket (a mistyped path) */
+    if (!S_ISSOCK(tStat.st_mode)) {
+        return GLOB_ERROR_ALREADY_EXIST;
+    }
+    
+    /* A socket that accepts a connection belongs to a running server. Only a
+     * refused connection means that nobody listens on it. */
+    nSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == nSocket) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    nResult = connect(nSocket, (const struct sockaddr *)ptAddress,
+                      sizeof(*ptAddress));
+    if (0 == nResult) {
+        close(nSocket);
+        return GLOB_ERROR_ALREADY_EXIST;
+    }
+    if (ECONNREFUSED != errno) {
+        nResult = GLOB_ERROR_SYS_CALL_ERROR();
+        close(nSocket);
+        return nResult;
+    }
+    close(nSocket);
+    
+    if (0 != unlink(ptAddress->sun_path)) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    server_Stop
+ * Purpose: Stop the server. All the threads return before they serve the
+ *          next client.
+ * Parameters:
+ *          ptState [IN] - the server
+ *****************************************************************************/
+static void server_Stop(PSERVER_STATE ptState) {
+    /* The byte is never read, so the pipe stays readable */
+    while (-1 == write(ptState->anStopPipe[1], "", 1) && EINTR == errno) {
+        continue;
+    }
+}
+
+/******************************************************************************
+ * Name:    server_Thread
+ * Purpose: The entry point of a thread of the server. The thread serves the
+ *          clients until the server is stopped.
+ * Parameters:
+ *          pvState [IN] - pointer to the SERVER_STATE
+ * Return Value:
+ *          NULL
+ *****************************************************************************/
+static void * server_Thread(void * pvState) {
+    PSERVER_STATE ptState = (PSERVER_STATE)pvState;
+    struct pollfd atWaited[2];
+    int nSocket = -1;
+    
+    atWaited[0].fd = ptState->anStopPipe[0];
+    atWaited[0].events = POLLIN;
+    atWaited[1].fd = ptState->nListener;
+    atWaited[1].events = POLLIN;
+    
+    while (TRUE) {
+        /* Wait for a client, or for the server to stop */
+        if (-1 == poll(atWaited, 2, -1)) {
+            continue;
+        }
+        if (0 != atWaited[0].revents) {
+            return NULL;
+        }
+        
+        nSocket = accept(ptState->nListener, NULL, NULL);
+        if (-1 == nSocket) {
+            /* Another thread accepted the client, or the client closed the
+             * connection. Wait again. */
+            continue;
+        }
+        
+        /* On some systems the socket inherits the non-blocking mode of the
+         * listening socket */
+        fcntl(nSocket, F_SETFL, fcntl(nSocket, F_GETFL) & ~O_NONBLOCK);
+        server_ServeClient(ptState, nSocket);
+    }
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    SERVER_Run
+ *****************************************************************************/
+GLOB_ERROR SERVER_Run(const char * szSocketPath,
+                      int nThreads,
+                      SERVER_COMPILECALLBACK pfnCompile,
+                      void * pvContext) {
+    SERVER_STATE tState;
+    struct sockaddr_un tAddress;
+    pthread_t * patThreads = NULL;
+    int nStartedThreads = 0;
+    mode_t nOldMask = 0;
+    int nResult = 0;
+    GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    
+    /* Check parameters */
+    if (NULL == szSocketPath || nThreads < 1 || NULL == pfnCompile
+        || strlen(szSocketPath) >= sizeof(tAddress.sun_path)) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* A client that closes its connection shouldn't kill the server */
+    signal(SIGPIPE, SIG_IGN);
+    
+    /* Listen on the socket */
+    memset(&tAddress, 0, sizeof(tAddress));
+    tAddress.sun_family = AF_UNIX;
+    strcpy(tAddress.sun_path, szSocketPath);
+    eRetValue = server_RemoveStaleSocket(&tAddress);
+    if (eRetValue) {
+        return eRetValue;
+    }
+    memset(&tState, 0, sizeof(tState));
+    tState.pfnCompile = pfnCompile;
+    tState.pvContext = pvContext;
+    if (0 != pipe(tState.anStopPipe)) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    tState.nListener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == tState.nListener) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        close(tState.anStopPipe[0]);
+        close(tState.anStopPipe[1]);
+        return eRetValue;
+    }
+    
+    /* The clients compile files with the permissions of the server, so only
+     * its user may connect. The socket file is created without the
+     * permissions of the group and the others (the threads aren't started
+     * yet, so changing the umask of the process is safe). */
+    nOldMask = umask(S_IRWXG | S_IRWXO);
+    nResult = bind(tState.nListener, (struct sockaddr *)&tAddress,
+                   sizeof(tAddress));
+    umask(nOldMask);
+    if (0 != nResult || 0 != listen(tState.nListener, SERVER_BACKLOG)
+        || -1 == fcntl(tState.nListener, F_SETFL,
+                       fcntl(tState.nListener, F_GETFL) | O_NONBLOCK)) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        close(tState.nListener);
+        close(tState.anStopPipe[0]);
+        close(tState.anStopPipe[1]);
+        return eRetValue;
+    }
+    
+    /* Start the threads */
+    STATS_CountAllocation(STATS_MODULE_SERVER, nThreads * sizeof(*patThreads));
+    patThreads = malloc(nThreads * sizeof(*patThreads));
+    if (NULL == patThreads) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        close(tState.nListener);
+        close(tState.anStopPipe[0]);
+        close(tState.anStopPipe[1]);
+        unlink(szSocketPath);
+        return eRetValue;
+    }
+    for (nStartedThreads = 0; nStartedThreads < nThreads; nStartedThreads++) {
+        if (0 != pthread_create(&patThreads[nStartedThreads], NULL,
+                                server_Thread, &tState)) {
+            eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+            
+            /* Stop the started threads */
+            server_Stop(&tState);
+            break;
+        }
+    }
+    
+    /* Wait until the server is stopped */
+    for (int nIndex = 0; nIndex < nStartedThreads; nIndex++) {
+        pthread_join(patThreads[nIndex], NULL);
+    }
+    free(patThreads);
+    close(tState.nListener);
+    close(tState.anStopPipe[0]);
+    close(tState.anStopPipe[1]);
+    unlink(szSocketPath);
+    return eRetValue;
+}
@@ -0,0 +1,107 @@
+/******************************************************************************
+ * File:    server.h
+ * Author:  Doron Shvartztuch
+ * The SERVER module runs the assembler as a long-lived server, that compiles
+ * files for clients (see asmc.c) that connect to it with a Unix domain
+ * socket. The server saves the start of a new process for each build step.
+ *
+ * The protocol is text lines, ended with '\n':
+ * Request:  "ASM <version>"            - must be GLOB_ASM_VERSION
+ *           "CWD <directory>"          - the directory of the relative names
+ *           "FILE <name>"              - compile <name>.as (w/o extension)
+ *           "SOURCE <length> <name>"   - compile the <length> chars that
+ *                                        follow the line, as <name>.as
+ *           ...                        - more FILE/SOURCE lines
+ *           "END"
+ *           Or just "STOP", to stop the server.
+ * Response: "MSG <length>"             - followed by the messages of a file
+ *           ...                        - the messages of the other files
+ *           "RESULT <code>"            - the exit code (like the CLI)
+ * The output files are written by the server, next to the source.
+ *****************************************************************************/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stddef.h>
+#include "global.h"
+#include "buffer.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The protocol keywords */
+#define SERVER_REQUEST_VERSION "ASM"
+#define SERVER_REQUEST_CWD "CWD"
+#define SERVER_REQUEST_FILE "FILE"
+#define SERVER_REQUEST_SOURCE "SOURCE"
+#define SERVER_REQUEST_END "END"
+#define SERVER_REQUEST_STOP "STOP"
+#define SERVER_RESPONSE_MESSAGES "MSG"
+#define SERVER_RESPONSE_RESULT "RESULT"
+
+/* The environment variable with the path of the socket, and its default */
+#define SERVER_SOCKET_VARIABLE "ASM_SERVER"
+#define SERVER_DEFAULT_SOCKET "/tmp/asm.sock"
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    SERVER_COMPILECALLBACK
+ * Purpose: Compile a file of a request and write its output files
+ * Parameters:
+ *          pvContext [IN] - the context passed to SERVER_Run
+ *          pszName [IN] - the name of the file, as the client sent it (for
+ *                         the messages)
+ *          pszPath [IN] - the path to the file (w/o the extension), for the
+ *                         output files
+ *          pcSource [IN OPTIONAL] - the source sent by the client. If NULL,
+ *                                   the source is read from the path.
+ *          nLength [IN] - the length (in chars) of the source
+ *          hMessages [IN] - the buffer of the messages of the file
+ * Return Value:
+ *          Same as ASM_Compile.
+ * Remark:  The callback is called by several threads at once
+ *****************************************************************************/
+typedef GLOB_ERROR (*SERVER_COMPILECALLBACK)(void * pvContext,
+                                             const char * pszName,
+                                             const char * pszPath,
+                                             const char * pcSource,
+                                             size_t nLength,
+                                             HBUFFER hMessages);
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    SERVER_Run
+ * Purpose: Listen on a socket and serve the clients until a client asks to
+ *          stop the server
+ * Parameters:
+ *          szSocketPath [IN] - the path of the Unix domain socket
+ *          nThreads [IN] - number of the threads that serve the clients
+ *          pfnCompile [IN] - the function that compiles a file
+ *          pvContext [IN] - context for the compile function
+ * Return Value:
+ *          Upon successful completion (the server was stopped), GLOB_SUCCESS
+ *          is returned.
+ *          If the function fails, an error code is returned.
+ * Remark:  A stale socket in the path (of a server that didn't stop
+ *          cleanly) is replaced. Any other file in the path, or the socket
+ *          of a running server, is kept, and GLOB_ERROR_ALREADY_EXIST is
+ *          returned. Only the user that runs the server may connect to the
+ *          socket.
+ *****************************************************************************/
+GLOB_ERROR SERVER_Run(const char * szSocketPath,
+                      int nThreads,
+                      SERVER_COMPILECALLBACK pfnCompile,
+                      void * pvContext);
+
+#endif /* SERVER_H */
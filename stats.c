@@ -0,0 +1,203 @@
+/******************************************************************************
+ * File:    stats.c
+ * Author:  Doron Shvartztuch
+ * The STATS module collects statistics of the compilation.
+ *
+ * Implementation:
+ * Each thread has a pointer to the structure it collects into, so the worker
+ * threads of the driver don't share anything. When the pointer is NULL, the
+ * functions return at once and the time is not measured.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include "global.h"
+#include "stats.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* Conversion of the times */
+#define NANOSECONDS_IN_SECOND 1000000000LL
+#define NANOSECONDS_IN_MILLISECOND 1000000.0
+
+/******************************************************************************
+ * CONSTANTS
+ *****************************************************************************/
+
+/* The names of the phases, counters and modules (for the printing) */
+static const char * g_aszPhaseNames[STATS_PHASE_COUNT] = {
+    "first_phase",
+    "symtable_finalize",
+    "resolve_fixups",
+    "prepare_entries",
+    "write_object",
+    "write_externals",
+    "write_entries",
+    "write_packed",
+};
+static const char * g_aszCounterNames[STATS_COUNTER_COUNT] = {
+    "files",
+    "lines",
+    "tokens",
+    "symbols",
+    "cache_hits",
+};
+static const char * g_aszModuleNames[STATS_MODULE_COUNT] = {
+    "LEX",
+    "LINESTR",
+    "ARENA",
+    "SYMTABLE",
+    "MEMSTREAM",
+    "BUFFER",
+    "ASM",
+    "OUTPUT",
+    "INTERN",
+    "WRITER",
+    "CACHE",
+    "SERVER",
+    "PACKED",
+    "MACHINE",
+    "LINKER",
+};
+
+/******************************************************************************
+ * GLOBALS
+ *****************************************************************************/
+
+/* The statistics of the calling thread (NULL if they are not collected) */
+static _Thread_local PSTATS g_ptCurrent = NULL;
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    STATS_SetCurrent
+ *****************************************************************************/
+void STATS_SetCurrent(PSTATS ptStats) {
+    g_ptCurrent = ptStats;
+}
+
+/******************************************************************************
+ * Name:    STATS_GetCurrent
+ *****************************************************************************/
+PSTATS STATS_GetCurrent(void) {
+    return g_ptCurrent;
+}
+
+/******************************************************************************
+ * Name:    STATS_StartPhase
+ *****************************************************************************/
+long long STATS_StartPhase(void) {
+    struct timespec tNow;
+    
+    if (NULL == g_ptCurrent) {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &tNow);
+    return tNow.tv_sec * NANOSECONDS_IN_SECOND + tNow.tv_nsec;
+}
+
+/******************************************************************************
+ * Name:    STATS_EndPhase
+ *****************************************************************************/
+void STATS_EndPhase(STATS_PHASE ePhase, long long nStartTime) {
+    if (NULL == g_ptCurrent) {
+        return;
+    }
+    g_ptCurrent->anPhaseNanoseconds[ePhase] +=
+            STATS_StartPhase() - nStartTime;
+}
+
+/******************************************************************************
+ * Name:    STATS_Count
+ *****************************************************************************/
+void STATS_Count(STATS_COUNTER eCounter, int nCount) {
+    if (NULL != g_ptCurrent) {
+        g_ptCurrent->anCounters[eCounter] += nCount;
+    }
+}
+
+/******************************************************************************
+ * Name:    STATS_CountAllocation
+ *****************************************************************************/
+void STATS_CountAllocation(STATS_MODULE eModule, size_t nBytes) {
+    if (NULL != g_ptCurrent) {
+        g_ptCurrent->anAllocations[eModule]++;
+        g_ptCurrent->anAllocatedBytes[eModule] += nBytes;
+    }
+}
+
+/******************************************************************************
+ * Name:    STATS_Add
+ *****************************************************************************/
+void STATS_Add(PSTATS ptTotal, const STATS * ptStats) {
+    for (int nIndex = 0; nIndex < STATS_PHASE_COUNT; nIndex++) {
+        ptTotal->anPhaseNanoseconds[nIndex] +=
+                ptStats->anPhaseNanoseconds[nIndex];
+    }
+    for (int nIndex = 0; nIndex < STATS_COUNTER_COUNT; nIndex++) {
+        ptTotal->anCounters[nIndex] += ptStats->anCounters[nIndex];
+    }
+    for (int nIndex = 0; nIndex < STATS_MODULE_COUNT; nIndex++) {
+        ptTotal->anAllocations[nIndex] += ptStats->anAllocations[nIndex];
+        ptTotal->anAllocatedBytes[nIndex] += ptStats->anAllocatedBytes[nIndex];
+    }
+}
+
+/******************************************************************************
+ * Name:    STATS_Print
+ *****************************************************************************/
+void STATS_Print(FILE * pfOutput, const STATS * ptStats, BOOL bIsJson) {
+    double dMilliseconds = 0;
+    
+    if (bIsJson) {
+        fprintf(pfOutput, "{\"phases_ms\": {");
+        for (int nIndex = 0; nIndex < STATS_PHASE_COUNT; nIndex++) {
+            dMilliseconds = ptStats->anPhaseNanoseconds[nIndex]
+                            / NANOSECONDS_IN_MILLISECOND;
+            fprintf(pfOutput, "%s\"%s\": %.3f", nIndex ? ", " : "",
+                    g_aszPhaseNames[nIndex], dMilliseconds);
+        }
+        fprintf(pfOutput, "}, \"counters\": {");
+        for (int nIndex = 0; nIndex < STATS_COUNTER_COUNT; nIndex++) {
+            fprintf(pfOutput, "%s\"%s\": %lld", nIndex ? ", " : "",
+                    g_aszCounterNames[nIndex], ptStats->anCounters[nIndex]);
+        }
+        fprintf(pfOutput, "}, \"allocations\": {");
+        for (int nIndex = 0; nIndex < STATS_MODULE_COUNT; nIndex++) {
+            fprintf(pfOutput, "%s\"%s\": {\"count\": %lld, \"bytes\": %lld}",
+                    nIndex ? ", " : "", g_aszModuleNames[nIndex],
+                    ptStats->anAllocations[nIndex],
+                    ptStats->anAllocatedBytes[nIndex]);
+        }
+        fprintf(pfOutput, "}}\n");
+        return;
+    }
+    
+    fprintf(pfOutput, "Statistics:\n");
+    for (int nIndex = 0; nIndex < STATS_PHASE_COUNT; nIndex++) {
+        dMilliseconds = ptStats->anPhaseNanoseconds[nIndex]
+                        / NANOSECONDS_IN_MILLISECOND;
+        fprintf(pfOutput, "  %-20s %12.3f ms\n",
+                g_aszPhaseNames[nIndex], dMilliseconds);
+    }
+    for (int nIndex = 0; nIndex < STATS_COUNTER_COUNT; nIndex++) {
+        fprintf(pfOutput, "  %-20s %12lld\n",
+                g_aszCounterNames[nIndex], ptStats->anCounters[nIndex]);
+    }
+    for (int nIndex = 0; nIndex < STATS_MODULE_COUNT; nIndex++) {
+        fprintf(pfOutput, "  %-20s %12lld allocation(s) %12lld byte(s)\n",
+                g_aszModuleNames[nIndex], ptStats->anAllocations[nIndex],
+                ptStats->anAllocatedBytes[nIndex]);
+    }
+}
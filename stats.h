@@ -0,0 +1,164 @@
+/******************************************************************************
+ * File:    stats.h
+ * Author:  Doron Shvartztuch
+ * The STATS module collects statistics of the compilation: the time of each
+ * phase, the number of lines/tokens/symbols and the memory allocations of
+ * each module.
+ * The statistics are collected into the STATS structure that was set as the
+ * current one of the calling thread. If no structure was set, nothing is
+ * collected.
+ *****************************************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include "global.h"
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The measured phases of the compilation */
+typedef enum STATS_PHASE {
+    STATS_PHASE_FIRST_PHASE,
+    STATS_PHASE_SYMTABLE_FINALIZE,
+    STATS_PHASE_RESOLVE_FIXUPS,
+    STATS_PHASE_PREPARE_ENTRIES,
+    STATS_PHASE_WRITE_OBJECT,
+    STATS_PHASE_WRITE_EXTERNALS,
+    STATS_PHASE_WRITE_ENTRIES,
+    STATS_PHASE_WRITE_PACKED,
+    
+    /* The number of phases */
+    STATS_PHASE_COUNT
+} STATS_PHASE;
+
+/* The counted items */
+typedef enum STATS_COUNTER {
+    STATS_COUNTER_FILES,
+    STATS_COUNTER_LINES,
+    STATS_COUNTER_TOKENS,
+    STATS_COUNTER_SYMBOLS,
+    STATS_COUNTER_CACHE_HITS,
+    
+    /* The number of counters */
+    STATS_COUNTER_COUNT
+} STATS_COUNTER;
+
+/* The modules that allocate memory */
+typedef enum STATS_MODULE {
+    STATS_MODULE_LEX,
+    STATS_MODULE_LINESTR,
+    STATS_MODULE_ARENA,
+    STATS_MODULE_SYMTABLE,
+    STATS_MODULE_MEMSTREAM,
+    STATS_MODULE_BUFFER,
+    STATS_MODULE_ASM,
+    STATS_MODULE_OUTPUT,
+    STATS_MODULE_INTERN,
+    STATS_MODULE_WRITER,
+    STATS_MODULE_CACHE,
+    STATS_MODULE_SERVER,
+    STATS_MODULE_PACKED,
+    STATS_MODULE_MACHINE,
+    STATS_MODULE_LINKER,
+    
+    /* The number of modules */
+    STATS_MODULE_COUNT
+} STATS_MODULE;
+
+/* The statistics of one or more compiled files. Init it with zeros. */
+typedef struct STATS {
+    /* The wall time (in nanoseconds) of each phase */
+    long long anPhaseNanoseconds[STATS_PHASE_COUNT];
+    
+    /* The value of each counter */
+    long long anCounters[STATS_COUNTER_COUNT];
+    
+    /* The number of calls to malloc/realloc and the requested bytes of each
+     * module */
+    long long anAllocations[STATS_MODULE_COUNT];
+    long long anAllocatedBytes[STATS_MODULE_COUNT];
+} STATS, *PSTATS;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    STATS_SetCurrent
+ * Purpose: Set the structure that collects the statistics of the calling
+ *          thread
+ * Parameters:
+ *          ptStats [IN] - the statistics. NULL stops the collection.
+ *****************************************************************************/
+void STATS_SetCurrent(PSTATS ptStats);
+
+/******************************************************************************
+ * Name:    STATS_GetCurrent
+ * Purpose: Get the structure that collects the statistics of the calling
+ *          thread
+ * Return Value:
+ *          The statistics. NULL if they are not collected.
+ *****************************************************************************/
+PSTATS STATS_GetCurrent(void);
+
+/******************************************************************************
+ * Name:    STATS_StartPhase
+ * Purpose: Get the start time of a phase
+ * Return Value:
+ *          The start time, to pass to STATS_EndPhase
+ *****************************************************************************/
+long long STATS_StartPhase(void);
+
+/******************************************************************************
+ * Name:    STATS_EndPhase
+ * Purpose: Add the time since the start of a phase to the phase
+ * Parameters:
+ *          ePhase [IN] - the phase
+ *          nStartTime [IN] - the value returned by STATS_StartPhase
+ *****************************************************************************/
+void STATS_EndPhase(STATS_PHASE ePhase, long long nStartTime);
+
+/******************************************************************************
+ * Name:    STATS_Count
+ * Purpose: Add to a counter
+ * Parameters:
+ *          eCounter [IN] - the counter
+ *          nCount [IN] - the value to add
+ *****************************************************************************/
+void STATS_Count(STATS_COUNTER eCounter, int nCount);
+
+/******************************************************************************
+ * Name:    STATS_CountAllocation
+ * Purpose: Count a call to malloc/realloc of a module
+ * Parameters:
+ *          eModule [IN] - the module
+ *          nBytes [IN] - the requested size (in bytes)
+ *****************************************************************************/
+void STATS_CountAllocation(STATS_MODULE eModule, size_t nBytes);
+
+/******************************************************************************
+ * Name:    STATS_Add
+ * Purpose: Add statistics to other statistics
+ * Parameters:
+ *          ptTotal [IN OUT] - the statistics to add to
+ *          ptStats [IN] - the statistics to add
+ *****************************************************************************/
+void STATS_Add(PSTATS ptTotal, const STATS * ptStats);
+
+/******************************************************************************
+ * Name:    STATS_Print
+ * Purpose: Print the statistics
+ * Parameters:
+ *          pfOutput [IN] - the stream to print to
+ *          ptStats [IN] - the statistics
+ *          bIsJson [IN] - TRUE to print a JSON object. FALSE for a table.
+ *****************************************************************************/
+void STATS_Print(FILE * pfOutput, const STATS * ptStats, BOOL bIsJson);
+
+#endif /* STATS_H */
@@ -7,6 +7,9 @@
  * Implementation:
  * The table is implemented as an array allocated on dynamic memory. In case
  * there is not enough space, we use the realloc method to expand.
+ * The records are kept in the array by insertion order. The symbols are
+ * identified by the ids of their names (see INTERN), so to find a symbol we
+ * keep an additional array with the index of the record of each name id.
  *****************************************************************************/
 
 /******************************************************************************
@@ -15,7 +18,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "helper.h"
+#include "intern.h"
 #include "symtable.h"
+#include "stats.h"
 
 /******************************************************************************
  * CONSTANTS & MACROS
@@ -27,6 +33,12 @@
 /* The expand factor to use when the table is full */
 #define SYMTABLE_ALLOCATION_FACTOR 2
 
+/* The default size (in name ids) of the index */
+#define SYMTABLE_DEFAULT_INDEX_SIZE 16
+
+/* Value of a name id without a record in the index */
+#define SYMTABLE_NO_RECORD (-1)
+
 /******************************************************************************
  * TYPEDEFS
  *****************************************************************************/
@@ -34,8 +46,8 @@
 /* The struct that represents a record in the table */
 typedef struct SYMTABLE_RECORD {
     
-    /* The symbol name. Saved on dynamic memory allocated separated. */
-    char * pszName;
+    /* The id of the symbol name */
+    int nNameId;
     
     /* Symbol Type */
     SYMTABLE_SYMTYPE eType;
@@ -48,6 +60,11 @@ typedef struct SYMTABLE_RECORD {
     
     /* Whether this symbol is for export */
     BOOL bMarkedForExport;
+    
+    /* Whether this symbol was inserted (and not only marked for export).
+     * The address can't tell it: the first data symbol has the address 0
+     * until the table is finalized. */
+    BOOL bIsDefined;
 } SYMTABLE_RECORD, *PSYMTABLE_RECORD;
 
 /* SYMTABLE_TABLE is the struct behind the the HSYMTABLE_TABLE.
@@ -59,6 +76,9 @@ struct SYMTABLE_TABLE {
      * Changes cannot be made for finalized tables. */
     BOOL bIsFinalized;
     
+    /* The names of the symbols */
+    HINTERN_TABLE hNames;
+    
     /* Number of allocated records in the table (array) */
     int nAllocatedRecords;
     
@@ -67,6 +87,13 @@ struct SYMTABLE_TABLE {
     
     /* Pointer to the table (array) */
     PSYMTABLE_RECORD patTable;
+    
+    /* Number of name ids in the index */
+    int nIndexSize;
+    
+    /* The index. For each name id, the index of its record in patTable
+     * or SYMTABLE_NO_RECORD */
+    int * panIndex;
 };
 
 /******************************************************************************
@@ -74,9 +101,10 @@ struct SYMTABLE_TABLE {
  * -------------------------------
  * See function-level documentation next to the implementation below
  *****************************************************************************/
-static int symtable_FindSymbol(HSYMTABLE_TABLE table, const char *name);
+static int symtable_FindSymbol(HSYMTABLE_TABLE hTable, int nNameId);
+static GLOB_ERROR symtable_ExpandIndex(HSYMTABLE_TABLE hTable, int nNameId);
 static GLOB_ERROR symtable_InsertRecord(HSYMTABLE_TABLE hTable,
-                                        const char *pszName,
+                                        int nNameId,
                                         SYMTABLE_SYMTYPE eType,
                                         int nAddress,
                                         BOOL isExtern,
@@ -91,18 +119,53 @@ static GLOB_ERROR symtable_InsertRecord(HSYMTABLE_TABLE hTable,
  * Purpose: find a symbol in the table
  * Parameters:
  *          hTable [IN] - the handle to the symbols table
- *          pszName [IN] - the symbol name
+ *          nNameId [IN] - the id of the symbol name
  * Return Value:
  *          The index of the symbol in the array. -1 if not found.
  *****************************************************************************/
-static int symtable_FindSymbol(HSYMTABLE_TABLE hTable, const char *pszName) {
-    for (int nIndex = 0; nIndex < hTable->nUsedRecords; nIndex++) {
-        /* Symbols name are case-sensitive */
-        if (0 == strcmp(pszName, hTable->patTable[nIndex].pszName)) {
-            return nIndex;
-        }
+static int symtable_FindSymbol(HSYMTABLE_TABLE hTable, int nNameId) {
+    if (nNameId < 0 || nNameId >= hTable->nIndexSize) {
+        return SYMTABLE_NO_RECORD;
     }
-    return -1;
+    
+    /* SYMTABLE_NO_RECORD is -1, which means "not found" */
+    return hTable->panIndex[nNameId];
+}
+
+/******************************************************************************
+ * Name:    symtable_ExpandIndex
+ * Purpose: expand the index so it contains a name id
+ * Parameters:
+ *          hTable [IN] - the handle to the symbols table
+ *          nNameId [IN] - the name id
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+static GLOB_ERROR symtable_ExpandIndex(HSYMTABLE_TABLE hTable, int nNameId) {
+    int * panNewIndex = NULL;
+    int nNewIndexSize = 0;
+    
+    /* Calculate the new size */
+    nNewIndexSize = MAX(SYMTABLE_ALLOCATION_FACTOR * hTable->nIndexSize,
+                        nNameId + 1);
+    
+    /* try to reallocate the memory */
+    STATS_CountAllocation(STATS_MODULE_SYMTABLE,
+                          nNewIndexSize * sizeof(*panNewIndex));
+    panNewIndex = realloc(hTable->panIndex,
+                          nNewIndexSize * sizeof(*panNewIndex));
+    if (NULL == panNewIndex) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    
+    /* The new name ids don't have records */
+    for (int nId = hTable->nIndexSize; nId < nNewIndexSize; nId++) {
+        panNewIndex[nId] = SYMTABLE_NO_RECORD;
+    }
+    hTable->panIndex = panNewIndex;
+    hTable->nIndexSize = nNewIndexSize;
+    return GLOB_SUCCESS;
 }
 
 /******************************************************************************
@@ -110,24 +173,35 @@ static int symtable_FindSymbol(HSYMTABLE_TABLE hTable, const char *pszName) {
  * Purpose: Insert a new record the table
  * Parameters:
  *          hTable [IN] - the handle to the symbols table
- *          pszName [IN] - the symbol name to insert
+ *          nNameId [IN] - the id of the symbol name to insert
  *          eType [IN] - the type of the symbol. meaningless for extern symbols
  *          nAddress [IN] - the address of the symbol. 0 for extern symbols
  *          bIsExtern [IN] - whether the symbol is declared as extern.
- *          bMarkedForExport [IN] - whether the symbol is for export
+ *          bMarkedForExport [IN] - whether the symbol is for export (then
+ *                                   it is not defined yet)
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
  *          If the function fails, an error code is returned.
+ * Remark:  The caller should check the symbol doesn't exist in the table.
  *****************************************************************************/
 static GLOB_ERROR symtable_InsertRecord(HSYMTABLE_TABLE hTable,
-                                        const char *pszName,
+                                        int nNameId,
                                         SYMTABLE_SYMTYPE eType,
                                         int nAddress,
                                         BOOL bIsExtern,
                                         BOOL bMarkedForExport) {
     PSYMTABLE_RECORD patNewTable = NULL;
     int newAllocatedRecords = 0;
-
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check if the index should be expanded */
+    if (nNameId >= hTable->nIndexSize) {
+        eRetValue = symtable_ExpandIndex(hTable, nNameId);
+        if (eRetValue) {
+            return eRetValue;
+        }
+    }
+    
     /* Check if the table is full */
     if (hTable->nUsedRecords == hTable->nAllocatedRecords) {
         /* Table is full, exapnd it*/
@@ -137,6 +211,8 @@ static GLOB_ERROR symtable_InsertRecord(HSYMTABLE_TABLE hTable,
                 SYMTABLE_ALLOCATION_FACTOR * hTable->nAllocatedRecords;
         
         /* try to reallocate the memory */
+        STATS_CountAllocation(STATS_MODULE_SYMTABLE,
+                              newAllocatedRecords * sizeof(*patNewTable));
         patNewTable = realloc(hTable->patTable,
                               newAllocatedRecords * sizeof(*patNewTable));
         if (NULL == patNewTable) {
@@ -149,22 +225,21 @@ static GLOB_ERROR symtable_InsertRecord(HSYMTABLE_TABLE hTable,
     }
     
     /* Now we are sure there is an empty space in the table. */
-
-    /* Allocate memory for the symbol name. take one extra char for '\0'*/
-    hTable->patTable[hTable->nUsedRecords].pszName = malloc(strlen(pszName)+1);
-    if (NULL == hTable->patTable[hTable->nUsedRecords].pszName) {
-        return GLOB_ERROR_SYS_CALL_ERROR();
-    }
     
     /* Set the fields */
-    strcpy(hTable->patTable[hTable->nUsedRecords].pszName, pszName);
+    hTable->patTable[hTable->nUsedRecords].nNameId = nNameId;
     hTable->patTable[hTable->nUsedRecords].eType = eType;
     hTable->patTable[hTable->nUsedRecords].nAddress = nAddress;
     hTable->patTable[hTable->nUsedRecords].bIsExtern = bIsExtern;
     hTable->patTable[hTable->nUsedRecords].bMarkedForExport = bMarkedForExport;
+    hTable->patTable[hTable->nUsedRecords].bIsDefined = !bMarkedForExport;
+    
+    /* Add the record to the index */
+    hTable->panIndex[nNameId] = hTable->nUsedRecords;
     
     /* Update number of used records */
     hTable->nUsedRecords++;
+    STATS_Count(STATS_COUNTER_SYMBOLS, 1);
     return GLOB_SUCCESS;
 }
 
@@ -177,21 +252,24 @@ static GLOB_ERROR symtable_InsertRecord(HSYMTABLE_TABLE hTable,
 /******************************************************************************
  * Name:    SYMTABLE_Create
  *****************************************************************************/
-GLOB_ERROR SYMTABLE_Create(HSYMTABLE_TABLE *phTable) {
+GLOB_ERROR SYMTABLE_Create(HINTERN_TABLE hNames, HSYMTABLE_TABLE *phTable) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
     HSYMTABLE_TABLE  hTable = NULL;
-
+    
     /* Check parameters */
-    if (NULL == phTable) {
+    if (NULL == hNames || NULL == phTable) {
         return GLOB_ERROR_INVALID_PARAMETERS;
     }
     /* Allocate the handle structure */
+    STATS_CountAllocation(STATS_MODULE_SYMTABLE, sizeof(*hTable));
     hTable = (HSYMTABLE_TABLE)malloc(sizeof(*hTable));
     if (NULL == hTable) {
         return GLOB_ERROR_SYS_CALL_ERROR();
     }
     
     /* Allocate the table in the default size */
+    STATS_CountAllocation(STATS_MODULE_SYMTABLE,
+                          SYMTABLE_DEFAULT_TABLE_SIZE * sizeof(SYMTABLE_RECORD));
     hTable->patTable = (PSYMTABLE_RECORD)malloc(SYMTABLE_DEFAULT_TABLE_SIZE * sizeof(SYMTABLE_RECORD));
     if(NULL == hTable->patTable) {
         eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
@@ -199,7 +277,23 @@ GLOB_ERROR SYMTABLE_Create(HSYMTABLE_TABLE *phTable) {
         return eRetValue;
     }
     
+    /* Allocate the index in the default size. No name has a record. */
+    STATS_CountAllocation(STATS_MODULE_SYMTABLE,
+                          SYMTABLE_DEFAULT_INDEX_SIZE * sizeof(int));
+    hTable->panIndex = malloc(SYMTABLE_DEFAULT_INDEX_SIZE * sizeof(int));
+    if (NULL == hTable->panIndex) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        free(hTable->patTable);
+        free(hTable);
+        return eRetValue;
+    }
+    for (int nId = 0; nId < SYMTABLE_DEFAULT_INDEX_SIZE; nId++) {
+        hTable->panIndex[nId] = SYMTABLE_NO_RECORD;
+    }
+    
     /* Init fields and set out parameters */
+    hTable->hNames = hNames;
+    hTable->nIndexSize = SYMTABLE_DEFAULT_INDEX_SIZE;
     hTable->nAllocatedRecords = SYMTABLE_DEFAULT_TABLE_SIZE;
     hTable->nUsedRecords = 0;
     hTable->bIsFinalized = FALSE;
@@ -211,14 +305,14 @@ GLOB_ERROR SYMTABLE_Create(HSYMTABLE_TABLE *phTable) {
  * Name:    SYMTABLE_Insert
  *****************************************************************************/
 GLOB_ERROR SYMTABLE_Insert(HSYMTABLE_TABLE hTable,
-                           const char *pszName,
+                           int nNameId,
                            SYMTABLE_SYMTYPE eType,
                            int nAddress,
                            BOOL bIsExtern) {
     int nIndex = 0;
     
     /* Check parameters */
-    if (NULL == hTable) {
+    if (NULL == hTable || nNameId < 0) {
         return GLOB_ERROR_INVALID_PARAMETERS;
     }
     
@@ -228,13 +322,12 @@ GLOB_ERROR SYMTABLE_Insert(HSYMTABLE_TABLE hTable,
     }
     
     /* Check if the symbol is already exist */
-    nIndex = symtable_FindSymbol(hTable, pszName);
+    nIndex = symtable_FindSymbol(hTable, nNameId);
     if (-1 != nIndex) {
         /* Symbol already exist in the table, there are some cases... */
         
         /* check if it exist because previous call to SYMTABLE_Insert */
-        if (hTable->patTable[nIndex].bIsExtern
-            || 0 != hTable->patTable[nIndex].nAddress) {
+        if (hTable->patTable[nIndex].bIsDefined) {
             /* Symbol already exist (as regular or extern) */
             return GLOB_ERROR_ALREADY_EXIST;
         }
@@ -248,22 +341,23 @@ GLOB_ERROR SYMTABLE_Insert(HSYMTABLE_TABLE hTable,
         /* Update the record of the symbol */
         hTable->patTable[nIndex].eType = eType;
         hTable->patTable[nIndex].nAddress = nAddress;
+        hTable->patTable[nIndex].bIsDefined = TRUE;
         return GLOB_SUCCESS;
     }
     
     /* Insert a new symbol to the table */
-    return symtable_InsertRecord(hTable, pszName, eType,
+    return symtable_InsertRecord(hTable, nNameId, eType,
                                  nAddress, bIsExtern, FALSE);
 }
 
 /******************************************************************************
  * Name:    SYMTABLE_MarkForExport
  *****************************************************************************/
-GLOB_ERROR SYMTABLE_MarkForExport(HSYMTABLE_TABLE hTable, const char *pszName) {
+GLOB_ERROR SYMTABLE_MarkForExport(HSYMTABLE_TABLE hTable, int nNameId) {
     int nIndex = 0;
     
     /* Check parameters */
-    if (NULL == hTable) {
+    if (NULL == hTable || nNameId < 0) {
         return GLOB_ERROR_INVALID_PARAMETERS;
     }
     
@@ -273,10 +367,10 @@ GLOB_ERROR SYMTABLE_MarkForExport(HSYMTABLE_TABLE hTable, const char *pszName) {
     }
     
     /* Check if the symbol already exist in the table */
-    nIndex = symtable_FindSymbol(hTable, pszName);
+    nIndex = symtable_FindSymbol(hTable, nNameId);
     if (nIndex == -1) {
         /* Symbol not found. just add it. */
-        return symtable_InsertRecord(hTable, pszName,
+        return symtable_InsertRecord(hTable, nNameId,
                 SYMTABLE_SYMTYPE_CODE /*Unused*/, 0, FALSE, TRUE);
     }
     
@@ -313,8 +407,7 @@ GLOB_ERROR SYMTABLE_Finalize(HSYMTABLE_TABLE hTable, int nDataOffset) {
     for (int nIndex = 0; nIndex < hTable->nUsedRecords; nIndex++) {
         
         /* Check if all export symbols got a value */
-        if (0 == hTable->patTable[nIndex].nAddress
-            && hTable->patTable[nIndex].bMarkedForExport) {
+        if (!hTable->patTable[nIndex].bIsDefined) {
             return GLOB_ERROR_NOT_FOUND;
         }
         
@@ -333,7 +426,7 @@ GLOB_ERROR SYMTABLE_Finalize(HSYMTABLE_TABLE hTable, int nDataOffset) {
  * Name:    SYMTABLE_GetSymbolInfo
  *****************************************************************************/
 GLOB_ERROR SYMTABLE_GetSymbolInfo(HSYMTABLE_TABLE hTable,
-                                  const char *pszName,
+                                  int nNameId,
                                   int *pnAddress,
                                   BOOL *pbIsExtern) {
     int nIndex = 0;
@@ -349,7 +442,7 @@ GLOB_ERROR SYMTABLE_GetSymbolInfo(HSYMTABLE_TABLE hTable,
     }
     
     /* Search the symbol */
-    nIndex = symtable_FindSymbol(hTable, pszName);
+    nIndex = symtable_FindSymbol(hTable, nNameId);
     if (nIndex == -1) {
         return GLOB_ERROR_NOT_FOUND;
     }
@@ -360,6 +453,29 @@ GLOB_ERROR SYMTABLE_GetSymbolInfo(HSYMTABLE_TABLE hTable,
     return GLOB_SUCCESS;
 }
 
+/******************************************************************************
+ * Name:    SYMTABLE_GetCodeAddress
+ *****************************************************************************/
+GLOB_ERROR SYMTABLE_GetCodeAddress(HSYMTABLE_TABLE hTable,
+                                   int nNameId,
+                                   int *pnAddress) {
+    int nIndex = 0;
+    
+    /* Check parameters */
+    if (NULL == hTable || NULL == pnAddress) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Only the address of a code symbol is final before the finalization */
+    *pnAddress = 0;
+    nIndex = symtable_FindSymbol(hTable, nNameId);
+    if (nIndex != -1 && !hTable->patTable[nIndex].bIsExtern
+            && SYMTABLE_SYMTYPE_CODE == hTable->patTable[nIndex].eType) {
+        *pnAddress = hTable->patTable[nIndex].nAddress;
+    }
+    return GLOB_SUCCESS;
+}
+
 /******************************************************************************
  * Name:    SYMTABLE_ForEach
  *****************************************************************************/
@@ -367,6 +483,7 @@ GLOB_ERROR SYMTABLE_ForEach(HSYMTABLE_TABLE hTable,
                             SYMTABLE_FOREACH_CALLBACK pfCallback,
                             void * pvContext) {
     GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    PSYMTABLE_RECORD ptRecord = NULL;
     
     /* Check parameters */
     if (NULL == hTable) {
@@ -380,9 +497,10 @@ GLOB_ERROR SYMTABLE_ForEach(HSYMTABLE_TABLE hTable,
     
     /* Call to the callback for each record */
     for (int nIndex = 0; nIndex < hTable->nUsedRecords; nIndex++) {
-        eRetValue = pfCallback(hTable->patTable[nIndex].pszName,
-                hTable->patTable[nIndex].nAddress,
-                hTable->patTable[nIndex].bMarkedForExport,
+        ptRecord = &hTable->patTable[nIndex];
+        eRetValue = pfCallback(INTERN_GetName(hTable->hNames, ptRecord->nNameId),
+                ptRecord->nAddress,
+                ptRecord->bMarkedForExport,
                 pvContext);
         if (eRetValue) {
             return eRetValue;
@@ -399,14 +517,9 @@ void SYMTABLE_Free(HSYMTABLE_TABLE hTable) {
         return;
     }
     
-    /* free the strings of the symbols name */
-    for (int nIndex = 0; nIndex < hTable->nUsedRecords; nIndex++) {
-        if (NULL != hTable->patTable[nIndex].pszName) {
-            free(hTable->patTable[nIndex].pszName);
-        }
-    } 
-    
-    /* free the array and the main structure. */
+    /* free the arrays and the main structure. The names are owned by the
+     * caller. */
+    free(hTable->panIndex);
     free(hTable->patTable);
     free(hTable);
 }
@@ -3,6 +3,8 @@
  * Author:  Doron Shvartztuch
  * The SYMTABLE module provides functions to create and manipulate
  * the symbols table.
+ * The symbols are identified by the ids of their names in a table of names
+ * (see INTERN).
  *****************************************************************************/
 
 #ifndef SYMTABLE_H
@@ -12,6 +14,7 @@
  * INCLUDES
  *****************************************************************************/
 #include "global.h"
+#include "intern.h"
 
 /******************************************************************************
  * TYPEDEFS
@@ -52,6 +55,8 @@ typedef struct SYMTABLE_TABLE SYMTABLE_TABLE, *HSYMTABLE_TABLE;
  * Name:    SYMTABLE_Create
  * Purpose: Creates a new symbols table
  * Parameters:
+ *          hNames [IN] - the table of the names of the symbols. It must be
+ *                        valid until the call to SYMTABLE_Free.
  *          phTable [OUT] - the handle to the created symbols table
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
@@ -59,14 +64,14 @@ typedef struct SYMTABLE_TABLE SYMTABLE_TABLE, *HSYMTABLE_TABLE;
  *          the caller must free it with SYMTABLE_Free.
  *          If the function fails, an error code is returned.
  *****************************************************************************/
-GLOB_ERROR SYMTABLE_Create(HSYMTABLE_TABLE *phTable);
+GLOB_ERROR SYMTABLE_Create(HINTERN_TABLE hNames, HSYMTABLE_TABLE *phTable);
 
 /******************************************************************************
  * Name:    SYMTABLE_Insert
  * Purpose: Inserts a symbol to the symbols table
  * Parameters:
  *          hTable [IN] - the handle to the symbols table
- *          pszName [IN] - the symbol name to insert
+ *          nNameId [IN] - the id of the symbol name to insert
  *          eType [IN] - the type of the symbol. meaningless for extern symbols
  *          nAddress [IN] - the address of the symbol. 0 for extern symbols
  *          bIsExtern [IN] - whether the symbol is declared as extern.
@@ -82,7 +87,7 @@ GLOB_ERROR SYMTABLE_Create(HSYMTABLE_TABLE *phTable);
  *          SYMTABLE_MarkForExport. You can call them in any order.
  *****************************************************************************/
 GLOB_ERROR SYMTABLE_Insert(HSYMTABLE_TABLE hTable,
-                           const char *pszName,
+                           int nNameId,
                            SYMTABLE_SYMTYPE eType,
                            int nAddress,
                            BOOL bIsExtern);
@@ -92,7 +97,7 @@ GLOB_ERROR SYMTABLE_Insert(HSYMTABLE_TABLE hTable,
  * Purpose: Mark a symbol for export
  * Parameters:
  *          hTable [IN] - the handle to the symbols table
- *          pszName [IN] - the symbol name to export
+ *          nNameId [IN] - the id of the symbol name to export
  * Return Value:
  *          Upon successful completion, GLOB_SUCCESS is returned.
  *          GLOB_ERROR_INVALID_STATE - The table is already finalized.
@@ -105,7 +110,7 @@ GLOB_ERROR SYMTABLE_Insert(HSYMTABLE_TABLE hTable,
  *          For symbols to export, you have to call both SYMTABLE_Insert and
  *          SYMTABLE_MarkForExport. You can call them in any order.
  *****************************************************************************/
-GLOB_ERROR SYMTABLE_MarkForExport(HSYMTABLE_TABLE hTable, const char *pszName);
+GLOB_ERROR SYMTABLE_MarkForExport(HSYMTABLE_TABLE hTable, int nNameId);
 
 /******************************************************************************
  * Name:    SYMTABLE_Finalize
@@ -131,7 +136,7 @@ GLOB_ERROR SYMTABLE_Finalize(HSYMTABLE_TABLE hTable, int nDataOffset);
  * Purpose: Gets information about a symbol
  * Parameters:
  *          hTable [IN] - the handle to the symbols table
- *          pszName [IN] - the symbol name to read
+ *          nNameId [IN] - the id of the symbol name to read
  *          pnAddress [OUT] - the address of the symbol
  *          pbIsExtern [OUT] - whether the symbol is declared as extern.
  * Return Value:
@@ -145,10 +150,30 @@ GLOB_ERROR SYMTABLE_Finalize(HSYMTABLE_TABLE hTable, int nDataOffset);
  *          SYMTABLE_MarkForExport. You can call them in any order.
  *****************************************************************************/
 GLOB_ERROR SYMTABLE_GetSymbolInfo(HSYMTABLE_TABLE hTable,
-                                  const char *pszName,
+                                  int nNameId,
                                   int *pnAddress,
                                   BOOL *pbIsExtern);
 
+/******************************************************************************
+ * Name:    SYMTABLE_GetCodeAddress
+ * Purpose: Get the address of a code symbol, before the table is finalized
+ * Parameters:
+ *          hTable [IN] - the handle to the symbols table
+ *          nNameId [IN] - the id of the symbol name
+ *          pnAddress [OUT] - the address of the symbol, if it is already
+ *                            inserted as a code symbol (not extern).
+ *                            Otherwise, 0.
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ * Remarks:
+ *          The address of code symbols is not changed by SYMTABLE_Finalize,
+ *          so it is already final.
+ *****************************************************************************/
+GLOB_ERROR SYMTABLE_GetCodeAddress(HSYMTABLE_TABLE hTable,
+                                   int nNameId,
+                                   int *pnAddress);
+
 /******************************************************************************
  * Name:    SYMTABLE_ForEach
  * Purpose: Enumerate all symbols marked for export
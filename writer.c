@@ -0,0 +1,305 @@
+/******************************************************************************
+ * File:    writer.c
+ * Author:  Doron Shvartztuch
+ * The WRITER module writes the output files of compiled files by background
+ * threads.
+ *
+ * Implementation:
+ * The submitted files are kept in a small circular queue, protected by one
+ * lock. Each thread takes the next file, writes its output files with
+ * OUTPUT_WriteFiles (the formatting of the object file is done by the thread
+ * too), and the packed object file if it was asked for, closes it and calls
+ * the done callback of the file with the result, so the caller can report
+ * the file as soon as it is written. The queue is bounded, so a slow disk
+ * can't make us keep the compiled files of all the command line in the
+ * memory.
+ * The first error is kept and returned by the next call to WRITER_Submit or
+ * WRITER_Close. After an error, the queued files are closed without writing.
+ * Each thread collects its statistics into its own structure, which is added
+ * to the total by WRITER_Close.
+ *****************************************************************************/
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "global.h"
+#include "asm.h"
+#include "output.h"
+#include "stats.h"
+#include "writer.h"
+
+/******************************************************************************
+ * CONSTANTS & MACROS
+ *****************************************************************************/
+
+/* The maximum number of files that wait in the queue */
+#define WRITER_MAX_QUEUED 4
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* A file to write */
+typedef struct WRITER_FILE {
+    /* The file name (w/o extension) */
+    const char * pszFileName;
+    
+    /* The compiled file */
+    HASM_FILE hFile;
+    
+    /* The callback to call when the file is written, and its context */
+    WRITER_DONECALLBACK pfnDoneCallback;
+    void * pvContext;
+} WRITER_FILE, *PWRITER_FILE;
+
+/* A writing thread */
+typedef struct WRITER_THREAD {
+    pthread_t tThread;
+    
+    /* The writer of the thread */
+    HWRITER hWriter;
+    
+    /* The statistics of the thread */
+    STATS tStats;
+} WRITER_THREAD, *PWRITER_THREAD;
+
+/* WRITER is the struct behind the HWRITER.
+ * All the fields of the queue are protected by tLock. */
+struct WRITER {
+    pthread_mutex_t tLock;
+    
+    /* Signaled when a file is queued or when the threads should stop */
+    pthread_cond_t tQueued;
+    
+    /* Signaled when a file is taken from the queue */
+    pthread_cond_t tTaken;
+    
+    /* The circular queue of the files */
+    WRITER_FILE atQueue[WRITER_MAX_QUEUED];
+    int nFirst;
+    int nQueued;
+    
+    /* Set to stop the threads when the queue is empty */
+    BOOL bStop;
+    
+    /* The first error of writing a file */
+    GLOB_ERROR eError;
+    
+    /* TRUE if the threads should collect statistics */
+    BOOL bCollectStats;
+    
+    /* TRUE if the packed object files should be written too */
+    BOOL bWritePacked;
+    
+    /* The threads */
+    PWRITER_THREAD patThreads;
+    int nThreads;
+};
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS (prototypes)
+ * -------------------------------
+ * See function-level documentation next to the implementation below
+ *****************************************************************************/
+static void * writer_Thread(void * pvThread);
+
+/******************************************************************************
+ * INTERNAL FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    writer_Thread
+ * Purpose: The entry point of a writing thread. The thread writes the queued
+ *          files until the writer is closed.
+ * Parameters:
+ *          pvThread [IN] - pointer to the WRITER_THREAD of the thread
+ * Return Value:
+ *          NULL
+ *****************************************************************************/
+static void * writer_Thread(void * pvThread) {
+    PWRITER_THREAD ptThread = (PWRITER_THREAD)pvThread;
+    HWRITER hWriter = ptThread->hWriter;
+    WRITER_FILE tFile;
+    GLOB_ERROR eRetValue = GLOB_SUCCESS;
+    
+    STATS_SetCurrent(hWriter->bCollectStats ? &ptThread->tStats : NULL);
+    while (TRUE) {
+        /* Take the next file */
+        pthread_mutex_lock(&hWriter->tLock);
+        while (0 == hWriter->nQueued && !hWriter->bStop) {
+            pthread_cond_wait(&hWriter->tQueued, &hWriter->tLock);
+        }
+        if (0 == hWriter->nQueued) {
+            pthread_mutex_unlock(&hWriter->tLock);
+            break;
+        }
+        tFile = hWriter->atQueue[hWriter->nFirst];
+        hWriter->nFirst = (hWriter->nFirst + 1) % WRITER_MAX_QUEUED;
+        hWriter->nQueued--;
+        eRetValue = hWriter->eError;
+        pthread_cond_signal(&hWriter->tTaken);
+        pthread_mutex_unlock(&hWriter->tLock);
+        
+        /* Write the files, unless we already failed */
+        if (GLOB_SUCCESS == eRetValue) {
+            eRetValue = OUTPUT_WriteFiles(tFile.pszFileName, tFile.hFile);
+            if (GLOB_SUCCESS == eRetValue && hWriter->bWritePacked) {
+                eRetValue = OUTPUT_WritePacked(tFile.pszFileName, tFile.hFile);
+            }
+            if (eRetValue) {
+                pthread_mutex_lock(&hWriter->tLock);
+                if (GLOB_SUCCESS == hWriter->eError) {
+                    hWriter->eError = eRetValue;
+                }
+                pthread_mutex_unlock(&hWriter->tLock);
+            }
+        }
+        ASM_Close(tFile.hFile);
+        if (NULL != tFile.pfnDoneCallback) {
+            tFile.pfnDoneCallback(tFile.pvContext, eRetValue);
+        }
+    }
+    STATS_SetCurrent(NULL);
+    return NULL;
+}
+
+/******************************************************************************
+ * EXTERNAL FUNCTIONS
+ * ------------------
+ * See function-level documentation in the header file
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    WRITER_Create
+ *****************************************************************************/
+GLOB_ERROR WRITER_Create(int nThreads,
+                         BOOL bCollectStats,
+                         BOOL bWritePacked,
+                         PHWRITER phWriter) {
+    HWRITER hWriter = NULL;
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    /* Check parameters */
+    if (nThreads < 1 || NULL == phWriter) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Allocate the handle and the threads */
+    STATS_CountAllocation(STATS_MODULE_WRITER, sizeof(*hWriter));
+    hWriter = calloc(1, sizeof(*hWriter));
+    if (NULL == hWriter) {
+        return GLOB_ERROR_SYS_CALL_ERROR();
+    }
+    STATS_CountAllocation(STATS_MODULE_WRITER,
+                          nThreads * sizeof(*hWriter->patThreads));
+    hWriter->patThreads = calloc(nThreads, sizeof(*hWriter->patThreads));
+    if (NULL == hWriter->patThreads) {
+        eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+        free(hWriter);
+        return eRetValue;
+    }
+    hWriter->bCollectStats = bCollectStats;
+    hWriter->bWritePacked = bWritePacked;
+    hWriter->eError = GLOB_SUCCESS;
+    pthread_mutex_init(&hWriter->tLock, NULL);
+    pthread_cond_init(&hWriter->tQueued, NULL);
+    pthread_cond_init(&hWriter->tTaken, NULL);
+    
+    /* Start the threads */
+    for (int nIndex = 0; nIndex < nThreads; nIndex++) {
+        hWriter->patThreads[nIndex].hWriter = hWriter;
+        if (0 != pthread_create(&hWriter->patThreads[nIndex].tThread, NULL,
+                                writer_Thread, &hWriter->patThreads[nIndex])) {
+            eRetValue = GLOB_ERROR_SYS_CALL_ERROR();
+            WRITER_Close(hWriter, NULL);
+            return eRetValue;
+        }
+        hWriter->nThreads++;
+    }
+    
+    /* Set out parameter upon success */
+    *phWriter = hWriter;
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    WRITER_Submit
+ *****************************************************************************/
+GLOB_ERROR WRITER_Submit(HWRITER hWriter,
+                         const char * szFileName,
+                         HASM_FILE hFile,
+                         WRITER_DONECALLBACK pfnDoneCallback,
+                         void * pvContext) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    PWRITER_FILE ptFile = NULL;
+    
+    /* Check parameters */
+    if (NULL == hWriter || NULL == szFileName || NULL == hFile) {
+        if (NULL != hFile) {
+            ASM_Close(hFile);
+        }
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Wait for a free place in the queue */
+    pthread_mutex_lock(&hWriter->tLock);
+    while (WRITER_MAX_QUEUED == hWriter->nQueued
+           && GLOB_SUCCESS == hWriter->eError) {
+        pthread_cond_wait(&hWriter->tTaken, &hWriter->tLock);
+    }
+    eRetValue = hWriter->eError;
+    if (eRetValue) {
+        /* A previous file failed. Don't queue more files */
+        pthread_mutex_unlock(&hWriter->tLock);
+        ASM_Close(hFile);
+        return eRetValue;
+    }
+    
+    /* Queue the file */
+    ptFile = &hWriter->atQueue[(hWriter->nFirst + hWriter->nQueued)
+                               % WRITER_MAX_QUEUED];
+    ptFile->pszFileName = szFileName;
+    ptFile->hFile = hFile;
+    ptFile->pfnDoneCallback = pfnDoneCallback;
+    ptFile->pvContext = pvContext;
+    hWriter->nQueued++;
+    pthread_cond_signal(&hWriter->tQueued);
+    pthread_mutex_unlock(&hWriter->tLock);
+    return GLOB_SUCCESS;
+}
+
+/******************************************************************************
+ * Name:    WRITER_Close
+ *****************************************************************************/
+GLOB_ERROR WRITER_Close(HWRITER hWriter, PSTATS ptStats) {
+    GLOB_ERROR eRetValue = GLOB_ERROR_UNKNOWN;
+    
+    if (NULL == hWriter) {
+        return GLOB_ERROR_INVALID_PARAMETERS;
+    }
+    
+    /* Stop the threads (after the queue is empty) and wait for them */
+    pthread_mutex_lock(&hWriter->tLock);
+    hWriter->bStop = TRUE;
+    pthread_cond_broadcast(&hWriter->tQueued);
+    pthread_mutex_unlock(&hWriter->tLock);
+    for (int nIndex = 0; nIndex < hWriter->nThreads; nIndex++) {
+        pthread_join(hWriter->patThreads[nIndex].tThread, NULL);
+        if (NULL != ptStats) {
+            STATS_Add(ptStats, &hWriter->patThreads[nIndex].tStats);
+        }
+    }
+    eRetValue = hWriter->eError;
+    
+    /* Free the writer */
+    pthread_cond_destroy(&hWriter->tTaken);
+    pthread_cond_destroy(&hWriter->tQueued);
+    pthread_mutex_destroy(&hWriter->tLock);
+    free(hWriter->patThreads);
+    free(hWriter);
+    return eRetValue;
+}
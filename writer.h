@@ -0,0 +1,102 @@
+/******************************************************************************
+ * File:    writer.h
+ * Author:  Doron Shvartztuch
+ * The WRITER module writes the output files of compiled files by background
+ * threads, so the caller can compile the next file while the output files of
+ * the previous one are written.
+ *****************************************************************************/
+
+#ifndef WRITER_H
+#define WRITER_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "global.h"
+#include "asm.h"
+#include "stats.h"
+
+/******************************************************************************
+ * TYPEDEFS
+ *****************************************************************************/
+
+/* The HWRITER represents a handle to the writer and its threads.
+ * Always close the writer with the WRITER_Close function */
+typedef struct WRITER WRITER, *HWRITER, **PHWRITER;
+
+/******************************************************************************
+ * Name:    WRITER_DONECALLBACK
+ * Purpose: callback function that is called by a writing thread when the
+ *          output files of a submitted file are written (or not)
+ * Parameters:
+ *          pvContext [IN] - context as passed to WRITER_Submit
+ *          eRetValue [IN] - GLOB_SUCCESS if the files were written. Otherwise
+ *                           the error of writing them, or the error of a
+ *                           previous file (then they are not written).
+ *****************************************************************************/
+typedef void (*WRITER_DONECALLBACK)(void * pvContext, GLOB_ERROR eRetValue);
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/******************************************************************************
+ * Name:    WRITER_Create
+ * Purpose: Create a writer and start its threads
+ * Parameters:
+ *          nThreads [IN] - number of the writing threads
+ *          bCollectStats [IN] - TRUE if the threads should collect statistics
+ *                               (see WRITER_Close)
+ *          bWritePacked [IN] - TRUE if the packed object file (see
+ *                              OUTPUT_WritePacked) should be written too
+ *          phWriter [OUT] - the handle to the created writer
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If the function fails, an error code is returned.
+ *****************************************************************************/
+GLOB_ERROR WRITER_Create(int nThreads,
+                         BOOL bCollectStats,
+                         BOOL bWritePacked,
+                         PHWRITER phWriter);
+
+/******************************************************************************
+ * Name:    WRITER_Submit
+ * Purpose: Queue the output files of a successfully compiled file for
+ *          writing (see OUTPUT_WriteFiles). The compiled file is closed
+ *          after its files are written.
+ * Parameters:
+ *          hWriter [IN] - the handle to the writer
+ *          szFileName [IN] - the file name (w/o extension). It should be
+ *                            valid until the call to WRITER_Close.
+ *          hFile [IN] - handle to the compiled file. The writer owns it
+ *                       from now on, also if the function fails.
+ *          pfnDoneCallback [IN OPTIONAL] - called when the files are written
+ *          pvContext [IN] - context for the callback function
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          In this case, the callback is called once for the file.
+ *          If the function fails, an error code is returned. It may be the
+ *          error of writing the files of a previously submitted file.
+ * Remark:  The function waits if too many files are already queued.
+ *****************************************************************************/
+GLOB_ERROR WRITER_Submit(HWRITER hWriter,
+                         const char * szFileName,
+                         HASM_FILE hFile,
+                         WRITER_DONECALLBACK pfnDoneCallback,
+                         void * pvContext);
+
+/******************************************************************************
+ * Name:    WRITER_Close
+ * Purpose: Wait until all the queued files are written and free the writer
+ * Parameters:
+ *          hWriter [IN] - the handle to the writer
+ *          ptStats [IN OUT OPTIONAL] - the statistics of the writing threads
+ *                                      are added to it
+ * Return Value:
+ *          Upon successful completion, GLOB_SUCCESS is returned.
+ *          If writing the files of one of the submitted files failed, the
+ *          first error is returned. The writer is freed in any case.
+ *****************************************************************************/
+GLOB_ERROR WRITER_Close(HWRITER hWriter, PSTATS ptStats);
+
+#endif /* WRITER_H */